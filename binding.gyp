@@ -1,15 +1,96 @@
 {
 	"variables": {
 		"js_rtlsdr_sources": [
+			"lib/addon/addon_env.cc",
+			"lib/addon/buffer_pool.cc",
+			"lib/addon/burst_capture.cc",
+			"lib/addon/capture_group.cc",
+			"lib/addon/channelizer.cc",
+			"lib/addon/command_queue.cc",
+			"lib/addon/convert.cc",
+			"lib/addon/demod.cc",
+			"lib/addon/device_backend.cc",
+			"lib/addon/device_context.cc",
+			"lib/addon/device_settings.cc",
+			"lib/addon/device_task.cc",
+			"lib/addon/energy_squelch.cc",
+			"lib/addon/fft.cc",
+			"lib/addon/file_device.cc",
+			"lib/addon/fir.cc",
+			"lib/addon/iq_correct.cc",
+			"lib/addon/reader_options.cc",
+			"lib/addon/recorder.cc",
+			"lib/addon/resampler.cc",
 			"lib/addon/rtlsdr_wrapper.cc",
-			"lib/addon/sample_reader.cc"
+			"lib/addon/sample_queue.cc",
+			"lib/addon/sample_reader.cc",
+			"lib/addon/sample_ring.cc",
+			"lib/addon/spectrum.cc",
+			"lib/addon/stream_aligner.cc",
+			"lib/addon/stream_stats.cc",
+			"lib/addon/sweep.cc"
 		],
 		"js_rtlsdr_addon_test_sources": [
 			"test/addon/mock_helper.cc",
 			"test/include/rtl-sdr.cc"
 		],
 		"js_rtlsdr_cpp_test_sources": [
+			"lib/addon/buffer_pool.cc",
+			"lib/addon/burst_capture.cc",
+			"lib/addon/channelizer.cc",
+			"lib/addon/convert.cc",
+			"lib/addon/demod.cc",
+			"lib/addon/device_backend.cc",
+			"lib/addon/device_settings.cc",
+			"lib/addon/energy_squelch.cc",
+			"lib/addon/fft.cc",
+			"lib/addon/file_device.cc",
+			"lib/addon/fir.cc",
+			"lib/addon/iq_correct.cc",
+			"lib/addon/recorder.cc",
+			"lib/addon/resampler.cc",
+			"lib/addon/sample_queue.cc",
+			"lib/addon/sample_ring.cc",
+			"lib/addon/spectrum.cc",
+			"lib/addon/stream_aligner.cc",
+			"lib/addon/stream_stats.cc",
+			"lib/addon/sweep.cc",
+			"test/cpp/buffer_pool.cc",
+			"test/cpp/burst_capture.cc",
+			"test/cpp/channelizer.cc",
+			"test/cpp/convert.cc",
+			"test/cpp/demod.cc",
+			"test/cpp/device_settings.cc",
+			"test/cpp/energy_squelch.cc",
+			"test/cpp/fft.cc",
+			"test/cpp/file_device.cc",
+			"test/cpp/iq_correct.cc",
 			"test/cpp/main.cc",
+			"test/cpp/mock_source.cc",
+			"test/cpp/recorder.cc",
+			"test/cpp/resampler.cc",
+			"test/cpp/sample_queue.cc",
+			"test/cpp/sample_ring.cc",
+			"test/cpp/spectrum.cc",
+			"test/cpp/stream_aligner.cc",
+			"test/cpp/stream_stats.cc",
+			"test/cpp/sweep.cc",
+			"test/include/rtl-sdr.cc"
+		],
+		"js_rtlsdr_cpp_bench_sources": [
+			"lib/addon/buffer_pool.cc",
+			"lib/addon/channelizer.cc",
+			"lib/addon/convert.cc",
+			"lib/addon/demod.cc",
+			"lib/addon/energy_squelch.cc",
+			"lib/addon/fft.cc",
+			"lib/addon/fir.cc",
+			"lib/addon/iq_correct.cc",
+			"lib/addon/resampler.cc",
+			"lib/addon/sample_queue.cc",
+			"lib/addon/spectrum.cc",
+			"lib/addon/stream_stats.cc",
+			"test/bench/native.cc",
 			"test/include/rtl-sdr.cc"
 		]
 	},
@@ -52,6 +133,20 @@
 					"<!(node -e \"require('@bchociej/catch')\")",
 				]
 			}]
+		}],
+		['"<!(echo $JS_RTLSDR_BUILD_CPP_BENCH)"=="yes"', {
+			"targets": [{
+				"target_name": "js-rtlsdr-addon-cpp-bench",
+				"type":        "executable",
+				"cflags!":     ["-fno-exceptions"],
+				"cflags_cc!":  ["-fno-exceptions"],
+				"sources": [
+					"<@(js_rtlsdr_cpp_bench_sources)",
+				],
+				"include_dirs": [
+					"test/include"
+				]
+			}]
 		}]
 	]
 }
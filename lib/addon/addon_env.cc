@@ -0,0 +1,75 @@
+#include <algorithm>
+
+#include "addon_env.h"
+#include "device_backend.h"
+#include "device_context.h"
+
+std::mutex AddonEnv::registry_mutex;
+std::map<v8::Isolate *, AddonEnv *> AddonEnv::registry;
+
+/* static */ void AddonEnv::Init(v8::Isolate * isolate) {
+	std::lock_guard<std::mutex> registry_lock(AddonEnv::registry_mutex);
+	if(AddonEnv::registry.count(isolate) > 0) return;
+
+#ifdef JS_RTLSDR_CONTEXT_AWARE
+	AddonEnv * env = new AddonEnv(isolate, node::GetCurrentEventLoop(isolate));
+	node::AddEnvironmentCleanupHook(isolate, &AddonEnv::Cleanup, env);
+#else
+	AddonEnv * env = new AddonEnv(isolate, uv_default_loop());
+#endif
+
+	AddonEnv::registry[isolate] = env;
+}
+
+/* static */ AddonEnv * AddonEnv::Current() {
+	std::lock_guard<std::mutex> registry_lock(AddonEnv::registry_mutex);
+	return AddonEnv::registry[v8::Isolate::GetCurrent()];
+}
+
+void AddonEnv::InitAsync(uv_async_t * async, uv_async_cb async_cb, uv_close_cb close_cb) {
+	uv_async_init(this->loop, async, async_cb);
+	this->handles[async] = close_cb;
+}
+
+void AddonEnv::CloseAsync(uv_async_t * async) {
+	std::map<uv_async_t *, uv_close_cb>::iterator it = this->handles.find(async);
+	if(it == this->handles.end()) return;
+
+	const uv_close_cb close_cb = it->second;
+	this->handles.erase(it);
+	uv_close(reinterpret_cast<uv_handle_t *>(async), close_cb);
+}
+
+void AddonEnv::Adopt(DeviceContext * ctx) {
+	this->devices.push_back(ctx);
+}
+
+void AddonEnv::Forget(DeviceContext * ctx) {
+	this->devices.erase(std::remove(this->devices.begin(), this->devices.end(), ctx), this->devices.end());
+}
+
+// JS thread, as the environment is torn down: its isolate is still alive, but no more JS will run in it
+/* static */ void AddonEnv::Cleanup(void * arg) {
+	AddonEnv * env = static_cast<AddonEnv *>(arg);
+
+	{
+		std::lock_guard<std::mutex> registry_lock(AddonEnv::registry_mutex);
+		AddonEnv::registry.erase(env->isolate);
+	}
+
+	// joining every capture and control thread stops everything that could signal a handle
+	for(size_t i = 0; i < env->devices.size(); i++) {
+		DeviceContext * ctx = env->devices[i];
+		ctx->Shutdown();
+		backend_close(ctx->Device());
+		delete ctx;
+	}
+
+	// whatever was still to be delivered is dropped with its handle, and the close callbacks free the owners
+	for(std::map<uv_async_t *, uv_close_cb>::iterator it = env->handles.begin(); it != env->handles.end(); ++it)
+		uv_close(reinterpret_cast<uv_handle_t *>(it->first), it->second);
+
+	// run them now, before the environment closes its loop
+	uv_run(env->loop, UV_RUN_NOWAIT);
+	delete env;
+}
@@ -0,0 +1,58 @@
+#ifndef JS_RTLSDR_ADDON_ENV_GRAB_H
+#define JS_RTLSDR_ADDON_ENV_GRAB_H
+
+#include <node.h>
+#include <uv.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Node.js 10.7 brought NODE_MODULE_INIT, and with it every per-environment hook used here; older versions have a
+// single environment, on the default loop
+#ifdef NODE_MODULE_INIT
+#define JS_RTLSDR_CONTEXT_AWARE (1)
+#endif
+
+class DeviceContext;
+
+// The addon's state in one Node.js environment: the main thread's, or that of a worker_threads Worker, each of which
+// loads the addon into its own isolate and runs its own event loop. Readers, tasks, and capture groups wake their
+// JS thread through a uv_async_t on the loop of the environment that created them, never uv_default_loop(), and
+// register it here. When the environment is torn down (its Worker exits), its open devices are shut down and
+// closed first, which stops every producer, and then every handle still registered is closed with the callback that
+// frees its owner, so nothing outlives the loop or calls into the departing isolate.
+class AddonEnv {
+public:
+	// JS thread, from the module initializer: set up the calling isolate's environment, once per environment
+	static void Init(v8::Isolate * isolate);
+
+	// JS thread: the calling isolate's environment
+	static AddonEnv * Current(void);
+
+	uv_loop_t * Loop(void) const { return this->loop; }
+
+	// JS thread: uv_async_init async on this environment's loop; close_cb frees the handle and its owner
+	void InitAsync(uv_async_t * async, uv_async_cb async_cb, uv_close_cb close_cb);
+
+	// JS thread: uv_close a handle from InitAsync with its close_cb
+	void CloseAsync(uv_async_t * async);
+
+	// JS thread: a device was opened in this environment / is about to be closed
+	void Adopt(DeviceContext * ctx);
+	void Forget(DeviceContext * ctx);
+
+private:
+	AddonEnv(v8::Isolate * isolate, uv_loop_t * loop) : isolate(isolate), loop(loop) {}
+
+	static void Cleanup(void * arg);
+
+	v8::Isolate * const isolate;
+	uv_loop_t * const   loop;
+	std::map<uv_async_t *, uv_close_cb> handles;
+	std::vector<DeviceContext *> devices;
+
+	static std::mutex registry_mutex;
+	static std::map<v8::Isolate *, AddonEnv *> registry;
+};
+
+#endif
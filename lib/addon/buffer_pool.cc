@@ -0,0 +1,199 @@
+#include <atomic>
+#include <algorithm>
+#include "buffer_pool.h"
+
+std::mutex BufferPool::registry_mutex;
+std::vector<BufferPool *> BufferPool::registry;
+
+// shared by every pool so a stale lease can never match a slab in a newer pool at the same address
+static std::atomic<uintptr_t> next_generation(1);
+
+/* static */ BufferPool * BufferPool::Create(size_t slab_size, size_t slab_count) {
+	BufferPool * pool = new BufferPool(slab_size, slab_count);
+
+	std::lock_guard<std::mutex> registry_lock(BufferPool::registry_mutex);
+	BufferPool::registry.push_back(pool);
+	return pool;
+}
+
+BufferPool::BufferPool(size_t slab_size, size_t slab_count)
+	: slab_size(slab_size),
+	  stride((slab_size + BUFFER_POOL_ALIGNMENT - 1) & ~((size_t) BUFFER_POOL_ALIGNMENT - 1)),
+	  slabs(slab_count < 1 ? 1 : slab_count) {
+	this->memory = new uint8_t[this->stride * this->slabs.size() + BUFFER_POOL_ALIGNMENT];
+	this->base = (uint8_t *) (((uintptr_t) this->memory + BUFFER_POOL_ALIGNMENT - 1)
+	                          & ~((uintptr_t) BUFFER_POOL_ALIGNMENT - 1));
+
+	this->free_list.reserve(this->slabs.size());
+	for(size_t i = this->slabs.size(); i > 0; i--)
+		this->free_list.push_back(i - 1);
+}
+
+BufferPool::~BufferPool() {
+	delete [] this->memory;
+}
+
+uint8_t * BufferPool::Acquire() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if(this->free_list.empty()) return NULL;
+
+	const size_t index = this->free_list.back();
+	this->free_list.pop_back();
+	this->slabs[index].busy = true;
+
+	return this->base + index * this->stride;
+}
+
+void BufferPool::Recycle(uint8_t * data) {
+	bool should_delete;
+
+	{
+		std::lock_guard<std::mutex> registry_lock(BufferPool::registry_mutex);
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->Free((size_t) (data - this->base) / this->stride);
+		should_delete = this->ShouldDelete();
+	}
+
+	if(should_delete) delete this;
+}
+
+void BufferPool::Share(uint8_t * data, unsigned holders) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->slabs[(size_t) (data - this->base) / this->stride].refs = holders;
+}
+
+void BufferPool::Unref(uint8_t * data) {
+	bool should_delete;
+
+	{
+		std::lock_guard<std::mutex> registry_lock(BufferPool::registry_mutex);
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		const size_t index = (size_t) (data - this->base) / this->stride;
+		if(this->slabs[index].refs > 0) this->slabs[index].refs--;
+
+		this->Free(index);
+		should_delete = this->ShouldDelete();
+	}
+
+	if(should_delete) delete this;
+}
+
+uintptr_t BufferPool::Lend(uint8_t * data) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	pool_slab_t & slab = this->slabs[(size_t) (data - this->base) / this->stride];
+
+	slab.generation = next_generation++;
+	slab.lent = true;
+	this->buffers_alive++;
+	this->leases++;
+
+	return slab.generation;
+}
+
+/* static */ size_t BufferPool::Return(const uint8_t * data, uintptr_t generation) {
+	BufferPool * pool;
+	size_t index, slab_size = 0;
+	bool should_delete = false;
+
+	{
+		std::lock_guard<std::mutex> registry_lock(BufferPool::registry_mutex);
+		pool = BufferPool::Find(data, &index);
+		if(pool == NULL) return 0;
+
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		pool_slab_t & slab = pool->slabs[index];
+
+		// a stale generation means the slab was explicitly released and has since been lent again
+		if(slab.lent && slab.generation == generation) {
+			slab.lent = false;
+			pool->leases--;
+			pool->Free(index);
+		}
+
+		pool->buffers_alive--;
+		slab_size = pool->slab_size;
+		should_delete = pool->ShouldDelete();
+	}
+
+	if(should_delete) delete pool;
+	return slab_size;
+}
+
+/* static */ bool BufferPool::Release(const uint8_t * data) {
+	std::lock_guard<std::mutex> registry_lock(BufferPool::registry_mutex);
+	size_t index;
+
+	BufferPool * pool = BufferPool::Find(data, &index);
+	if(pool == NULL) return false;
+
+	std::lock_guard<std::mutex> lock(pool->mutex);
+	pool_slab_t & slab = pool->slabs[index];
+	if(!slab.lent) return false;
+
+	// the Buffer itself stays alive (and keeps the pool alive) until it is collected
+	slab.lent = false;
+	pool->leases--;
+	pool->Free(index);
+	return true;
+}
+
+void BufferPool::Orphan() {
+	bool should_delete;
+
+	{
+		std::lock_guard<std::mutex> registry_lock(BufferPool::registry_mutex);
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		this->orphaned = true;
+		should_delete = this->ShouldDelete();
+	}
+
+	if(should_delete) delete this;
+}
+
+size_t BufferPool::FreeCount() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->free_list.size();
+}
+
+size_t BufferPool::LentCount() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->leases;
+}
+
+// caller holds registry_mutex
+/* static */ BufferPool * BufferPool::Find(const uint8_t * data, size_t * index) {
+	for(size_t i = 0; i < BufferPool::registry.size(); i++) {
+		BufferPool * pool = BufferPool::registry[i];
+		if(data < pool->base || data >= pool->base + pool->stride * pool->slabs.size()) continue;
+
+		const size_t offset = (size_t) (data - pool->base);
+		if(offset % pool->stride != 0) return NULL;
+
+		*index = offset / pool->stride;
+		return pool;
+	}
+
+	return NULL;
+}
+
+// caller holds mutex; a slab that is still shared or lent stays busy
+void BufferPool::Free(size_t index) {
+	pool_slab_t & slab = this->slabs[index];
+	if(!slab.busy || slab.refs > 0 || slab.lent) return;
+
+	slab.busy = false;
+	this->free_list.push_back(index);
+}
+
+// caller holds registry_mutex and mutex; unregisters the pool if it should be deleted
+bool BufferPool::ShouldDelete() {
+	if(!this->orphaned || this->buffers_alive > 0 || this->free_list.size() < this->slabs.size())
+		return false;
+
+	std::vector<BufferPool *> & registry = BufferPool::registry;
+	registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+	return true;
+}
@@ -0,0 +1,86 @@
+#ifndef JS_RTLSDR_BUFFER_POOL_GRAB_H
+#define JS_RTLSDR_BUFFER_POOL_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <vector>
+
+#define BUFFER_POOL_DEFAULT_SLAB_SIZE (16 * 32 * 512) // librtlsdr's DEFAULT_BUF_LENGTH
+#define BUFFER_POOL_DEFAULT_SLAB_COUNT (15)           // librtlsdr's DEFAULT_BUF_NUMBER
+#define BUFFER_POOL_ALIGNMENT (64)
+
+typedef struct pool_slab {
+	uintptr_t generation = 0; // lease generation; bumped every time the slab is lent to JS
+	bool      busy = false;   // acquired and not yet returned to the free list
+	bool      lent = false;   // the current lease is still held by JS
+	unsigned  refs = 0;       // native holders of a shared slab besides its lease
+} pool_slab_t;
+
+// Fixed set of preallocated, equally-sized slabs. The capture thread acquires a slab per transfer; the main thread
+// lends it to JS as an external Buffer, and the slab comes back when that Buffer is collected or explicitly
+// released. A slab may also be shared by several native holders, such as the pipelines of a fan-out, and then only
+// comes back once each of them has let go of it, and its lease, if it was lent, has ended. A pool is deleted only
+// after its owner has orphaned it and every slab and Buffer has come back, so a Buffer can never outlive the memory
+// it points at.
+class BufferPool {
+public:
+	static BufferPool * Create(size_t slab_size, size_t slab_count);
+
+	// capture thread: take a free slab, or NULL if every slab is busy
+	uint8_t * Acquire(void);
+
+	// either thread: return a slab that was acquired but never lent
+	void Recycle(uint8_t * data);
+
+	// capture thread: hand a slab just acquired to holders native holders, each of which must Unref it
+	void Share(uint8_t * data, unsigned holders);
+
+	// any thread: one holder of a shared slab is done with it
+	void Unref(uint8_t * data);
+
+	// main thread: record that the slab is now owned by a JS Buffer; returns the lease generation, which must be
+	// handed back to Return when that Buffer is collected
+	uintptr_t Lend(uint8_t * data);
+
+	// main thread: a lent Buffer was collected; returns the slab size if data belonged to a live pool, else 0
+	static size_t Return(const uint8_t * data, uintptr_t generation);
+
+	// main thread: JS is done with a lent Buffer before it has been collected; returns true iff data is the start
+	// of a slab with an outstanding lease
+	static bool Release(const uint8_t * data);
+
+	// the owner is done with the pool
+	void Orphan(void);
+
+	size_t SlabSize(void) const { return this->slab_size; }
+	size_t SlabCount(void) const { return this->slabs.size(); }
+	size_t FreeCount(void);
+
+	// slabs whose current lease JS still holds
+	size_t LentCount(void);
+
+private:
+	BufferPool(size_t slab_size, size_t slab_count);
+	~BufferPool();
+
+	static BufferPool * Find(const uint8_t * data, size_t * index);
+	void Free(size_t index);
+	bool ShouldDelete(void);
+
+	static std::mutex registry_mutex;
+	static std::vector<BufferPool *> registry;
+
+	std::mutex mutex;
+	uint8_t * memory;
+	uint8_t * base;
+	const size_t slab_size;
+	const size_t stride;
+	std::vector<pool_slab_t> slabs;
+	std::vector<size_t> free_list;
+	size_t buffers_alive = 0; // lent Buffers not yet collected, including explicitly released ones
+	size_t leases = 0;        // slabs whose current lease has neither been returned nor released
+	bool orphaned = false;
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include <cstring>
+#include "burst_capture.h"
+
+BurstCapture::BurstCapture(const burst_capture_options_t & opts)
+	: opts(opts), ring(opts.history), captures(1 + BURST_CAPTURE_MAX_SNAPSHOTS), pending_requests(0) {
+	if(opts.trigger) this->detector = new EnergySquelch(opts.detector);
+
+	this->completed.reserve(this->captures.size());
+	this->requests.reserve(BURST_CAPTURE_MAX_SNAPSHOTS);
+}
+
+BurstCapture::~BurstCapture() {
+	delete this->detector;
+}
+
+int BurstCapture::Snapshot(size_t pre, size_t post) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if(this->busy_snapshots + this->requests.size() >= BURST_CAPTURE_MAX_SNAPSHOTS) return 0;
+
+	snapshot_request_t request;
+	request.id = this->next_id;
+	request.pre = pre;
+	request.post = post;
+
+	this->next_id = this->next_id == INT32_MAX ? 1 : this->next_id + 1;
+	this->requests.push_back(request);
+	this->pending_requests = this->requests.size();
+	return request.id;
+}
+
+// copy len bytes of the ring, starting from byte offset from, which must still be held
+void BurstCapture::CopyRing(uint64_t from, size_t len, uint8_t * out) const {
+	const size_t size = this->ring.size();
+	const size_t at = (size_t) (from % size);
+	const size_t first = size - at < len ? size - at : len;
+
+	memcpy(out, &this->ring[at], first);
+	memcpy(out + first, &this->ring[0], len - first);
+}
+
+// begin a capture around trigger, taking whatever of its pre-trigger part is already behind us from the ring
+void BurstCapture::Start(burst_capture_t & capture, int id, uint64_t trigger, size_t pre, size_t post) {
+	const uint64_t held = this->written < this->ring.size() ? this->written : this->ring.size();
+	const uint64_t oldest = this->written - held;
+
+	capture.id = id;
+	capture.trigger = trigger;
+	capture.start = pre > trigger || trigger - pre < oldest ? oldest : trigger - pre;
+	capture.end = trigger + post;
+	if(capture.end - capture.start > this->opts.max_capture) capture.end = capture.start + this->opts.max_capture;
+	capture.busy = true;
+	capture.data.resize((size_t) (capture.end - capture.start));
+
+	const uint64_t behind = this->written > capture.start ? this->written - capture.start : 0;
+	if(behind > 0) this->CopyRing(capture.start, (size_t) behind, capture.data.data());
+	capture.next = capture.start + behind;
+}
+
+const std::vector<const burst_capture_t *> & BurstCapture::Process(const uint8_t * buf, uint32_t len) {
+	// the captures handed out last time have been queued by now
+	for(size_t i = 0; i < this->completed.size(); i++) {
+		burst_capture_t & done = this->captures[this->completed[i] - this->captures.data()];
+		done.busy = false;
+
+		if(done.id != 0) {
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->busy_snapshots--;
+		}
+	}
+
+	this->completed.clear();
+
+	if(this->pending_requests > 0) {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		for(size_t i = 0; i < this->requests.size(); i++) {
+			size_t slot = 1;
+			while(this->captures[slot].busy) slot++;
+
+			this->Start(this->captures[slot], this->requests[i].id, this->written, this->requests[i].pre,
+			            this->requests[i].post);
+			this->busy_snapshots++;
+		}
+
+		this->requests.clear();
+		this->pending_requests = 0;
+	}
+
+	// a burst that starts while the last one is still being captured belongs to it
+	if(this->detector != NULL) {
+		const std::vector<squelch_segment_t> & segments = this->detector->Process(buf, len);
+
+		for(size_t i = 0; i < segments.size() && !this->captures[0].busy; i++) {
+			if(segments[i].opened)
+				this->Start(this->captures[0], 0, this->written + segments[i].start, this->opts.pre, this->opts.post);
+		}
+	}
+
+	const uint64_t first = this->written, last = this->written + len;
+
+	for(size_t i = 0; i < this->captures.size(); i++) {
+		burst_capture_t & capture = this->captures[i];
+		if(!capture.busy) continue;
+
+		const uint64_t from = capture.next > first ? capture.next : first;
+		const uint64_t to = capture.end < last ? capture.end : last;
+
+		if(to > from) {
+			memcpy(&capture.data[(size_t) (from - capture.start)], buf + (from - first), (size_t) (to - from));
+			capture.next = to;
+		}
+
+		if(capture.next == capture.end) this->completed.push_back(&capture);
+	}
+
+	// keep the newest ring.size() bytes of the transfer
+	const size_t size = this->ring.size();
+	const size_t keep = len < size ? len : size;
+	const uint8_t * tail = buf + (len - keep);
+	const size_t at = (size_t) ((last - keep) % size);
+	const size_t head = size - at < keep ? size - at : keep;
+
+	memcpy(&this->ring[at], tail, head);
+	memcpy(&this->ring[0], tail + head, keep - head);
+
+	this->written = last;
+	return this->completed;
+}
@@ -0,0 +1,81 @@
+#ifndef JS_RTLSDR_BURST_CAPTURE_GRAB_H
+#define JS_RTLSDR_BURST_CAPTURE_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "energy_squelch.h"
+
+#define BURST_CAPTURE_MAX_SNAPSHOTS (16)                 // snapshots pending or in progress at once
+#define BURST_CAPTURE_MAX_BYTES     ((size_t) 1 << 31)   // of history, and of any one capture
+
+typedef struct burst_capture_options {
+	size_t history = 0;   // bytes of raw I/Q kept behind the newest transfer
+	bool   trigger = false; // capture whenever the power detector opens
+	energy_squelch_options_t detector;
+	size_t pre = 0;       // bytes before a detector trigger to capture
+	size_t post = 0;      // bytes from a detector trigger on to capture
+	size_t max_capture = BURST_CAPTURE_MAX_BYTES; // any capture's post-trigger part is cut to keep it this small
+} burst_capture_options_t;
+
+// one capture, complete once next == end
+typedef struct burst_capture {
+	int      id = 0;        // the snapshot's id, or 0 for a detector trigger
+	uint64_t start = 0;     // byte offsets since the first transfer
+	uint64_t trigger = 0;
+	uint64_t end = 0;
+	uint64_t next = 0;      // the first byte not yet copied into data
+	bool     busy = false;
+	std::vector<uint8_t> data; // keeps its capacity between captures
+} burst_capture_t;
+
+// Triggered capture over a ring of the last `history` bytes of raw I/Q. The ring is allocated once; while nothing
+// is triggered, a transfer costs one copy into it. A trigger, either the power detector opening or a Snapshot
+// request from any thread, starts a capture that takes its pre-trigger bytes from the ring and then fills from the
+// transfers that follow, so a capture may reach further forward than the ring holds. Captures land in slots whose
+// buffers are reused, so only a capture larger than any before it allocates.
+class BurstCapture {
+public:
+	explicit BurstCapture(const burst_capture_options_t & opts);
+	~BurstCapture();
+
+	// any thread: capture from pre bytes before the next transfer to post bytes after its start; pre is cut to
+	// what the ring holds, then post to opts.max_capture. Returns the snapshot's id, or 0 if
+	// BURST_CAPTURE_MAX_SNAPSHOTS are already pending.
+	int Snapshot(size_t pre, size_t post);
+
+	// capture thread: record one transfer; returns the captures it completed, which stay valid until the next call
+	const std::vector<const burst_capture_t *> & Process(const uint8_t * buf, uint32_t len);
+
+	size_t History(void) const { return this->ring.size(); }
+
+private:
+	typedef struct snapshot_request {
+		int    id;
+		size_t pre;
+		size_t post;
+	} snapshot_request_t;
+
+	void Start(burst_capture_t & capture, int id, uint64_t trigger, size_t pre, size_t post);
+	void CopyRing(uint64_t from, size_t len, uint8_t * out) const;
+
+	const burst_capture_options_t opts;
+	std::vector<uint8_t> ring;
+	uint64_t written = 0;   // bytes ever written to the ring
+	EnergySquelch * detector = NULL;
+
+	// slot 0 is the detector's; the rest serve snapshots
+	std::vector<burst_capture_t> captures;
+	std::vector<const burst_capture_t *> completed;
+
+	std::mutex mutex;       // guards requests, next_id, and busy_snapshots against Snapshot
+	std::vector<snapshot_request_t> requests;
+	std::atomic<size_t> pending_requests;
+	size_t busy_snapshots = 0;
+	int next_id = 1;
+};
+
+#endif
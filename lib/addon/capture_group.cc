@@ -0,0 +1,330 @@
+#include <algorithm>
+#include "capture_group.h"
+#include "device_backend.h"
+#include "device_context.h"
+#include "sample_reader.h"
+
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+static uint32_t transfer_samples(const capture_group_work_t * work) {
+	return (work->buf_len > 0 ? work->buf_len : BUFFER_POOL_DEFAULT_SLAB_SIZE) / 2;
+}
+
+// a device may run ahead of the slowest by everything librtlsdr can have in flight twice over, or by a block if
+// that is more, on top of its own offset
+static stream_aligner_options_t aligner_options(const capture_group_work_t * work) {
+	stream_aligner_options_t opts = work->align;
+	const uint64_t in_flight = (uint64_t) (work->buf_num > 0 ? work->buf_num : BUFFER_POOL_DEFAULT_SLAB_COUNT)
+	                           * transfer_samples(work);
+
+	uint64_t offset = 0;
+	for(size_t i = 0; i < opts.offsets.size(); i++) offset = std::max(offset, opts.offsets[i]);
+
+	opts.max_backlog = 2 * std::max<uint64_t>(in_flight, opts.block) + offset;
+	return opts;
+}
+
+// one slab per queue slot, plus one for the block being queued, each holding a block of every device
+static BufferPool * create_pool(const capture_group_work_t * work) {
+	const size_t slab_size = work->rtl_devs.size() * 2 * work->align.block * sample_format_size(work->format);
+	return BufferPool::Create(slab_size, work->queue_depth + 1);
+}
+
+CaptureGroup::CaptureGroup(Nan::Callback * listener, capture_group_work_t * work)
+	: env(AddonEnv::Current()), callback(listener), work(work), streams(work->rtl_devs.size()), pool(create_pool(work)),
+	  queue(work->queue_depth, work->overflow, this->pool, work->format, &this->stats),
+	  owners(work->rtl_devs.size(), NULL), outstanding(work->rtl_devs.size()), cancelled(false),
+	  aligner(work->rtl_devs.size(), aligner_options(work)), scratch(work->rtl_devs.size() * 2 * work->align.block),
+	  aligned(false) {
+	for(size_t i = 0; i < this->streams.size(); i++) {
+		this->streams[i].group = this;
+		this->streams[i].index = i;
+		this->streams[i].rtl_dev = work->rtl_devs[i];
+	}
+
+	this->async = new uv_async_t;
+	this->env->InitAsync(this->async, &CaptureGroup::AsyncDeliver, &CaptureGroup::AsyncClose);
+	this->async->data = this;
+
+	Local<v8::ArrayBuffer> timing_buffer =
+		v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), SAMPLE_READER_TIMING_FIELDS * sizeof(double));
+	Local<v8::Float64Array> timing = v8::Float64Array::New(timing_buffer, 0, SAMPLE_READER_TIMING_FIELDS);
+	this->timing.Reset(timing);
+	Nan::TypedArrayContents<double> timing_contents(timing);
+	this->timing_data = *timing_contents;
+}
+
+CaptureGroup::~CaptureGroup() {
+	sample_block_t block;
+	while(this->queue.Pop(block)) this->queue.Discard(block);
+
+	// slabs still held by JS Buffers keep the pool alive until they are collected
+	this->pool->Orphan();
+
+	delete this->callback;
+	delete this->work;
+	this->timing.Reset();
+}
+
+void CaptureGroup::Start(const std::vector<DeviceContext *> & devices) {
+	for(size_t i = 0; i < devices.size(); i++) {
+		CaptureGroupMember * member = new CaptureGroupMember(this, i);
+
+		if(!devices[i]->Post(member)) {
+			member->Abort("the device's capture thread refused the capture");
+			continue;
+		}
+
+		this->owners[i] = devices[i];
+		devices[i]->Join(this);
+	}
+}
+
+void CaptureGroup::Cancel() {
+	this->cancelled = true;
+	this->queue.Close();
+
+	std::lock_guard<std::mutex> lock(this->state_mutex);
+	this->reset.notify_all();
+
+	// a device that has not started yet sees the cancel before it does; one that has finished is left alone
+	for(size_t i = 0; i < this->streams.size(); i++)
+		if(this->streams[i].running) backend_cancel_async(this->streams[i].rtl_dev);
+}
+
+void CaptureGroup::Disown(DeviceContext * owner) {
+	for(size_t i = 0; i < this->owners.size(); i++)
+		if(this->owners[i] == owner) this->owners[i] = NULL;
+}
+
+// record the first failure, and end the group
+void CaptureGroup::Fail(const std::string & msg) {
+	{
+		std::lock_guard<std::mutex> lock(this->state_mutex);
+		if(this->error.empty()) this->error = msg;
+	}
+
+	this->Cancel();
+}
+
+void CaptureGroup::Stream(size_t index) {
+	capture_group_stream_t & stream = this->streams[index];
+	this->work->stats[index]->Begin();
+
+	int err = backend_reset_buffer(stream.rtl_dev, *this->work->controls[index]);
+	if(err < 0) {
+		this->Fail("rtlsdr_reset_buffer failed with code " + std::to_string(err));
+		return;
+	}
+
+	// every device starts streaming as soon as the last has reset, so that the streams begin close together
+	{
+		std::unique_lock<std::mutex> lock(this->state_mutex);
+		this->ready++;
+		this->reset.notify_all();
+
+		while(this->ready < this->streams.size() && !this->cancelled) this->reset.wait(lock);
+		if(this->cancelled) return;
+
+		stream.running = true;
+	}
+
+	err = backend_read_async(stream.rtl_dev, &CaptureGroup::RTLSDRAsyncCallback, &stream,
+	                         this->work->buf_num, this->work->buf_len);
+
+	{
+		std::lock_guard<std::mutex> lock(this->state_mutex);
+		stream.running = false;
+	}
+
+	// a read the group cut short before it got going is not a failure of its own
+	if(err != 0 && !this->cancelled)
+		this->Fail("rtlsdr_read_async returned error code " + std::to_string(err) + " on exit");
+
+	// one device stopping stops them all, since the others' blocks could no longer be matched
+	this->Cancel();
+}
+
+/* static */ void CaptureGroup::RTLSDRAsyncCallback(uint8_t * buf, uint32_t len, void * ctx) {
+	capture_group_stream_t * stream = (capture_group_stream_t *) ctx;
+	CaptureGroup * group = stream->group;
+	group->work->stats[stream->index]->Transfer(len);
+
+	// a cancel that raced the start of rtlsdr_read_async is applied here
+	if(group->cancelled) {
+		backend_cancel_async(stream->rtl_dev);
+		return;
+	}
+
+	group->Process(stream->index, buf, len);
+}
+
+// capture thread: stage one device's transfer, and queue every block it completes
+void CaptureGroup::Process(size_t index, const uint8_t * buf, uint32_t len) {
+	bool queued = false, behind = false;
+	size_t lagging = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stats.Transfer(len);
+
+		if(this->aligner.Push(index, buf, len, this->work->stats[index]->Arrival())) {
+			if(!this->aligned && this->aligner.Aligned()) {
+				for(size_t i = 0; i < this->aligner.Streams(); i++) this->leads.push_back(this->aligner.Lead(i));
+				this->aligned = true;
+			}
+
+			uint64_t first;
+			while(this->aligner.Pop(this->scratch.data(), &first)) {
+				this->queue.Push(this->scratch.data(), (uint32_t) this->scratch.size(), first);
+				queued = true;
+			}
+		} else {
+			behind = true;
+			lagging = this->aligner.Lagging();
+		}
+	}
+
+	if(behind) {
+		this->Fail("device " + std::to_string(lagging) + " of the group fell more than " +
+		           std::to_string(aligner_options(this->work).max_backlog) + " samples behind");
+	}
+
+	if(queued) uv_async_send(this->async);
+}
+
+/* static */ NAUV_WORK_CB(CaptureGroup::AsyncDeliver) {
+	CaptureGroup * group = static_cast<CaptureGroup *>(async->data);
+	group->Deliver();
+}
+
+// drain every matched block to the listener, then report any overflow since the last drain
+void CaptureGroup::Deliver() {
+	Nan::HandleScope scope;
+
+	if(!this->aligned_reported && this->aligned) {
+		Local<v8::Array> leads = Nan::New<v8::Array>((int) this->leads.size());
+		for(size_t i = 0; i < this->leads.size(); i++)
+			Nan::Set(leads, (uint32_t) i, Nan::New<v8::Number>((double) this->leads[i]));
+
+		Local<Value> argv[] = {Nan::New("aligned").ToLocalChecked(), leads};
+		this->callback->Call(2, argv);
+		this->aligned_reported = true;
+	}
+
+	sample_block_t block;
+	uint64_t delivered = 0;
+
+	while(this->queue.Pop(block)) {
+		Local<Object> buffer;
+
+		if(block.pooled) {
+			const uintptr_t generation = this->pool->Lend(block.data);
+			buffer = Nan::NewBuffer((char *) block.data, block.len,
+			                        &SampleReader::FreePooledBuffer, (void *) generation).ToLocalChecked();
+			Nan::AdjustExternalMemory((int) this->pool->SlabSize());
+		} else {
+			buffer = Nan::NewBuffer((char *) block.data, block.len).ToLocalChecked();
+		}
+
+		this->stats.Delivered(block.arrival_ns);
+		delivered++;
+
+		// every device's view shares the one slab, and keeps it leased
+		const size_t per_device = block.len / this->streams.size();
+		Local<v8::Array> samples = Nan::New<v8::Array>((int) this->streams.size());
+		for(size_t i = 0; i < this->streams.size(); i++)
+			Nan::Set(samples, (uint32_t) i, this->View(buffer, i * per_device, per_device));
+
+		this->timing_data[SAMPLE_READER_TIMING_INDEX] = (double) block.offset;
+		this->timing_data[SAMPLE_READER_TIMING_MONOTONIC] = block.arrival_ns / 1e6;
+		this->timing_data[SAMPLE_READER_TIMING_REALTIME] = block.wall_ns / 1e6;
+
+		Local<Value> argv[] = {Nan::New("data").ToLocalChecked(), samples, Nan::New(this->timing)};
+		this->callback->Call(3, argv);
+	}
+
+	this->stats.Drained(delivered);
+
+	const sample_queue_counts_t counts = this->queue.Counts();
+
+	if(counts.dropped > this->dropped_reported) {
+		Local<Object> overflow = Nan::New<Object>();
+		Nan::Set(overflow, Nan::New("dropped").ToLocalChecked(),
+		         Nan::New<v8::Number>((double) (counts.dropped - this->dropped_reported)));
+		Nan::Set(overflow, Nan::New("totalDropped").ToLocalChecked(), Nan::New<v8::Number>((double) counts.dropped));
+		Nan::Set(overflow, Nan::New("totalTransfers").ToLocalChecked(),
+		         Nan::New<v8::Number>((double) counts.transfers));
+		Nan::Set(overflow, Nan::New("queueDepth").ToLocalChecked(), Nan::New<v8::Number>((double) this->queue.Depth()));
+
+		this->dropped_reported = counts.dropped;
+
+		Local<Value> argv[] = {Nan::New("overflow").ToLocalChecked(), overflow};
+		this->callback->Call(2, argv);
+	}
+}
+
+// one device's stretch of a block, as the typed array for the group's format
+Local<Object> CaptureGroup::View(Local<Object> buffer, size_t offset, size_t len) {
+	Local<v8::Uint8Array> bytes = buffer.As<v8::Uint8Array>();
+	Local<v8::ArrayBuffer> backing = bytes->Buffer();
+	offset += bytes->ByteOffset();
+
+	if(this->work->format == SAMPLE_FORMAT_UINT8)
+		return v8::Uint8Array::New(backing, offset, len);
+
+	if(this->work->format == SAMPLE_FORMAT_INT16)
+		return v8::Int16Array::New(backing, offset, len / sizeof(int16_t));
+
+	return v8::Float32Array::New(backing, offset, len / sizeof(float));
+}
+
+void CaptureGroup::Completed(const std::string & error) {
+	if(!error.empty()) this->Fail(error);
+	if(--this->outstanding > 0) return;
+
+	// every member is back, so nothing more can be queued
+	this->Deliver();
+	this->Complete();
+}
+
+// emit 'done' or 'error', then close the async handle; AsyncClose frees the group
+void CaptureGroup::Complete() {
+	Nan::HandleScope scope;
+
+	for(size_t i = 0; i < this->owners.size(); i++)
+		if(this->owners[i] != NULL) this->owners[i]->Leave(this);
+
+	if(this->error.empty()) {
+		Local<Value> argv[] = {Nan::New("done").ToLocalChecked()};
+		this->callback->Call(1, argv);
+	} else {
+		Local<Value> argv[] = {
+			Nan::New("error").ToLocalChecked(),
+			Nan::New<v8::String>(this->error).ToLocalChecked()
+		};
+
+		this->callback->Call(2, argv);
+	}
+
+	this->env->CloseAsync(this->async);
+}
+
+/* static */ void CaptureGroup::AsyncClose(uv_handle_t * handle) {
+	CaptureGroup * group = static_cast<CaptureGroup *>(handle->data);
+	delete reinterpret_cast<uv_async_t *>(handle);
+	delete group;
+}
+
+void CaptureGroupMember::Execute(rtlsdr_dev_t *, std::mutex &, bool * buffer_reset) {
+	this->group->Stream(this->index);
+
+	// the next synchronous read starts from a fresh buffer again
+	if(buffer_reset != NULL) *buffer_reset = false;
+}
+
+void CaptureGroupMember::Complete() {
+	this->group->Completed(this->error);
+}
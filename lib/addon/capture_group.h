@@ -0,0 +1,133 @@
+#ifndef JS_RTLSDR_CAPTURE_GROUP_GRAB_H
+#define JS_RTLSDR_CAPTURE_GROUP_GRAB_H
+
+#include <rtl-sdr.h>
+#include <node.h>
+#include <nan.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "addon_env.h"
+#include "buffer_pool.h"
+#include "device_task.h"
+#include "sample_queue.h"
+#include "stream_aligner.h"
+#include "stream_stats.h"
+
+#define CAPTURE_GROUP_MAX_DEVICES (32)
+
+class CaptureGroup;
+class DeviceContext;
+
+typedef struct capture_group_work {
+	std::vector<rtlsdr_dev_t *> rtl_devs;
+	std::vector<std::mutex *> controls; // each device's control mutex (see DeviceContext::ControlMutex)
+	std::vector<std::shared_ptr<StreamStats> > stats; // each device's counters (see DeviceContext::Stats)
+	uint32_t          buf_num = 0;
+	uint32_t          buf_len = 0;
+	size_t            queue_depth = 32;
+	overflow_policy_t overflow = OVERFLOW_BLOCK;
+	sample_format_t   format = SAMPLE_FORMAT_UINT8; // any but SAMPLE_FORMAT_FLOAT32_PLANAR
+	stream_aligner_options_t align; // block, rate, by_time, and offsets; max_backlog is derived from the rest
+} capture_group_work_t;
+
+// one device's part in a group, the context of its rtlsdr_read_async callback
+typedef struct capture_group_stream {
+	CaptureGroup * group = NULL;
+	size_t         index = 0;
+	rtlsdr_dev_t * rtl_dev = NULL;
+	bool           running = false; // under the group's state mutex: inside rtlsdr_read_async
+} capture_group_stream_t;
+
+// One synchronized capture across several devices that share a clock. Every device streams on its own capture
+// thread (see DeviceContext::Post), and each of those resets its device's buffer, waits until all the others have
+// done the same, and only then starts rtlsdr_read_async, so that the streams start within a transfer or so of one
+// another. Their transfers meet in a StreamAligner, and each matched block -- the same `block` samples of every
+// device, side by side in one BufferPool slab and converted to work->format -- goes through one SampleQueue to the
+// listener as a 'data' event with an array of per-device views, followed by a timing Float64Array laid out as
+// SampleReader's, its index counting group samples. The devices' leads are reported once, as an 'aligned' event,
+// before the first block. When any device's read ends -- cancelled, failed, or its device closed -- the group
+// cancels the others, and once every member has come back to the main thread it emits 'done' or 'error' and frees
+// itself.
+class CaptureGroup {
+public:
+	CaptureGroup(Nan::Callback * listener, capture_group_work_t * work);
+
+	// main thread: post a member to the capture thread of each of devices, in the order of work->rtl_devs, and
+	// tell each device it is streaming in this group. A device that refuses fails the group.
+	void Start(const std::vector<DeviceContext *> & devices);
+
+	// any thread: end every device's read, and release a producer blocked on a full queue; whatever is already
+	// queued is still delivered
+	void Cancel(void);
+	bool Cancelled(void) const { return this->cancelled; }
+
+	// main thread: a device of the group is being freed
+	void Disown(DeviceContext * owner);
+
+	// capture thread, from a member: stream one device until the group is cancelled
+	void Stream(size_t index);
+
+	// main thread, from a member: one device's part is over, unsuccessfully if error is not empty
+	void Completed(const std::string & error);
+
+private:
+	~CaptureGroup();
+
+	static void RTLSDRAsyncCallback(uint8_t * buf, uint32_t len, void * ctx);
+	static NAUV_WORK_CB(AsyncDeliver);
+	static void AsyncClose(uv_handle_t * handle);
+
+	void Process(size_t index, const uint8_t * buf, uint32_t len);
+	void Fail(const std::string & msg);
+	void Deliver(void);
+	v8::Local<v8::Object> View(v8::Local<v8::Object> buffer, size_t offset, size_t len);
+	void Complete(void);
+
+	AddonEnv * const       env;
+	Nan::Callback *        callback;
+	capture_group_work_t * work;
+	std::vector<capture_group_stream_t> streams;
+	BufferPool *           pool;
+	StreamStats            stats; // the group's own, for its queue; each device's are counted as well
+	SampleQueue            queue;
+	std::vector<DeviceContext *> owners; // main thread
+	size_t                 outstanding;  // main thread: members that have not completed
+	Nan::Persistent<v8::Float64Array> timing; // main thread
+	double *               timing_data;
+	uv_async_t *           async;
+	uint64_t               dropped_reported = 0;
+	bool                   aligned_reported = false; // main thread
+	std::atomic<bool>      cancelled;
+
+	std::mutex             mutex; // capture threads: the aligner and scratch
+	StreamAligner          aligner;
+	std::vector<uint8_t>   scratch;   // one matched block, before it is queued
+	std::vector<uint64_t>  leads;     // the aligner's leads, published once by aligned
+	std::atomic<bool>      aligned;
+
+	std::mutex              state_mutex; // any thread: what follows, and streams[].running
+	std::condition_variable reset;       // a device has reset its buffer, or the group was cancelled
+	size_t                  ready = 0;   // devices that have reset their buffers
+	std::string             error;       // the first failure
+};
+
+// a device's part in a CaptureGroup, run on the device's capture thread
+class CaptureGroupMember : public DeviceTask {
+public:
+	CaptureGroupMember(CaptureGroup * group, size_t index) : group(group), index(index) {}
+
+protected:
+	void Execute(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool * buffer_reset);
+	void Complete(void);
+
+private:
+	CaptureGroup * const group;
+	const size_t         index;
+};
+
+#endif
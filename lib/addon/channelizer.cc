@@ -0,0 +1,130 @@
+#include <cmath>
+#include "channelizer.h"
+#include "fir.h"
+
+Channelizer::Channelizer(unsigned count, const std::vector<unsigned> & selected, unsigned threads)
+	: count(count), selected(selected), streams(count), outputs(selected.size()) {
+	const size_t taps = CHANNELIZER_BRANCH_TAPS;
+
+	// branch p holds prototype taps p, p + count, p + 2 count, ...
+	const std::vector<float> proto = fir_design_lowpass((size_t) count * taps, 0.5 / count, 1.0);
+	float branch[CHANNELIZER_BRANCH_TAPS];
+
+	for(unsigned p = 0; p < count; p++) {
+		for(size_t j = 0; j < taps; j++) branch[j] = proto[p + j * count];
+
+		const std::vector<float> prepared = fir_prepare_taps(branch, taps);
+		this->branch_taps.insert(this->branch_taps.end(), prepared.begin(), prepared.end());
+
+		// stream p carries x[j * count - p]; x[-p] is a zero for every branch but the first
+		this->streams[p].assign(2 * (p == 0 ? taps - 1 : taps), 0.0f);
+	}
+
+	for(size_t i = 0; i < selected.size(); i++) {
+		for(unsigned p = 0; p < count; p++) {
+			const double angle = 2 * M_PI * (double) selected[i] * p / count;
+			this->twiddles.push_back((float) cos(angle));
+			this->twiddles.push_back((float) sin(angle));
+		}
+	}
+
+	if(threads < 1) threads = 1;
+	this->branch_out.assign(threads, std::vector<float>(2 * count));
+	for(size_t slice = 1; slice < threads; slice++)
+		this->workers.push_back(std::thread(&Channelizer::Work, this, slice));
+}
+
+Channelizer::~Channelizer() {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->exiting = true;
+		this->wake.notify_all();
+	}
+
+	for(size_t i = 0; i < this->workers.size(); i++) this->workers[i].join();
+}
+
+size_t Channelizer::Process(const float * iq, size_t len) {
+	const size_t pairs = len / 2;
+	const size_t history = CHANNELIZER_BRANCH_TAPS - 1;
+
+	for(size_t k = 0; k < pairs; k++) {
+		std::vector<float> & stream = this->streams[(this->count - this->commutator) % this->count];
+		stream.push_back(iq[2 * k]);
+		stream.push_back(iq[2 * k + 1]);
+		this->commutator = (this->commutator + 1) % this->count;
+	}
+
+	size_t out = this->streams[0].size() / 2 - history;
+	for(unsigned p = 1; p < this->count; p++) {
+		const size_t ready = this->streams[p].size() / 2 - history;
+		if(ready < out) out = ready;
+	}
+
+	for(size_t i = 0; i < this->outputs.size(); i++) this->outputs[i].resize(2 * out);
+
+	const size_t slices = this->branch_out.size();
+	if(slices == 1 || out < slices) {
+		this->Compute(0, 0, out);
+	} else {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->job_outputs = out;
+			this->pending = slices - 1;
+			this->generation++;
+			this->wake.notify_all();
+		}
+
+		this->Compute(0, 0, out / slices);
+
+		std::unique_lock<std::mutex> lock(this->mutex);
+		while(this->pending > 0) this->done.wait(lock);
+	}
+
+	for(unsigned p = 0; p < this->count; p++)
+		this->streams[p].erase(this->streams[p].begin(), this->streams[p].begin() + 2 * out);
+
+	return 2 * out;
+}
+
+size_t Channelizer::MaxOutput(size_t len) const {
+	return 2 * ((len / 2) / this->count + 1);
+}
+
+// output times [from, to): filter every branch once, then take one DFT bin per selected channel
+void Channelizer::Compute(size_t slice, size_t from, size_t to) {
+	float * branch_out = this->branch_out[slice].data();
+	const size_t stride = 2 * CHANNELIZER_BRANCH_TAPS;
+
+	for(size_t m = from; m < to; m++) {
+		for(unsigned p = 0; p < this->count; p++) {
+			fir_dot(&this->streams[p][2 * m], &this->branch_taps[p * stride], CHANNELIZER_BRANCH_TAPS,
+			        branch_out + 2 * p);
+		}
+
+		for(size_t i = 0; i < this->selected.size(); i++)
+			complex_dot(&this->twiddles[2 * i * this->count], branch_out, this->count, &this->outputs[i][2 * m]);
+	}
+}
+
+// worker thread for slice (1 to threads - 1) of every Process call
+void Channelizer::Work(size_t slice) {
+	const size_t slices = this->branch_out.size();
+	uint64_t seen = 0;
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	for(;;) {
+		while(this->generation == seen && !this->exiting) this->wake.wait(lock);
+		if(this->exiting) return;
+
+		seen = this->generation;
+		const size_t out = this->job_outputs;
+		lock.unlock();
+
+		this->Compute(slice, out * slice / slices, out * (slice + 1) / slices);
+
+		lock.lock();
+		if(--this->pending == 0) this->done.notify_one();
+	}
+}
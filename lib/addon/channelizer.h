@@ -0,0 +1,63 @@
+#ifndef JS_RTLSDR_CHANNELIZER_GRAB_H
+#define JS_RTLSDR_CHANNELIZER_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define CHANNELIZER_BRANCH_TAPS (16)   // prototype taps per polyphase branch
+#define CHANNELIZER_MAX_CHANNELS (1024)
+#define CHANNELIZER_MAX_THREADS (64)
+
+// Critically sampled polyphase filter-bank channelizer for interleaved complex float samples. The input band is
+// split into `count` equal channels, channel k centered at k / count of the sample rate (so channels above count / 2
+// are the negative frequencies), and each selected channel comes out decimated by count. The branch filters are
+// shared by all channels; each selected channel then costs one count-point DFT bin per output, so any subset is
+// cheap. Output times are independent, so a transfer is split across `threads` threads (the calling thread plus
+// threads - 1 workers owned by the channelizer).
+class Channelizer {
+public:
+	Channelizer(unsigned count, const std::vector<unsigned> & selected, unsigned threads);
+	~Channelizer();
+
+	// channelize len interleaved floats; returns how many floats each selected channel produced, available from
+	// Output until the next call
+	size_t Process(const float * iq, size_t len);
+
+	// output of the i-th selected channel
+	const float * Output(size_t i) const { return this->outputs[i].data(); }
+
+	// the most floats per channel Process can produce for len floats of input
+	size_t MaxOutput(size_t len) const;
+
+	unsigned Count(void) const { return this->count; }
+	const std::vector<unsigned> & Selected(void) const { return this->selected; }
+
+private:
+	void Compute(size_t slice, size_t from, size_t to);
+	void Work(size_t slice);
+
+	const unsigned count;
+	const std::vector<unsigned> selected;
+
+	std::vector<float> branch_taps;             // count branches of prepared taps
+	std::vector<float> twiddles;                // per selected channel, count complex e^(2 pi i k p / count)
+	std::vector<std::vector<float> > streams;   // commutated input, one stream per branch: history, then new samples
+	std::vector<std::vector<float> > branch_out; // per slice scratch: the count branch outputs for one time
+	std::vector<std::vector<float> > outputs;   // per selected channel
+	size_t commutator = 0;                      // input index modulo count
+
+	// worker handshake, one generation per Process call
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	uint64_t generation = 0;
+	size_t pending = 0;
+	size_t job_outputs = 0;
+	bool exiting = false;
+};
+
+#endif
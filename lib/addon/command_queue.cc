@@ -0,0 +1,57 @@
+#include "command_queue.h"
+#include "device_task.h"
+
+void CommandQueue::Start() {
+	this->thread = std::thread(&CommandQueue::Run, this);
+}
+
+bool CommandQueue::Post(DeviceTask * task) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if(this->exiting || !this->thread.joinable()) return false;
+
+	// queued tasks have not started; the running one has already been taken off the queue
+	if(!this->tasks.empty() && this->tasks.back()->Absorb(task)) {
+		task->Discard();
+		return true;
+	}
+
+	this->tasks.push_back(task);
+	this->wake.notify_all();
+	return true;
+}
+
+void CommandQueue::Shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if(!this->thread.joinable()) return;
+
+		this->exiting = true;
+		this->wake.notify_all();
+	}
+
+	this->thread.join();
+}
+
+void CommandQueue::Run() {
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	for(;;) {
+		while(this->tasks.empty() && !this->exiting) this->wake.wait(lock);
+
+		if(this->exiting) {
+			for(size_t i = 0; i < this->tasks.size(); i++)
+				this->tasks[i]->Abort("the device was closed before the command ran");
+			this->tasks.clear();
+			return;
+		}
+
+		DeviceTask * task = this->tasks.front();
+		this->tasks.pop_front();
+		lock.unlock();
+
+		// the task may be freed by the main thread as soon as this returns
+		task->Run(this->rtl_dev, this->control, NULL);
+
+		lock.lock();
+	}
+}
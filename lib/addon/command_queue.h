@@ -0,0 +1,45 @@
+#ifndef JS_RTLSDR_COMMAND_QUEUE_GRAB_H
+#define JS_RTLSDR_COMMAND_QUEUE_GRAB_H
+
+#include <rtl-sdr.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+class DeviceTask;
+
+// A device's control thread: runs the DeviceTasks that change its settings or touch its EEPROM, one at a time in
+// the order they were posted. Control transfers then neither block the event loop nor wait for a stream to end:
+// libusb takes them on this thread while rtlsdr_read_async streams on the capture thread. librtlsdr's control calls
+// are not safe to overlap, though, so each one, from here, the main thread, or a sweep, holds the device's control
+// mutex (see DeviceContext). A task posted while the last queued one has not started is offered to it to Absorb,
+// so that a burst of retunes costs one control transfer per setting.
+class CommandQueue {
+public:
+	CommandQueue(rtlsdr_dev_t * rtl_dev, std::mutex & control) : rtl_dev(rtl_dev), control(control) {}
+	~CommandQueue() { this->Shutdown(); }
+
+	// main thread: start the control thread
+	void Start(void);
+
+	// main thread: queue a task, or merge it into the last queued one; false if the thread is not running. The
+	// queue owns the task afterwards.
+	bool Post(DeviceTask * task);
+
+	// abort the queued tasks, let the running one finish, and join the thread. Idempotent.
+	void Shutdown(void);
+
+private:
+	void Run(void);
+
+	rtlsdr_dev_t * const rtl_dev;
+	std::mutex & control;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<DeviceTask *> tasks;
+	bool exiting = false;
+};
+
+#endif
@@ -0,0 +1,325 @@
+#include <cmath>
+#include <cstring>
+#include "convert.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define JS_RTLSDR_CONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+#define CONVERT_OFFSET (127.5f)
+#define CONVERT_SCALE  (1.0f / 127.5f)
+#define CONVERT_INT16_OFFSET (32640) // 127.5 * 256
+
+typedef void (*convert_fn_t)(const uint8_t * in, size_t len, void * out);
+
+typedef struct convert_lut {
+	float   f32[256];
+	int16_t s16[256];
+
+	convert_lut() {
+		for(int i = 0; i < 256; i++) {
+			this->f32[i] = ((float) i - CONVERT_OFFSET) * CONVERT_SCALE;
+			this->s16[i] = (int16_t) (i * 256 - CONVERT_INT16_OFFSET);
+		}
+	}
+} convert_lut_t;
+
+static const convert_lut_t & lut() {
+	static const convert_lut_t table;
+	return table;
+}
+
+// scalar pairs [from, pairs) of a planar conversion, plus the odd trailing byte; shared by every kernel's tail
+static void planar_tail(const uint8_t * in, size_t len, size_t from, float * out) {
+	const float * f32 = lut().f32;
+	const size_t pairs = len / 2;
+
+	for(size_t k = from; k < pairs; k++) {
+		out[k]         = f32[in[2 * k]];
+		out[pairs + k] = f32[in[2 * k + 1]];
+	}
+
+	if(len & 1) out[len - 1] = f32[in[len - 1]];
+}
+
+// Each kernel is specialised per output format so that the hot loops carry no per-sample branches.
+template<sample_format_t F> static void convert_lut(const uint8_t * in, size_t len, void * out);
+
+template<> void convert_lut<SAMPLE_FORMAT_UINT8>(const uint8_t * in, size_t len, void * out) {
+	memcpy(out, in, len);
+}
+
+template<> void convert_lut<SAMPLE_FORMAT_INT16>(const uint8_t * in, size_t len, void * out) {
+	const int16_t * s16 = lut().s16;
+	int16_t * o = (int16_t *) out;
+	for(size_t i = 0; i < len; i++) o[i] = s16[in[i]];
+}
+
+template<> void convert_lut<SAMPLE_FORMAT_FLOAT32>(const uint8_t * in, size_t len, void * out) {
+	const float * f32 = lut().f32;
+	float * o = (float *) out;
+	for(size_t i = 0; i < len; i++) o[i] = f32[in[i]];
+}
+
+template<> void convert_lut<SAMPLE_FORMAT_FLOAT32_PLANAR>(const uint8_t * in, size_t len, void * out) {
+	planar_tail(in, len, 0, (float *) out);
+}
+
+#define CONVERT_KERNEL_ROW(kernel) { \
+	&kernel<SAMPLE_FORMAT_UINT8>, \
+	&kernel<SAMPLE_FORMAT_INT16>, \
+	&kernel<SAMPLE_FORMAT_FLOAT32>, \
+	&kernel<SAMPLE_FORMAT_FLOAT32_PLANAR> \
+}
+
+#ifdef JS_RTLSDR_CONVERT_X86
+
+template<sample_format_t F> static void convert_sse2(const uint8_t * in, size_t len, void * out);
+
+template<> void convert_sse2<SAMPLE_FORMAT_UINT8>(const uint8_t * in, size_t len, void * out) {
+	memcpy(out, in, len);
+}
+
+template<> __attribute__((target("sse2")))
+void convert_sse2<SAMPLE_FORMAT_INT16>(const uint8_t * in, size_t len, void * out) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i offset = _mm_set1_epi16(CONVERT_INT16_OFFSET);
+	int16_t * o = (int16_t *) out;
+	size_t i = 0;
+
+	for(; i + 16 <= len; i += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i *) (in + i));
+
+		// unpacking with zero as the low byte yields x << 8
+		_mm_storeu_si128((__m128i *) (o + i),     _mm_sub_epi16(_mm_unpacklo_epi8(zero, v), offset));
+		_mm_storeu_si128((__m128i *) (o + i + 8), _mm_sub_epi16(_mm_unpackhi_epi8(zero, v), offset));
+	}
+
+	convert_lut<SAMPLE_FORMAT_INT16>(in + i, len - i, o + i);
+}
+
+static inline __attribute__((target("sse2"))) __m128 sse2_scale(__m128i u32) {
+	return _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(u32), _mm_set1_ps(CONVERT_OFFSET)), _mm_set1_ps(CONVERT_SCALE));
+}
+
+template<> __attribute__((target("sse2")))
+void convert_sse2<SAMPLE_FORMAT_FLOAT32>(const uint8_t * in, size_t len, void * out) {
+	const __m128i zero = _mm_setzero_si128();
+	float * o = (float *) out;
+	size_t i = 0;
+
+	for(; i + 16 <= len; i += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i *) (in + i));
+		const __m128i lo = _mm_unpacklo_epi8(v, zero);
+		const __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+		_mm_storeu_ps(o + i,      sse2_scale(_mm_unpacklo_epi16(lo, zero)));
+		_mm_storeu_ps(o + i + 4,  sse2_scale(_mm_unpackhi_epi16(lo, zero)));
+		_mm_storeu_ps(o + i + 8,  sse2_scale(_mm_unpacklo_epi16(hi, zero)));
+		_mm_storeu_ps(o + i + 12, sse2_scale(_mm_unpackhi_epi16(hi, zero)));
+	}
+
+	convert_lut<SAMPLE_FORMAT_FLOAT32>(in + i, len - i, o + i);
+}
+
+template<> __attribute__((target("sse2")))
+void convert_sse2<SAMPLE_FORMAT_FLOAT32_PLANAR>(const uint8_t * in, size_t len, void * out) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i low_bytes = _mm_set1_epi16(0x00ff);
+	const size_t pairs = len / 2;
+	float * o_i = (float *) out;
+	float * o_q = o_i + pairs;
+	size_t k = 0;
+
+	for(; k + 8 <= pairs; k += 8) {
+		const __m128i v = _mm_loadu_si128((const __m128i *) (in + 2 * k));
+
+		// little-endian 16-bit lanes hold I in the low byte and Q in the high byte
+		const __m128i i16 = _mm_and_si128(v, low_bytes);
+		const __m128i q16 = _mm_srli_epi16(v, 8);
+
+		_mm_storeu_ps(o_i + k,     sse2_scale(_mm_unpacklo_epi16(i16, zero)));
+		_mm_storeu_ps(o_i + k + 4, sse2_scale(_mm_unpackhi_epi16(i16, zero)));
+		_mm_storeu_ps(o_q + k,     sse2_scale(_mm_unpacklo_epi16(q16, zero)));
+		_mm_storeu_ps(o_q + k + 4, sse2_scale(_mm_unpackhi_epi16(q16, zero)));
+	}
+
+	planar_tail(in, len, k, o_i);
+}
+
+template<sample_format_t F> static void convert_avx2(const uint8_t * in, size_t len, void * out);
+
+template<> void convert_avx2<SAMPLE_FORMAT_UINT8>(const uint8_t * in, size_t len, void * out) {
+	memcpy(out, in, len);
+}
+
+template<> __attribute__((target("avx2")))
+void convert_avx2<SAMPLE_FORMAT_INT16>(const uint8_t * in, size_t len, void * out) {
+	const __m256i offset = _mm256_set1_epi16(CONVERT_INT16_OFFSET);
+	int16_t * o = (int16_t *) out;
+	size_t i = 0;
+
+	for(; i + 32 <= len; i += 32) {
+		const __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (in + i)));
+		const __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) (in + i + 16)));
+
+		_mm256_storeu_si256((__m256i *) (o + i),      _mm256_sub_epi16(_mm256_slli_epi16(lo, 8), offset));
+		_mm256_storeu_si256((__m256i *) (o + i + 16), _mm256_sub_epi16(_mm256_slli_epi16(hi, 8), offset));
+	}
+
+	convert_sse2<SAMPLE_FORMAT_INT16>(in + i, len - i, o + i);
+}
+
+static inline __attribute__((target("avx2"))) __m256 avx2_scale(__m256i u32) {
+	return _mm256_mul_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(u32), _mm256_set1_ps(CONVERT_OFFSET)),
+	                     _mm256_set1_ps(CONVERT_SCALE));
+}
+
+template<> __attribute__((target("avx2")))
+void convert_avx2<SAMPLE_FORMAT_FLOAT32>(const uint8_t * in, size_t len, void * out) {
+	float * o = (float *) out;
+	size_t i = 0;
+
+	for(; i + 32 <= len; i += 32) {
+		for(size_t j = 0; j < 32; j += 8) {
+			const __m128i v = _mm_loadl_epi64((const __m128i *) (in + i + j));
+			_mm256_storeu_ps(o + i + j, avx2_scale(_mm256_cvtepu8_epi32(v)));
+		}
+	}
+
+	convert_sse2<SAMPLE_FORMAT_FLOAT32>(in + i, len - i, o + i);
+}
+
+template<> __attribute__((target("avx2")))
+void convert_avx2<SAMPLE_FORMAT_FLOAT32_PLANAR>(const uint8_t * in, size_t len, void * out) {
+	const __m128i low_bytes = _mm_set1_epi16(0x00ff);
+	const size_t pairs = len / 2;
+	float * o_i = (float *) out;
+	float * o_q = o_i + pairs;
+	size_t k = 0;
+
+	for(; k + 8 <= pairs; k += 8) {
+		const __m128i v = _mm_loadu_si128((const __m128i *) (in + 2 * k));
+
+		_mm256_storeu_ps(o_i + k, avx2_scale(_mm256_cvtepu16_epi32(_mm_and_si128(v, low_bytes))));
+		_mm256_storeu_ps(o_q + k, avx2_scale(_mm256_cvtepu16_epi32(_mm_srli_epi16(v, 8))));
+	}
+
+	planar_tail(in, len, k, o_i);
+}
+
+static const convert_fn_t kernels[3][4] = {
+	CONVERT_KERNEL_ROW(convert_lut),
+	CONVERT_KERNEL_ROW(convert_sse2),
+	CONVERT_KERNEL_ROW(convert_avx2)
+};
+
+#else
+
+// no vector kernels on this architecture; every row is the lookup table
+static const convert_fn_t kernels[3][4] = {
+	CONVERT_KERNEL_ROW(convert_lut),
+	CONVERT_KERNEL_ROW(convert_lut),
+	CONVERT_KERNEL_ROW(convert_lut)
+};
+
+#endif
+
+size_t sample_format_size(sample_format_t format) {
+	switch(format) {
+		case SAMPLE_FORMAT_INT16:          return sizeof(int16_t);
+		case SAMPLE_FORMAT_FLOAT32:        return sizeof(float);
+		case SAMPLE_FORMAT_FLOAT32_PLANAR: return sizeof(float);
+		default:                           return 1;
+	}
+}
+
+bool parse_sample_format(const char * name, sample_format_t * format) {
+	if(0 == strcmp(name, "uint8"))               *format = SAMPLE_FORMAT_UINT8;
+	else if(0 == strcmp(name, "int16"))          *format = SAMPLE_FORMAT_INT16;
+	else if(0 == strcmp(name, "float32"))        *format = SAMPLE_FORMAT_FLOAT32;
+	else if(0 == strcmp(name, "float32-planar")) *format = SAMPLE_FORMAT_FLOAT32_PLANAR;
+	else return false;
+
+	return true;
+}
+
+const char * sample_format_name(sample_format_t format) {
+	switch(format) {
+		case SAMPLE_FORMAT_INT16:          return "int16";
+		case SAMPLE_FORMAT_FLOAT32:        return "float32";
+		case SAMPLE_FORMAT_FLOAT32_PLANAR: return "float32-planar";
+		default:                           return "uint8";
+	}
+}
+
+bool convert_kernel_supported(convert_kernel_t kernel) {
+	switch(kernel) {
+		case CONVERT_KERNEL_LUT: return true;
+
+		#ifdef JS_RTLSDR_CONVERT_X86
+		case CONVERT_KERNEL_SSE2: __builtin_cpu_init(); return __builtin_cpu_supports("sse2");
+		case CONVERT_KERNEL_AVX2: __builtin_cpu_init(); return __builtin_cpu_supports("avx2");
+		#endif
+
+		default: return false;
+	}
+}
+
+convert_kernel_t convert_best_kernel() {
+	static const convert_kernel_t best =
+		convert_kernel_supported(CONVERT_KERNEL_AVX2) ? CONVERT_KERNEL_AVX2 :
+		convert_kernel_supported(CONVERT_KERNEL_SSE2) ? CONVERT_KERNEL_SSE2 :
+		CONVERT_KERNEL_LUT;
+
+	return best;
+}
+
+void convert_samples(sample_format_t format, const uint8_t * in, size_t len, void * out) {
+	kernels[convert_best_kernel()][format](in, len, out);
+}
+
+void convert_samples_with(convert_kernel_t kernel, sample_format_t format, const uint8_t * in, size_t len, void * out) {
+	if(!convert_kernel_supported(kernel)) kernel = CONVERT_KERNEL_LUT;
+	kernels[kernel][format](in, len, out);
+}
+
+// plain loops; the compiler vectorises these at the addon's optimisation level
+void encode_samples(sample_format_t format, const float * in, size_t len, void * out) {
+	switch(format) {
+		case SAMPLE_FORMAT_UINT8: {
+			uint8_t * o = (uint8_t *) out;
+			for(size_t i = 0; i < len; i++) {
+				const float x = in[i] * 127.5f + CONVERT_OFFSET;
+				o[i] = (uint8_t) (x <= 0 ? 0 : x >= 255 ? 255 : lrintf(x));
+			}
+			break;
+		}
+
+		case SAMPLE_FORMAT_INT16: {
+			int16_t * o = (int16_t *) out;
+			for(size_t i = 0; i < len; i++) {
+				const float x = in[i] * (float) CONVERT_INT16_OFFSET;
+				o[i] = (int16_t) (x <= -32768 ? -32768 : x >= 32767 ? 32767 : lrintf(x));
+			}
+			break;
+		}
+
+		case SAMPLE_FORMAT_FLOAT32:
+			memcpy(out, in, len * sizeof(float));
+			break;
+
+		case SAMPLE_FORMAT_FLOAT32_PLANAR: {
+			const size_t pairs = len / 2;
+			float * o = (float *) out;
+			for(size_t k = 0; k < pairs; k++) {
+				o[k] = in[2 * k];
+				o[pairs + k] = in[2 * k + 1];
+			}
+
+			if(len & 1) o[len - 1] = in[len - 1];
+			break;
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef JS_RTLSDR_CONVERT_GRAB_H
+#define JS_RTLSDR_CONVERT_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// output layouts for offset-binary uint8 I/Q samples
+typedef enum sample_format {
+	SAMPLE_FORMAT_UINT8 = 0,     // raw bytes, exactly as librtlsdr delivers them
+	SAMPLE_FORMAT_INT16,         // interleaved I/Q, signed 16-bit, x * 256 - 32640
+	SAMPLE_FORMAT_FLOAT32,       // interleaved I/Q, (x - 127.5) / 127.5
+	SAMPLE_FORMAT_FLOAT32_PLANAR // every I, then every Q, (x - 127.5) / 127.5
+} sample_format_t;
+
+typedef enum convert_kernel {
+	CONVERT_KERNEL_LUT = 0, // portable 256-entry lookup table
+	CONVERT_KERNEL_SSE2,
+	CONVERT_KERNEL_AVX2
+} convert_kernel_t;
+
+// bytes of output per byte of input
+size_t sample_format_size(sample_format_t format);
+
+bool parse_sample_format(const char * name, sample_format_t * format);
+const char * sample_format_name(sample_format_t format);
+
+// the fastest kernel this CPU supports
+convert_kernel_t convert_best_kernel(void);
+bool convert_kernel_supported(convert_kernel_t kernel);
+
+// Convert len bytes of I/Q into out, which must hold len * sample_format_size(format) bytes. For the planar format
+// the I plane is out[0, len / 2) and the Q plane follows; an odd trailing byte lands in the last element.
+void convert_samples(sample_format_t format, const uint8_t * in, size_t len, void * out);
+void convert_samples_with(convert_kernel_t kernel, sample_format_t format, const uint8_t * in, size_t len, void * out);
+
+// The inverse, for samples that were processed as float: encode len interleaved floats (-1.0 to 1.0) into out, which
+// must hold len * sample_format_size(format) bytes. Out-of-range values saturate.
+void encode_samples(sample_format_t format, const float * in, size_t len, void * out);
+
+#endif
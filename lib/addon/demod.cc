@@ -0,0 +1,356 @@
+#include <cmath>
+#include <cstring>
+#include "demod.h"
+#include "fir.h"
+
+bool parse_demod_mode(const char * name, demod_mode_t * mode) {
+	if(0 == strcmp(name, "wbfm"))      *mode = DEMOD_MODE_WBFM;
+	else if(0 == strcmp(name, "nbfm")) *mode = DEMOD_MODE_NBFM;
+	else if(0 == strcmp(name, "am"))   *mode = DEMOD_MODE_AM;
+	else if(0 == strcmp(name, "usb"))  *mode = DEMOD_MODE_USB;
+	else if(0 == strcmp(name, "lsb"))  *mode = DEMOD_MODE_LSB;
+	else if(0 == strcmp(name, "cw"))   *mode = DEMOD_MODE_CW;
+	else return false;
+
+	return true;
+}
+
+const char * demod_mode_name(demod_mode_t mode) {
+	switch(mode) {
+		case DEMOD_MODE_NBFM: return "nbfm";
+		case DEMOD_MODE_AM:   return "am";
+		case DEMOD_MODE_USB:  return "usb";
+		case DEMOD_MODE_LSB:  return "lsb";
+		case DEMOD_MODE_CW:   return "cw";
+		default:              return "wbfm";
+	}
+}
+
+static bool is_fm(demod_mode_t mode) {
+	return mode == DEMOD_MODE_WBFM || mode == DEMOD_MODE_NBFM;
+}
+
+Mixer::Mixer(double offset, uint32_t rate) : table(2 * DEMOD_MIXER_BLOCK), oscillator(2 * DEMOD_MIXER_BLOCK) {
+	const double w = -2 * M_PI * offset / rate;
+
+	for(size_t n = 0; n < DEMOD_MIXER_BLOCK; n++) {
+		this->table[2 * n] = (float) cos(w * n);
+		this->table[2 * n + 1] = (float) sin(w * n);
+	}
+
+	this->step_re = cos(w * DEMOD_MIXER_BLOCK);
+	this->step_im = sin(w * DEMOD_MIXER_BLOCK);
+}
+
+void Mixer::Process(const float * in, size_t len, float * out) {
+	const size_t pairs = len / 2;
+
+	for(size_t k = 0; k < pairs;) {
+		if(this->index == 0) {
+			// this block's oscillator: the block phasor times the fixed table
+			const float pr = (float) this->phase_re, pi = (float) this->phase_im;
+			const float * t = this->table.data();
+			float * o = this->oscillator.data();
+
+			for(size_t n = 0; n < 2 * DEMOD_MIXER_BLOCK; n += 2) {
+				o[n] = pr * t[n] - pi * t[n + 1];
+				o[n + 1] = pr * t[n + 1] + pi * t[n];
+			}
+		}
+
+		const size_t run = DEMOD_MIXER_BLOCK - this->index < pairs - k ? DEMOD_MIXER_BLOCK - this->index : pairs - k;
+		const float * o = &this->oscillator[2 * this->index];
+		const float * x = in + 2 * k;
+		float * y = out + 2 * k;
+
+		for(size_t n = 0; n < 2 * run; n += 2) {
+			const float re = x[n] * o[n] - x[n + 1] * o[n + 1];
+			const float im = x[n] * o[n + 1] + x[n + 1] * o[n];
+			y[n] = re;
+			y[n + 1] = im;
+		}
+
+		k += run;
+		this->index += run;
+
+		if(this->index == DEMOD_MIXER_BLOCK) {
+			this->index = 0;
+
+			const double re = this->phase_re * this->step_re - this->phase_im * this->step_im;
+			const double im = this->phase_re * this->step_im + this->phase_im * this->step_re;
+			const double norm = 1 / sqrt(re * re + im * im); // keep the magnitude from drifting
+			this->phase_re = re * norm;
+			this->phase_im = im * norm;
+		}
+	}
+}
+
+Agc::Agc(uint32_t rate)
+	: attack((float) (1 - exp(-1 / (rate * DEMOD_AGC_ATTACK)))), decay((float) (1 - exp(-1 / (rate * DEMOD_AGC_DECAY)))),
+	  envelope((float) (DEMOD_AGC_TARGET / DEMOD_AGC_MAX_GAIN)) {}
+
+void Agc::Process(float * x, size_t len) {
+	const float floor = (float) (DEMOD_AGC_TARGET / DEMOD_AGC_MAX_GAIN);
+	float envelope = this->envelope;
+
+	for(size_t n = 0; n < len; n++) {
+		const float level = fabsf(x[n]);
+		envelope += (level > envelope ? this->attack : this->decay) * (level - envelope);
+		if(envelope < floor) envelope = floor;
+
+		const float y = x[n] * ((float) DEMOD_AGC_TARGET / envelope);
+		x[n] = y > 1 ? 1 : (y < -1 ? -1 : y);
+	}
+
+	this->envelope = envelope;
+}
+
+/* static */ demod_options_t Demodulator::Resolve(const demod_options_t & opts) {
+	demod_options_t out = opts;
+	double bandwidth = 0, deviation = 0, deemphasis = 0, pitch = 0;
+
+	switch(opts.mode) {
+		case DEMOD_MODE_WBFM: bandwidth = 200000; deviation = 75000; deemphasis = 75; break;
+		case DEMOD_MODE_NBFM: bandwidth = 16000;  deviation = 5000; break;
+		case DEMOD_MODE_AM:   bandwidth = 10000; break;
+		case DEMOD_MODE_USB:
+		case DEMOD_MODE_LSB:  bandwidth = 2800; break;
+		case DEMOD_MODE_CW:   bandwidth = 500; pitch = 700; break;
+	}
+
+	if(out.bandwidth < 0) out.bandwidth = bandwidth;
+	if(out.deviation < 0) out.deviation = deviation;
+	if(out.deemphasis < 0) out.deemphasis = deemphasis;
+	if(out.pitch < 0) out.pitch = pitch;
+	if(out.agc < 0) out.agc = is_fm(opts.mode) ? 0 : 1;
+	return out;
+}
+
+// where the first mixer puts 0 Hz: the middle of the channel, which for SSB is half the bandwidth to one side of
+// the suppressed carrier at offset
+static double tune_for(const demod_options_t & opts) {
+	switch(opts.mode) {
+		case DEMOD_MODE_USB: return opts.offset + opts.bandwidth / 2;
+		case DEMOD_MODE_LSB: return opts.offset - opts.bandwidth / 2;
+		default:             return opts.offset;
+	}
+}
+
+// the BFO's shift, which puts the suppressed carrier back at 0 Hz (SSB) or the carrier at the pitch (CW)
+static double bfo_for(const demod_options_t & opts) {
+	switch(opts.mode) {
+		case DEMOD_MODE_USB: return -opts.bandwidth / 2;
+		case DEMOD_MODE_LSB: return opts.bandwidth / 2;
+		case DEMOD_MODE_CW:  return -opts.pitch;
+		default:             return 0;
+	}
+}
+
+// the smallest whole multiple of the audio rate that holds the channel, but no more than the input rate
+static uint32_t if_rate_for(const demod_options_t & opts, uint32_t input_rate) {
+	const uint32_t multiple = (uint32_t) ceil(opts.bandwidth / opts.audio_rate);
+	const uint64_t rate = (uint64_t) (multiple > 0 ? multiple : 1) * opts.audio_rate;
+	return rate < input_rate ? (uint32_t) rate : input_rate;
+}
+
+// enough taps for a transition band of about half the channel's width; narrow channels at a wide IF need more
+static size_t channel_taps_for(const demod_options_t & opts, uint32_t if_rate) {
+	const double taps = ceil(8 * if_rate / opts.bandwidth);
+	if(taps < DEMOD_CHANNEL_TAPS) return DEMOD_CHANNEL_TAPS;
+	return taps > DEMOD_MAX_CHANNEL_TAPS ? DEMOD_MAX_CHANNEL_TAPS : (size_t) taps;
+}
+
+/* static */ bool Demodulator::Valid(const demod_options_t & opts_in, uint32_t input_rate, std::string * err) {
+	const demod_options_t opts = Demodulator::Resolve(opts_in);
+
+	if(opts.audio_rate > input_rate) {
+		*err = "the audio rate must not exceed the input sample rate";
+		return false;
+	}
+
+	if(!(opts.bandwidth > 0 && fabs(tune_for(opts)) + opts.bandwidth / 2 <= input_rate / 2.0)) {
+		*err = opts.mode == DEMOD_MODE_USB || opts.mode == DEMOD_MODE_LSB
+		       ? "the sideband (offset to offset +/- bandwidth) must lie within the input band"
+		       : "the channel (offset +/- bandwidth / 2) must lie within the input band";
+		return false;
+	}
+
+	if(is_fm(opts.mode) && !(opts.deviation > 0 && opts.deviation < if_rate_for(opts, input_rate) / 2.0)) {
+		*err = "the deviation must be positive and less than half the IF rate";
+		return false;
+	}
+
+	if((opts.mode == DEMOD_MODE_USB || opts.mode == DEMOD_MODE_LSB) && !(opts.bandwidth < opts.audio_rate / 2.0)) {
+		*err = "the sideband's bandwidth must be less than half the audio rate";
+		return false;
+	}
+
+	if(opts.mode == DEMOD_MODE_CW && !(opts.pitch > 0 && opts.pitch + opts.bandwidth / 2 < opts.audio_rate / 2.0)) {
+		*err = "the CW pitch must be positive, and the pitch plus half the bandwidth less than half the audio rate";
+		return false;
+	}
+
+	return true;
+}
+
+Demodulator::Demodulator(const demod_options_t & opts, uint32_t input_rate)
+	: opts(Demodulator::Resolve(opts)), if_rate(if_rate_for(this->opts, input_rate)),
+	  ntaps(channel_taps_for(this->opts, this->if_rate)), mixer(tune_for(this->opts), input_rate),
+	  decimator(input_rate, this->if_rate), bfo(bfo_for(this->opts), this->if_rate),
+	  audio_resampler(this->if_rate, this->opts.audio_rate), agc(this->opts.audio_rate),
+	  history(2 * (this->ntaps - 1), 0.0f) {
+	// the decimator already band-limits to 0.45 of the IF rate; narrower channels need the channel filter
+	const double cutoff = this->opts.bandwidth / 2 / this->if_rate;
+	const std::vector<float> proto = fir_design_lowpass(this->ntaps, cutoff < 0.5 ? cutoff : 0.5, 1.0);
+	this->taps = fir_prepare_taps(proto.data(), this->ntaps);
+
+	this->fm_gain = is_fm(this->opts.mode) ? (float) (this->if_rate / (2 * M_PI * this->opts.deviation)) : 1;
+	this->carrier_alpha = (float) (1 / (this->if_rate * DEMOD_AM_CARRIER_TIME));
+
+	if(this->opts.deemphasis > 0)
+		this->deemphasis_alpha = (float) (1 - exp(-1 / (this->opts.audio_rate * this->opts.deemphasis * 1e-6)));
+
+	this->squelch_window = (size_t) (this->if_rate * DEMOD_SQUELCH_WINDOW);
+	this->squelch_open_level = pow(10, this->opts.squelch_level / 10);
+	this->squelch_close_level = pow(10, (this->opts.squelch_level - DEMOD_SQUELCH_HYSTERESIS) / 10);
+}
+
+size_t Demodulator::Process(const float * in, size_t len) {
+	len -= len % 2;
+	if(this->iq.size() < len) this->iq.resize(len);
+
+	this->mixer.Process(in, len, this->iq.data());
+	const size_t pairs = this->decimator.Process(this->iq.data(), len) / 2;
+
+	this->Filter(pairs);
+
+	switch(this->opts.mode) {
+		case DEMOD_MODE_WBFM:
+		case DEMOD_MODE_NBFM: this->Discriminate(pairs); break;
+		case DEMOD_MODE_AM:   this->Envelope(pairs); break;
+		default:              this->Beat(pairs); break;
+	}
+
+	if(this->opts.squelch) this->Squelch(pairs);
+
+	const size_t out = this->audio_resampler.Process(this->baseband.data(), 2 * pairs) / 2;
+
+	this->audio.resize(out);
+	for(size_t n = 0; n < out; n++) this->audio[n] = this->baseband[2 * n];
+
+	if(this->deemphasis_alpha > 0) this->Deemphasize(out);
+	if(this->opts.agc) this->agc.Process(this->audio.data(), out);
+	return out;
+}
+
+// channel filter the decimated IF in place
+void Demodulator::Filter(size_t pairs) {
+	this->history.insert(this->history.end(), this->iq.begin(), this->iq.begin() + 2 * pairs);
+
+	for(size_t n = 0; n < pairs; n++)
+		fir_dot(&this->history[2 * n], this->taps.data(), this->ntaps, &this->iq[2 * n]);
+
+	this->history.erase(this->history.begin(), this->history.begin() + 2 * pairs);
+}
+
+// atan(z) for |z| <= 1, to about 1e-5 radians
+static inline float atan_unit(float z) {
+	const float z2 = z * z;
+	return z * (0.99997726f + z2 * (-0.33262347f + z2 * (0.19354346f + z2 * (-0.11643287f + z2 * (0.05265332f
+	           + z2 * -0.01172120f)))));
+}
+
+// branch-free atan2 from atan_unit, so the discriminator loop vectorises
+static inline float fast_atan2(float y, float x) {
+	const float ax = fabsf(x), ay = fabsf(y);
+	const float big = ax > ay ? ax : ay, small = ax > ay ? ay : ax;
+	float a = atan_unit(big > 0 ? small / big : 0);
+
+	a = ay > ax ? (float) M_PI_2 - a : a;
+	a = x < 0 ? (float) M_PI - a : a;
+	return y < 0 ? -a : a;
+}
+
+// polar discriminator: the phase step between consecutive IF samples is the instantaneous frequency
+void Demodulator::Discriminate(size_t pairs) {
+	this->baseband.resize(2 * pairs);
+	const float * x = this->iq.data();
+	float * out = this->baseband.data();
+
+	if(pairs == 0) return;
+
+	// x[n] * conj(x[n - 1])
+	out[0] = fast_atan2(x[1] * this->last_re - x[0] * this->last_im, x[0] * this->last_re + x[1] * this->last_im);
+	for(size_t n = 1; n < pairs; n++) {
+		const float re = x[2 * n] * x[2 * n - 2] + x[2 * n + 1] * x[2 * n - 1];
+		const float im = x[2 * n + 1] * x[2 * n - 2] - x[2 * n] * x[2 * n - 1];
+		out[2 * n] = fast_atan2(im, re);
+	}
+
+	for(size_t n = 0; n < pairs; n++) {
+		out[2 * n] *= this->fm_gain;
+		out[2 * n + 1] = 0;
+	}
+
+	this->last_re = x[2 * pairs - 2];
+	this->last_im = x[2 * pairs - 1];
+}
+
+// AM: the envelope, less its running average (the carrier)
+void Demodulator::Envelope(size_t pairs) {
+	this->baseband.resize(2 * pairs);
+	const float * x = this->iq.data();
+	float * out = this->baseband.data();
+
+	for(size_t n = 0; n < pairs; n++) {
+		out[2 * n] = sqrtf(x[2 * n] * x[2 * n] + x[2 * n + 1] * x[2 * n + 1]);
+		out[2 * n + 1] = 0;
+	}
+
+	float carrier = this->carrier;
+	for(size_t n = 0; n < pairs; n++) {
+		carrier += this->carrier_alpha * (out[2 * n] - carrier);
+		out[2 * n] -= carrier;
+	}
+
+	this->carrier = carrier;
+}
+
+// SSB and CW: the real part of the filtered channel once the BFO has shifted it to audio
+void Demodulator::Beat(size_t pairs) {
+	this->baseband.resize(2 * pairs);
+	float * out = this->baseband.data();
+
+	this->bfo.Process(this->iq.data(), 2 * pairs, out);
+	for(size_t n = 0; n < pairs; n++) out[2 * n + 1] = 0;
+}
+
+// mute the demodulated signal while the channel's power, measured a window at a time, is below the squelch level;
+// each window is muted or not by the decision of the window before it
+void Demodulator::Squelch(size_t pairs) {
+	const float * x = this->iq.data();
+	float * out = this->baseband.data();
+
+	for(size_t n = 0; n < pairs; n++) {
+		this->squelch_power += x[2 * n] * x[2 * n] + x[2 * n + 1] * x[2 * n + 1];
+		if(!this->squelch_open) out[2 * n] = 0;
+
+		if(++this->squelch_count < this->squelch_window) continue;
+
+		const double mean = this->squelch_power / this->squelch_count;
+		this->squelch_open = mean >= (this->squelch_open ? this->squelch_close_level : this->squelch_open_level);
+		this->squelch_power = 0;
+		this->squelch_count = 0;
+	}
+}
+
+// single-pole lowpass with the de-emphasis time constant
+void Demodulator::Deemphasize(size_t len) {
+	float y = this->deemphasis_state;
+	for(size_t n = 0; n < len; n++) this->audio[n] = y += this->deemphasis_alpha * (this->audio[n] - y);
+	this->deemphasis_state = y;
+}
+
+size_t Demodulator::MaxOutput(size_t len) const {
+	return this->audio_resampler.MaxOutput(this->decimator.MaxOutput(len)) / 2;
+}
@@ -0,0 +1,144 @@
+#ifndef JS_RTLSDR_DEMOD_GRAB_H
+#define JS_RTLSDR_DEMOD_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "resampler.h"
+
+#define DEMOD_MAX_RECEIVERS   (64)
+#define DEMOD_CHANNEL_TAPS    (64)   // least taps of the FIR channel filter at the IF rate
+#define DEMOD_MAX_CHANNEL_TAPS (1024)
+#define DEMOD_MIXER_BLOCK     (256)  // oscillator samples precomputed per mixer block
+#define DEMOD_SQUELCH_WINDOW  (0.01) // seconds of IF averaged per squelch decision
+#define DEMOD_SQUELCH_HYSTERESIS (3.0) // dB below the open level at which the squelch closes again
+#define DEMOD_AM_CARRIER_TIME (0.05) // seconds over which the AM carrier level is averaged out of the envelope
+#define DEMOD_AGC_TARGET      (0.5)  // peak audio level the AGC holds
+#define DEMOD_AGC_ATTACK      (0.002) // seconds for the AGC to pull the gain down on a louder signal
+#define DEMOD_AGC_DECAY       (0.5)  // seconds for the AGC to let the gain back up
+#define DEMOD_AGC_MAX_GAIN    (100000.0)
+
+typedef enum demod_mode {
+	DEMOD_MODE_WBFM = 0, // broadcast FM: 200 kHz, 75 kHz deviation, 75 us de-emphasis
+	DEMOD_MODE_NBFM,     // narrowband FM: 16 kHz, 5 kHz deviation, no de-emphasis
+	DEMOD_MODE_AM,       // AM envelope: 10 kHz
+	DEMOD_MODE_USB,      // upper sideband: 2.8 kHz above the offset
+	DEMOD_MODE_LSB,      // lower sideband: 2.8 kHz below the offset
+	DEMOD_MODE_CW        // CW: 500 Hz around the offset, heard as a 700 Hz tone
+} demod_mode_t;
+
+bool parse_demod_mode(const char * name, demod_mode_t * mode);
+const char * demod_mode_name(demod_mode_t mode);
+
+// Negative values stand for the mode's default.
+typedef struct demod_options {
+	demod_mode_t mode = DEMOD_MODE_WBFM;
+	double       offset = 0;         // Hz from the center of the input band
+	double       bandwidth = -1;     // Hz, both sidebands
+	double       deviation = -1;     // Hz of FM deviation that demodulates to full scale
+	double       deemphasis = -1;    // time constant in microseconds; 0 for none
+	bool         squelch = false;
+	double       squelch_level = 0;  // dBFS of channel power below which the audio is muted
+	double       pitch = -1;         // Hz of the CW tone
+	int          agc = -1;           // 0 or 1; on for every mode but FM
+	uint32_t     audio_rate = 48000;
+} demod_options_t;
+
+// The mixer / decimator front end of a receiver: shifts offset Hz to 0 with a numerically controlled oscillator,
+// then resamples to if_rate. The oscillator is a block of precomputed phasors rotated by a double-precision phasor
+// per block, so each sample costs two complex multiplies that the compiler vectorises.
+class Mixer {
+public:
+	Mixer(double offset, uint32_t rate);
+
+	// out[0, len) = in[0, len) * e^(-2 pi i offset t); in and out may be the same
+	void Process(const float * in, size_t len, float * out);
+
+private:
+	std::vector<float> table; // e^(-2 pi i offset n / rate) for n < DEMOD_MIXER_BLOCK
+	double step_re, step_im;  // the rotation over a whole block
+	double phase_re = 1, phase_im = 0;
+	size_t index = 0;         // position within the current block
+	std::vector<float> oscillator;
+};
+
+// Automatic gain control for real audio: a peak envelope that rises within DEMOD_AGC_ATTACK and falls within
+// DEMOD_AGC_DECAY sets the gain that holds it at DEMOD_AGC_TARGET, up to DEMOD_AGC_MAX_GAIN.
+class Agc {
+public:
+	explicit Agc(uint32_t rate);
+
+	void Process(float * x, size_t len);
+
+private:
+	const float attack, decay;
+	float envelope;
+};
+
+// One receiver: mixer, decimation to an IF rate of a whole multiple of audio_rate, a channel filter of bandwidth,
+// demodulation, resampling to audio_rate, de-emphasis, and AGC. Every mode shares the chain and differs only in the
+// demodulator: FM takes the phase step, AM the envelope less its carrier, and SSB and CW the real part after a
+// second mixer (the BFO) moves the filtered sideband or carrier up to audio. Produces mono float audio from -1.0 to
+// 1.0.
+class Demodulator {
+public:
+	// opts must satisfy Demodulator::Valid for input_rate; defaults are filled in from the mode
+	Demodulator(const demod_options_t & opts, uint32_t input_rate);
+
+	static bool Valid(const demod_options_t & opts, uint32_t input_rate, std::string * err);
+
+	// opts with the mode's defaults filled in
+	static demod_options_t Resolve(const demod_options_t & opts);
+
+	// demodulate len interleaved floats; returns how many audio samples were produced, available from Output until
+	// the next call
+	size_t Process(const float * iq, size_t len);
+
+	const float * Output(void) const { return this->audio.data(); }
+
+	// the most audio samples Process can produce for len floats of input
+	size_t MaxOutput(size_t len) const;
+
+	uint32_t IfRate(void) const { return this->if_rate; }
+	const demod_options_t & Options(void) const { return this->opts; }
+
+private:
+	void Filter(size_t pairs);
+	void Discriminate(size_t pairs);
+	void Envelope(size_t pairs);
+	void Beat(size_t pairs);
+	void Squelch(size_t pairs);
+	void Deemphasize(size_t len);
+
+	const demod_options_t opts;
+	const uint32_t if_rate;
+	const size_t ntaps;
+	Mixer mixer;
+	Resampler decimator;
+	Mixer bfo;                  // SSB and CW: moves the filtered channel up to audio
+	Resampler audio_resampler;  // runs on the demodulated signal as I, with Q held at 0
+	Agc agc;
+
+	std::vector<float> taps;    // prepared channel filter
+	std::vector<float> history; // channel filter input: history, then new samples
+	std::vector<float> iq;      // mixed and decimated input, then the filtered IF
+	std::vector<float> baseband; // demodulated IF-rate signal, interleaved with zeros for the audio resampler
+	std::vector<float> audio;
+
+	float last_re = 0, last_im = 0; // previous IF sample, for the discriminator
+	float fm_gain;                  // radians per IF sample to full scale
+	float carrier_alpha;            // AM: per IF sample weight of the carrier average
+	float carrier = 0;
+	float deemphasis_alpha = 0;     // 0 for none
+	float deemphasis_state = 0;
+	double squelch_power = 0;       // sum over the current window
+	size_t squelch_count = 0;
+	size_t squelch_window;          // IF samples
+	double squelch_open_level;      // linear mean power
+	double squelch_close_level;
+	bool squelch_open = false;
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include "device_backend.h"
+#include "file_device.h"
+
+int backend_close(rtlsdr_dev_t * dev) {
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_close(dev);
+
+	delete file;
+	return 0;
+}
+
+int backend_set_xtal_freq(rtlsdr_dev_t * dev, std::mutex & control, uint32_t rtl_freq, uint32_t tuner_freq) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_set_xtal_freq(dev, rtl_freq, tuner_freq);
+
+	if(rtl_freq > 0) file->settings.rtl_xtal = rtl_freq;
+	if(tuner_freq > 0) file->settings.tuner_xtal = tuner_freq;
+	return 0;
+}
+
+int backend_get_xtal_freq(rtlsdr_dev_t * dev, std::mutex & control, uint32_t * rtl_freq, uint32_t * tuner_freq) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_get_xtal_freq(dev, rtl_freq, tuner_freq);
+
+	if(rtl_freq != NULL) *rtl_freq = file->settings.rtl_xtal;
+	if(tuner_freq != NULL) *tuner_freq = file->settings.tuner_xtal;
+	return 0;
+}
+
+int backend_get_usb_strings(rtlsdr_dev_t * dev, std::mutex & control, char * manufact, char * product, char * serial) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_get_usb_strings(dev, manufact, product, serial);
+
+	// librtlsdr's strings are at most 256 bytes, terminator included
+	const std::string & path = file->Path();
+	const size_t slash = path.rfind('/');
+	const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+	if(manufact != NULL) snprintf(manufact, 256, "%s", "js-rtlsdr");
+	if(product != NULL) snprintf(product, 256, "%s", "file replay");
+	if(serial != NULL) snprintf(serial, 256, "%s", name.c_str());
+	return 0;
+}
+
+int backend_write_eeprom(rtlsdr_dev_t * dev, std::mutex & control, uint8_t * data, uint8_t offset, uint16_t len) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_write_eeprom(dev, data, offset, len);
+	return -3;
+}
+
+int backend_read_eeprom(rtlsdr_dev_t * dev, std::mutex & control, uint8_t * data, uint8_t offset, uint16_t len) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_read_eeprom(dev, data, offset, len);
+	return -3;
+}
+
+int backend_set_center_freq(rtlsdr_dev_t * dev, std::mutex & control, uint32_t freq) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_set_center_freq(dev, freq);
+
+	file->settings.center_freq = freq;
+	return 0;
+}
+
+uint32_t backend_get_center_freq(rtlsdr_dev_t * dev, std::mutex & control) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_get_center_freq(dev);
+
+	return file->settings.center_freq;
+}
+
+int backend_set_freq_correction(rtlsdr_dev_t * dev, std::mutex & control, int ppm) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_set_freq_correction(dev, ppm);
+
+	// librtlsdr reports an unchanged correction with -2
+	if(file->settings.freq_correction.exchange(ppm) == ppm) return -2;
+	return 0;
+}
+
+int backend_get_freq_correction(rtlsdr_dev_t * dev, std::mutex & control) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_get_freq_correction(dev);
+
+	return file->settings.freq_correction;
+}
+
+enum rtlsdr_tuner backend_get_tuner_type(rtlsdr_dev_t * dev, std::mutex & control) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_get_tuner_type(dev);
+	return RTLSDR_TUNER_UNKNOWN;
+}
+
+int backend_get_tuner_gains(rtlsdr_dev_t * dev, std::mutex & control, int * gains) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_get_tuner_gains(dev, gains);
+	return 0;
+}
+
+int backend_set_tuner_gain(rtlsdr_dev_t * dev, std::mutex & control, int gain) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_set_tuner_gain(dev, gain);
+
+	file->settings.tuner_gain = gain;
+	return 0;
+}
+
+int backend_set_tuner_bandwidth(rtlsdr_dev_t * dev, std::mutex & control, uint32_t bw) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_set_tuner_bandwidth(dev, bw);
+	return 0;
+}
+
+int backend_get_tuner_gain(rtlsdr_dev_t * dev, std::mutex & control) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_get_tuner_gain(dev);
+
+	return file->settings.tuner_gain;
+}
+
+int backend_set_tuner_if_gain(rtlsdr_dev_t * dev, std::mutex & control, int stage, int gain) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_set_tuner_if_gain(dev, stage, gain);
+	return 0;
+}
+
+int backend_set_tuner_gain_mode(rtlsdr_dev_t * dev, std::mutex & control, int manual) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_set_tuner_gain_mode(dev, manual);
+	return 0;
+}
+
+int backend_set_sample_rate(rtlsdr_dev_t * dev, std::mutex & control, uint32_t rate) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_set_sample_rate(dev, rate);
+
+	// a recording cannot be resampled by retuning
+	return rate == file->SampleRate() ? 0 : -EINVAL;
+}
+
+uint32_t backend_get_sample_rate(rtlsdr_dev_t * dev, std::mutex & control) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_get_sample_rate(dev);
+
+	return file->SampleRate();
+}
+
+int backend_set_testmode(rtlsdr_dev_t * dev, std::mutex & control, int on) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_set_testmode(dev, on);
+	return 0;
+}
+
+int backend_set_agc_mode(rtlsdr_dev_t * dev, std::mutex & control, int on) {
+	std::lock_guard<std::mutex> lock(control);
+	if(FileDevice::Find(dev) == NULL) return rtlsdr_set_agc_mode(dev, on);
+	return 0;
+}
+
+int backend_set_direct_sampling(rtlsdr_dev_t * dev, std::mutex & control, int on) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_set_direct_sampling(dev, on);
+
+	file->settings.direct_sampling = on;
+	return 0;
+}
+
+int backend_get_direct_sampling(rtlsdr_dev_t * dev, std::mutex & control) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_get_direct_sampling(dev);
+
+	return file->settings.direct_sampling;
+}
+
+int backend_set_offset_tuning(rtlsdr_dev_t * dev, std::mutex & control, int on) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_set_offset_tuning(dev, on);
+
+	file->settings.offset_tuning = on;
+	return 0;
+}
+
+int backend_get_offset_tuning(rtlsdr_dev_t * dev, std::mutex & control) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_get_offset_tuning(dev);
+
+	return file->settings.offset_tuning;
+}
+
+int backend_reset_buffer(rtlsdr_dev_t * dev, std::mutex & control) {
+	std::lock_guard<std::mutex> lock(control);
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_reset_buffer(dev);
+
+	return file->ResetBuffer();
+}
+
+int backend_read_sync(rtlsdr_dev_t * dev, void * buf, int len, int * n_read) {
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_read_sync(dev, buf, len, n_read);
+
+	return file->ReadSync(buf, len, n_read);
+}
+
+int backend_wait_async(rtlsdr_dev_t * dev, rtlsdr_read_async_cb_t cb, void * ctx) {
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_wait_async(dev, cb, ctx);
+
+	return file->ReadAsync(cb, ctx, 0);
+}
+
+int backend_read_async(rtlsdr_dev_t * dev, rtlsdr_read_async_cb_t cb, void * ctx, uint32_t buf_num, uint32_t buf_len) {
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_read_async(dev, cb, ctx, buf_num, buf_len);
+
+	// the mapping is the buffer, so buf_num has nothing to size
+	return file->ReadAsync(cb, ctx, buf_len);
+}
+
+int backend_cancel_async(rtlsdr_dev_t * dev) {
+	FileDevice * file = FileDevice::Find(dev);
+	if(file == NULL) return rtlsdr_cancel_async(dev);
+
+	return file->CancelAsync();
+}
@@ -0,0 +1,45 @@
+#ifndef JS_RTLSDR_DEVICE_BACKEND_GRAB_H
+#define JS_RTLSDR_DEVICE_BACKEND_GRAB_H
+
+#include <rtl-sdr.h>
+#include <stdint.h>
+#include <mutex>
+
+// The librtlsdr calls the addon makes on an open device, each dispatched to librtlsdr or, for a handle that stands
+// for a FileDevice, to the recording. Arguments and results are librtlsdr's. A recording keeps whatever it is told
+// except its sample rate, which is fixed; it has no EEPROM, no gain table, and an unknown tuner. The control calls,
+// from backend_set_xtal_freq to backend_reset_buffer, hold control, the device's mutex (see DeviceContext), so any
+// of the device's threads may make them.
+
+int backend_close(rtlsdr_dev_t * dev);
+int backend_set_xtal_freq(rtlsdr_dev_t * dev, std::mutex & control, uint32_t rtl_freq, uint32_t tuner_freq);
+int backend_get_xtal_freq(rtlsdr_dev_t * dev, std::mutex & control, uint32_t * rtl_freq, uint32_t * tuner_freq);
+int backend_get_usb_strings(rtlsdr_dev_t * dev, std::mutex & control, char * manufact, char * product, char * serial);
+int backend_write_eeprom(rtlsdr_dev_t * dev, std::mutex & control, uint8_t * data, uint8_t offset, uint16_t len);
+int backend_read_eeprom(rtlsdr_dev_t * dev, std::mutex & control, uint8_t * data, uint8_t offset, uint16_t len);
+int backend_set_center_freq(rtlsdr_dev_t * dev, std::mutex & control, uint32_t freq);
+uint32_t backend_get_center_freq(rtlsdr_dev_t * dev, std::mutex & control);
+int backend_set_freq_correction(rtlsdr_dev_t * dev, std::mutex & control, int ppm);
+int backend_get_freq_correction(rtlsdr_dev_t * dev, std::mutex & control);
+enum rtlsdr_tuner backend_get_tuner_type(rtlsdr_dev_t * dev, std::mutex & control);
+int backend_get_tuner_gains(rtlsdr_dev_t * dev, std::mutex & control, int * gains);
+int backend_set_tuner_gain(rtlsdr_dev_t * dev, std::mutex & control, int gain);
+int backend_set_tuner_bandwidth(rtlsdr_dev_t * dev, std::mutex & control, uint32_t bw);
+int backend_get_tuner_gain(rtlsdr_dev_t * dev, std::mutex & control);
+int backend_set_tuner_if_gain(rtlsdr_dev_t * dev, std::mutex & control, int stage, int gain);
+int backend_set_tuner_gain_mode(rtlsdr_dev_t * dev, std::mutex & control, int manual);
+int backend_set_sample_rate(rtlsdr_dev_t * dev, std::mutex & control, uint32_t rate);
+uint32_t backend_get_sample_rate(rtlsdr_dev_t * dev, std::mutex & control);
+int backend_set_testmode(rtlsdr_dev_t * dev, std::mutex & control, int on);
+int backend_set_agc_mode(rtlsdr_dev_t * dev, std::mutex & control, int on);
+int backend_set_direct_sampling(rtlsdr_dev_t * dev, std::mutex & control, int on);
+int backend_get_direct_sampling(rtlsdr_dev_t * dev, std::mutex & control);
+int backend_set_offset_tuning(rtlsdr_dev_t * dev, std::mutex & control, int on);
+int backend_get_offset_tuning(rtlsdr_dev_t * dev, std::mutex & control);
+int backend_reset_buffer(rtlsdr_dev_t * dev, std::mutex & control);
+int backend_read_sync(rtlsdr_dev_t * dev, void * buf, int len, int * n_read);
+int backend_wait_async(rtlsdr_dev_t * dev, rtlsdr_read_async_cb_t cb, void * ctx);
+int backend_read_async(rtlsdr_dev_t * dev, rtlsdr_read_async_cb_t cb, void * ctx, uint32_t buf_num, uint32_t buf_len);
+int backend_cancel_async(rtlsdr_dev_t * dev);
+
+#endif
@@ -0,0 +1,261 @@
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "capture_group.h"
+#include "device_backend.h"
+#include "device_context.h"
+#include "device_task.h"
+#include "sample_reader.h"
+
+DeviceContext::~DeviceContext() {
+	this->Shutdown();
+
+	// a group still completing outlives the device too
+	if(this->group != NULL) this->group->Disown(this);
+
+	// readers still delivering outlive the device; a paused one must still drain and complete
+	for(size_t i = 0; i < this->delivering.size(); i++) {
+		this->delivering[i]->SetOwner(NULL);
+		this->delivering[i]->Resume();
+	}
+}
+
+int DeviceContext::Start(const reader_thread_opts_t & opts, std::string * err) {
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	this->thread = std::thread(&DeviceContext::Run, this, opts);
+	while(!this->started) this->wake.wait(lock);
+
+	if(this->start_err != 0) {
+		*err = this->start_msg;
+		lock.unlock();
+		this->thread.join();
+		return this->start_err;
+	}
+
+	this->control.Start();
+	return 0;
+}
+
+bool DeviceContext::Accepting() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->AcceptingLocked();
+}
+
+bool DeviceContext::Submit(SampleReader * reader) {
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if(!this->AcceptingLocked()) return false;
+
+		this->pending = reader;
+		this->wake.notify_all();
+	}
+
+	reader->SetOwner(this);
+	this->delivering.push_back(reader);
+	return true;
+}
+
+bool DeviceContext::Post(DeviceTask * task) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if(this->exiting || !this->thread.joinable()) return false;
+
+	this->tasks.push_back(task);
+	this->wake.notify_all();
+	return true;
+}
+
+// caller holds mutex
+bool DeviceContext::AcceptingLocked() {
+	if(this->exiting || !this->thread.joinable()) return false;
+	if(this->pending != NULL) return false;
+	if(this->group != NULL && !this->group->Cancelled()) return false;
+	return this->active == NULL || this->cancelling;
+}
+
+int DeviceContext::Cancel() {
+	this->Resume();
+
+	if(this->group != NULL) {
+		this->group->Cancel();
+		return 0;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		if(this->active != NULL) {
+			this->cancelling = true;
+			this->active->Cancel(false);
+
+			// a sweep polls its cancel flag between rtlsdr_read_sync calls; there is no async read to cancel
+			if(this->active->Sweeping()) return 0;
+		}
+	}
+
+	return backend_cancel_async(this->rtl_dev);
+}
+
+void DeviceContext::Shutdown() {
+	this->control.Shutdown();
+
+	// a member waiting for the rest of its group to start would otherwise never see the cancel
+	if(this->group != NULL) this->group->Cancel();
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if(!this->thread.joinable()) return;
+
+		this->exiting = true;
+
+		// a producer blocked on a full queue would otherwise never see the cancel
+		if(this->active != NULL) this->active->Cancel(true);
+		this->wake.notify_all();
+	}
+
+	backend_cancel_async(this->rtl_dev);
+	this->thread.join();
+}
+
+void DeviceContext::Resume() {
+	for(size_t i = 0; i < this->delivering.size(); i++) this->delivering[i]->Resume();
+}
+
+void DeviceContext::Delivering(SampleReader * reader) {
+	reader->SetOwner(this);
+	this->delivering.push_back(reader);
+}
+
+void DeviceContext::Completed(SampleReader * reader) {
+	for(size_t i = 0; i < this->delivering.size(); i++) {
+		if(this->delivering[i] == reader) {
+			this->delivering.erase(this->delivering.begin() + i);
+			return;
+		}
+	}
+}
+
+bool DeviceContext::Correction(iq_correction_estimates_t * out) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->active != NULL && this->active->Correction(out);
+}
+
+int DeviceContext::Snapshot(double pre_ms, double post_ms) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->active != NULL ? this->active->Snapshot(pre_ms, post_ms) : -1;
+}
+
+bool DeviceContext::RecordStats(recorder_stats_t * out) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->active != NULL && this->active->RecordStats(out);
+}
+
+void DeviceContext::Run(reader_thread_opts_t opts) {
+	std::string msg;
+	const int err = DeviceContext::ApplyThreadOpts(opts, &msg);
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->started = true;
+	this->start_err = err;
+	this->start_msg = msg;
+	this->wake.notify_all();
+
+	if(err != 0) return;
+
+	for(;;) {
+		while(this->pending == NULL && this->tasks.empty() && !this->exiting) this->wake.wait(lock);
+
+		if(this->exiting) {
+			if(this->pending != NULL) this->pending->Abort("the device was closed before the read started");
+			this->pending = NULL;
+
+			for(size_t i = 0; i < this->tasks.size(); i++)
+				this->tasks[i]->Abort("the device was closed before the task ran");
+			this->tasks.clear();
+			return;
+		}
+
+		if(!this->tasks.empty()) {
+			DeviceTask * task = this->tasks.front();
+			this->tasks.pop_front();
+			lock.unlock();
+
+			// the task may be freed by the main thread as soon as this returns
+			task->Run(this->rtl_dev, this->control_mutex, &this->buffer_reset);
+
+			lock.lock();
+			continue;
+		}
+
+		SampleReader * reader = this->active = this->pending;
+		this->pending = NULL;
+		this->cancelling = false;
+		lock.unlock();
+
+		reader->Execute();
+
+		lock.lock();
+		this->active = NULL;
+		this->buffer_reset = false;
+
+		// the reader may be freed by the main thread as soon as this returns
+		reader->Finish();
+	}
+}
+
+/* static */ int DeviceContext::ApplyThreadOpts(const reader_thread_opts_t & opts, std::string * err) {
+	int result;
+
+	if(!opts.cpus.empty()) {
+		#ifdef __linux__
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for(size_t i = 0; i < opts.cpus.size(); i++) CPU_SET(opts.cpus[i], &cpus);
+
+		result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+		if(result != 0) {
+			*err = std::string("could not set reader thread CPU affinity: ") + strerror(result);
+			return result;
+		}
+		#else
+		*err = "reader thread CPU affinity is not supported on this platform";
+		return ENOTSUP;
+		#endif
+	}
+
+	if(opts.fifo_priority > 0) {
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = opts.fifo_priority;
+
+		result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if(result != 0) {
+			*err = std::string("could not set reader thread SCHED_FIFO priority: ") + strerror(result);
+			return result;
+		}
+	}
+
+	if(opts.has_nice) {
+		#ifdef __linux__
+		// on Linux, nice values are per-thread when addressed by tid
+		if(setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), opts.nice) != 0) {
+			result = errno;
+			*err = std::string("could not set reader thread nice value: ") + strerror(result);
+			return result;
+		}
+		#else
+		*err = "reader thread nice values are not supported on this platform";
+		return ENOTSUP;
+		#endif
+	}
+
+	return 0;
+}
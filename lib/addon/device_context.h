@@ -0,0 +1,127 @@
+#ifndef JS_RTLSDR_DEVICE_CONTEXT_GRAB_H
+#define JS_RTLSDR_DEVICE_CONTEXT_GRAB_H
+
+#include <rtl-sdr.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "command_queue.h"
+#include "iq_correct.h"
+#include "recorder.h"
+#include "stream_stats.h"
+
+class CaptureGroup;
+class DeviceTask;
+class SampleReader;
+
+// scheduling applied to a device's capture thread when it starts
+typedef struct reader_thread_opts {
+	std::vector<int> cpus;          // CPU affinity; empty means any CPU
+	int              fifo_priority = 0; // SCHED_FIFO priority 1-99; 0 leaves the default policy
+	bool             has_nice = false;
+	int              nice = 0;      // per-thread nice value, Linux only
+} reader_thread_opts_t;
+
+// Native state for one open device. Each device owns a capture thread, started by open and joined by close, that
+// runs the blocking rtlsdr_read_async loop so streaming never occupies a libuv threadpool slot. Between reads the
+// thread also runs posted DeviceTasks, in the order they were posted and ahead of a queued reader; a CaptureGroup
+// streams through one of those, and the device takes no reads until the group has been cancelled. Settings and
+// EEPROM commands run on a second, control thread (see CommandQueue), so that they apply while a read streams.
+class DeviceContext {
+public:
+	explicit DeviceContext(rtlsdr_dev_t * rtl_dev) : rtl_dev(rtl_dev), control(rtl_dev, control_mutex) {}
+	~DeviceContext();
+
+	// start the capture thread and wait until it has applied opts, then the control thread; returns 0 or an errno
+	// value, with a description in err
+	int Start(const reader_thread_opts_t & opts, std::string * err);
+
+	// whether Submit would accept a reader right now: no read is queued, any active read or capture group has been
+	// cancelled, and the thread is running
+	bool Accepting(void);
+
+	// main thread: hand a reader to the capture thread; false if !Accepting(). The thread owns the reader
+	// afterwards.
+	bool Submit(SampleReader * reader);
+
+	// main thread: queue a task for the capture thread; false if the thread is not running. The thread owns the
+	// task afterwards, and aborts it if the device closes first.
+	bool Post(DeviceTask * task);
+
+	// main thread: queue a command for the control thread (see CommandQueue::Post)
+	bool Command(DeviceTask * task) { return this->control.Post(task); }
+
+	// rtlsdr_cancel_async the active read (or stop the active sweep), if any, and allow the next Submit to queue
+	// behind it. Paused readers are resumed, so that a producer blocked on a full queue sees the cancel.
+	int Cancel(void);
+
+	// main thread: SampleReader::Resume every submitted reader that has not completed
+	void Resume(void);
+
+	// main thread: a reader that was not submitted, a fan-out's pipeline, delivers on the device's behalf from now on,
+	// until Completed, as a submitted reader does
+	void Delivering(SampleReader * reader);
+
+	// main thread: a submitted or Delivering reader has emitted 'done' or 'error'
+	void Completed(SampleReader * reader);
+
+	// main thread: the device streams in group, whose member has been posted, until the group Leaves; Cancel and
+	// Shutdown cancel the whole group
+	void Join(CaptureGroup * group) { this->group = group; }
+	void Leave(CaptureGroup * group) { if(this->group == group) this->group = NULL; }
+
+	// cancel any active read, release a blocked producer, and join the capture thread; abort queued commands and
+	// join the control thread. Idempotent.
+	void Shutdown(void);
+
+	// the DC / I/Q correction of the active read; false if there is no active read or it does not correct samples
+	bool Correction(iq_correction_estimates_t * out);
+
+	// SampleReader::Snapshot on the active read; -1 if there is no active read or it keeps no history
+	int Snapshot(double pre_ms, double post_ms);
+
+	// the active read's recording statistics; false if there is no active read or it does not record
+	bool RecordStats(recorder_stats_t * out);
+
+	// the device's streaming counters, which every reader submitted to it must share
+	const std::shared_ptr<StreamStats> & Stats(void) const { return this->stats; }
+
+	rtlsdr_dev_t * Device(void) const { return this->rtl_dev; }
+
+	// the mutex the device's control calls hold (see device_backend.h); it lives until the context is deleted, after
+	// Shutdown has joined both threads
+	std::mutex & ControlMutex(void) { return this->control_mutex; }
+
+private:
+	void Run(reader_thread_opts_t opts);
+	bool AcceptingLocked(void);
+	static int ApplyThreadOpts(const reader_thread_opts_t & opts, std::string * err);
+
+	rtlsdr_dev_t * const rtl_dev;
+	const std::shared_ptr<StreamStats> stats = std::make_shared<StreamStats>();
+	std::mutex control_mutex;
+	CommandQueue control;
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+
+	SampleReader * pending = NULL;
+	SampleReader * active = NULL;
+	std::deque<DeviceTask *> tasks;
+	bool buffer_reset = false; // capture thread: a task has called rtlsdr_reset_buffer since the last read
+	std::vector<SampleReader *> delivering; // main thread: submitted readers that have not completed
+	CaptureGroup * group = NULL; // main thread: the capture group the device streams in, if any
+	bool cancelling = false;
+	bool exiting = false;
+
+	bool started = false;
+	int start_err = 0;
+	std::string start_msg;
+};
+
+#endif
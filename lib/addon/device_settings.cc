@@ -0,0 +1,80 @@
+#include "device_backend.h"
+#include "device_settings.h"
+
+typedef enum setting_check {
+	SETTING_CHECK_NONE,     // the synchronous setter ignores the result
+	SETTING_CHECK_NEGATIVE,
+	SETTING_CHECK_NONZERO
+} setting_check_t;
+
+static const char * const setting_fns[DEVICE_SETTING_COUNT] = {
+	"rtlsdr_set_sample_rate",
+	"rtlsdr_set_direct_sampling",
+	"rtlsdr_set_offset_tuning",
+	"rtlsdr_set_freq_correction",
+	"rtlsdr_set_center_freq",
+	"rtlsdr_set_tuner_bandwidth",
+	"rtlsdr_set_tuner_gain_mode",
+	"rtlsdr_set_tuner_gain",
+	"rtlsdr_set_agc_mode",
+	"rtlsdr_set_testmode"
+};
+
+static const setting_check_t setting_checks[DEVICE_SETTING_COUNT] = {
+	SETTING_CHECK_NONZERO,
+	SETTING_CHECK_NONZERO,
+	SETTING_CHECK_NONZERO,
+	SETTING_CHECK_NONE,
+	SETTING_CHECK_NONE,
+	SETTING_CHECK_NONZERO,
+	SETTING_CHECK_NONZERO,
+	SETTING_CHECK_NEGATIVE,
+	SETTING_CHECK_NONZERO,
+	SETTING_CHECK_NONZERO
+};
+
+static int apply_setting(rtlsdr_dev_t * dev, std::mutex & control, device_setting_t setting, int64_t value) {
+	switch(setting) {
+		case DEVICE_SETTING_SAMPLE_RATE:     return backend_set_sample_rate(dev, control, (uint32_t) value);
+		case DEVICE_SETTING_DIRECT_SAMPLING: return backend_set_direct_sampling(dev, control, (int) value);
+		case DEVICE_SETTING_OFFSET_TUNING:   return backend_set_offset_tuning(dev, control, (int) value);
+		case DEVICE_SETTING_FREQ_CORRECTION: return backend_set_freq_correction(dev, control, (int) value);
+		case DEVICE_SETTING_CENTER_FREQ:     return backend_set_center_freq(dev, control, (uint32_t) value);
+		case DEVICE_SETTING_TUNER_BANDWIDTH: return backend_set_tuner_bandwidth(dev, control, (uint32_t) value);
+		case DEVICE_SETTING_TUNER_GAIN_MODE: return backend_set_tuner_gain_mode(dev, control, (int) value);
+		case DEVICE_SETTING_TUNER_GAIN:      return backend_set_tuner_gain(dev, control, (int) value);
+		case DEVICE_SETTING_AGC_MODE:        return backend_set_agc_mode(dev, control, (int) value);
+		case DEVICE_SETTING_TESTMODE:        return backend_set_testmode(dev, control, (int) value);
+		default:                             return 0;
+	}
+}
+
+void merge_device_settings(device_settings_t * pending, const device_settings_t & later) {
+	if(later.set[DEVICE_SETTING_TUNER_GAIN_MODE] && !later.set[DEVICE_SETTING_TUNER_GAIN])
+		pending->set[DEVICE_SETTING_TUNER_GAIN] = false;
+
+	for(int i = 0; i < DEVICE_SETTING_COUNT; i++) {
+		if(!later.set[i]) continue;
+
+		pending->set[i] = true;
+		pending->value[i] = later.value[i];
+	}
+}
+
+int apply_device_settings(rtlsdr_dev_t * dev, std::mutex & control, const device_settings_t & settings,
+                          std::string * err) {
+	for(int i = 0; i < DEVICE_SETTING_COUNT; i++) {
+		if(!settings.set[i]) continue;
+
+		const int result = apply_setting(dev, control, (device_setting_t) i, settings.value[i]);
+		const bool failed = (setting_checks[i] == SETTING_CHECK_NEGATIVE && result < 0) ||
+		                    (setting_checks[i] == SETTING_CHECK_NONZERO && result != 0);
+
+		if(failed) {
+			*err = std::string(setting_fns[i]) + " failed with code " + std::to_string(result);
+			return result;
+		}
+	}
+
+	return 0;
+}
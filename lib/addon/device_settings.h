@@ -0,0 +1,43 @@
+#ifndef JS_RTLSDR_DEVICE_SETTINGS_GRAB_H
+#define JS_RTLSDR_DEVICE_SETTINGS_GRAB_H
+
+#include <stdint.h>
+#include <rtl-sdr.h>
+#include <mutex>
+#include <string>
+
+// The device settings a batch can change, in the order apply_device_settings applies them: the sample rate and
+// input path first, since the tuner's frequency and filters depend on them, then tuning, then gain mode ahead of
+// the gain it governs.
+typedef enum device_setting {
+	DEVICE_SETTING_SAMPLE_RATE = 0,
+	DEVICE_SETTING_DIRECT_SAMPLING,
+	DEVICE_SETTING_OFFSET_TUNING,
+	DEVICE_SETTING_FREQ_CORRECTION,
+	DEVICE_SETTING_CENTER_FREQ,
+	DEVICE_SETTING_TUNER_BANDWIDTH,
+	DEVICE_SETTING_TUNER_GAIN_MODE,
+	DEVICE_SETTING_TUNER_GAIN,
+	DEVICE_SETTING_AGC_MODE,
+	DEVICE_SETTING_TESTMODE,
+	DEVICE_SETTING_COUNT
+} device_setting_t;
+
+// a batch of settings to apply together; value[s] is librtlsdr's argument for setting s, if set[s]
+typedef struct device_settings {
+	bool    set[DEVICE_SETTING_COUNT] = {};
+	int64_t value[DEVICE_SETTING_COUNT] = {};
+} device_settings_t;
+
+// fold later into pending, as though pending were applied and then later: later's values win, and a gain mode
+// change drops a pending gain that later does not repeat, since setting a gain switches most tuners to manual
+void merge_device_settings(device_settings_t * pending, const device_settings_t & later);
+
+// apply every setting in settings, in device_setting_t order, stopping at the first that librtlsdr rejects; control
+// is dev's control mutex (see device_backend.h). Errors are judged as the synchronous setters judge them:
+// rtlsdr_set_center_freq and rtlsdr_set_freq_correction never fail. Returns 0, or librtlsdr's error with a
+// description in err.
+int apply_device_settings(rtlsdr_dev_t * dev, std::mutex & control, const device_settings_t & settings,
+                          std::string * err);
+
+#endif
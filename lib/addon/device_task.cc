@@ -0,0 +1,168 @@
+#include "device_backend.h"
+#include "device_task.h"
+
+using v8::Local;
+using v8::Value;
+
+DeviceTask::DeviceTask() : env(AddonEnv::Current()) {
+	this->async = new uv_async_t;
+	this->env->InitAsync(this->async, &DeviceTask::AsyncComplete, &DeviceTask::AsyncClose);
+	this->async->data = this;
+}
+
+DeviceTask::~DeviceTask() {}
+
+// the last thing the capture thread does with a task; the main thread may free it right after
+void DeviceTask::Run(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool * buffer_reset) {
+	this->Execute(rtl_dev, control, buffer_reset);
+	uv_async_send(this->async);
+}
+
+void DeviceTask::Abort(const char * msg) {
+	this->error = msg;
+	uv_async_send(this->async);
+}
+
+void DeviceTask::Discard() {
+	this->env->CloseAsync(this->async);
+}
+
+/* static */ NAUV_WORK_CB(DeviceTask::AsyncComplete) {
+	DeviceTask * task = static_cast<DeviceTask *>(async->data);
+	task->Complete();
+	task->env->CloseAsync(task->async);
+}
+
+/* static */ void DeviceTask::AsyncClose(uv_handle_t * handle) {
+	DeviceTask * task = static_cast<DeviceTask *>(handle->data);
+	delete reinterpret_cast<uv_async_t *>(handle);
+	delete task;
+}
+
+ReadIntoTask::ReadIntoTask(Local<v8::Object> buffer, uint8_t * data, uint32_t len, Nan::Callback * callback)
+	: data(data), len(len), callback(callback) {
+	this->buffer.Reset(buffer);
+}
+
+ReadIntoTask::~ReadIntoTask() {
+	this->buffer.Reset();
+	delete this->callback;
+}
+
+void ReadIntoTask::Execute(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool * buffer_reset) {
+	int err = 0;
+
+	// the first synchronous read after a stream starts from a fresh buffer; later ones continue where it left off
+	if(buffer_reset == NULL || !*buffer_reset) {
+		err = backend_reset_buffer(rtl_dev, control);
+		if(err < 0) {
+			this->error = "rtlsdr_reset_buffer failed with code " + std::to_string(err);
+			return;
+		}
+
+		if(buffer_reset != NULL) *buffer_reset = true;
+	}
+
+	err = backend_read_sync(rtl_dev, this->data, (int) this->len, &this->n_read);
+	if(err < 0) this->error = "rtlsdr_read_sync failed with code " + std::to_string(err);
+}
+
+void ReadIntoTask::Complete() {
+	Nan::HandleScope scope;
+
+	if(this->error.empty()) {
+		Local<Value> argv[] = {Nan::Null(), Nan::New<v8::Number>(this->n_read)};
+		this->callback->Call(2, argv);
+	} else {
+		Local<Value> argv[] = {Nan::Error(this->error.c_str())};
+		this->callback->Call(1, argv);
+	}
+}
+
+SettingsTask::SettingsTask(const device_settings_t & settings, Nan::Callback * callback) : settings(settings) {
+	this->callbacks.push_back(callback);
+}
+
+SettingsTask::~SettingsTask() {
+	for(size_t i = 0; i < this->callbacks.size(); i++) delete this->callbacks[i];
+}
+
+bool SettingsTask::Absorb(DeviceTask * later) {
+	const device_settings_t * later_settings = later->Settings();
+	if(later_settings == NULL) return false;
+
+	SettingsTask * other = static_cast<SettingsTask *>(later);
+	merge_device_settings(&this->settings, *later_settings);
+	this->callbacks.insert(this->callbacks.end(), other->callbacks.begin(), other->callbacks.end());
+	other->callbacks.clear();
+	return true;
+}
+
+void SettingsTask::Execute(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool *) {
+	apply_device_settings(rtl_dev, control, this->settings, &this->error);
+}
+
+void SettingsTask::Complete() {
+	Nan::HandleScope scope;
+
+	for(size_t i = 0; i < this->callbacks.size(); i++) {
+		if(this->error.empty()) {
+			Local<Value> argv[] = {Nan::Null(), Nan::New<v8::Number>((double) this->callbacks.size())};
+			this->callbacks[i]->Call(2, argv);
+		} else {
+			Local<Value> argv[] = {Nan::Error(this->error.c_str())};
+			this->callbacks[i]->Call(1, argv);
+		}
+	}
+}
+
+EepromTask::EepromTask(uint8_t offset, uint16_t len, const uint8_t * data, Nan::Callback * callback)
+	: offset(offset), len(len), write(data != NULL), callback(callback) {
+	if(data != NULL) this->data.assign(data, data + len);
+	else this->data.resize(len);
+}
+
+EepromTask::~EepromTask() {
+	delete this->callback;
+}
+
+void EepromTask::Execute(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool *) {
+	const char * fn = this->write ? "rtlsdr_write_eeprom" : "rtlsdr_read_eeprom";
+	const int err = this->write ? backend_write_eeprom(rtl_dev, control, this->data.data(), this->offset, this->len)
+	                            : backend_read_eeprom(rtl_dev, control, this->data.data(), this->offset, this->len);
+
+	switch(err) {
+		case 0:
+			return;
+		case -1:
+			this->error = std::string(fn) + ": the device handle is invalid (error -1)";
+			return;
+		case -2:
+			this->error = std::string(fn) + ": the EEPROM size is exceeded (error -2)";
+			return;
+		case -3:
+			this->error = std::string(fn) + ": no EEPROM was found (error -3)";
+			return;
+		default:
+			if(err < 0) this->error = std::string(fn) + " failed with code " + std::to_string(err);
+	}
+}
+
+void EepromTask::Complete() {
+	Nan::HandleScope scope;
+
+	if(!this->error.empty()) {
+		Local<Value> argv[] = {Nan::Error(this->error.c_str())};
+		this->callback->Call(1, argv);
+	} else if(this->write) {
+		Local<Value> argv[] = {Nan::Null()};
+		this->callback->Call(1, argv);
+	} else {
+		Local<Value> argv[] = {
+			Nan::Null(),
+			Nan::CopyBuffer((const char *) this->data.data(), (uint32_t) this->data.size()).ToLocalChecked()
+		};
+
+		this->callback->Call(2, argv);
+	}
+}
@@ -0,0 +1,118 @@
+#ifndef JS_RTLSDR_DEVICE_TASK_GRAB_H
+#define JS_RTLSDR_DEVICE_TASK_GRAB_H
+
+#include <rtl-sdr.h>
+#include <node.h>
+#include <nan.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "addon_env.h"
+#include "device_settings.h"
+
+// One job run on one of a device's threads -- its capture thread between reads (see DeviceContext::Post), or its
+// control thread (see CommandQueue) -- whose result is reported back on the main thread through its own uv_async_t.
+// A task frees itself on the main thread after Complete.
+class DeviceTask {
+public:
+	DeviceTask();
+	virtual ~DeviceTask();
+
+	// worker thread: run the task against the device, whose control calls hold control. buffer_reset is whether
+	// rtlsdr_reset_buffer has been called since the last streaming read, for tasks that read with rtlsdr_read_sync;
+	// NULL on the control thread.
+	void Run(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool * buffer_reset);
+
+	// any thread: give up without running
+	void Abort(const char * msg);
+
+	// main thread, before this task has started: take over later's work, so that later need not run; false if
+	// the two cannot be combined. An absorbed task must be Discarded.
+	virtual bool Absorb(DeviceTask * /* later */) { return false; }
+
+	// the settings this task applies, or NULL if it is not a SettingsTask
+	virtual const device_settings_t * Settings(void) const { return NULL; }
+
+	// main thread: free a task that was never posted or was absorbed, without completing it
+	void Discard(void);
+
+protected:
+	// worker thread: set error if the task fails
+	virtual void Execute(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool * buffer_reset) = 0;
+
+	// main thread: report the result (or error) to JS
+	virtual void Complete(void) = 0;
+
+	std::string error;
+
+private:
+	static NAUV_WORK_CB(AsyncComplete);
+	static void AsyncClose(uv_handle_t * handle);
+
+	AddonEnv * const env;
+	uv_async_t *     async;
+};
+
+// rtlsdr_read_sync straight into a JS-owned buffer, so that a polling reader can reuse one buffer indefinitely.
+// The buffer is held by a persistent handle until the read completes, and callback is called with (err) or
+// (null, bytes read).
+class ReadIntoTask : public DeviceTask {
+public:
+	ReadIntoTask(v8::Local<v8::Object> buffer, uint8_t * data, uint32_t len, Nan::Callback * callback);
+	~ReadIntoTask();
+
+protected:
+	void Execute(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool * buffer_reset);
+	void Complete(void);
+
+private:
+	Nan::Persistent<v8::Object> buffer;
+	uint8_t * const             data;
+	const uint32_t              len;
+	int                         n_read = 0;
+	Nan::Callback *             callback;
+};
+
+// A batch of device settings applied together with apply_device_settings on the control thread. A batch posted
+// while another is still queued is merged into it with merge_device_settings, and every merged caller's callback
+// is called, in the order they were posted, with (err) or (null, the number of batches merged).
+class SettingsTask : public DeviceTask {
+public:
+	SettingsTask(const device_settings_t & settings, Nan::Callback * callback);
+	~SettingsTask();
+
+	bool Absorb(DeviceTask * later);
+	const device_settings_t * Settings(void) const { return &this->settings; }
+
+protected:
+	void Execute(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool * buffer_reset);
+	void Complete(void);
+
+private:
+	device_settings_t            settings;
+	std::vector<Nan::Callback *> callbacks;
+};
+
+// rtlsdr_read_eeprom or rtlsdr_write_eeprom on the control thread. A read calls back with (err) or (null, Buffer);
+// a write, which copies its data when posted, with (err) or (null).
+class EepromTask : public DeviceTask {
+public:
+	// read len bytes at offset if data is NULL, otherwise write data's len bytes there
+	EepromTask(uint8_t offset, uint16_t len, const uint8_t * data, Nan::Callback * callback);
+	~EepromTask();
+
+protected:
+	void Execute(rtlsdr_dev_t * rtl_dev, std::mutex & control, bool * buffer_reset);
+	void Complete(void);
+
+private:
+	const uint8_t        offset;
+	const uint16_t       len;
+	const bool           write;
+	std::vector<uint8_t> data;
+	Nan::Callback *      callback;
+};
+
+#endif
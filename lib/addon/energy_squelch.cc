@@ -0,0 +1,62 @@
+#include <cmath>
+#include "energy_squelch.h"
+
+// full scale is |x|^2 = 1, i.e. squares[I] + squares[Q] = 255^2
+#define ENERGY_SQUELCH_FULL_SCALE (255.0 * 255.0)
+
+EnergySquelch::EnergySquelch(const energy_squelch_options_t & opts) : window(opts.window) {
+	for(int x = 0; x < 256; x++) this->squares[x] = (uint16_t) ((2 * x - 255) * (2 * x - 255));
+
+	this->open_level = pow(10, opts.level / 10) * ENERGY_SQUELCH_FULL_SCALE;
+	this->close_level = pow(10, (opts.level - opts.hysteresis) / 10) * ENERGY_SQUELCH_FULL_SCALE;
+}
+
+const std::vector<squelch_segment_t> & EnergySquelch::Process(const uint8_t * buf, uint32_t len) {
+	const uint32_t pairs = len / 2;
+	squelch_segment_t * current = NULL;
+
+	this->segments.clear();
+	this->segments.reserve(pairs / this->window + 2); // only allocates for the first, or a longer, transfer
+
+	for(uint32_t from = 0; from < pairs; from += this->window) {
+		const uint32_t count = pairs - from < this->window ? pairs - from : this->window;
+		const uint8_t * x = buf + 2 * from;
+		uint64_t sum = 0;
+
+		for(uint32_t n = 0; n < 2 * count; n++) sum += this->squares[x[n]];
+
+		const double threshold = this->open ? this->close_level : this->open_level;
+		const bool open = (double) sum >= threshold * count;
+
+		if(open) {
+			if(current == NULL) {
+				squelch_segment_t segment;
+				segment.start = 2 * from;
+				segment.offset = this->position + from;
+				segment.opened = !this->open;
+
+				this->segments.push_back(segment);
+				current = &this->segments.back();
+			}
+
+			current->len += 2 * count;
+		} else if(this->open) {
+			if(current != NULL) {
+				current->closed = true;
+			} else {
+				squelch_segment_t segment;
+				segment.start = 2 * from;
+				segment.offset = this->position + from;
+				segment.closed = true;
+				this->segments.push_back(segment);
+			}
+
+			current = NULL;
+		}
+
+		this->open = open;
+	}
+
+	this->position += pairs;
+	return this->segments;
+}
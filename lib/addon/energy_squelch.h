@@ -0,0 +1,49 @@
+#ifndef JS_RTLSDR_ENERGY_SQUELCH_GRAB_H
+#define JS_RTLSDR_ENERGY_SQUELCH_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define ENERGY_SQUELCH_MIN_WINDOW     (16)      // complex samples per decision
+#define ENERGY_SQUELCH_MAX_WINDOW     (1048576)
+#define ENERGY_SQUELCH_DEFAULT_WINDOW (2048)
+
+typedef struct energy_squelch_options {
+	double   level = -30;     // dBFS of mean power at which the squelch opens
+	double   hysteresis = 3;  // dB below level at which it closes again
+	uint32_t window = ENERGY_SQUELCH_DEFAULT_WINDOW;
+} energy_squelch_options_t;
+
+// one run of open windows within a transfer, or a bare close at the start of one
+typedef struct squelch_segment {
+	uint32_t start = 0;  // bytes into the transfer
+	uint32_t len = 0;    // bytes; 0 for a close that fell on the transfer's first window
+	uint64_t offset = 0; // complex samples since the first transfer, at start
+	bool     opened = false; // the squelch opened at start
+	bool     closed = false; // the squelch closed at start + len
+} squelch_segment_t;
+
+// Power gate over raw offset-binary uint8 I/Q. Each transfer is cut into windows of `window` complex samples (the
+// last one may be short), and each window's mean power, taken from a 256-entry table of squared deviations, opens
+// or closes the squelch with hysteresis. Only the open windows are reported, as segments of the transfer.
+class EnergySquelch {
+public:
+	explicit EnergySquelch(const energy_squelch_options_t & opts);
+
+	// gate one transfer; the segments are valid until the next call
+	const std::vector<squelch_segment_t> & Process(const uint8_t * buf, uint32_t len);
+
+	bool Open(void) const { return this->open; }
+
+private:
+	const uint32_t window;
+	double   open_level;  // levels in squares[I] + squares[Q] per complex sample
+	double   close_level;
+	uint16_t squares[256]; // (2x - 255)^2: the squared deviation from the midpoint, in half steps
+	bool open = false;
+	uint64_t position = 0;
+	std::vector<squelch_segment_t> segments;
+};
+
+#endif
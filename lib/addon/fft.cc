@@ -0,0 +1,137 @@
+#include <cmath>
+#include <map>
+#include <mutex>
+#include "fft.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* static */ bool FftPlan::ValidSize(size_t size) {
+	return size >= FFT_MIN_SIZE && size <= FFT_MAX_SIZE && (size & (size - 1)) == 0;
+}
+
+/* static */ std::shared_ptr<const FftPlan> FftPlan::Get(size_t size) {
+	static std::mutex mutex;
+	static std::map<size_t, std::shared_ptr<const FftPlan> > plans;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	std::shared_ptr<const FftPlan> & plan = plans[size];
+	if(!plan) plan = std::make_shared<FftPlan>(size);
+	return plan;
+}
+
+FftPlan::FftPlan(size_t size) : size(size) {
+	while(((size_t) 1 << this->log2_size) < size) this->log2_size++;
+
+	for(uint32_t i = 0; i < size; i++) {
+		uint32_t reversed = 0;
+		for(unsigned b = 0; b < this->log2_size; b++) reversed |= ((i >> b) & 1) << (this->log2_size - 1 - b);
+
+		if(i < reversed) {
+			this->swaps.push_back(i);
+			this->swaps.push_back(reversed);
+		}
+	}
+
+	for(size_t m = (this->log2_size & 1) ? 2 : 1; m < size; m *= 4) {
+		for(int r = 1; r <= 3; r++) {
+			for(size_t k = 0; k < m; k++) {
+				const double angle = -2 * M_PI * (double) (r * k) / (double) (4 * m);
+				this->twiddles.push_back((float) cos(angle));
+				this->twiddles.push_back((float) sin(angle));
+			}
+		}
+	}
+}
+
+void FftPlan::Permute(float * iq) const {
+	double * pairs = (double *) iq; // swap whole complex samples
+
+	for(size_t i = 0; i < this->swaps.size(); i += 2) {
+		const double t = pairs[this->swaps[i]];
+		pairs[this->swaps[i]] = pairs[this->swaps[i + 1]];
+		pairs[this->swaps[i + 1]] = t;
+	}
+}
+
+#ifdef __SSE2__
+// two complex products a * w at once
+static inline __m128 complex_mul(__m128 a, __m128 w) {
+	const __m128 sign = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+	const __m128 w_re = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+	const __m128 w_im = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+	const __m128 swapped = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+
+	return _mm_add_ps(_mm_mul_ps(a, w_re), _mm_mul_ps(_mm_mul_ps(swapped, w_im), sign));
+}
+#endif
+
+// After the bit-reversal permutation, the four span-m blocks of each span-4m group hold the DFTs of the samples
+// congruent to 0, 2, 1, and 3 modulo 4 (within that group's decimation), in that order.
+void FftPlan::Forward(float * iq) const {
+	const size_t n = this->size;
+	this->Permute(iq);
+
+	size_t m = 1;
+	if(this->log2_size & 1) {
+		for(size_t i = 0; i < 2 * n; i += 4) {
+			const float ar = iq[i], ai = iq[i + 1], br = iq[i + 2], bi = iq[i + 3];
+			iq[i]     = ar + br;
+			iq[i + 1] = ai + bi;
+			iq[i + 2] = ar - br;
+			iq[i + 3] = ai - bi;
+		}
+
+		m = 2;
+	}
+
+	const float * tw = this->twiddles.data();
+
+	for(; m < n; tw += 6 * m, m *= 4) {
+		const float * w1 = tw, * w2 = tw + 2 * m, * w3 = tw + 4 * m;
+
+		for(size_t base = 0; base < n; base += 4 * m) {
+			float * x0 = iq + 2 * base, * x1 = x0 + 2 * m, * x2 = x1 + 2 * m, * x3 = x2 + 2 * m;
+			size_t k = 0;
+
+			#ifdef __SSE2__
+			// multiplying by -i takes (re, im) to (im, -re)
+			const __m128 negate_im = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+
+			for(; k + 2 <= m; k += 2) {
+				const size_t j = 2 * k;
+				const __m128 a = _mm_loadu_ps(x0 + j);
+				const __m128 c = complex_mul(_mm_loadu_ps(x1 + j), _mm_loadu_ps(w2 + j));
+				const __m128 b = complex_mul(_mm_loadu_ps(x2 + j), _mm_loadu_ps(w1 + j));
+				const __m128 d = complex_mul(_mm_loadu_ps(x3 + j), _mm_loadu_ps(w3 + j));
+
+				const __m128 s0 = _mm_add_ps(a, c), d0 = _mm_sub_ps(a, c);
+				const __m128 s1 = _mm_add_ps(b, d), d1 = _mm_sub_ps(b, d);
+				const __m128 rot = _mm_xor_ps(_mm_shuffle_ps(d1, d1, _MM_SHUFFLE(2, 3, 0, 1)), negate_im);
+
+				_mm_storeu_ps(x0 + j, _mm_add_ps(s0, s1));
+				_mm_storeu_ps(x1 + j, _mm_add_ps(d0, rot));
+				_mm_storeu_ps(x2 + j, _mm_sub_ps(s0, s1));
+				_mm_storeu_ps(x3 + j, _mm_sub_ps(d0, rot));
+			}
+			#endif
+
+			for(; k < m; k++) {
+				const size_t j = 2 * k;
+				const float ar = x0[j], ai = x0[j + 1];
+				const float cr = x1[j] * w2[j] - x1[j + 1] * w2[j + 1], ci = x1[j] * w2[j + 1] + x1[j + 1] * w2[j];
+				const float br = x2[j] * w1[j] - x2[j + 1] * w1[j + 1], bi = x2[j] * w1[j + 1] + x2[j + 1] * w1[j];
+				const float dr = x3[j] * w3[j] - x3[j + 1] * w3[j + 1], di = x3[j] * w3[j + 1] + x3[j + 1] * w3[j];
+
+				const float s0r = ar + cr, s0i = ai + ci, d0r = ar - cr, d0i = ai - ci;
+				const float s1r = br + dr, s1i = bi + di, d1r = br - dr, d1i = bi - di;
+
+				x0[j] = s0r + s1r; x0[j + 1] = s0i + s1i;
+				x1[j] = d0r + d1i; x1[j + 1] = d0i - d1r;
+				x2[j] = s0r - s1r; x2[j + 1] = s0i - s1i;
+				x3[j] = d0r - d1i; x3[j + 1] = d0i + d1r;
+			}
+		}
+	}
+}
@@ -0,0 +1,40 @@
+#ifndef JS_RTLSDR_FFT_GRAB_H
+#define JS_RTLSDR_FFT_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+#define FFT_MIN_SIZE (16)
+#define FFT_MAX_SIZE (65536)
+
+// In-place forward FFT of interleaved complex floats, for power-of-two sizes: a bit-reversal permutation, then
+// radix-4 decimation-in-time stages (led by one radix-2 stage when log2(size) is odd), two butterflies at a time
+// with SSE2. A plan holds the permutation and every stage's twiddles; plans are immutable and shared, one per size,
+// so any thread may run one concurrently with others.
+class FftPlan {
+public:
+	// the shared plan for size, building it on first use; size must be a power of two from FFT_MIN_SIZE to
+	// FFT_MAX_SIZE
+	static std::shared_ptr<const FftPlan> Get(size_t size);
+
+	static bool ValidSize(size_t size);
+
+	// X[k] = sum over n of x[n] * e^(-2 pi i k n / size), unnormalized; iq holds 2 * size floats
+	void Forward(float * iq) const;
+
+	size_t Size(void) const { return this->size; }
+
+	explicit FftPlan(size_t size); // use Get
+
+private:
+	void Permute(float * iq) const;
+
+	const size_t size;
+	unsigned log2_size = 0;
+	std::vector<uint32_t> swaps;  // pairs of indices exchanged by the bit-reversal permutation
+	std::vector<float> twiddles;  // per radix-4 stage of span m: w^k for k < m, then w^2k, then w^3k
+};
+
+#endif
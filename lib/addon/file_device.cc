@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "file_device.h"
+
+std::mutex FileDevice::registry_mutex;
+std::vector<FileDevice *> FileDevice::registry;
+
+static bool ends_with(const std::string & s, const std::string & suffix) {
+	return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// path without its last extension
+static std::string strip_extension(const std::string & path) {
+	const size_t dot = path.rfind('.'), slash = path.rfind('/');
+	if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) return path;
+	return path.substr(0, dot);
+}
+
+// the value of the first "key": in a SigMF document, as its raw text (a number) or unquoted string; enough for the
+// flat core: fields, which is all a replay needs
+static bool sigmf_field(const std::string & meta, const char * key, std::string * out) {
+	const std::string quoted = std::string("\"") + key + "\"";
+	const size_t at = meta.find(quoted);
+	if(at == std::string::npos) return false;
+
+	size_t i = meta.find(':', at + quoted.size());
+	if(i == std::string::npos) return false;
+	i = meta.find_first_not_of(" \t\r\n", i + 1);
+	if(i == std::string::npos) return false;
+
+	if(meta[i] == '"') {
+		const size_t end = meta.find('"', i + 1);
+		if(end == std::string::npos) return false;
+		*out = meta.substr(i + 1, end - i - 1);
+	} else {
+		const size_t end = meta.find_first_of(",}] \t\r\n", i);
+		*out = meta.substr(i, end == std::string::npos ? std::string::npos : end - i);
+	}
+
+	return true;
+}
+
+/* static */ FileDevice * FileDevice::Open(const std::string & path, const file_device_options_t & opts,
+                                           std::string * err) {
+	std::string data_path = path, meta_path = strip_extension(path) + ".sigmf-meta";
+
+	std::ifstream meta_in(meta_path.c_str());
+	if(ends_with(path, ".sigmf-meta") && !meta_in) {
+		*err = "could not open " + meta_path;
+		return NULL;
+	}
+
+	uint32_t sample_rate = opts.sample_rate, center_freq = opts.center_freq;
+
+	if(meta_in) {
+		std::ostringstream text;
+		text << meta_in.rdbuf();
+		const std::string meta = text.str();
+		std::string value;
+
+		if(sigmf_field(meta, "core:datatype", &value) && value != "cu8") {
+			*err = meta_path + " describes " + value + " samples; only cu8 recordings can be replayed";
+			return NULL;
+		}
+
+		if(sample_rate == 0 && sigmf_field(meta, "core:sample_rate", &value))
+			sample_rate = (uint32_t) strtod(value.c_str(), NULL);
+
+		if(center_freq == 0 && sigmf_field(meta, "core:frequency", &value))
+			center_freq = (uint32_t) strtod(value.c_str(), NULL);
+
+		// a dataset is named relative to its sidecar
+		if(ends_with(path, ".sigmf-meta")) {
+			const size_t slash = meta_path.rfind('/');
+			const std::string dir = slash == std::string::npos ? "" : meta_path.substr(0, slash + 1);
+			data_path = sigmf_field(meta, "core:dataset", &value) ? dir + value
+			                                                      : strip_extension(path) + ".sigmf-data";
+		}
+	}
+
+	if(sample_rate == 0) {
+		*err = "the recording has no SigMF sample rate, so one must be given";
+		return NULL;
+	}
+
+	const int fd = open(data_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0) {
+		*err = "could not open " + data_path + ": " + strerror(errno);
+		return NULL;
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size < 2) {
+		*err = data_path + " holds no samples";
+		close(fd);
+		return NULL;
+	}
+
+	// a trailing half sample is ignored; private and writable, so a reader that scribbles on a transfer only
+	// touches its own copy of the page
+	const uint64_t size = (uint64_t) st.st_size & ~(uint64_t) 1;
+	void * data = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if(data == MAP_FAILED) {
+		*err = "could not map " + data_path + ": " + strerror(errno);
+		return NULL;
+	}
+
+	madvise(data, (size_t) size, MADV_SEQUENTIAL);
+
+	FileDevice * dev = new FileDevice(data_path, opts, sample_rate, (uint8_t *) data, size);
+	dev->settings.center_freq = center_freq;
+
+	std::lock_guard<std::mutex> lock(FileDevice::registry_mutex);
+	FileDevice::registry.push_back(dev);
+	return dev;
+}
+
+FileDevice::FileDevice(const std::string & path, const file_device_options_t & opts, uint32_t sample_rate,
+                       uint8_t * data, uint64_t size)
+	: path(path), sample_rate(sample_rate), data(data), size(size), position(0), loop(opts.loop), speed(opts.speed) {
+	this->settings.center_freq = 0;
+	this->settings.rtl_xtal = 28800000;
+	this->settings.tuner_xtal = 28800000;
+	this->settings.freq_correction = 0;
+	this->settings.tuner_gain = 0;
+	this->settings.direct_sampling = 0;
+	this->settings.offset_tuning = 0;
+}
+
+FileDevice::~FileDevice() {
+	{
+		std::lock_guard<std::mutex> lock(FileDevice::registry_mutex);
+		std::vector<FileDevice *> & registry = FileDevice::registry;
+		registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+	}
+
+	munmap(this->data, (size_t) this->size);
+}
+
+/* static */ FileDevice * FileDevice::Find(const rtlsdr_dev_t * dev) {
+	std::lock_guard<std::mutex> lock(FileDevice::registry_mutex);
+
+	for(size_t i = 0; i < FileDevice::registry.size(); i++) {
+		if((const rtlsdr_dev_t *) FileDevice::registry[i] == dev) return FileDevice::registry[i];
+	}
+
+	return NULL;
+}
+
+// capture thread: wait until samples more are due; false if the read was cancelled meanwhile
+bool FileDevice::Pace(uint64_t samples) {
+	std::unique_lock<std::mutex> lock(this->mutex);
+	if(this->cancelled) return false;
+	if(this->speed == 0) return true;
+
+	if(this->pace_reset) {
+		this->pace_start = std::chrono::steady_clock::now();
+		this->pace_samples = 0;
+		this->pace_reset = false;
+	}
+
+	// a transfer is due once hardware would have finished sampling it
+	this->pace_samples += samples;
+	const std::chrono::duration<double> due(this->pace_samples / (this->sample_rate * this->speed));
+	const auto deadline = this->pace_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(due);
+
+	this->wake.wait_until(lock, deadline, [this] { return this->cancelled || this->pace_reset; });
+	return !this->cancelled;
+}
+
+// len bytes from byte offset from, wrapping around the end of the recording
+void FileDevice::Copy(uint64_t from, uint8_t * out, size_t len) const {
+	while(len > 0) {
+		const size_t n = (size_t) std::min<uint64_t>(len, this->size - from);
+		memcpy(out, this->data + from, n);
+		out += n;
+		len -= n;
+		from = 0;
+	}
+}
+
+uint64_t FileDevice::Advance(uint64_t from, size_t len) const {
+	return this->loop ? (from + len) % this->size : std::min<uint64_t>(from + len, this->size);
+}
+
+int FileDevice::ReadAsync(rtlsdr_read_async_cb_t cb, void * ctx, uint32_t buf_len) {
+	if(buf_len == 0) buf_len = FILE_DEVICE_DEFAULT_BUF_LEN;
+	if(buf_len % 512 != 0) return -1;
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->cancelled = false;
+	}
+
+	for(;;) {
+		const uint64_t from = this->position;
+		if(from >= this->size) break; // only reached without loop
+
+		const uint8_t * buf = this->data + from;
+		size_t len = (size_t) std::min<uint64_t>(buf_len, this->size - from);
+
+		if(len < buf_len && this->loop) {
+			this->scratch.resize(buf_len);
+			this->Copy(from, this->scratch.data(), buf_len);
+			buf = this->scratch.data();
+			len = buf_len;
+		}
+
+		if(!this->Pace(len / 2)) break;
+
+		// a Seek while this transfer was paced wins; the transfer is not delivered
+		uint64_t expected = from;
+		if(!this->position.compare_exchange_strong(expected, this->Advance(from, len))) continue;
+
+		(*cb)((uint8_t *) buf, (uint32_t) len, ctx);
+	}
+
+	// the cancel was for this read; later ReadSync calls are still paced
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->cancelled = false;
+	return 0;
+}
+
+int FileDevice::ReadSync(void * buf, int len, int * n_read) {
+	if(len < 0) return -1;
+
+	const uint64_t from = this->position;
+	size_t n = (size_t) len;
+	if(!this->loop) n = (size_t) std::min<uint64_t>(n, this->size - from);
+
+	if(n > 0) {
+		this->Pace(n / 2);
+		this->Copy(from, (uint8_t *) buf, n);
+
+		uint64_t expected = from;
+		this->position.compare_exchange_strong(expected, this->Advance(from, n));
+	}
+
+	if(n_read != NULL) *n_read = (int) n;
+	return 0;
+}
+
+int FileDevice::CancelAsync() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->cancelled = true;
+	this->wake.notify_all();
+	return 0;
+}
+
+int FileDevice::ResetBuffer() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->pace_reset = true;
+	this->wake.notify_all();
+	return 0;
+}
+
+void FileDevice::Seek(uint64_t sample) {
+	this->position = std::min<uint64_t>(2 * sample, this->size);
+	this->ResetBuffer();
+}
+
+void FileDevice::SetSpeed(double speed) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->speed = speed;
+	this->pace_reset = true;
+	this->wake.notify_all();
+}
+
+void FileDevice::SetLoop(bool loop) {
+	this->loop = loop;
+}
@@ -0,0 +1,102 @@
+#ifndef JS_RTLSDR_FILE_DEVICE_GRAB_H
+#define JS_RTLSDR_FILE_DEVICE_GRAB_H
+
+#include <rtl-sdr.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define FILE_DEVICE_DEFAULT_BUF_LEN (16 * 32 * 512) // librtlsdr's DEFAULT_BUF_LENGTH
+#define FILE_DEVICE_MAX_SPEED       (10000)
+
+typedef struct file_device_options {
+	uint32_t sample_rate = 0; // required unless the recording's SigMF metadata has one, which this overrides
+	uint32_t center_freq = 0; // 0 to take the metadata's, if any
+	double   speed = 1;       // 1 for real time, N for N times real time, 0 for as fast as the reader keeps up
+	bool     loop = false;    // start over at the end of the recording instead of finishing the read
+} file_device_options_t;
+
+// the settings librtlsdr would hold for a device, kept so that the rest of the API works on a recording; the
+// capture thread may retune during a sweep while the main thread reads them
+typedef struct file_device_settings {
+	std::atomic<uint32_t> center_freq;
+	std::atomic<uint32_t> rtl_xtal;
+	std::atomic<uint32_t> tuner_xtal;
+	std::atomic<int>      freq_correction;
+	std::atomic<int>      tuner_gain;
+	std::atomic<int>      direct_sampling;
+	std::atomic<int>      offset_tuning;
+} file_device_settings_t;
+
+// A virtual device that replays a memory-mapped .cu8 recording (raw offset-binary I/Q, optionally described by a
+// SigMF .sigmf-meta sidecar) through the librtlsdr calls the addon makes; see device_backend.h. Transfers point
+// straight into the mapping except where a loop wraps. Reads are paced against a steady clock at speed times the
+// sample rate, so detectors see data at the rate (or N times the rate) they would from hardware, or as fast as they
+// can take it. A FileDevice's address stands in for its rtlsdr_dev_t *; Find tells the two apart.
+class FileDevice {
+public:
+	// path is the data file, or a .sigmf-meta whose core:dataset (or matching .sigmf-data) is the data file. Returns
+	// NULL with a description in err on failure.
+	static FileDevice * Open(const std::string & path, const file_device_options_t & opts, std::string * err);
+
+	// the FileDevice a handle stands for, or NULL for a librtlsdr device
+	static FileDevice * Find(const rtlsdr_dev_t * dev);
+
+	~FileDevice();
+
+	rtlsdr_dev_t * Handle(void) { return (rtlsdr_dev_t *) this; }
+
+	// capture thread: as rtlsdr_read_async; returns 0 once cancelled or, unless looping, at the end of the recording
+	int ReadAsync(rtlsdr_read_async_cb_t cb, void * ctx, uint32_t buf_len);
+
+	// capture thread: as rtlsdr_read_sync; *n_read falls short only at the end of a recording that does not loop
+	int ReadSync(void * buf, int len, int * n_read);
+
+	// any thread
+	int CancelAsync(void);
+	int ResetBuffer(void); // restart pacing from now
+	void Seek(uint64_t sample);
+	void SetSpeed(double speed);
+	void SetLoop(bool loop);
+
+	uint64_t Position(void) const { return this->position / 2; } // the next sample to be read
+	uint64_t Length(void) const { return this->size / 2; }       // samples in the recording
+	uint32_t SampleRate(void) const { return this->sample_rate; }
+	const std::string & Path(void) const { return this->path; }
+
+	file_device_settings_t settings;
+
+private:
+	FileDevice(const std::string & path, const file_device_options_t & opts, uint32_t sample_rate, uint8_t * data,
+	           uint64_t size);
+
+	bool Pace(uint64_t samples);
+	void Copy(uint64_t from, uint8_t * out, size_t len) const;
+	uint64_t Advance(uint64_t from, size_t len) const;
+
+	static std::mutex registry_mutex;
+	static std::vector<FileDevice *> registry;
+
+	const std::string path;
+	const uint32_t sample_rate;
+	uint8_t * const data;
+	const uint64_t size;                // bytes mapped, a whole number of samples
+	std::atomic<uint64_t> position;     // byte offset of the next sample
+	std::atomic<bool> loop;
+	std::vector<uint8_t> scratch;       // capture thread: a transfer that wraps around the end
+
+	std::mutex mutex;                   // guards the pacing state and wakes a paced read on cancel
+	std::condition_variable wake;
+	bool cancelled = false;
+	double speed;
+	bool pace_reset = true;             // start the pacing clock over at the next transfer
+	std::chrono::steady_clock::time_point pace_start;
+	uint64_t pace_samples = 0;          // samples released since pace_start
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include <cmath>
+#include "fir.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// ~80 dB of stopband attenuation
+#define FIR_KAISER_BETA (8.0)
+
+// zeroth-order modified Bessel function of the first kind, for the Kaiser window
+static double bessel_i0(double x) {
+	double sum = 1, term = 1;
+
+	for(int k = 1; k < 50; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+		if(term < sum * 1e-12) break;
+	}
+
+	return sum;
+}
+
+std::vector<float> fir_design_lowpass(size_t ntaps, double cutoff, double gain) {
+	std::vector<double> taps(ntaps);
+	const double middle = (ntaps - 1) / 2.0;
+	const double norm = bessel_i0(FIR_KAISER_BETA);
+	double sum = 0;
+
+	for(size_t n = 0; n < ntaps; n++) {
+		const double t = n - middle;
+		const double sinc = t == 0 ? 2 * cutoff : sin(2 * M_PI * cutoff * t) / (M_PI * t);
+		const double r = middle > 0 ? t / middle : 0;
+		const double window = bessel_i0(FIR_KAISER_BETA * sqrt(1 - r * r)) / norm;
+
+		taps[n] = sinc * window;
+		sum += taps[n];
+	}
+
+	std::vector<float> out(ntaps);
+	for(size_t n = 0; n < ntaps; n++) out[n] = (float) (taps[n] * gain / sum);
+	return out;
+}
+
+std::vector<float> fir_prepare_taps(const float * taps, size_t ntaps) {
+	std::vector<float> prepared(2 * ntaps);
+
+	for(size_t i = 0; i < ntaps; i++)
+		prepared[2 * i] = prepared[2 * i + 1] = taps[ntaps - 1 - i];
+
+	return prepared;
+}
+
+void fir_dot(const float * x, const float * prepared, size_t ntaps, float * out) {
+	const size_t len = 2 * ntaps;
+	size_t i = 0;
+	float re = 0, im = 0;
+
+	#ifdef __SSE2__
+	// lanes are I, Q, I, Q; two accumulators hide the add latency
+	__m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+
+	for(; i + 8 <= len; i += 8) {
+		acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x + i), _mm_loadu_ps(prepared + i)));
+		acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x + i + 4), _mm_loadu_ps(prepared + i + 4)));
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+	re = lanes[0] + lanes[2];
+	im = lanes[1] + lanes[3];
+	#endif
+
+	for(; i < len; i += 2) {
+		re += x[i] * prepared[i];
+		im += x[i + 1] * prepared[i + 1];
+	}
+
+	out[0] = re;
+	out[1] = im;
+}
+
+void complex_dot(const float * a, const float * b, size_t n, float * out) {
+	const size_t len = 2 * n;
+	size_t i = 0;
+	float re = 0, im = 0;
+
+	#ifdef __SSE2__
+	// straight lanes give ar * br and ai * bi, swapped lanes give ar * bi and ai * br
+	__m128 straight = _mm_setzero_ps(), swapped = _mm_setzero_ps();
+
+	for(; i + 4 <= len; i += 4) {
+		const __m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i);
+		straight = _mm_add_ps(straight, _mm_mul_ps(va, vb));
+		swapped = _mm_add_ps(swapped, _mm_mul_ps(va, _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+
+	float s[4], w[4];
+	_mm_storeu_ps(s, straight);
+	_mm_storeu_ps(w, swapped);
+	re = (s[0] + s[2]) - (s[1] + s[3]);
+	im = w[0] + w[1] + w[2] + w[3];
+	#endif
+
+	for(; i < len; i += 2) {
+		re += a[i] * b[i] - a[i + 1] * b[i + 1];
+		im += a[i] * b[i + 1] + a[i + 1] * b[i];
+	}
+
+	out[0] = re;
+	out[1] = im;
+}
@@ -0,0 +1,23 @@
+#ifndef JS_RTLSDR_FIR_GRAB_H
+#define JS_RTLSDR_FIR_GRAB_H
+
+#include <stddef.h>
+#include <vector>
+
+// FIR filters and complex dot products over interleaved complex float samples, shared by the native DSP stages.
+
+// Kaiser-windowed sinc lowpass of ntaps taps with the given cutoff (cycles per sample, 0-0.5) and DC gain
+std::vector<float> fir_design_lowpass(size_t ntaps, double cutoff, double gain);
+
+// Lay taps out for fir_dot: reversed, so that taps[0] applies to the newest sample, and with each tap repeated once
+// per I and Q lane.
+std::vector<float> fir_prepare_taps(const float * taps, size_t ntaps);
+
+// out[0..1] = sum over k of taps[k] * x[ntaps - 1 - k], where x is ntaps interleaved complex samples, oldest first,
+// and prepared came from fir_prepare_taps
+void fir_dot(const float * x, const float * prepared, size_t ntaps, float * out);
+
+// out[0..1] = sum over k of a[k] * b[k], for n interleaved complex values in each of a and b
+void complex_dot(const float * a, const float * b, size_t n, float * out);
+
+#endif
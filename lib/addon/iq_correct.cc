@@ -0,0 +1,155 @@
+#include <cmath>
+#include "iq_correct.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// vector lanes are flushed into doubles this often, so long transfers do not lose float precision
+#define IQ_CORRECT_FLUSH_PAIRS (2048)
+
+// sum of I and of Q over pairs complex samples
+static void block_sums(const float * iq, size_t pairs, double * sum_i, double * sum_q) {
+	size_t k = 0;
+	*sum_i = *sum_q = 0;
+
+	#ifdef __SSE2__
+	while(k + 2 <= pairs) {
+		const size_t end = k + IQ_CORRECT_FLUSH_PAIRS < pairs ? k + IQ_CORRECT_FLUSH_PAIRS : pairs;
+		__m128 acc = _mm_setzero_ps();
+
+		// lanes are I, Q, I, Q
+		for(; k + 2 <= end; k += 2) acc = _mm_add_ps(acc, _mm_loadu_ps(iq + 2 * k));
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, acc);
+		*sum_i += (double) lanes[0] + lanes[2];
+		*sum_q += (double) lanes[1] + lanes[3];
+	}
+	#endif
+
+	for(; k < pairs; k++) {
+		*sum_i += iq[2 * k];
+		*sum_q += iq[2 * k + 1];
+	}
+}
+
+// Remove dc and apply Q' = a * Q + b * I in place. If TRACK, also sum I^2, Q^2 and I*Q of the DC-free input into
+// moments, for the balance estimator.
+template<bool TRACK>
+static void correct_block(float * iq, size_t pairs, float dc_i, float dc_q, float a, float b, double * moments) {
+	size_t k = 0;
+
+	#ifdef __SSE2__
+	const __m128 dc = _mm_set_ps(dc_q, dc_i, dc_q, dc_i);
+	const __m128 gain = _mm_set_ps(a, 1, a, 1);
+	const __m128 cross = _mm_set_ps(b, 0, b, 0);
+
+	while(k + 2 <= pairs) {
+		const size_t end = k + IQ_CORRECT_FLUSH_PAIRS < pairs ? k + IQ_CORRECT_FLUSH_PAIRS : pairs;
+		__m128 squares = _mm_setzero_ps();
+		__m128 products = _mm_setzero_ps();
+
+		for(; k + 2 <= end; k += 2) {
+			const __m128 v = _mm_sub_ps(_mm_loadu_ps(iq + 2 * k), dc);
+
+			if(TRACK) {
+				squares = _mm_add_ps(squares, _mm_mul_ps(v, v));
+				products = _mm_add_ps(products, _mm_mul_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1))));
+			}
+
+			// I, I, I', I' of the two samples
+			const __m128 in_phase = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+			_mm_storeu_ps(iq + 2 * k, _mm_add_ps(_mm_mul_ps(v, gain), _mm_mul_ps(in_phase, cross)));
+		}
+
+		if(TRACK) {
+			float sq[4], pr[4];
+			_mm_storeu_ps(sq, squares);
+			_mm_storeu_ps(pr, products);
+			moments[0] += (double) sq[0] + sq[2];
+			moments[1] += (double) sq[1] + sq[3];
+			moments[2] += (double) pr[0] + pr[2];
+		}
+	}
+	#endif
+
+	for(; k < pairs; k++) {
+		const float i = iq[2 * k] - dc_i;
+		const float q = iq[2 * k + 1] - dc_q;
+
+		if(TRACK) {
+			moments[0] += (double) i * i;
+			moments[1] += (double) q * q;
+			moments[2] += (double) i * q;
+		}
+
+		iq[2 * k] = i;
+		iq[2 * k + 1] = a * q + b * i;
+	}
+}
+
+// weight of a block of n samples in an exponential average with the given per-sample rate
+static double block_weight(double rate, size_t n) {
+	return 1.0 - pow(1.0 - rate, (double) n);
+}
+
+IqCorrector::IqCorrector(bool dc, bool balance) : dc(dc), balance(balance) {}
+
+void IqCorrector::Process(float * iq, size_t len) {
+	const size_t pairs = len / 2;
+	if(pairs == 0) return;
+
+	if(this->dc) {
+		double sum_i, sum_q;
+		block_sums(iq, pairs, &sum_i, &sum_q);
+
+		const double w = this->primed ? block_weight(IQ_CORRECT_DC_RATE, pairs) : 1.0;
+		this->dc_i += (float) (w * (sum_i / pairs - this->dc_i));
+		this->dc_q += (float) (w * (sum_q / pairs - this->dc_q));
+	}
+
+	if(this->balance) {
+		double moments[3] = {0, 0, 0};
+		correct_block<true>(iq, pairs, this->dc_i, this->dc_q, this->a, this->b, moments);
+
+		const double w = this->primed ? block_weight(IQ_CORRECT_BALANCE_RATE, pairs) : 1.0;
+		this->ii += w * (moments[0] / pairs - this->ii);
+		this->qq += w * (moments[1] / pairs - this->qq);
+		this->iq += w * (moments[2] / pairs - this->iq);
+		this->UpdateCoefficients();
+	} else {
+		correct_block<false>(iq, pairs, this->dc_i, this->dc_q, 1, 0, NULL);
+	}
+
+	this->primed = true;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->published.dc_i = this->dc_i;
+	this->published.dc_q = this->dc_q;
+	this->published.samples += pairs;
+}
+
+// For I = cos(wt) and Q = g sin(wt + phi): E[Q^2] / E[I^2] = g^2 and E[IQ] / sqrt(E[I^2] E[Q^2]) = sin(phi), and
+// sin(wt) = (Q / g - I sin(phi)) / cos(phi).
+void IqCorrector::UpdateCoefficients() {
+	if(this->ii < 1e-12 || this->qq < 1e-12) return;
+
+	const double gain = sqrt(this->qq / this->ii);
+	double sin_phi = this->iq / sqrt(this->ii * this->qq);
+	if(sin_phi > 0.99) sin_phi = 0.99;
+	if(sin_phi < -0.99) sin_phi = -0.99;
+	const double cos_phi = sqrt(1.0 - sin_phi * sin_phi);
+
+	this->a = (float) (1.0 / (gain * cos_phi));
+	this->b = (float) (-sin_phi / cos_phi);
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->published.gain = (float) gain;
+	this->published.phase = (float) asin(sin_phi);
+}
+
+iq_correction_estimates_t IqCorrector::Estimates() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->published;
+}
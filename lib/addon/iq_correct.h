@@ -0,0 +1,51 @@
+#ifndef JS_RTLSDR_IQ_CORRECT_GRAB_H
+#define JS_RTLSDR_IQ_CORRECT_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+// per-sample smoothing of the running estimates; the DC time constant is ~40 ms at 2.4 MS/s, the balance
+// estimator settles about ten times more slowly
+#define IQ_CORRECT_DC_RATE (1e-5)
+#define IQ_CORRECT_BALANCE_RATE (1e-6)
+
+// the correction IqCorrector is currently applying
+typedef struct iq_correction_estimates {
+	float    dc_i = 0;     // DC offset removed from I
+	float    dc_q = 0;     // DC offset removed from Q
+	float    gain = 1;     // estimated Q/I amplitude ratio
+	float    phase = 0;    // estimated quadrature phase error, radians
+	uint64_t samples = 0;  // complex samples corrected so far
+} iq_correction_estimates_t;
+
+// Running-average DC blocker and blind adaptive I/Q imbalance corrector for interleaved float I/Q. Estimates are
+// updated once per block from vectorised block sums, and applied to the next block, so a whole transfer is
+// corrected with fixed coefficients and no per-sample feedback. Process runs on the capture thread; Estimates may
+// be read from any thread.
+class IqCorrector {
+public:
+	IqCorrector(bool dc, bool balance);
+
+	// correct len interleaved floats (len / 2 complex samples) in place
+	void Process(float * iq, size_t len);
+
+	iq_correction_estimates_t Estimates(void);
+
+private:
+	void UpdateCoefficients(void);
+
+	const bool dc;
+	const bool balance;
+
+	// capture thread only
+	float  dc_i = 0, dc_q = 0;
+	double ii = 0, qq = 0, iq = 0; // smoothed second moments of DC-free I/Q
+	float  a = 1, b = 0;           // Q' = a * Q + b * I
+	bool   primed = false;
+
+	std::mutex mutex;
+	iq_correction_estimates_t published;
+};
+
+#endif
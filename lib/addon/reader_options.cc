@@ -0,0 +1,1029 @@
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include "device_backend.h"
+#include "reader_options.h"
+
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+#define JS_RTLSDR_MAX_QUEUE_DEPTH (4096)
+#define JS_RTLSDR_MAX_CPU (1024) // CPU_SETSIZE
+#define JS_RTLSDR_MAX_GROUP_BLOCK (1048576)
+
+static Local<Value> get_opt(Local<Object> opts, const char * name) {
+	return Nan::Get(opts, Nan::New(name).ToLocalChecked()).ToLocalChecked();
+}
+
+// leaves *out alone if the option is absent
+static bool get_bool_opt(Local<Object> opts, const char * name, bool * out) {
+	Local<Value> value = get_opt(opts, name);
+	if(value->IsUndefined()) return true;
+
+	if(!value->IsBoolean()) {
+		Nan::ThrowTypeError((std::string(name) + " must be a boolean").c_str());
+		return false;
+	}
+
+	*out = Nan::To<bool>(value).FromJust();
+	return true;
+}
+
+// leaves *out alone if the option is absent and not required; range describes [min, max] for the RangeError
+static bool get_number_opt(Local<Object> opts, const char * name, bool required, double min, double max,
+                           const char * range, double * out) {
+	Local<Value> value = get_opt(opts, name);
+	if(value->IsUndefined() && !required) return true;
+
+	if(!value->IsNumber()) {
+		Nan::ThrowTypeError((std::string(name) + " must be a number").c_str());
+		return false;
+	}
+
+	const double d_value = Nan::To<double>(value).FromJust();
+	if(!(d_value >= min && d_value <= max)) {
+		Nan::ThrowRangeError((std::string(name) + " must be " + range).c_str());
+		return false;
+	}
+
+	*out = d_value;
+	return true;
+}
+
+// queueDepth:int = 32, overflow:('drop-oldest'|'drop-newest'|'block') = 'block'
+static bool parse_queue_options(Local<Object> opts, size_t * depth, overflow_policy_t * policy) {
+	Local<Value> queue_depth = get_opt(opts, "queueDepth");
+	if(!queue_depth->IsUndefined()) {
+		if(!queue_depth->IsNumber()) {
+			Nan::ThrowTypeError("queueDepth must be a number");
+			return false;
+		}
+
+		const uint32_t u_depth = Nan::To<uint32_t>(queue_depth).FromJust();
+		if(!queue_depth->IsUint32() || u_depth < 1 || u_depth > JS_RTLSDR_MAX_QUEUE_DEPTH) {
+			Nan::ThrowRangeError("queueDepth must be an integer from 1-4096");
+			return false;
+		}
+
+		*depth = u_depth;
+	}
+
+	Local<Value> overflow = get_opt(opts, "overflow");
+	if(!overflow->IsUndefined()) {
+		if(!overflow->IsString()) {
+			Nan::ThrowTypeError("overflow must be a string");
+			return false;
+		}
+
+		std::string s_overflow(*Nan::Utf8String(overflow));
+		if(!SampleQueue::ParsePolicy(s_overflow.c_str(), policy)) {
+			Nan::ThrowRangeError("overflow must be 'drop-oldest', 'drop-newest', or 'block'");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// format:('uint8'|'int16'|'float32'|'float32-planar') = 'uint8', without 'float32-planar' unless planar
+static bool get_format_opt(Local<Object> opts, bool planar, sample_format_t * out) {
+	Local<Value> format = get_opt(opts, "format");
+	if(format->IsUndefined()) return true;
+
+	if(!format->IsString()) {
+		Nan::ThrowTypeError("format must be a string");
+		return false;
+	}
+
+	std::string s_format(*Nan::Utf8String(format));
+	if(!planar) {
+		if(!parse_sample_format(s_format.c_str(), out) || *out == SAMPLE_FORMAT_FLOAT32_PLANAR) {
+			Nan::ThrowRangeError("format must be 'uint8', 'int16', or 'float32'");
+			return false;
+		}
+	} else if(!parse_sample_format(s_format.c_str(), out)) {
+		Nan::ThrowRangeError("format must be 'uint8', 'int16', 'float32', or 'float32-planar'");
+		return false;
+	}
+
+	return true;
+}
+
+// channels: {count:int, select:int[] = <every channel>, threads:int = 1}
+static bool parse_channel_options(Local<Value> channels_val, sample_reader_work_t * work) {
+	if(!channels_val->IsObject()) {
+		Nan::ThrowTypeError("channels must be an object");
+		return false;
+	}
+
+	Local<Object> channels = Nan::To<Object>(channels_val).ToLocalChecked();
+
+	Local<Value> count = get_opt(channels, "count");
+	if(!count->IsNumber()) {
+		Nan::ThrowTypeError("channels.count must be a number");
+		return false;
+	}
+
+	const int64_t i_count = Nan::To<int64_t>(count).FromJust();
+	if(i_count < 2 || i_count > CHANNELIZER_MAX_CHANNELS) {
+		Nan::ThrowRangeError("channels.count must be an integer from 2-1024");
+		return false;
+	}
+
+	work->channel_count = (unsigned) i_count;
+
+	Local<Value> select = get_opt(channels, "select");
+	if(select->IsUndefined()) {
+		for(unsigned k = 0; k < work->channel_count; k++) work->channels.push_back(k);
+	} else if(select->IsArray()) {
+		Local<v8::Array> indices = select.As<v8::Array>();
+
+		for(uint32_t i = 0; i < indices->Length(); i++) {
+			Local<Value> one = Nan::Get(indices, i).ToLocalChecked();
+			if(!one->IsNumber()) {
+				Nan::ThrowTypeError("channels.select must be an array of numbers");
+				return false;
+			}
+
+			const int64_t index = Nan::To<int64_t>(one).FromJust();
+			if(index < 0 || index >= i_count) {
+				Nan::ThrowRangeError("channels.select must hold channel numbers from 0 to channels.count - 1");
+				return false;
+			}
+
+			work->channels.push_back((unsigned) index);
+		}
+
+		if(work->channels.empty()) {
+			Nan::ThrowRangeError("channels.select must not be empty");
+			return false;
+		}
+	} else {
+		Nan::ThrowTypeError("channels.select must be an array of numbers");
+		return false;
+	}
+
+	Local<Value> threads = get_opt(channels, "threads");
+	if(!threads->IsUndefined()) {
+		if(!threads->IsNumber()) {
+			Nan::ThrowTypeError("channels.threads must be a number");
+			return false;
+		}
+
+		const int64_t i_threads = Nan::To<int64_t>(threads).FromJust();
+		if(i_threads < 1 || i_threads > CHANNELIZER_MAX_THREADS) {
+			Nan::ThrowRangeError("channels.threads must be an integer from 1-64");
+			return false;
+		}
+
+		work->channel_threads = (unsigned) i_threads;
+	}
+
+	return true;
+}
+
+// spectrum: {size:int, window:string = 'hann', overlap:number = 0, averages:int = 1}
+static bool parse_spectrum_options(Local<Value> spectrum_val, sample_reader_work_t * work) {
+	if(!spectrum_val->IsObject()) {
+		Nan::ThrowTypeError("spectrum must be an object");
+		return false;
+	}
+
+	Local<Object> spectrum = Nan::To<Object>(spectrum_val).ToLocalChecked();
+
+	Local<Value> size = get_opt(spectrum, "size");
+	if(!size->IsNumber()) {
+		Nan::ThrowTypeError("spectrum.size must be a number");
+		return false;
+	}
+
+	const int64_t i_size = Nan::To<int64_t>(size).FromJust();
+	if(i_size < 0 || !FftPlan::ValidSize((size_t) i_size)) {
+		Nan::ThrowRangeError("spectrum.size must be a power of two from 16-65536");
+		return false;
+	}
+
+	work->spectrum_size = (size_t) i_size;
+
+	Local<Value> window = get_opt(spectrum, "window");
+	if(!window->IsUndefined()) {
+		if(!window->IsString()) {
+			Nan::ThrowTypeError("spectrum.window must be a string");
+			return false;
+		}
+
+		std::string s_window(*Nan::Utf8String(window));
+		if(!parse_spectrum_window(s_window.c_str(), &work->spectrum_window)) {
+			Nan::ThrowRangeError("spectrum.window must be 'rectangular', 'hann', 'hamming', 'blackman', or "
+			                     "'blackman-harris'");
+			return false;
+		}
+	}
+
+	Local<Value> overlap = get_opt(spectrum, "overlap");
+	if(!overlap->IsUndefined()) {
+		if(!overlap->IsNumber()) {
+			Nan::ThrowTypeError("spectrum.overlap must be a number");
+			return false;
+		}
+
+		work->spectrum_overlap = Nan::To<double>(overlap).FromJust();
+		if(!(work->spectrum_overlap >= 0 && work->spectrum_overlap < 1)) {
+			Nan::ThrowRangeError("spectrum.overlap must be at least 0 and less than 1");
+			return false;
+		}
+	}
+
+	Local<Value> averages = get_opt(spectrum, "averages");
+	if(!averages->IsUndefined()) {
+		if(!averages->IsNumber()) {
+			Nan::ThrowTypeError("spectrum.averages must be a number");
+			return false;
+		}
+
+		const int64_t i_averages = Nan::To<int64_t>(averages).FromJust();
+		if(i_averages < 1 || i_averages > SPECTRUM_MAX_AVERAGES) {
+			Nan::ThrowRangeError("spectrum.averages must be an integer from 1-65536");
+			return false;
+		}
+
+		work->spectrum_averages = (unsigned) i_averages;
+	}
+
+	// rows are always dB values
+	work->format = SAMPLE_FORMAT_FLOAT32;
+	return true;
+}
+
+// squelch, history.trigger: {level:number, hysteresis:number = 3, window:int = 2048}; name is for messages
+static bool parse_detector_options(Local<Value> detector_val, const char * name, energy_squelch_options_t * opts) {
+	if(!detector_val->IsObject()) {
+		Nan::ThrowTypeError((std::string(name) + " must be an object").c_str());
+		return false;
+	}
+
+	Local<Object> detector = Nan::To<Object>(detector_val).ToLocalChecked();
+
+	if(!get_number_opt(detector, "level", true, -100, 0, "from -100 to 0 dBFS", &opts->level)) return false;
+	if(!get_number_opt(detector, "hysteresis", false, 0, 60, "from 0-60 dB", &opts->hysteresis)) return false;
+
+	double window = opts->window;
+	if(!get_number_opt(detector, "window", false, ENERGY_SQUELCH_MIN_WINDOW, ENERGY_SQUELCH_MAX_WINDOW,
+	                   "from 16-1048576 samples", &window)) return false;
+	opts->window = (uint32_t) window;
+
+	return true;
+}
+
+// record: {path:string, blockSize:int = 1048576, blocks:int = 16, direct:bool = false, rotateBytes:number = 0,
+//          rotateSeconds:number = 0}; the SigMF metadata comes from the device's current settings
+static bool parse_record_options(Local<Value> record_val, sample_reader_work_t * work) {
+	if(!record_val->IsObject()) {
+		Nan::ThrowTypeError("record must be an object");
+		return false;
+	}
+
+	Local<Object> record = Nan::To<Object>(record_val).ToLocalChecked();
+	recorder_options_t * opts = &work->record_options;
+
+	Local<Value> path = get_opt(record, "path");
+	if(!path->IsString() || Nan::To<v8::String>(path).ToLocalChecked()->Length() == 0) {
+		Nan::ThrowTypeError("path must be a non-empty string");
+		return false;
+	}
+
+	opts->path = *Nan::Utf8String(path);
+
+	work->input_rate = backend_get_sample_rate(work->rtl_dev, *work->control);
+	if(work->input_rate == 0) {
+		Nan::ThrowError("the sample rate must be set before recording");
+		return false;
+	}
+
+	double block_size = (double) opts->block_size, blocks = (double) opts->blocks;
+	if(!get_number_opt(record, "blockSize", false, RECORDER_ALIGNMENT, RECORDER_MAX_BLOCK_SIZE,
+	                   "a multiple of 4096 from 4096-67108864", &block_size)) return false;
+	if(fmod(block_size, RECORDER_ALIGNMENT) != 0) {
+		Nan::ThrowRangeError("blockSize must be a multiple of 4096 from 4096-67108864");
+		return false;
+	}
+
+	if(!get_number_opt(record, "blocks", false, 2, RECORDER_MAX_BLOCKS, "from 2-4096", &blocks)) return false;
+	if(block_size * (uint64_t) blocks > (double) ((uint64_t) 1 << 32)) {
+		Nan::ThrowRangeError("blockSize * blocks must be at most 4 GiB");
+		return false;
+	}
+
+	opts->block_size = (size_t) block_size;
+	opts->blocks = (size_t) blocks;
+
+	if(!get_bool_opt(record, "direct", &opts->direct)) return false;
+
+	// rotation by time is by sample time, so files hold exactly that many samples whatever the wall clock does
+	double rotate_bytes = 0, rotate_seconds = 0;
+	if(!get_number_opt(record, "rotateBytes", false, 0, 9007199254740992.0, "at least 0", &rotate_bytes))
+		return false;
+	if(!get_number_opt(record, "rotateSeconds", false, 0, 31536000, "from 0-31536000", &rotate_seconds))
+		return false;
+
+	// whole complex samples
+	opts->rotate_bytes = 2 * (uint64_t) (rotate_bytes / 2);
+	const uint64_t seconds_bytes = 2 * (uint64_t) ceil(rotate_seconds * work->input_rate);
+	if(seconds_bytes > 0 && (opts->rotate_bytes == 0 || seconds_bytes < opts->rotate_bytes))
+		opts->rotate_bytes = seconds_bytes;
+
+	if((rotate_bytes > 0 || rotate_seconds > 0) && opts->rotate_bytes == 0) {
+		Nan::ThrowRangeError("rotateBytes and rotateSeconds must each be 0 or hold at least one sample");
+		return false;
+	}
+
+	opts->overflow = work->overflow;
+	opts->sample_rate = work->input_rate;
+	opts->center_freq = backend_get_center_freq(work->rtl_dev, *work->control);
+
+	char hw[64];
+	const int gain = backend_get_tuner_gain(work->rtl_dev, *work->control);
+	snprintf(hw, sizeof(hw), "RTL-SDR, tuner gain %.1f dB", gain / 10.0);
+	opts->hw = hw;
+
+	work->record = true;
+	return true;
+}
+
+// history: {seconds:number, pre:number = 250, post:number = 250, trigger:Object = none}; pre and post are
+// milliseconds of a trigger's capture, and trigger is a detector as for squelch
+static bool parse_history_options(Local<Value> history_val, sample_reader_work_t * work) {
+	if(!history_val->IsObject()) {
+		Nan::ThrowTypeError("history must be an object");
+		return false;
+	}
+
+	Local<Object> history = Nan::To<Object>(history_val).ToLocalChecked();
+	burst_capture_options_t * opts = &work->capture_options;
+
+	work->input_rate = backend_get_sample_rate(work->rtl_dev, *work->control);
+	if(work->input_rate == 0) {
+		Nan::ThrowError("the sample rate must be set before reading with history");
+		return false;
+	}
+
+	// bytes per millisecond, in whole complex samples
+	const double samples_per_ms = work->input_rate / 1000.0;
+	const double max_ms = BURST_CAPTURE_MAX_BYTES / 2.0 / samples_per_ms;
+
+	double seconds = 0;
+	if(!get_number_opt(history, "seconds", true, 0.001, max_ms / 1000, "positive and hold at most 2 GiB of samples",
+	                   &seconds)) return false;
+	opts->history = 2 * (size_t) ceil(seconds * 1000 * samples_per_ms);
+
+	double pre = 250, post = 250;
+	if(!get_number_opt(history, "pre", false, 0, seconds * 1000, "from 0 to history.seconds * 1000", &pre))
+		return false;
+	// a capture is delivered in one block of the read's format
+	opts->max_capture = BURST_CAPTURE_MAX_BYTES / sample_format_size(work->format);
+	const double max_capture_ms = opts->max_capture / 2.0 / samples_per_ms;
+
+	if(!get_number_opt(history, "post", false, 0, max_capture_ms - pre, "from 0 to what 2 GiB of output holds",
+	                   &post)) return false;
+	opts->pre = 2 * (size_t) (pre * samples_per_ms);
+	opts->post = 2 * (size_t) (post * samples_per_ms);
+
+	Local<Value> trigger = get_opt(history, "trigger");
+	if(!trigger->IsUndefined()) {
+		if(!parse_detector_options(trigger, "history.trigger", &opts->detector)) return false;
+		opts->trigger = true;
+	}
+
+	work->history = true;
+	return true;
+}
+
+// one receiver: {mode:string = 'wbfm', offset:number = 0, bandwidth:number, deviation:number, deemphasis:number,
+// squelch:number, pitch:number, agc:bool, audioRate:int = 48000}; rate is the rate the receivers see
+static bool parse_receiver_options(Local<Value> receiver_val, uint32_t rate, demod_options_t * out) {
+	if(!receiver_val->IsObject()) {
+		Nan::ThrowTypeError("demod must be an object or an array of objects");
+		return false;
+	}
+
+	Local<Object> receiver = Nan::To<Object>(receiver_val).ToLocalChecked();
+	demod_options_t demod;
+
+	Local<Value> mode = get_opt(receiver, "mode");
+	if(!mode->IsUndefined()) {
+		if(!mode->IsString()) {
+			Nan::ThrowTypeError("demod.mode must be a string");
+			return false;
+		}
+
+		std::string s_mode(*Nan::Utf8String(mode));
+		if(!parse_demod_mode(s_mode.c_str(), &demod.mode)) {
+			Nan::ThrowRangeError("demod.mode must be 'wbfm', 'nbfm', 'am', 'usb', 'lsb', or 'cw'");
+			return false;
+		}
+	}
+
+	const double nyquist = rate / 2.0;
+	if(!get_number_opt(receiver, "offset", false, -nyquist, nyquist, "within half the sample rate of the center",
+	                   &demod.offset)) return false;
+	if(!get_number_opt(receiver, "bandwidth", false, 1, rate, "from 1 to the sample rate", &demod.bandwidth))
+		return false;
+	if(!get_number_opt(receiver, "deviation", false, 1, nyquist, "from 1 to half the sample rate", &demod.deviation))
+		return false;
+	if(!get_number_opt(receiver, "deemphasis", false, 0, 10000, "from 0-10000 microseconds", &demod.deemphasis))
+		return false;
+
+	Local<Value> squelch = get_opt(receiver, "squelch");
+	if(!squelch->IsUndefined()) {
+		if(!get_number_opt(receiver, "squelch", true, -200, 0, "from -200 to 0 dBFS", &demod.squelch_level))
+			return false;
+		demod.squelch = true;
+	}
+
+	if(!get_number_opt(receiver, "pitch", false, 1, 20000, "from 1-20000", &demod.pitch)) return false;
+
+	Local<Value> agc = get_opt(receiver, "agc");
+	if(!agc->IsUndefined()) {
+		if(!agc->IsBoolean()) {
+			Nan::ThrowTypeError("demod.agc must be a boolean");
+			return false;
+		}
+
+		demod.agc = Nan::To<bool>(agc).FromJust() ? 1 : 0;
+	}
+
+	double audio_rate = demod.audio_rate;
+	if(!get_number_opt(receiver, "audioRate", false, 1000, 384000, "from 1000-384000", &audio_rate)) return false;
+	demod.audio_rate = (uint32_t) audio_rate;
+
+	std::string err;
+	if(!Demodulator::Valid(demod, rate, &err)) {
+		Nan::ThrowRangeError(err.c_str());
+		return false;
+	}
+
+	*out = demod;
+	return true;
+}
+
+// demod: one receiver's options, or an array of up to 64 of them; the receivers see the outputRate stream if there
+// is one
+static bool parse_demod_options(Local<Value> demod_val, bool format_set, sample_reader_work_t * work) {
+	if(work->input_rate == 0) work->input_rate = backend_get_sample_rate(work->rtl_dev, *work->control);
+	if(work->input_rate == 0) {
+		Nan::ThrowError("the sample rate must be set before reading with demod");
+		return false;
+	}
+
+	const uint32_t rate = work->output_rate > 0 ? work->output_rate : work->input_rate;
+
+	if(demod_val->IsArray()) {
+		Local<v8::Array> receivers = demod_val.As<v8::Array>();
+
+		if(receivers->Length() < 1 || receivers->Length() > DEMOD_MAX_RECEIVERS) {
+			Nan::ThrowRangeError("demod must hold from 1-64 receivers");
+			return false;
+		}
+
+		work->receivers.resize(receivers->Length());
+		for(uint32_t i = 0; i < receivers->Length(); i++) {
+			if(!parse_receiver_options(Nan::Get(receivers, i).ToLocalChecked(), rate, &work->receivers[i]))
+				return false;
+		}
+	} else {
+		work->receivers.resize(1);
+		if(!parse_receiver_options(demod_val, rate, &work->receivers[0])) return false;
+	}
+
+	// audio is mono PCM
+	if(!format_set) work->format = SAMPLE_FORMAT_FLOAT32;
+	if(work->format != SAMPLE_FORMAT_FLOAT32 && work->format != SAMPLE_FORMAT_INT16) {
+		Nan::ThrowRangeError("format must be 'int16' or 'float32' with demod");
+		return false;
+	}
+
+	return true;
+}
+
+// ring: SharedArrayBuffer, laid out as a SampleRing by the reader; parsed last, as it rules out the other stages
+static bool parse_ring_option(Local<Value> ring_val, sample_reader_work_t * work) {
+	if(!ring_val->IsSharedArrayBuffer()) {
+		Nan::ThrowTypeError("ring must be a SharedArrayBuffer");
+		return false;
+	}
+
+	if(work->format == SAMPLE_FORMAT_FLOAT32_PLANAR || work->output_rate > 0 || work->channel_count > 0 ||
+	   work->spectrum_size > 0 || !work->receivers.empty() || work->squelch || work->history || work->record ||
+	   work->dc_block || work->iq_balance) {
+		Nan::ThrowError("ring cannot be used with the 'float32-planar' format, outputRate, channels, spectrum, demod, "
+		                "squelch, history, record, dcBlock, or iqBalance");
+		return false;
+	}
+
+	Local<v8::SharedArrayBuffer> ring = ring_val.As<v8::SharedArrayBuffer>();
+	const size_t size = ring->ByteLength();
+	const size_t transfer = work->buf_len > 0 ? work->buf_len : BUFFER_POOL_DEFAULT_SLAB_SIZE;
+
+	if(!SampleRing::Fits(size, SampleRing::RecordBytes(transfer, work->format))) {
+		Nan::ThrowRangeError("ring must be 256 bytes of header plus a power of two from 4096 bytes to 1 GiB with room "
+		                     "for two transfers");
+		return false;
+	}
+
+	// the contents stay where they are for as long as the buffer is alive, which work->ring_buffer sees to; V8 9
+	// (Node.js 16) dropped GetContents for the backing store
+#if NODE_MODULE_VERSION >= 83 // Node.js 14
+	work->ring = (uint8_t *) ring->GetBackingStore()->Data();
+#else
+	work->ring = (uint8_t *) ring->GetContents().Data();
+#endif
+	work->ring_size = size;
+	work->ring_buffer.Reset(ring);
+	return true;
+}
+
+bool parse_reader_options(Local<Value> opts_val, sample_reader_work_t * work) {
+	if(opts_val->IsUndefined() || opts_val->IsNull()) return true;
+
+	if(!opts_val->IsObject()) {
+		Nan::ThrowTypeError("opts must be an object");
+		return false;
+	}
+
+	Local<Object> opts = Nan::To<Object>(opts_val).ToLocalChecked();
+
+	if(!parse_queue_options(opts, &work->queue_depth, &work->overflow)) return false;
+
+	Local<Value> format = get_opt(opts, "format");
+	if(!get_format_opt(opts, true, &work->format)) return false;
+
+	if(!get_bool_opt(opts, "dcBlock", &work->dc_block)) return false;
+	if(!get_bool_opt(opts, "iqBalance", &work->iq_balance)) return false;
+
+	Local<Value> output_rate = get_opt(opts, "outputRate");
+	if(!output_rate->IsUndefined()) {
+		if(!output_rate->IsNumber()) {
+			Nan::ThrowTypeError("outputRate must be a number");
+			return false;
+		}
+
+		work->input_rate = backend_get_sample_rate(work->rtl_dev, *work->control);
+		if(work->input_rate == 0) {
+			Nan::ThrowError("the sample rate must be set before reading with outputRate");
+			return false;
+		}
+
+		const double d_rate = Nan::To<double>(output_rate).FromJust();
+		if(!(d_rate >= 1 && d_rate <= work->input_rate)) {
+			Nan::ThrowRangeError("outputRate must be from 1 to the device's sample rate");
+			return false;
+		}
+
+		work->output_rate = (uint32_t) d_rate;
+	}
+
+	Local<Value> channels = get_opt(opts, "channels");
+	if(!channels->IsUndefined() && !parse_channel_options(channels, work)) return false;
+
+	Local<Value> spectrum = get_opt(opts, "spectrum");
+	if(!spectrum->IsUndefined()) {
+		if(work->channel_count > 0) {
+			Nan::ThrowError("channels and spectrum cannot be used together");
+			return false;
+		}
+
+		if(!parse_spectrum_options(spectrum, work)) return false;
+	}
+
+	Local<Value> demod = get_opt(opts, "demod");
+	if(!demod->IsUndefined()) {
+		if(work->channel_count > 0 || work->spectrum_size > 0) {
+			Nan::ThrowError("demod cannot be used with channels or spectrum");
+			return false;
+		}
+
+		if(!parse_demod_options(demod, !format->IsUndefined(), work)) return false;
+	}
+
+	Local<Value> squelch = get_opt(opts, "squelch");
+	if(!squelch->IsUndefined()) {
+		if(work->output_rate > 0 || work->channel_count > 0 || work->spectrum_size > 0 || !work->receivers.empty()) {
+			Nan::ThrowError("squelch cannot be used with outputRate, channels, spectrum, or demod");
+			return false;
+		}
+
+		if(!parse_detector_options(squelch, "squelch", &work->squelch_options)) return false;
+		work->squelch = true;
+	}
+
+	Local<Value> history = get_opt(opts, "history");
+	if(!history->IsUndefined()) {
+		if(work->output_rate > 0 || work->channel_count > 0 || work->spectrum_size > 0 || !work->receivers.empty() ||
+		   work->squelch || work->dc_block || work->iq_balance) {
+			Nan::ThrowError("history cannot be used with outputRate, channels, spectrum, demod, squelch, dcBlock, or "
+			                "iqBalance");
+			return false;
+		}
+
+		if(!parse_history_options(history, work)) return false;
+	}
+
+	Local<Value> record = get_opt(opts, "record");
+	if(!record->IsUndefined()) {
+		if(work->format != SAMPLE_FORMAT_UINT8 || work->output_rate > 0 || work->channel_count > 0 ||
+		   work->spectrum_size > 0 || !work->receivers.empty() || work->squelch || work->history || work->dc_block ||
+		   work->iq_balance) {
+			Nan::ThrowError("record cannot be used with a format other than 'uint8', outputRate, channels, spectrum, "
+			                "demod, squelch, history, dcBlock, or iqBalance");
+			return false;
+		}
+
+		if(!parse_record_options(record, work)) return false;
+	}
+
+	Local<Value> ring = get_opt(opts, "ring");
+	if(!ring->IsUndefined() && !parse_ring_option(ring, work)) return false;
+
+	return true;
+}
+
+// one pipeline: the options of read_async but squelch, history, and ring, with overflow 'drop-oldest' by default
+// and never 'block', so that no pipeline can hold up the capture thread and with it the others
+static bool parse_pipeline_options(Local<Value> opts_val, sample_reader_work_t * work) {
+	if(!opts_val->IsObject()) {
+		Nan::ThrowTypeError("pipelines must be an array of objects");
+		return false;
+	}
+
+	Local<Object> opts = Nan::To<Object>(opts_val).ToLocalChecked();
+	if(!get_opt(opts, "squelch")->IsUndefined() || !get_opt(opts, "history")->IsUndefined() ||
+	   !get_opt(opts, "ring")->IsUndefined()) {
+		Nan::ThrowError("a pipeline cannot use squelch, history, or ring");
+		return false;
+	}
+
+	work->overflow = OVERFLOW_DROP_OLDEST;
+	if(!parse_reader_options(opts, work)) return false;
+
+	if(work->overflow == OVERFLOW_BLOCK) {
+		Nan::ThrowRangeError("a pipeline's overflow must be 'drop-oldest' or 'drop-newest'");
+		return false;
+	}
+
+	return true;
+}
+
+bool parse_fan_out_options(Local<Value> pipelines_val, sample_reader_work_t * work,
+                           std::vector<sample_reader_work_t *> * out) {
+	if(!pipelines_val->IsArray()) {
+		Nan::ThrowTypeError("pipelines must be an array of objects");
+		return false;
+	}
+
+	Local<v8::Array> pipelines = pipelines_val.As<v8::Array>();
+	if(pipelines->Length() < 1 || pipelines->Length() > SAMPLE_READER_MAX_PIPELINES) {
+		Nan::ThrowRangeError("a fan-out must have from 1-16 pipelines");
+		return false;
+	}
+
+	// a slab per USB buffer librtlsdr may have in flight, plus one per slot of every pipeline's queue and one for
+	// the transfer each is working on, and for the raw pipeline, one per Buffer it may lend (see Deliver)
+	size_t slabs = work->buf_num > 0 ? work->buf_num : BUFFER_POOL_DEFAULT_SLAB_COUNT;
+	bool shared = false;
+
+	for(uint32_t i = 0; i < pipelines->Length(); i++) {
+		sample_reader_work_t * pipeline = new sample_reader_work_t();
+		pipeline->rtl_dev  = work->rtl_dev;
+		pipeline->control  = work->control;
+		pipeline->stats    = std::make_shared<StreamStats>();
+		pipeline->buf_num  = work->buf_num;
+		pipeline->buf_len  = work->buf_len;
+		pipeline->pipeline = true;
+		out->push_back(pipeline);
+
+		if(!parse_pipeline_options(Nan::Get(pipelines, i).ToLocalChecked(), pipeline)) {
+			for(size_t j = 0; j < out->size(); j++) delete (*out)[j];
+			out->clear();
+			return false;
+		}
+
+		// the first raw pipeline queues the slabs themselves; any other runs its stages on a thread of its own
+		pipeline->shared_slabs = !shared && pipeline->format == SAMPLE_FORMAT_UINT8 && !pipeline->dc_block &&
+		                         !pipeline->iq_balance && pipeline->output_rate == 0 && pipeline->channel_count == 0 &&
+		                         pipeline->spectrum_size == 0 && pipeline->receivers.empty() && !pipeline->record;
+		shared = shared || pipeline->shared_slabs;
+
+		slabs += pipeline->queue_depth + 1;
+		if(pipeline->shared_slabs) slabs += pipeline->queue_depth;
+	}
+
+	work->fan_out_slabs = slabs;
+	return true;
+}
+
+bool parse_sweep_options(Local<Value> opts_val, sample_reader_work_t * work) {
+	if(!opts_val->IsObject()) {
+		Nan::ThrowTypeError("opts must be an object");
+		return false;
+	}
+
+	Local<Object> opts = Nan::To<Object>(opts_val).ToLocalChecked();
+	sweep_options_t & sweep = work->sweep_options;
+	double start, stop, sweeps = 0;
+
+	if(!parse_queue_options(opts, &work->queue_depth, &work->overflow)) return false;
+
+	if(!get_number_opt(opts, "start", true, 0, UINT32_MAX, "a frequency from 0-4294967295 Hz", &start)) return false;
+	if(!get_number_opt(opts, "stop", true, 0, UINT32_MAX, "a frequency from 0-4294967295 Hz", &stop)) return false;
+	if(!get_number_opt(opts, "binWidth", true, 0, HUGE_VAL, "a positive number of Hz", &sweep.bin_width))
+		return false;
+	if(!get_number_opt(opts, "dwell", false, 1, 60000, "from 1-60000 ms", &sweep.dwell_ms)) return false;
+	if(!get_number_opt(opts, "settle", false, 0, 10000, "from 0-10000 ms", &sweep.settle_ms)) return false;
+	if(!get_number_opt(opts, "crop", false, 0, 0.99, "from 0-0.99", &sweep.crop)) return false;
+	if(!get_number_opt(opts, "sweeps", false, 0, UINT32_MAX, "an integer from 0-4294967295", &sweeps)) return false;
+
+	sweep.start = (uint32_t) start;
+	sweep.stop = (uint32_t) stop;
+	sweep.sweeps = (uint32_t) sweeps;
+
+	Local<Value> window = get_opt(opts, "window");
+	if(!window->IsUndefined()) {
+		if(!window->IsString()) {
+			Nan::ThrowTypeError("window must be a string");
+			return false;
+		}
+
+		std::string s_window(*Nan::Utf8String(window));
+		if(!parse_spectrum_window(s_window.c_str(), &sweep.window)) {
+			Nan::ThrowRangeError("window must be 'rectangular', 'hann', 'hamming', 'blackman', or 'blackman-harris'");
+			return false;
+		}
+	}
+
+	work->input_rate = backend_get_sample_rate(work->rtl_dev, *work->control);
+	if(work->input_rate == 0) {
+		Nan::ThrowError("the sample rate must be set before sweeping");
+		return false;
+	}
+
+	std::string err;
+	if(!Sweeper::Valid(sweep, work->input_rate, &err)) {
+		Nan::ThrowRangeError(err.c_str());
+		return false;
+	}
+
+	work->sweep = true;
+	work->format = SAMPLE_FORMAT_FLOAT32;
+	return true;
+}
+
+// blockSize:int = buf_len / 2, align:('time'|'index') = 'time', offsets:int[] = <0 for every device>, and the
+// queue options and format of read_async, except 'float32-planar'; the devices' sample rates must match
+bool parse_capture_group_options(Local<Value> opts_val, capture_group_work_t * work) {
+	stream_aligner_options_t & align = work->align;
+	align.block = (work->buf_len > 0 ? work->buf_len : BUFFER_POOL_DEFAULT_SLAB_SIZE) / 2;
+
+	const uint32_t rate = backend_get_sample_rate(work->rtl_devs[0], *work->controls[0]);
+	for(size_t i = 1; i < work->rtl_devs.size(); i++) {
+		if(backend_get_sample_rate(work->rtl_devs[i], *work->controls[i]) != rate) {
+			Nan::ThrowError("every device in a group must have the same sample rate");
+			return false;
+		}
+	}
+
+	align.rate = rate;
+
+	if(!opts_val->IsUndefined() && !opts_val->IsNull()) {
+		if(!opts_val->IsObject()) {
+			Nan::ThrowTypeError("opts must be an object");
+			return false;
+		}
+
+		Local<Object> opts = Nan::To<Object>(opts_val).ToLocalChecked();
+
+		if(!parse_queue_options(opts, &work->queue_depth, &work->overflow)) return false;
+		if(!get_format_opt(opts, false, &work->format)) return false;
+
+		double block = align.block;
+		if(!get_number_opt(opts, "blockSize", false, 1, JS_RTLSDR_MAX_GROUP_BLOCK, "an integer from 1-1048576",
+		                   &block))
+			return false;
+
+		align.block = (uint32_t) block;
+
+		Local<Value> by = get_opt(opts, "align");
+		if(!by->IsUndefined()) {
+			if(!by->IsString()) {
+				Nan::ThrowTypeError("align must be a string");
+				return false;
+			}
+
+			std::string s_by(*Nan::Utf8String(by));
+			if(s_by != "time" && s_by != "index") {
+				Nan::ThrowRangeError("align must be 'time' or 'index'");
+				return false;
+			}
+
+			align.by_time = s_by == "time";
+		}
+
+		Local<Value> offsets = get_opt(opts, "offsets");
+		if(!offsets->IsUndefined()) {
+			if(!offsets->IsArray()) {
+				Nan::ThrowTypeError("offsets must be an array of numbers");
+				return false;
+			}
+
+			Local<v8::Array> a_offsets = offsets.As<v8::Array>();
+			if(a_offsets->Length() != work->rtl_devs.size()) {
+				Nan::ThrowRangeError("offsets must hold one number for each device");
+				return false;
+			}
+
+			for(uint32_t i = 0; i < a_offsets->Length(); i++) {
+				Local<Value> one = Nan::Get(a_offsets, i).ToLocalChecked();
+				if(!one->IsNumber()) {
+					Nan::ThrowTypeError("offsets must be an array of numbers");
+					return false;
+				}
+
+				const double d_offset = Nan::To<double>(one).FromJust();
+				if(!(d_offset >= 0 && d_offset <= UINT32_MAX)) {
+					Nan::ThrowRangeError("offsets must be integers from 0-4294967295");
+					return false;
+				}
+
+				align.offsets.push_back((uint64_t) d_offset);
+			}
+		}
+	}
+
+	if(align.by_time && rate == 0) {
+		Nan::ThrowError("the sample rate must be set before capturing with align 'time'");
+		return false;
+	}
+
+	return true;
+}
+
+bool parse_thread_options(Local<Value> opts_val, reader_thread_opts_t * thread_opts) {
+	if(opts_val->IsUndefined() || opts_val->IsNull()) return true;
+
+	if(!opts_val->IsObject()) {
+		Nan::ThrowTypeError("opts must be an object");
+		return false;
+	}
+
+	Local<Object> opts = Nan::To<Object>(opts_val).ToLocalChecked();
+
+	Local<Value> cpu = get_opt(opts, "cpu");
+	if(cpu->IsNumber()) {
+		thread_opts->cpus.push_back(Nan::To<int>(cpu).FromJust());
+	} else if(cpu->IsArray()) {
+		Local<v8::Array> cpus = cpu.As<v8::Array>();
+
+		for(uint32_t i = 0; i < cpus->Length(); i++) {
+			Local<Value> one = Nan::Get(cpus, i).ToLocalChecked();
+			if(!one->IsNumber()) {
+				Nan::ThrowTypeError("cpu must be a number or an array of numbers");
+				return false;
+			}
+
+			thread_opts->cpus.push_back(Nan::To<int>(one).FromJust());
+		}
+	} else if(!cpu->IsUndefined()) {
+		Nan::ThrowTypeError("cpu must be a number or an array of numbers");
+		return false;
+	}
+
+	for(size_t i = 0; i < thread_opts->cpus.size(); i++) {
+		if(thread_opts->cpus[i] < 0 || thread_opts->cpus[i] >= JS_RTLSDR_MAX_CPU) {
+			Nan::ThrowRangeError("cpu numbers must be from 0-1023");
+			return false;
+		}
+	}
+
+	Local<Value> realtime = get_opt(opts, "realtimePriority");
+	if(!realtime->IsUndefined()) {
+		if(!realtime->IsNumber()) {
+			Nan::ThrowTypeError("realtimePriority must be a number");
+			return false;
+		}
+
+		int i_realtime = Nan::To<int>(realtime).FromJust();
+		if(i_realtime < 1 || i_realtime > 99) {
+			Nan::ThrowRangeError("realtimePriority must be an integer from 1-99");
+			return false;
+		}
+
+		thread_opts->fifo_priority = i_realtime;
+	}
+
+	Local<Value> nice = get_opt(opts, "nice");
+	if(!nice->IsUndefined()) {
+		if(!nice->IsNumber()) {
+			Nan::ThrowTypeError("nice must be a number");
+			return false;
+		}
+
+		int i_nice = Nan::To<int>(nice).FromJust();
+		if(i_nice < -20 || i_nice > 19) {
+			Nan::ThrowRangeError("nice must be an integer from -20-19");
+			return false;
+		}
+
+		thread_opts->has_nice = true;
+		thread_opts->nice = i_nice;
+	}
+
+	return true;
+}
+
+// sampleRate:int, centerFreq:int, speed:number = 1, loop:bool = false
+bool parse_file_device_options(Local<Value> opts_val, file_device_options_t * file_opts) {
+	if(opts_val->IsUndefined() || opts_val->IsNull()) return true;
+
+	if(!opts_val->IsObject()) {
+		Nan::ThrowTypeError("opts must be an object");
+		return false;
+	}
+
+	Local<Object> opts = Nan::To<Object>(opts_val).ToLocalChecked();
+	double sample_rate = 0, center_freq = 0;
+
+	if(!get_number_opt(opts, "sampleRate", false, 1, UINT32_MAX, "a rate from 1-4294967295 Hz", &sample_rate))
+		return false;
+
+	if(!get_number_opt(opts, "centerFreq", false, 1, UINT32_MAX, "a frequency from 1-4294967295 Hz", &center_freq))
+		return false;
+
+	if(!get_number_opt(opts, "speed", false, 0, FILE_DEVICE_MAX_SPEED, "a number from 0-10000", &file_opts->speed))
+		return false;
+
+	if(!get_bool_opt(opts, "loop", &file_opts->loop)) return false;
+
+	file_opts->sample_rate = (uint32_t) sample_rate;
+	file_opts->center_freq = (uint32_t) center_freq;
+	return true;
+}
+
+// marks setting as set if the option is present
+static bool get_setting_opt(Local<Object> opts, const char * name, double min, double max, const char * range,
+                            device_setting_t setting, device_settings_t * out) {
+	if(get_opt(opts, name)->IsUndefined()) return true;
+
+	double value = 0;
+	if(!get_number_opt(opts, name, true, min, max, range, &value)) return false;
+
+	if(value != std::floor(value)) {
+		Nan::ThrowRangeError((std::string(name) + " must be " + range).c_str());
+		return false;
+	}
+
+	out->set[setting] = true;
+	out->value[setting] = (int64_t) value;
+	return true;
+}
+
+// marks setting as set if the option is present
+static bool get_setting_bool_opt(Local<Object> opts, const char * name, device_setting_t setting,
+                                 device_settings_t * out) {
+	if(get_opt(opts, name)->IsUndefined()) return true;
+
+	bool value = false;
+	if(!get_bool_opt(opts, name, &value)) return false;
+
+	out->set[setting] = true;
+	out->value[setting] = value ? 1 : 0;
+	return true;
+}
+
+// sampleRate:int, directSampling:int, offsetTuning:bool, freqCorrection:int, centerFreq:int, bandwidth:int,
+// gainMode:int, gain:int, agc:bool, testmode:bool -- each as the matching set_* takes it; absent ones are unchanged
+bool parse_device_settings(Local<Value> settings_val, device_settings_t * out) {
+	if(!settings_val->IsObject()) {
+		Nan::ThrowTypeError("settings must be an object");
+		return false;
+	}
+
+	Local<Object> opts = Nan::To<Object>(settings_val).ToLocalChecked();
+
+	return get_setting_opt(opts, "sampleRate", 1, UINT32_MAX, "an integer rate from 1-4294967295 Hz",
+	                       DEVICE_SETTING_SAMPLE_RATE, out) &&
+	       get_setting_opt(opts, "directSampling", 0, 2, "0 (off), 1 (I-ADC input), or 2 (Q-ADC input)",
+	                       DEVICE_SETTING_DIRECT_SAMPLING, out) &&
+	       get_setting_bool_opt(opts, "offsetTuning", DEVICE_SETTING_OFFSET_TUNING, out) &&
+	       get_setting_opt(opts, "freqCorrection", INT32_MIN, INT32_MAX, "an integer ppm",
+	                       DEVICE_SETTING_FREQ_CORRECTION, out) &&
+	       get_setting_opt(opts, "centerFreq", 1, UINT32_MAX, "an integer frequency from 1-4294967295 Hz",
+	                       DEVICE_SETTING_CENTER_FREQ, out) &&
+	       get_setting_opt(opts, "bandwidth", 0, UINT32_MAX, "an integer from 0 (automatic)-4294967295 Hz",
+	                       DEVICE_SETTING_TUNER_BANDWIDTH, out) &&
+	       get_setting_opt(opts, "gainMode", 0, 1, "0 (automatic) or 1 (manual)",
+	                       DEVICE_SETTING_TUNER_GAIN_MODE, out) &&
+	       get_setting_opt(opts, "gain", INT32_MIN, INT32_MAX, "an integer gain in cB",
+	                       DEVICE_SETTING_TUNER_GAIN, out) &&
+	       get_setting_bool_opt(opts, "agc", DEVICE_SETTING_AGC_MODE, out) &&
+	       get_setting_bool_opt(opts, "testmode", DEVICE_SETTING_TESTMODE, out);
+}
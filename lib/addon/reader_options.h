@@ -0,0 +1,38 @@
+#ifndef JS_RTLSDR_READER_OPTIONS_GRAB_H
+#define JS_RTLSDR_READER_OPTIONS_GRAB_H
+
+#include <nan.h>
+
+#include "capture_group.h"
+#include "device_context.h"
+#include "device_settings.h"
+#include "file_device.h"
+#include "sample_reader.h"
+
+// Read the optional `opts` object of read_async / wait_async into work. On failure a JS exception has been
+// scheduled and false is returned; the caller should return immediately.
+bool parse_reader_options(v8::Local<v8::Value> opts, sample_reader_work_t * work);
+
+// Read the required `pipelines` array of fan_out into one work per pipeline, each a copy of the fan-out's work with
+// its own options and counters, and size the fan-out's shared pool, with the same failure convention; out holds
+// nothing on failure.
+bool parse_fan_out_options(v8::Local<v8::Value> pipelines, sample_reader_work_t * work,
+                           std::vector<sample_reader_work_t *> * out);
+
+// Read the required `opts` object of sweep into work, with the same failure convention.
+bool parse_sweep_options(v8::Local<v8::Value> opts, sample_reader_work_t * work);
+
+// Read the optional `opts` object of capture_group into work, whose devices and buffers are already set, with the
+// same failure convention.
+bool parse_capture_group_options(v8::Local<v8::Value> opts, capture_group_work_t * work);
+
+// Read the optional `opts` object of open into thread_opts, with the same failure convention.
+bool parse_thread_options(v8::Local<v8::Value> opts, reader_thread_opts_t * thread_opts);
+
+// Read the optional `opts` object of open_file into file_opts, with the same failure convention.
+bool parse_file_device_options(v8::Local<v8::Value> opts, file_device_options_t * file_opts);
+
+// Read the required `settings` object of configure into out, with the same failure convention.
+bool parse_device_settings(v8::Local<v8::Value> settings, device_settings_t * out);
+
+#endif
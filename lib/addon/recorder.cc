@@ -0,0 +1,336 @@
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include "recorder.h"
+
+static double wall_clock_ms() {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+// ISO 8601 UTC with milliseconds, as SigMF's core:datetime wants
+static std::string iso8601(double ms) {
+	const time_t secs = (time_t) (ms / 1000);
+	struct tm utc;
+	gmtime_r(&secs, &utc);
+
+	char out[40];
+	const size_t len = strftime(out, sizeof(out), "%Y-%m-%dT%H:%M:%S", &utc);
+	snprintf(out + len, sizeof(out) - len, ".%03dZ", (int) (ms - secs * 1000.0));
+	return out;
+}
+
+static std::string json_string(const std::string & s) {
+	std::string out = "\"";
+
+	for(size_t i = 0; i < s.size(); i++) {
+		const unsigned char c = (unsigned char) s[i];
+
+		if(c == '"' || c == '\\') {
+			out += '\\';
+			out += (char) c;
+		} else if(c < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			out += escaped;
+		} else {
+			out += (char) c;
+		}
+	}
+
+	return out + "\"";
+}
+
+Recorder::Recorder(const recorder_options_t & opts) : opts(opts), memory(NULL), blocks(opts.blocks) {
+	this->stats.blocks = opts.blocks;
+
+	void * memory = NULL;
+	if(posix_memalign(&memory, RECORDER_ALIGNMENT, opts.blocks * opts.block_size) != 0) {
+		this->Fail("could not allocate the recording's blocks");
+		return;
+	}
+
+	this->memory = (uint8_t *) memory;
+	this->free_blocks.reserve(opts.blocks);
+
+	for(size_t i = opts.blocks; i > 0; i--) {
+		this->blocks[i - 1].data = this->memory + (i - 1) * opts.block_size;
+		this->free_blocks.push_back(&this->blocks[i - 1]);
+	}
+
+	this->writer = std::thread(&Recorder::Run, this);
+}
+
+Recorder::~Recorder() {
+	std::string err;
+	this->Close(&err);
+	free(this->memory);
+}
+
+bool Recorder::Write(const uint8_t * buf, uint32_t len) {
+	while(len > 0) {
+		if(this->current == NULL) {
+			std::unique_lock<std::mutex> lock(this->mutex);
+
+			if(this->opts.overflow == OVERFLOW_BLOCK) {
+				while(this->free_blocks.empty() && !this->released && !this->failed) this->has_free.wait(lock);
+			}
+
+			if(this->failed || this->closed) return false;
+
+			// a block on its way to disk cannot be taken back, so both drop policies drop the arriving bytes
+			if(this->free_blocks.empty() || this->released) {
+				this->stats.bytes_dropped += len;
+				this->offset += len;
+				return true;
+			}
+
+			this->current = this->free_blocks.back();
+			this->free_blocks.pop_back();
+			lock.unlock();
+
+			this->current->len = 0;
+			this->current->opens = this->file_fill == 0;
+			this->current->closes = false;
+			this->current->offset = this->offset;
+			this->current->time = wall_clock_ms();
+		}
+
+		size_t room = this->opts.block_size - this->current->len;
+		if(this->opts.rotate_bytes > 0 && this->opts.rotate_bytes - this->file_fill < room)
+			room = (size_t) (this->opts.rotate_bytes - this->file_fill);
+
+		const size_t n = len < room ? len : room;
+		memcpy(this->current->data + this->current->len, buf, n);
+		this->current->len += n;
+		this->file_fill += n;
+		this->offset += n;
+		buf += n;
+		len -= (uint32_t) n;
+
+		if(this->opts.rotate_bytes > 0 && this->file_fill == this->opts.rotate_bytes) {
+			this->current->closes = true;
+			this->file_fill = 0;
+			this->Submit();
+		} else if(this->current->len == this->opts.block_size) {
+			this->Submit();
+		}
+	}
+
+	return true;
+}
+
+// capture thread: queue the current block for the writer
+void Recorder::Submit() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->pending.push_back(this->current);
+	this->current = NULL;
+
+	this->stats.backlog = this->pending.size();
+	if(this->stats.backlog > this->stats.backlog_max) this->stats.backlog_max = this->stats.backlog;
+	this->has_pending.notify_one();
+}
+
+bool Recorder::Close(std::string * err) {
+	if(!this->closed) {
+		this->closed = true;
+
+		if(this->current != NULL && this->current->len > 0) {
+			this->current->closes = true;
+			this->Submit();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->closing = true;
+			this->has_pending.notify_one();
+		}
+
+		if(this->writer.joinable()) this->writer.join();
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if(this->failed) *err = this->error;
+	return !this->failed;
+}
+
+void Recorder::Release() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->released = true;
+	this->has_free.notify_all();
+}
+
+void Recorder::Stats(recorder_stats_t * out) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	*out = this->stats;
+}
+
+// record the first failure; the writer keeps recycling blocks so the capture thread is never left waiting
+void Recorder::Fail(const std::string & msg) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if(!this->failed) this->error = msg;
+	this->failed = true;
+	this->has_free.notify_all();
+}
+
+// writer thread: write blocks in order until Close, then finish the last file
+void Recorder::Run() {
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	for(;;) {
+		while(this->pending.empty() && !this->closing) this->has_pending.wait(lock);
+		if(this->pending.empty()) break;
+
+		recorder_block_t * block = this->pending.front();
+		this->pending.pop_front();
+		this->stats.backlog = this->pending.size();
+		const bool skip = this->failed;
+		lock.unlock();
+
+		if(!skip) {
+			if(block->opens || this->fd < 0) {
+				this->CloseFile();
+				if(this->Open(*block) && this->WriteBlock(*block) && block->closes) this->CloseFile();
+			} else if(this->WriteBlock(*block) && block->closes) {
+				this->CloseFile();
+			}
+		}
+
+		lock.lock();
+		this->free_blocks.push_back(block);
+		this->has_free.notify_one();
+	}
+
+	lock.unlock();
+	this->CloseFile();
+}
+
+std::string Recorder::FileName(const char * ext) const {
+	if(this->opts.rotate_bytes == 0) return this->opts.path + ext;
+
+	char index[16];
+	snprintf(index, sizeof(index), "-%04u", this->file_index);
+	return this->opts.path + index + ext;
+}
+
+// writer thread: open the next data file and write its sidecar
+bool Recorder::Open(const recorder_block_t & block) {
+	const std::string data_path = this->FileName(".cu8");
+	const std::string meta_path = this->FileName(".sigmf-meta");
+	const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+	this->fd_direct = false;
+	this->fd = -1;
+
+	#ifdef O_DIRECT
+	// file systems without O_DIRECT (tmpfs, for one) refuse it with EINVAL; those get buffered writes
+	if(this->opts.direct) {
+		this->fd = open(data_path.c_str(), flags | O_DIRECT, 0644);
+		this->fd_direct = this->fd >= 0;
+	}
+	#endif
+
+	if(this->fd < 0) this->fd = open(data_path.c_str(), flags, 0644);
+
+	if(this->fd < 0) {
+		this->Fail("could not open " + data_path + ": " + strerror(errno));
+		return false;
+	}
+
+	// the dataset is named relative to the sidecar, which sits beside it
+	const size_t slash = data_path.rfind('/');
+	const std::string dataset = slash == std::string::npos ? data_path : data_path.substr(slash + 1);
+
+	FILE * meta = fopen(meta_path.c_str(), "w");
+	if(meta == NULL) {
+		this->Fail("could not open " + meta_path + ": " + strerror(errno));
+		return false;
+	}
+
+	fprintf(meta,
+		"{\n"
+		"    \"global\": {\n"
+		"        \"core:datatype\": \"cu8\",\n"
+		"        \"core:sample_rate\": %u,\n"
+		"        \"core:version\": \"1.0.0\",\n"
+		"        \"core:dataset\": %s,\n"
+		"        \"core:hw\": %s,\n"
+		"        \"core:recorder\": \"js-rtlsdr\"\n"
+		"    },\n"
+		"    \"captures\": [\n"
+		"        {\n"
+		"            \"core:sample_start\": 0,\n"
+		"            \"core:global_index\": %llu,\n"
+		"            \"core:frequency\": %u,\n"
+		"            \"core:datetime\": \"%s\"\n"
+		"        }\n"
+		"    ],\n"
+		"    \"annotations\": []\n"
+		"}\n",
+		this->opts.sample_rate, json_string(dataset).c_str(), json_string(this->opts.hw).c_str(),
+		(unsigned long long) (block.offset / 2), this->opts.center_freq, iso8601(block.time).c_str());
+
+	if(fclose(meta) != 0) {
+		this->Fail("could not write " + meta_path + ": " + strerror(errno));
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->file_index++;
+	this->stats.files = this->file_index;
+	this->stats.file = data_path;
+	this->stats.direct = this->fd_direct;
+	return true;
+}
+
+// writer thread: one block, in as few write(2) calls as the kernel allows
+bool Recorder::WriteBlock(const recorder_block_t & block) {
+	#ifdef O_DIRECT
+	// only a file's last block may be short, so dropping O_DIRECT for it leaves every earlier write aligned
+	if(this->fd_direct && block.len % RECORDER_ALIGNMENT != 0) {
+		fcntl(this->fd, F_SETFL, fcntl(this->fd, F_GETFL) & ~O_DIRECT);
+		this->fd_direct = false;
+	}
+	#endif
+
+	const auto started = std::chrono::steady_clock::now();
+	size_t done = 0;
+
+	while(done < block.len) {
+		const ssize_t n = write(this->fd, block.data + done, block.len - done);
+
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) {
+			this->Fail(std::string("could not write ") + this->stats.file + ": " + strerror(n < 0 ? errno : ENOSPC));
+			return false;
+		}
+
+		done += (size_t) n;
+	}
+
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->stats.writes++;
+	this->stats.bytes_written += block.len;
+	this->stats.write_ms_last = ms;
+	this->stats.write_ms_mean += (ms - this->stats.write_ms_mean) / this->stats.writes;
+	if(ms > this->stats.write_ms_max) this->stats.write_ms_max = ms;
+	return true;
+}
+
+void Recorder::CloseFile() {
+	if(this->fd < 0) return;
+
+	if(close(this->fd) != 0) this->Fail(std::string("could not close ") + this->stats.file + ": " + strerror(errno));
+	this->fd = -1;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->stats.file.clear();
+	this->stats.direct = false;
+}
@@ -0,0 +1,118 @@
+#ifndef JS_RTLSDR_RECORDER_GRAB_H
+#define JS_RTLSDR_RECORDER_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sample_queue.h"
+
+#define RECORDER_ALIGNMENT          (4096)      // of block memory, sizes, and file offsets, as O_DIRECT wants
+#define RECORDER_DEFAULT_BLOCK_SIZE (1 << 20)
+#define RECORDER_MAX_BLOCK_SIZE     (64 << 20)
+#define RECORDER_DEFAULT_BLOCKS     (16)
+#define RECORDER_MAX_BLOCKS         (4096)
+
+typedef struct recorder_options {
+	std::string path;            // files are path.cu8 and path.sigmf-meta, or path-NNNN.* when rotating
+	size_t   block_size = RECORDER_DEFAULT_BLOCK_SIZE; // bytes per write, a multiple of RECORDER_ALIGNMENT
+	size_t   blocks = RECORDER_DEFAULT_BLOCKS;         // blocks allocated up front, so the backlog's bound
+	bool     direct = false;     // open with O_DIRECT where the platform and file system allow it
+	uint64_t rotate_bytes = 0;   // start a new file every this many bytes; 0 for one file
+	overflow_policy_t overflow = OVERFLOW_BLOCK; // with no free block: wait for one, or drop the arriving bytes
+
+	// for the SigMF sidecars, as the device was set when the recording started
+	uint32_t    sample_rate = 0;
+	uint32_t    center_freq = 0;
+	std::string hw;
+} recorder_options_t;
+
+typedef struct recorder_stats {
+	uint64_t    bytes_written = 0;
+	uint64_t    bytes_dropped = 0;  // arrived while every block was full, under a drop policy
+	uint64_t    writes = 0;
+	double      write_ms_last = 0;  // latency of write(2) calls
+	double      write_ms_mean = 0;
+	double      write_ms_max = 0;
+	size_t      backlog = 0;        // full blocks waiting for the writer
+	size_t      backlog_max = 0;
+	size_t      blocks = 0;
+	unsigned    files = 0;          // data files opened so far
+	std::string file;               // the data file being written, if any
+	bool        direct = false;     // whether the current file is open with O_DIRECT
+} recorder_stats_t;
+
+// Records raw I/Q to disk off the capture thread. The capture thread copies each transfer into large blocks
+// allocated once, aligned for O_DIRECT, and hands every full block to a writer thread, which writes it with one
+// write(2). Files rotate after rotate_bytes, at a block boundary the capture thread seals, so every file but the
+// last is exactly that long; each data file gets a SigMF .sigmf-meta sidecar naming it as its dataset. The first
+// failed open or write stops the recording: Write returns false from then on and Close reports the error.
+class Recorder {
+public:
+	explicit Recorder(const recorder_options_t & opts);
+	~Recorder();
+
+	// capture thread: append one transfer; false once the writer has failed
+	bool Write(const uint8_t * buf, uint32_t len);
+
+	// capture thread: write out the partial block, finish the last file, and join the writer; false if the
+	// recording failed, with the reason in err. Idempotent.
+	bool Close(std::string * err);
+
+	// any thread: unblock a Write waiting for a free block and drop whatever arrives afterwards
+	void Release(void);
+
+	// any thread
+	void Stats(recorder_stats_t * out);
+
+private:
+	typedef struct recorder_block {
+		uint8_t * data;
+		size_t    len;
+		bool      opens;  // the first block of a file
+		bool      closes; // the last block of a file
+		uint64_t  offset; // bytes since the recording started, counting dropped ones
+		double    time;   // wall-clock ms when the capture thread started filling it
+	} recorder_block_t;
+
+	void Submit(void);
+	void Run(void);
+	bool Open(const recorder_block_t & block);
+	bool WriteBlock(const recorder_block_t & block);
+	void CloseFile(void);
+	void Fail(const std::string & msg);
+	std::string FileName(const char * ext) const;
+
+	const recorder_options_t opts;
+	uint8_t * memory;
+	std::vector<recorder_block_t> blocks;
+
+	// capture thread only
+	recorder_block_t * current = NULL;
+	uint64_t file_fill = 0; // bytes handed to the current file
+	uint64_t offset = 0;
+	bool closed = false;
+
+	// writer thread only
+	int fd = -1;
+	bool fd_direct = false;
+	unsigned file_index = 0;
+
+	std::mutex mutex;
+	std::condition_variable has_free, has_pending;
+	std::vector<recorder_block_t *> free_blocks;
+	std::deque<recorder_block_t *> pending;
+	bool closing = false;
+	bool released = false;
+	bool failed = false;
+	std::string error;
+	recorder_stats_t stats;
+	std::thread writer;
+};
+
+#endif
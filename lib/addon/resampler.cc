@@ -0,0 +1,275 @@
+#include <cmath>
+#include <cstring>
+#include "fir.h"
+#include "resampler.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define CIC_ORDER       (4)
+#define CIC_INPUT_SCALE (32768.0f) // floats are fixed-pointed to Q15 so the integrators can wrap exactly
+
+#define HALF_BAND_TAPS (31) // 4 * 8 - 1; every other tap but the center is zero
+#define HALF_BAND_EVEN (16) // nonzero taps besides the center
+#define HALF_BAND_HIST (15)
+
+// one step of the cascade; Process works in place on pairs complex samples and returns how many it wrote, which is
+// never more than it read
+class ResamplerStage {
+public:
+	virtual ~ResamplerStage() {}
+	virtual size_t Process(float * iq, size_t pairs) = 0;
+};
+
+// Order-4 CIC decimator. I and Q share one 128-bit register per integrator and comb, as two 64-bit lanes; the
+// lanes wrap modulo 2^64, which the CIC tolerates, so there is no precision drift however long it runs.
+class CicDecimator : public ResamplerStage {
+public:
+	explicit CicDecimator(unsigned factor)
+		: factor(factor), scale(1.0 / (CIC_INPUT_SCALE * pow((double) factor, CIC_ORDER))) {
+		memset(this->integrators, 0, sizeof(this->integrators));
+		memset(this->combs, 0, sizeof(this->combs));
+	}
+
+	size_t Process(float * iq, size_t pairs) {
+		size_t out = 0;
+
+		#ifdef __SSE2__
+		__m128i integ[CIC_ORDER], comb[CIC_ORDER];
+		for(int s = 0; s < CIC_ORDER; s++) {
+			integ[s] = _mm_loadu_si128((const __m128i *) this->integrators[s]);
+			comb[s] = _mm_loadu_si128((const __m128i *) this->combs[s]);
+		}
+
+		const __m128 to_fixed = _mm_set1_ps(CIC_INPUT_SCALE);
+
+		for(size_t k = 0; k < pairs; k++) {
+			const __m128 x = _mm_castpd_ps(_mm_load_sd((const double *) (iq + 2 * k)));
+			const __m128i x32 = _mm_cvtps_epi32(_mm_mul_ps(x, to_fixed));
+			__m128i y = _mm_unpacklo_epi32(x32, _mm_srai_epi32(x32, 31)); // sign-extend to 64 bits
+
+			for(int s = 0; s < CIC_ORDER; s++) y = integ[s] = _mm_add_epi64(integ[s], y);
+
+			if(++this->phase < this->factor) continue;
+			this->phase = 0;
+
+			for(int s = 0; s < CIC_ORDER; s++) {
+				const __m128i delayed = comb[s];
+				comb[s] = y;
+				y = _mm_sub_epi64(y, delayed);
+			}
+
+			int64_t lanes[2];
+			_mm_storeu_si128((__m128i *) lanes, y);
+			iq[2 * out]     = (float) (lanes[0] * this->scale);
+			iq[2 * out + 1] = (float) (lanes[1] * this->scale);
+			out++;
+		}
+
+		for(int s = 0; s < CIC_ORDER; s++) {
+			_mm_storeu_si128((__m128i *) this->integrators[s], integ[s]);
+			_mm_storeu_si128((__m128i *) this->combs[s], comb[s]);
+		}
+		#else
+		for(size_t k = 0; k < pairs; k++) {
+			uint64_t y[2] = {
+				(uint64_t) (int64_t) lrintf(iq[2 * k] * CIC_INPUT_SCALE),
+				(uint64_t) (int64_t) lrintf(iq[2 * k + 1] * CIC_INPUT_SCALE)
+			};
+
+			for(int s = 0; s < CIC_ORDER; s++) {
+				for(int c = 0; c < 2; c++) y[c] = this->integrators[s][c] += y[c];
+			}
+
+			if(++this->phase < this->factor) continue;
+			this->phase = 0;
+
+			for(int s = 0; s < CIC_ORDER; s++) {
+				for(int c = 0; c < 2; c++) {
+					const uint64_t delayed = this->combs[s][c];
+					this->combs[s][c] = y[c];
+					y[c] -= delayed;
+				}
+			}
+
+			iq[2 * out]     = (float) ((int64_t) y[0] * this->scale);
+			iq[2 * out + 1] = (float) ((int64_t) y[1] * this->scale);
+			out++;
+		}
+		#endif
+
+		return out;
+	}
+
+private:
+	const unsigned factor;
+	const double scale; // undoes the fixed-point scale and the CIC's gain of factor^order
+	unsigned phase = 0;
+	uint64_t integrators[CIC_ORDER][2];
+	uint64_t combs[CIC_ORDER][2];
+};
+
+// Half-band decimator by 2. The input is split into its even and odd samples: the nonzero outer taps only ever see
+// even samples, so each output is one contiguous fir_dot over the even stream plus the center tap times one odd
+// sample.
+class HalfBandDecimator : public ResamplerStage {
+public:
+	HalfBandDecimator() : even(2 * HALF_BAND_HIST, 0.0f), odd(2 * HALF_BAND_HIST, 0.0f) {
+		const std::vector<float> proto = fir_design_lowpass(HALF_BAND_TAPS, 0.25, 1.0);
+		float outer[HALF_BAND_EVEN];
+
+		for(int i = 0; i < HALF_BAND_EVEN; i++) outer[i] = proto[2 * i];
+		this->taps = fir_prepare_taps(outer, HALF_BAND_EVEN);
+		this->center = proto[HALF_BAND_TAPS / 2];
+	}
+
+	size_t Process(float * iq, size_t pairs) {
+		for(size_t k = 0; k < pairs; k++) {
+			std::vector<float> & stream = this->next_odd ? this->odd : this->even;
+			stream.push_back(iq[2 * k]);
+			stream.push_back(iq[2 * k + 1]);
+			this->next_odd = !this->next_odd;
+		}
+
+		const size_t even_ready = this->even.size() / 2 - HALF_BAND_HIST;
+		const size_t odd_ready = this->odd.size() / 2 - HALF_BAND_HIST / 2;
+		const size_t out = even_ready < odd_ready ? even_ready : odd_ready;
+
+		for(size_t m = 0; m < out; m++) {
+			float acc[2];
+			fir_dot(&this->even[2 * m], this->taps.data(), HALF_BAND_EVEN, acc);
+
+			const float * middle = &this->odd[2 * (m + HALF_BAND_HIST / 2)];
+			iq[2 * m]     = acc[0] + this->center * middle[0];
+			iq[2 * m + 1] = acc[1] + this->center * middle[1];
+		}
+
+		this->even.erase(this->even.begin(), this->even.begin() + 2 * out);
+		this->odd.erase(this->odd.begin(), this->odd.begin() + 2 * out);
+		return out;
+	}
+
+private:
+	std::vector<float> taps;
+	float center;
+	std::vector<float> even, odd; // history, then pending input
+	bool next_odd = false;
+};
+
+// Polyphase resampler by interpolation / decimation: branch p of the prototype lowpass holds taps p, p + L, p + 2L,
+// ..., so each output is a single fir_dot over the newest RESAMPLER_PHASE_TAPS input samples.
+class PolyphaseResampler : public ResamplerStage {
+public:
+	PolyphaseResampler(unsigned interpolation, unsigned decimation)
+		: interpolation(interpolation), decimation(decimation),
+		  history(2 * (RESAMPLER_PHASE_TAPS - 1), 0.0f),
+		  time((uint64_t) (RESAMPLER_PHASE_TAPS - 1) * interpolation) {
+		const std::vector<float> proto = fir_design_lowpass((size_t) interpolation * RESAMPLER_PHASE_TAPS,
+		                                                    0.45 / decimation, interpolation);
+		float branch[RESAMPLER_PHASE_TAPS];
+
+		for(unsigned p = 0; p < interpolation; p++) {
+			for(unsigned j = 0; j < RESAMPLER_PHASE_TAPS; j++) branch[j] = proto[p + j * interpolation];
+
+			const std::vector<float> prepared = fir_prepare_taps(branch, RESAMPLER_PHASE_TAPS);
+			this->branches.insert(this->branches.end(), prepared.begin(), prepared.end());
+		}
+	}
+
+	size_t Process(float * iq, size_t pairs) {
+		this->history.insert(this->history.end(), iq, iq + 2 * pairs);
+
+		const size_t available = this->history.size() / 2;
+		size_t out = 0;
+
+		// time counts interpolated samples from history[0]; input n is at time n * L
+		for(size_t n; (n = (size_t) (this->time / this->interpolation)) < available; this->time += this->decimation) {
+			const size_t branch = (size_t) (this->time % this->interpolation);
+			fir_dot(&this->history[2 * (n + 1 - RESAMPLER_PHASE_TAPS)],
+			        &this->branches[branch * 2 * RESAMPLER_PHASE_TAPS], RESAMPLER_PHASE_TAPS, iq + 2 * out);
+			out++;
+		}
+
+		// keep what the next output's window still needs
+		size_t drop = (size_t) (this->time / this->interpolation) + 1 - RESAMPLER_PHASE_TAPS;
+		if(drop > available) drop = available;
+
+		this->history.erase(this->history.begin(), this->history.begin() + 2 * drop);
+		this->time -= (uint64_t) drop * this->interpolation;
+		return out;
+	}
+
+private:
+	const unsigned interpolation;
+	const unsigned decimation;
+	std::vector<float> branches; // interpolation branches of prepared taps
+	std::vector<float> history;
+	uint64_t time;
+};
+
+// the closest fraction p/q to num/den with q <= max_den, by continued fractions; exact when num/den reduces that far
+static void approximate_ratio(uint64_t num, uint64_t den, uint64_t max_den, unsigned * p, unsigned * q) {
+	uint64_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+
+	while(den != 0) {
+		const uint64_t a = num / den;
+		const uint64_t p2 = a * p1 + p0, q2 = a * q1 + q0;
+		if(q2 > max_den) break;
+
+		p0 = p1; q0 = q1;
+		p1 = p2; q1 = q2;
+
+		const uint64_t r = num - a * den;
+		num = den;
+		den = r;
+	}
+
+	*p = (unsigned) p1;
+	*q = (unsigned) q1;
+}
+
+Resampler::Resampler(uint32_t input_rate, uint32_t output_rate) {
+	const double requested = (double) input_rate / output_rate;
+
+	// a CIC takes big integer factors cheaply; leave at least 8x after it so its droop and aliasing stay far from
+	// the output band
+	if(requested >= 16) {
+		this->cic_factor = (unsigned) (requested / 8);
+		if(this->cic_factor > RESAMPLER_MAX_CIC_FACTOR) this->cic_factor = RESAMPLER_MAX_CIC_FACTOR;
+		this->stages.push_back(new CicDecimator(this->cic_factor));
+	}
+
+	// stop while the polyphase stage still has at least 2x to do: whatever the last half-band's transition band
+	// folds down then lands above the output Nyquist, where the polyphase lowpass removes it
+	for(double remaining = requested / this->cic_factor; remaining >= 4; remaining /= 2) {
+		this->half_bands++;
+		this->stages.push_back(new HalfBandDecimator());
+	}
+
+	// what is left is L/M = output_rate * cic * 2^half_bands / input_rate, in (1/4, 1]
+	approximate_ratio(((uint64_t) output_rate * this->cic_factor) << this->half_bands, input_rate,
+	                  RESAMPLER_MAX_PHASES, &this->interpolation, &this->decimation);
+
+	if(this->interpolation != this->decimation)
+		this->stages.push_back(new PolyphaseResampler(this->interpolation, this->decimation));
+
+	this->ratio = (double) this->cic_factor * (1u << this->half_bands) * this->decimation / this->interpolation;
+	this->output_rate = input_rate / this->ratio;
+}
+
+Resampler::~Resampler() {
+	for(size_t i = 0; i < this->stages.size(); i++) delete this->stages[i];
+}
+
+size_t Resampler::Process(float * iq, size_t len) {
+	size_t pairs = len / 2;
+	for(size_t i = 0; i < this->stages.size() && pairs > 0; i++) pairs = this->stages[i]->Process(iq, pairs);
+	return 2 * pairs;
+}
+
+size_t Resampler::MaxOutput(size_t len) const {
+	// each stage may release one more sample than its share, from input it held back last time
+	const size_t pairs = (size_t) ((len / 2) / this->ratio) + this->stages.size() + 1;
+	return 2 * pairs < len ? 2 * pairs : len;
+}
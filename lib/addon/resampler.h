@@ -0,0 +1,47 @@
+#ifndef JS_RTLSDR_RESAMPLER_GRAB_H
+#define JS_RTLSDR_RESAMPLER_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#define RESAMPLER_MAX_CIC_FACTOR (256)
+#define RESAMPLER_MAX_PHASES     (1024) // bound on the polyphase stage's interpolation/decimation factors
+#define RESAMPLER_PHASE_TAPS     (48)   // taps per polyphase branch
+
+class ResamplerStage;
+
+// Decimating resampler for interleaved complex float samples: a CIC decimator for large integer factors, then a
+// cascade of half-band decimators by 2, then a polyphase L/M resampler for whatever fractional ratio is left. The
+// stages are planned from the two rates; an L/M that needs more than RESAMPLER_MAX_PHASES phases is approximated by
+// the nearest ratio that does not, so OutputRate() may differ slightly from the requested rate.
+class Resampler {
+public:
+	// output_rate must be from 1 to input_rate
+	Resampler(uint32_t input_rate, uint32_t output_rate);
+	~Resampler();
+
+	// resample len interleaved floats in place, returning how many floats were written; filter state carries over
+	// between calls, so output may lag input by a few samples
+	size_t Process(float * iq, size_t len);
+
+	// the most floats Process can write for len floats of input
+	size_t MaxOutput(size_t len) const;
+
+	double   OutputRate(void) const { return this->output_rate; }
+	unsigned CicFactor(void) const { return this->cic_factor; }
+	unsigned HalfBands(void) const { return this->half_bands; }
+	unsigned Interpolation(void) const { return this->interpolation; }
+	unsigned Decimation(void) const { return this->decimation; }
+
+private:
+	std::vector<ResamplerStage *> stages;
+	double   ratio;
+	double   output_rate;
+	unsigned cic_factor = 1;
+	unsigned half_bands = 0;
+	unsigned interpolation = 1;
+	unsigned decimation = 1;
+};
+
+#endif
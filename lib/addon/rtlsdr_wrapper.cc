@@ -1,8 +1,13 @@
+#include <algorithm>
 #include <iostream>
 #include <rtl-sdr.h>
 #include <node_buffer.h>
 
 #include "rtlsdr_wrapper.h"
+#include "device_backend.h"
+#include "device_task.h"
+#include "file_device.h"
+#include "reader_options.h"
 #include "utils.h"
 
 using v8::Local;
@@ -71,25 +76,75 @@ void get_index_by_serial(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 		JS_RTLSDR_RETURN(Nan::New(result));
 }
 
-// open(index:int) => DeviceHandle
+// start rtl_dev's capture thread and return a handle holding both; on failure rtl_dev is closed and an exception
+// scheduled
+static void return_device_handle(const Nan::FunctionCallbackInfo<v8::Value> & info, rtlsdr_dev_t * rtl_dev,
+                                 const reader_thread_opts_t & thread_opts) {
+	DeviceContext * ctx = new DeviceContext(rtl_dev);
+	std::string thread_err;
+
+	if(ctx->Start(thread_opts, &thread_err) != 0) {
+		delete ctx;
+		backend_close(rtl_dev);
+		return Nan::ThrowError(thread_err.c_str());
+	}
+
+	// store the rtlsdr_dev_t and DeviceContext pointers in special "internal fields" on the returned Object
+	v8::Isolate * isolate = Nan::GetCurrentContext()->GetIsolate();
+	Local<v8::ObjectTemplate> DeviceHandle = v8::ObjectTemplate::New(isolate);
+	DeviceHandle->SetInternalFieldCount(JS_RTLSDR_HANDLE_FIELD_COUNT);
+	Local<Object> dev_hnd = DeviceHandle->NewInstance();
+	Nan::SetInternalFieldPointer(dev_hnd, JS_RTLSDR_HANDLE_FIELD_DEV, rtl_dev);
+	Nan::SetInternalFieldPointer(dev_hnd, JS_RTLSDR_HANDLE_FIELD_CTX, ctx);
+
+	// a device left open when a Worker exits is closed with its environment
+	AddonEnv::Current()->Adopt(ctx);
+
+	JS_RTLSDR_RETURN(dev_hnd);
+}
+
+// open(index:int, opts:Object = {}) => DeviceHandle
+// opts: {cpu:(int|[int]), realtimePriority:int, nice:int} -- scheduling for the device's capture thread
 void open(const Nan::FunctionCallbackInfo<v8::Value> & info) {
-	Local<Value> index = info[0];
+	Local<Value> index = info[0],
+	             opts  = info[1];
 
 	if(!index->IsNumber())
 		return Nan::ThrowTypeError("index must be a numeric device index");
 
+	reader_thread_opts_t thread_opts;
+	if(!parse_thread_options(opts, &thread_opts)) return;
+
 	rtlsdr_dev_t * rtl_dev;
 	const int err = rtlsdr_open(&rtl_dev, Nan::To<uint32_t>(index).FromJust());
 	JS_RTLSDR_CHECK_ERR("rtlsdr_open");
 
-	// store the rtlsdr_dev_t pointer in a special "internal field" on the returned Object
-	v8::Isolate * isolate = Nan::GetCurrentContext()->GetIsolate();
-	Local<v8::ObjectTemplate> DeviceHandle = v8::ObjectTemplate::New(isolate);
-	DeviceHandle->SetInternalFieldCount(1);
-	Local<Object> dev_hnd = DeviceHandle->NewInstance();
-	Nan::SetInternalFieldPointer(dev_hnd, /* internal field index = */ 0, rtl_dev);
+	return_device_handle(info, rtl_dev, thread_opts);
+}
 
-	JS_RTLSDR_RETURN(dev_hnd);
+// open_file(path:string, opts:Object = {}, thread_opts:Object = {}) => DeviceHandle
+// opts: {sampleRate:int, centerFreq:int, speed:number, loop:bool} -- see file_device_options_t
+// a handle for a recording, replayed through the same calls as a device
+void open_file(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> path        = info[0],
+	             opts        = info[1],
+	             thread_opts = info[2];
+
+	if(!path->IsString() || Nan::To<v8::String>(path).ToLocalChecked()->Length() == 0)
+		return Nan::ThrowTypeError("path must be a non-empty string");
+
+	file_device_options_t file_opts;
+	if(!parse_file_device_options(opts, &file_opts)) return;
+
+	reader_thread_opts_t s_thread_opts;
+	if(!parse_thread_options(thread_opts, &s_thread_opts)) return;
+
+	std::string open_err;
+	FileDevice * file = FileDevice::Open(*Nan::Utf8String(path), file_opts, &open_err);
+	if(file == NULL)
+		return Nan::ThrowError(open_err.c_str());
+
+	return_device_handle(info, file->Handle(), s_thread_opts);
 }
 
 // close(dev_hnd:DeviceHandle)
@@ -99,14 +154,21 @@ void close(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
 
-	const int err = rtlsdr_close(rtl_dev);
-	JS_RTLSDR_CHECK_ERR("rtlsdr_close");
+	// the capture thread must be stopped and joined before the device goes away
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	if(ctx != NULL) ctx->Shutdown();
+
+	const int err = backend_close(rtl_dev);
 
-	// make the handle non-usable hereafter
-	Nan::SetInternalFieldPointer(Nan::To<Object>(info[0]).ToLocalChecked(),
-	                             /* internal field index = */ 0,
-	                             (void *) NULL);
+	// make the handle non-usable hereafter, even if rtlsdr_close failed: the context has shut down either way
+	Local<Object> dev_hnd_obj = Nan::To<Object>(info[0]).ToLocalChecked();
+	Nan::SetInternalFieldPointer(dev_hnd_obj, JS_RTLSDR_HANDLE_FIELD_DEV, (void *) NULL);
+	Nan::SetInternalFieldPointer(dev_hnd_obj, JS_RTLSDR_HANDLE_FIELD_CTX, (void *) NULL);
 
+	AddonEnv::Current()->Forget(ctx);
+	delete ctx;
+
+	JS_RTLSDR_CHECK_ERR("rtlsdr_close");
 	//free(rtl_dev);
 }
 
@@ -118,6 +180,8 @@ void set_xtal_freq(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!rtl_freq->IsNumber())
 		return Nan::ThrowTypeError("rtl_freq must be a number");
@@ -125,9 +189,9 @@ void set_xtal_freq(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	if(!tuner_freq->IsNumber())
 		return Nan::ThrowTypeError("tuner_freq must be a number");
 
-	const int err = rtlsdr_set_xtal_freq(rtl_dev,
-	                                     Nan::To<uint32_t>(rtl_freq).FromJust(),
-	                                     Nan::To<uint32_t>(tuner_freq).FromJust());
+	const int err = backend_set_xtal_freq(rtl_dev, ctx->ControlMutex(),
+	                                      Nan::To<uint32_t>(rtl_freq).FromJust(),
+	                                      Nan::To<uint32_t>(tuner_freq).FromJust());
 
 	JS_RTLSDR_CHECK_ERR("rtlsdr_set_xtal_freq");
 }
@@ -138,10 +202,12 @@ void get_xtal_freq(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	uint32_t rtl_freq, tuner_freq;
 
-	const int err = rtlsdr_get_xtal_freq(rtl_dev, &rtl_freq, &tuner_freq);
+	const int err = backend_get_xtal_freq(rtl_dev, ctx->ControlMutex(), &rtl_freq, &tuner_freq);
 	JS_RTLSDR_CHECK_ERR("rtlsdr_get_xtal_freq");
 
 	Local<Object> xtalFreqs = Nan::New<Object>();
@@ -157,10 +223,12 @@ void get_usb_strings(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	char manufact[256], product[256], serial[256];
 
-	const int err = rtlsdr_get_usb_strings(rtl_dev, manufact, product, serial);
+	const int err = backend_get_usb_strings(rtl_dev, ctx->ControlMutex(), manufact, product, serial);
 	JS_RTLSDR_CHECK_ERR("rtlsdr_get_usb_strings");
 
 	Local<Object> usb_strs = Nan::New<Object>();
@@ -171,6 +239,35 @@ void get_usb_strings(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	JS_RTLSDR_RETURN(usb_strs);
 }
 
+// validate an EEPROM offset and length; on failure a JS exception has been scheduled and false is returned
+static bool get_eeprom_range(Local<Value> offset, Local<Value> len, uint8_t * u_offset, uint16_t * u_len) {
+	if(!offset->IsNumber()) {
+		Nan::ThrowTypeError("offset must be a number");
+		return false;
+	}
+
+	int64_t i_offset = Nan::To<int64_t>(offset).FromJust();
+	if(i_offset < 0 || i_offset >= 1<<8) {
+		Nan::ThrowRangeError("offset should be an integer value from 0-255");
+		return false;
+	}
+
+	if(!len->IsNumber()) {
+		Nan::ThrowTypeError("len must be a number");
+		return false;
+	}
+
+	int64_t i_len = Nan::To<int64_t>(len).FromJust();
+	if(i_len < 0 || i_len >= 1<<16) {
+		Nan::ThrowRangeError("len should be an integer value from 0-65535");
+		return false;
+	}
+
+	*u_offset = (uint8_t) i_offset;
+	*u_len = (uint16_t) i_len;
+	return true;
+}
+
 // write_eeprom(dev_hnd:DeviceHandle, data:Buffer, offset:int, len:int)
 void write_eeprom(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0],
@@ -180,29 +277,18 @@ void write_eeprom(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!node::Buffer::HasInstance(data))
 		return Nan::ThrowTypeError("data must be a Buffer");
 
-	if(!offset->IsNumber())
-		return Nan::ThrowTypeError("offset must be a number");
-
-	int64_t i_offset = Nan::To<int64_t>(offset).FromJust();
-	if(i_offset < 0 || i_offset >= 1<<8)
-		return Nan::ThrowRangeError("offset should be an integer value from 0-255");
-
-	if(!len->IsNumber())
-		return Nan::ThrowTypeError("len must be a number");
-
-	int64_t i_len = Nan::To<int64_t>(len).FromJust();
-	if(i_len < 0 || i_len >= 1<<16)
-	return Nan::ThrowRangeError("len should be an integer value from 0-65535");
+	uint8_t u_offset;
+	uint16_t u_len;
+	if(!get_eeprom_range(offset, len, &u_offset, &u_len)) return;
 
 	uint8_t * ua_data = (uint8_t *) node::Buffer::Data(data);
-	const int err = rtlsdr_write_eeprom(rtl_dev,
-	                                    ua_data,
-	                                    (uint8_t) i_offset,
-	                                    (uint16_t) i_len);
+	const int err = backend_write_eeprom(rtl_dev, ctx->ControlMutex(), ua_data, u_offset, u_len);
 	switch(err) {
 		case -1:
 			return Nan::ThrowError("rtlsdr_write_eeprom: the device handle is invalid (error -1)");
@@ -223,37 +309,112 @@ void read_eeprom(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	if(!offset->IsNumber())
-		return Nan::ThrowTypeError("offset must be a number");
-
-	int64_t i_offset = Nan::To<int64_t>(offset).FromJust();
-	if(i_offset < 0 || i_offset >= 1<<8)
-		return Nan::ThrowRangeError("offset should be an integer value from 0-255");
-
-	if(!len->IsNumber())
-		return Nan::ThrowTypeError("len must be a number");
-
-	int64_t i_len = Nan::To<int64_t>(len).FromJust();
-	if(i_len < 0 || i_len >= 1<<16)
-		return Nan::ThrowRangeError("len should be an integer value from 0-65535");
+	uint8_t u_offset;
+	uint16_t u_len;
+	if(!get_eeprom_range(offset, len, &u_offset, &u_len)) return;
 
-	uint8_t * data = new uint8_t[i_len];
+	uint8_t * data = new uint8_t[u_len];
 
-	const int err = rtlsdr_read_eeprom(rtl_dev, data, (uint8_t) i_offset, (uint16_t) i_len);
+	const int err = backend_read_eeprom(rtl_dev, ctx->ControlMutex(), data, u_offset, u_len);
 	switch(err) {
 		case -1:
+			delete [] data;
 			return Nan::ThrowError("rtlsdr_read_eeprom: the device handle is invalid (error -1)");
 		case -2:
+			delete [] data;
 			return Nan::ThrowError("rtlsdr_read_eeprom: the EEPROM size is exceeded (error -2)");
 		case -3:
+			delete [] data;
 			return Nan::ThrowError("rtlsdr_read_eeprom: no EEPROM was found (error -3)");
 		default:
+			if(err < 0) delete [] data;
 			JS_RTLSDR_CHECK_ERR("rtlsdr_read_eeprom");
 	}
 
-	JS_RTLSDR_RETURN(Nan::CopyBuffer((char *) data, (uint32_t) i_len).ToLocalChecked());
-	free(data);
+	JS_RTLSDR_RETURN(Nan::CopyBuffer((char *) data, (uint32_t) u_len).ToLocalChecked());
+	delete [] data;
+}
+
+// queue task on the device's control thread; a refusal (the device is closing) is reported through its callback
+static void post_command(DeviceContext * ctx, DeviceTask * task) {
+	if(!ctx->Command(task))
+		task->Abort("the device's control thread refused the command");
+}
+
+// write_eeprom_async(dev_hnd:DeviceHandle, data:Buffer, offset:int, len:int, callback:function(err))
+// rtlsdr_write_eeprom on the device's control thread; data is copied first
+void write_eeprom_async(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd  = info[0],
+	             data     = info[1],
+	             offset   = info[2],
+	             len      = info[3],
+	             callback = info[4];
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	if(!node::Buffer::HasInstance(data))
+		return Nan::ThrowTypeError("data must be a Buffer");
+
+	uint8_t u_offset;
+	uint16_t u_len;
+	if(!get_eeprom_range(offset, len, &u_offset, &u_len)) return;
+
+	if(u_len > node::Buffer::Length(data))
+		return Nan::ThrowRangeError("len must not exceed the length of data");
+
+	if(!callback->IsFunction())
+		return Nan::ThrowTypeError("callback must be a function");
+
+	post_command(ctx, new EepromTask(u_offset, u_len, (uint8_t *) node::Buffer::Data(data),
+	                                 new Nan::Callback(callback.As<v8::Function>())));
+}
+
+// read_eeprom_async(dev_hnd:DeviceHandle, offset:int, len:int, callback:function(err, Buffer))
+// rtlsdr_read_eeprom on the device's control thread
+void read_eeprom_async(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd  = info[0],
+	             offset   = info[1],
+	             len      = info[2],
+	             callback = info[3];
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	uint8_t u_offset;
+	uint16_t u_len;
+	if(!get_eeprom_range(offset, len, &u_offset, &u_len)) return;
+
+	if(!callback->IsFunction())
+		return Nan::ThrowTypeError("callback must be a function");
+
+	post_command(ctx, new EepromTask(u_offset, u_len, NULL, new Nan::Callback(callback.As<v8::Function>())));
+}
+
+// configure(dev_hnd:DeviceHandle, settings:Object, callback:function(err, batches:int))
+// settings: {sampleRate:int, directSampling:int, offsetTuning:bool, freqCorrection:int, centerFreq:int,
+//            bandwidth:int, gainMode:int, gain:int, agc:bool, testmode:bool} -- as the set_* functions take them
+// applies the settings together on the device's control thread, in the order listed in device_setting_t, stopping
+// at the first failure. A batch queued behind a running command absorbs those configured after it; batches is how
+// many configure calls the applied batch covered.
+void configure(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd  = info[0],
+	             settings = info[1],
+	             callback = info[2];
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	device_settings_t s_settings;
+	if(!parse_device_settings(settings, &s_settings)) return;
+
+	if(!callback->IsFunction())
+		return Nan::ThrowTypeError("callback must be a function");
+
+	post_command(ctx, new SettingsTask(s_settings, new Nan::Callback(callback.As<v8::Function>())));
 }
 
 // set_center_freq(dev_hnd:DeviceHandle, center_freq:int)
@@ -263,12 +424,14 @@ void set_center_freq(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!center_freq->IsNumber())
 		return Nan::ThrowTypeError("center_freq must be a number");
 
 	uint32_t u_center_freq = Nan::To<uint32_t>(center_freq).FromJust();
-	rtlsdr_set_center_freq(rtl_dev, u_center_freq);
+	backend_set_center_freq(rtl_dev, ctx->ControlMutex(), u_center_freq);
 }
 
 // get_center_freq(dev_hnd:DeviceHandle) => int
@@ -276,8 +439,10 @@ void get_center_freq(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	uint32_t result = rtlsdr_get_center_freq(rtl_dev);
+	uint32_t result = backend_get_center_freq(rtl_dev, ctx->ControlMutex());
 
 	if(result == 0)
 		return Nan::ThrowError("an error occurred in rtlsdr_get_center_freq - maybe no center_freq set yet?");
@@ -292,12 +457,14 @@ void set_freq_correction(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!ppm->IsNumber())
 		return Nan::ThrowTypeError("ppm must be a number");
 
 	int i_ppm = Nan::To<int>(ppm).FromJust();
-	rtlsdr_set_freq_correction(rtl_dev, i_ppm);
+	backend_set_freq_correction(rtl_dev, ctx->ControlMutex(), i_ppm);
 }
 
 // get_freq_correction(dev_hnd:DeviceHandle) => ppm:int
@@ -305,8 +472,10 @@ void get_freq_correction(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	int result = rtlsdr_get_freq_correction(rtl_dev);
+	int result = backend_get_freq_correction(rtl_dev, ctx->ControlMutex());
 	JS_RTLSDR_RETURN(Nan::New(result));
 }
 
@@ -315,8 +484,10 @@ void get_tuner_type(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	enum rtlsdr_tuner tuner_type = rtlsdr_get_tuner_type(rtl_dev);
+	enum rtlsdr_tuner tuner_type = backend_get_tuner_type(rtl_dev, ctx->ControlMutex());
 
 	std::string s_tuner_type = "";
 	switch(tuner_type) {
@@ -340,9 +511,11 @@ void get_tuner_gains(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 	int err;
 
-	err = rtlsdr_get_tuner_gains(rtl_dev, NULL);
+	err = backend_get_tuner_gains(rtl_dev, ctx->ControlMutex(), NULL);
 	JS_RTLSDR_CHECK_ERR("rtlsdr_get_tuner_gains");
 
 	const size_t num_gains = (size_t) err;
@@ -350,7 +523,7 @@ void get_tuner_gains(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	if(num_gains > 0) {
 		int i_gains[num_gains];
-		err = rtlsdr_get_tuner_gains(rtl_dev, i_gains);
+		err = backend_get_tuner_gains(rtl_dev, ctx->ControlMutex(), i_gains);
 		JS_RTLSDR_CHECK_ERR("rtlsdr_get_tuner_gains");
 
 		for(size_t i = 0; i < num_gains; i++)
@@ -367,12 +540,14 @@ void set_tuner_gain(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!gain->IsNumber())
 		return Nan::ThrowTypeError("gain must be a number");
 
 	int i_gain = Nan::To<int>(gain).FromJust();
-	const int err = rtlsdr_set_tuner_gain(rtl_dev, i_gain);
+	const int err = backend_set_tuner_gain(rtl_dev, ctx->ControlMutex(), i_gain);
 	JS_RTLSDR_CHECK_ERR("rtlsdr_set_tuner_gain");
 }
 
@@ -384,6 +559,8 @@ void set_tuner_bandwidth(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!bw->IsNumber())
 		return Nan::ThrowTypeError("bw must be a number");
@@ -393,7 +570,7 @@ void set_tuner_bandwidth(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 		return Nan::ThrowRangeError("bw must be non-negative");
 
 	uint32_t u_bw = Nan::To<uint32_t>(bw).FromJust();
-	const int err = rtlsdr_set_tuner_bandwidth(rtl_dev, u_bw);
+	const int err = backend_set_tuner_bandwidth(rtl_dev, ctx->ControlMutex(), u_bw);
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_set_tuner_gain");
 }
 
@@ -402,8 +579,10 @@ void get_tuner_gain(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	int gain = rtlsdr_get_tuner_gain(rtl_dev);
+	int gain = backend_get_tuner_gain(rtl_dev, ctx->ControlMutex());
 	JS_RTLSDR_RETURN(Nan::New(gain));
 }
 
@@ -415,6 +594,8 @@ void set_tuner_if_gain(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!stage->IsNumber())
 		return Nan::ThrowTypeError("stage must be a number");
@@ -425,7 +606,7 @@ void set_tuner_if_gain(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	int i_stage = Nan::To<int>(stage).FromJust();
 	int i_gain = Nan::To<int>(gain).FromJust();
 
-	const int err = rtlsdr_set_tuner_if_gain(rtl_dev, i_stage, i_gain);
+	const int err = backend_set_tuner_if_gain(rtl_dev, ctx->ControlMutex(), i_stage, i_gain);
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_set_tuner_if_gain");
 }
 
@@ -436,12 +617,14 @@ void set_tuner_gain_mode(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!manual->IsNumber())
 		return Nan::ThrowTypeError("mode must be a number");
 
 	int i_mode = Nan::To<int>(manual).FromJust();
-	const int err = rtlsdr_set_tuner_gain_mode(rtl_dev, i_mode);
+	const int err = backend_set_tuner_gain_mode(rtl_dev, ctx->ControlMutex(), i_mode);
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_set_tuner_gain_mode");
 }
 
@@ -454,12 +637,14 @@ void set_sample_rate(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!samp_rate->IsNumber())
 		return Nan::ThrowTypeError("samp_rate must be a number");
 
 	uint32_t u_samp_rate = Nan::To<uint32_t>(samp_rate).FromJust();
-	const int err = rtlsdr_set_sample_rate(rtl_dev, u_samp_rate);
+	const int err = backend_set_sample_rate(rtl_dev, ctx->ControlMutex(), u_samp_rate);
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_set_sample_rate");
 }
 
@@ -468,8 +653,10 @@ void get_sample_rate(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	const uint32_t samp_rate = rtlsdr_get_sample_rate(rtl_dev);
+	const uint32_t samp_rate = backend_get_sample_rate(rtl_dev, ctx->ControlMutex());
 
 	if(samp_rate == 0)
 		return Nan::ThrowError("an error occurred in rtlsdr_get_sample_rate");
@@ -484,12 +671,14 @@ void set_testmode(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!on->IsBoolean())
 		return Nan::ThrowTypeError("on must be a boolean");
 
 	bool b_on = Nan::To<bool>(on).FromJust();
-	const int err = rtlsdr_set_testmode(rtl_dev, b_on ? 1 : 0);
+	const int err = backend_set_testmode(rtl_dev, ctx->ControlMutex(), b_on ? 1 : 0);
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_set_testmode");
 }
 
@@ -500,12 +689,14 @@ void set_agc_mode(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!on->IsBoolean())
 		return Nan::ThrowTypeError("on must be a boolean");
 
 	bool b_on = Nan::To<bool>(on).FromJust();
-	const int err = rtlsdr_set_agc_mode(rtl_dev, b_on ? 1 : 0);
+	const int err = backend_set_agc_mode(rtl_dev, ctx->ControlMutex(), b_on ? 1 : 0);
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_set_agc_mode");
 }
 
@@ -516,6 +707,8 @@ void set_direct_sampling(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!mode->IsNumber())
 		return Nan::ThrowTypeError("mode must be a number");
@@ -524,7 +717,7 @@ void set_direct_sampling(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	if(i_mode < 0 || i_mode > 2)
 		return Nan::ThrowRangeError("mode must be 0 (off), 1 (I-ADC input), or 2 (Q-ADC input)");
 
-	const int err = rtlsdr_set_direct_sampling(rtl_dev, i_mode);
+	const int err = backend_set_direct_sampling(rtl_dev, ctx->ControlMutex(), i_mode);
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_set_direct_sampling");
 }
 
@@ -533,8 +726,10 @@ void get_direct_sampling(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	const int mode = rtlsdr_get_direct_sampling(rtl_dev), err = mode;
+	const int mode = backend_get_direct_sampling(rtl_dev, ctx->ControlMutex()), err = mode;
 	JS_RTLSDR_CHECK_ERR("rtlsdr_get_direct_sampling");
 	JS_RTLSDR_RETURN(Nan::New(mode));
 }
@@ -546,12 +741,14 @@ void set_offset_tuning(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
 	if(!on->IsBoolean())
 		return Nan::ThrowTypeError("on must be a boolean");
 
 	bool b_on = Nan::To<bool>(on).FromJust();
-	const int err = rtlsdr_set_offset_tuning(rtl_dev, b_on ? 1 : 0);
+	const int err = backend_set_offset_tuning(rtl_dev, ctx->ControlMutex(), b_on ? 1 : 0);
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_set_offset_tuning");
 }
 
@@ -560,8 +757,10 @@ void get_offset_tuning(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	const int mode = rtlsdr_get_offset_tuning(rtl_dev), err = mode;
+	const int mode = backend_get_offset_tuning(rtl_dev, ctx->ControlMutex()), err = mode;
 	JS_RTLSDR_CHECK_ERR("rtlsdr_get_direct_sampling");
 	JS_RTLSDR_RETURN(mode == 1 ? Nan::True() : Nan::False());
 }
@@ -571,8 +770,10 @@ void reset_buffer(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd = info[0];
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
 
-	const int err = rtlsdr_reset_buffer(rtl_dev);
+	const int err = backend_reset_buffer(rtl_dev, ctx->ControlMutex());
 	JS_RTLSDR_CHECK_ERR("rtlsdr_reset_buffer");
 }
 
@@ -591,19 +792,94 @@ void read_sync(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	unsigned char * data = new unsigned char[i_len];
 	int num_read = -1;
 
-	const int err = rtlsdr_read_sync(rtl_dev, (void *) data, i_len, &num_read);
+	const int err = backend_read_sync(rtl_dev, (void *) data, i_len, &num_read);
 	if(err < 0) delete [] data;
 	JS_RTLSDR_CHECK_ERR("rtlsdr_read_sync");
 
 	JS_RTLSDR_RETURN(Nan::NewBuffer((char *) data, (uint32_t) num_read).ToLocalChecked());
 }
 
+// read_into(dev_hnd:DeviceHandle, buf:Buffer|TypedArray, offset:int, len:int, callback:function(err, n_read))
+// rtlsdr_read_sync len bytes into buf at offset on the device's capture thread; the first read after a stream (or
+// after open) resets the device's buffer first
+void read_into(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd  = info[0],
+	             buf      = info[1],
+	             offset   = info[2],
+	             len      = info[3],
+	             callback = info[4];
+
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	if(!buf->IsArrayBufferView())
+		return Nan::ThrowTypeError("buf must be a Buffer or typed array");
+
+	if(!offset->IsUint32())
+		return Nan::ThrowTypeError("offset must be a non-negative integer");
+
+	if(!len->IsUint32())
+		return Nan::ThrowTypeError("len must be a non-negative integer");
+
+	if(!callback->IsFunction())
+		return Nan::ThrowTypeError("callback must be a function");
+
+	Nan::TypedArrayContents<uint8_t> contents(buf);
+	const uint32_t u_offset = Nan::To<uint32_t>(offset).FromJust(),
+	               u_len    = Nan::To<uint32_t>(len).FromJust();
+
+	if(u_len == 0 || u_len > INT32_MAX)
+		return Nan::ThrowRangeError("len must be positive and fit in an int");
+
+	if((size_t) u_offset + u_len > contents.length())
+		return Nan::ThrowRangeError("offset + len must not exceed the buffer's length");
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+	JS_RTLSDR_CHECK_ACCEPTING(ctx);
+
+	ReadIntoTask * task = new ReadIntoTask(buf.As<v8::Object>(), *contents + u_offset, u_len,
+	                                       new Nan::Callback(callback.As<v8::Function>()));
+
+	// accepting implies the thread is running
+	if(!ctx->Post(task)) task->Abort("the device's capture thread refused the read");
+}
+
+// the capture thread owns the reader from here; Accepting() was checked, so a refusal here is unexpected, but it is
+// still reported through the listener rather than leaking the reader
+static void submit_reader(DeviceContext * ctx, SampleReader * reader) {
+	if(!ctx->Submit(reader))
+		reader->Abort("the device's capture thread refused the read");
+}
+
 // DEPRECATED IN LIBRTLSDR
-// wait_async(dev_hnd:DeviceHandle, listener:function(event_name, args...))
-// listener event_names & args: <'data', Buffer> , <'error', msg:string> , <'done'>
+// wait_async(dev_hnd:DeviceHandle, listener:function(event_name, args...), opts:Object = {})
+// listener event_names & args: <'data', Buffer|TypedArray, timing:Float64Array> ,
+//                               <'channel', {channel:int, samples:TypedArray}, timing:Float64Array> ,
+//                               <'spectrum', Float32Array, timing:Float64Array> ,
+//                               <'audio', {receiver:int, samples:TypedArray}, timing:Float64Array> ,
+//                               <'squelch-open', offset:number> , <'squelch-close', offset:number> ,
+//                               <'capture', {id:int, trigger:string, offset:number, triggerOffset:number,
+//                                            samples:Buffer|TypedArray}> ,
+//                               <'overflow', counts:Object> , <'error', msg:string> , <'done'>
+// a listener that returns false from a payload event pauses delivery until resume_async
+// opts: {queueDepth:int = 32, overflow:('drop-oldest'|'drop-newest'|'block') = 'block',
+//        format:('uint8'|'int16'|'float32'|'float32-planar') = 'uint8', dcBlock:bool = false, iqBalance:bool = false,
+//        outputRate:number = <the device's sample rate>, channels:{count:int, select:int[], threads:int} = none,
+//        spectrum:{size:int, window:string, overlap:number, averages:int} = none,
+//        demod:({mode:string, offset:number, bandwidth:number, deviation:number, deemphasis:number, squelch:number,
+//                pitch:number, agc:bool, audioRate:int}|Object[]) = none,
+//        squelch:{level:number, hysteresis:number, window:int} = none,
+//        history:{seconds:number, pre:number, post:number, trigger:{level:number, hysteresis:number, window:int}}
+//                = none,
+//        record:{path:string, blockSize:int, blocks:int, direct:bool, rotateBytes:number, rotateSeconds:number}
+//                = none, ring:SharedArrayBuffer = none}
+// with ring, every transfer is written into the SharedArrayBuffer as a SampleRing (see sample_ring.h) and only 'done'
+// or 'error' reach the listener
 void wait_async(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd  = info[0],
-	             listener = info[1];
+	             listener = info[1],
+	             opts     = info[2];
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
@@ -611,21 +887,43 @@ void wait_async(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	if(!listener->IsFunction())
 		return Nan::ThrowTypeError("listener must be a function");
 
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+	JS_RTLSDR_CHECK_ACCEPTING(ctx);
+
 	sample_reader_work_t * work = new sample_reader_work_t();
 	work->rtl_dev = rtl_dev;
+	work->control = &ctx->ControlMutex();
+	work->stats   = ctx->Stats();
 	work->wait    = true;
 
+	if(!parse_reader_options(opts, work)) {
+		delete work;
+		return;
+	}
+
 	Nan::Callback * cb_listener = new Nan::Callback(listener.As<v8::Function>());
-	Nan::AsyncQueueWorker(new SampleReader(cb_listener, work));
+	submit_reader(ctx, new SampleReader(cb_listener, work));
 }
 
-// read_async(dev_hnd:DeviceHandle, listener:function(event_name, args...), buf_num:int = 0, buf_len:int = 0)
-// listener event_names & args: <'data', Buffer> , <'error', msg:string> , <'done'>
+// read_async(dev_hnd:DeviceHandle, listener:function(event_name, args...), buf_num:int = 0, buf_len:int = 0,
+//            opts:Object = {})
+// listener event_names & args: <'data', Buffer|TypedArray, timing:Float64Array> ,
+//                               <'channel', {channel:int, samples:TypedArray}, timing:Float64Array> ,
+//                               <'spectrum', Float32Array, timing:Float64Array> ,
+//                               <'audio', {receiver:int, samples:TypedArray}, timing:Float64Array> ,
+//                               <'squelch-open', offset:number> , <'squelch-close', offset:number> ,
+//                               <'capture', {id:int, trigger:string, offset:number, triggerOffset:number,
+//                                            samples:Buffer|TypedArray}> ,
+//                               <'overflow', counts:Object> , <'error', msg:string> , <'done'>
+// a listener that returns false from a payload event pauses delivery until resume_async
+// opts: as in wait_async
 void read_async(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	Local<Value> dev_hnd  = info[0],
 	             listener = info[1],
 	             buf_num  = info[2],
-	             buf_len  = info[3];
+	             buf_len  = info[3],
+	             opts     = info[4];
 
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
@@ -633,14 +931,222 @@ void read_async(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	if(!listener->IsFunction())
 		return Nan::ThrowTypeError("listener must be a function");
 
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+	JS_RTLSDR_CHECK_ACCEPTING(ctx);
+
 	sample_reader_work_t * work = new sample_reader_work_t();
 	work->rtl_dev = rtl_dev;
+	work->control = &ctx->ControlMutex();
+	work->stats   = ctx->Stats();
 	work->buf_num = Nan::To<uint32_t>(buf_num).FromMaybe(0);
 	work->buf_len = Nan::To<uint32_t>(buf_len).FromMaybe(0);
 	work->wait    = false;
 
+	if(!parse_reader_options(opts, work)) {
+		delete work;
+		return;
+	}
+
 	Nan::Callback * cb_listener = new Nan::Callback(listener.As<v8::Function>());
-	Nan::AsyncQueueWorker(new SampleReader(cb_listener, work));
+	submit_reader(ctx, new SampleReader(cb_listener, work));
+}
+
+// fan_out(dev_hnd:DeviceHandle, listeners:[function(event_name, args...)], buf_num:int = 0, buf_len:int = 0,
+//         pipelines:Object[])
+// listener event_names & args: as in read_async, each listener hearing its own pipeline
+// pipelines: 1-16 opts objects as in read_async, without squelch, history, or ring, and with overflow
+//            ('drop-oldest'|'drop-newest') = 'drop-oldest'
+// streams once, copying each transfer into a slab the pipelines share; the first raw 'uint8' pipeline delivers the
+// slabs themselves, and each other pipeline runs its stages on a thread of its own, so that a slow one only drops
+// its own blocks; cancel_async ends every pipeline
+void fan_out(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd   = info[0],
+	             listeners = info[1],
+	             buf_num   = info[2],
+	             buf_len   = info[3],
+	             pipelines = info[4];
+
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	if(!listeners->IsArray())
+		return Nan::ThrowTypeError("listeners must be an array of functions");
+
+	Local<v8::Array> a_listeners = listeners.As<v8::Array>();
+	for(uint32_t i = 0; i < a_listeners->Length(); i++) {
+		if(!Nan::Get(a_listeners, i).ToLocalChecked()->IsFunction())
+			return Nan::ThrowTypeError("listeners must be an array of functions");
+	}
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+	JS_RTLSDR_CHECK_ACCEPTING(ctx);
+
+	sample_reader_work_t * work = new sample_reader_work_t();
+	work->rtl_dev = rtl_dev;
+	work->control = &ctx->ControlMutex();
+	work->stats   = ctx->Stats();
+	work->buf_num = Nan::To<uint32_t>(buf_num).FromMaybe(0);
+	work->buf_len = Nan::To<uint32_t>(buf_len).FromMaybe(0);
+	work->wait    = false;
+
+	std::vector<sample_reader_work_t *> works;
+	if(!parse_fan_out_options(pipelines, work, &works)) {
+		delete work;
+		return;
+	}
+
+	if(works.size() != a_listeners->Length()) {
+		for(size_t i = 0; i < works.size(); i++) delete works[i];
+		delete work;
+		return Nan::ThrowRangeError("there must be one listener per pipeline");
+	}
+
+	std::vector<SampleReader *> readers;
+	for(uint32_t i = 0; i < a_listeners->Length(); i++) {
+		Local<Value> listener = Nan::Get(a_listeners, i).ToLocalChecked();
+		readers.push_back(new SampleReader(new Nan::Callback(listener.As<v8::Function>()), works[i]));
+	}
+
+	submit_reader(ctx, new SampleReader(NULL, work, readers));
+}
+
+// sweep(dev_hnd:DeviceHandle, listener:function(event_name, args...), opts:Object)
+// listener event_names & args: <'sweep', {bins:Float32Array, start:number, binWidth:number, startTime:number,
+//                               endTime:number}> , <'overflow', counts:Object> , <'error', msg:string> , <'done'>
+// opts: {start:number, stop:number, binWidth:number, dwell:number = 100, settle:number = 5, crop:number = 0.25,
+//        window:string = 'hann', sweeps:int = 0, queueDepth:int = 32, overflow:string = 'block'}
+// retunes the device on its capture thread until `sweeps` sweeps are done (0: until cancel_async)
+void sweep(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd  = info[0],
+	             listener = info[1],
+	             opts     = info[2];
+
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	if(!listener->IsFunction())
+		return Nan::ThrowTypeError("listener must be a function");
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+	JS_RTLSDR_CHECK_ACCEPTING(ctx);
+
+	sample_reader_work_t * work = new sample_reader_work_t();
+	work->rtl_dev = rtl_dev;
+	work->control = &ctx->ControlMutex();
+	work->stats   = ctx->Stats();
+
+	if(!parse_sweep_options(opts, work)) {
+		delete work;
+		return;
+	}
+
+	Nan::Callback * cb_listener = new Nan::Callback(listener.As<v8::Function>());
+	submit_reader(ctx, new SampleReader(cb_listener, work));
+}
+
+// capture_group(dev_hnds:[DeviceHandle], listener:function(event_name, args...), buf_num:int = 0, buf_len:int = 0,
+//               opts:Object = {})
+// listener event_names & args: <'aligned', leads:[number]> , <'data', [TypedArray], timing:Float64Array> ,
+//                               <'overflow', counts:Object> , <'error', msg:string> , <'done'>
+// opts: {blockSize:int = buf_len / 2, align:('time'|'index') = 'time', offsets:[int], queueDepth:int = 32,
+//        overflow:('drop-oldest'|'drop-newest'|'block') = 'block', format:('uint8'|'int16'|'float32') = 'uint8'}
+// streams 2-32 devices with a common sample rate in step, as matched blocks; cancel_async on any of them ends it
+void capture_group(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnds = info[0],
+	             listener = info[1],
+	             buf_num  = info[2],
+	             buf_len  = info[3],
+	             opts     = info[4];
+
+	if(!dev_hnds->IsArray())
+		return Nan::ThrowTypeError("dev_hnds must be an array of device handles");
+
+	Local<v8::Array> a_dev_hnds = dev_hnds.As<v8::Array>();
+	if(a_dev_hnds->Length() < 2 || a_dev_hnds->Length() > CAPTURE_GROUP_MAX_DEVICES)
+		return Nan::ThrowRangeError("a group must have from 2-32 devices");
+
+	if(!listener->IsFunction())
+		return Nan::ThrowTypeError("listener must be a function");
+
+	std::vector<DeviceContext *> contexts;
+	capture_group_work_t * work = new capture_group_work_t();
+
+	for(uint32_t i = 0; i < a_dev_hnds->Length(); i++) {
+		Local<Value> dev_hnd = Nan::Get(a_dev_hnds, i).ToLocalChecked();
+		rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+		DeviceContext * ctx = get_dev_ctx(dev_hnd);
+
+		if(rtl_dev == NULL || ctx == NULL) {
+			delete work;
+			return Nan::ThrowTypeError("every device handle must be a currently-open handle (from .open())");
+		}
+
+		if(std::find(contexts.begin(), contexts.end(), ctx) != contexts.end()) {
+			delete work;
+			return Nan::ThrowError("a device can only appear once in a group");
+		}
+
+		if(!ctx->Accepting()) {
+			delete work;
+			return Nan::ThrowError("a read is already in progress on one of the devices (cancel it first)");
+		}
+
+		contexts.push_back(ctx);
+		work->rtl_devs.push_back(rtl_dev);
+		work->controls.push_back(&ctx->ControlMutex());
+		work->stats.push_back(ctx->Stats());
+	}
+
+	work->buf_num = Nan::To<uint32_t>(buf_num).FromMaybe(0);
+	work->buf_len = Nan::To<uint32_t>(buf_len).FromMaybe(0);
+
+	if(!parse_capture_group_options(opts, work)) {
+		delete work;
+		return;
+	}
+
+	Nan::Callback * cb_listener = new Nan::Callback(listener.As<v8::Function>());
+	(new CaptureGroup(cb_listener, work))->Start(contexts);
+}
+
+// snapshot(dev_hnd:DeviceHandle, pre_ms:number, post_ms:number) => id:int
+// the active read must keep history; its listener gets the result as <'capture', {id, ...}>
+void snapshot(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0],
+	             pre_ms  = info[1],
+	             post_ms = info[2];
+
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	if(!pre_ms->IsNumber())
+		return Nan::ThrowTypeError("pre_ms must be a number");
+
+	if(!post_ms->IsNumber())
+		return Nan::ThrowTypeError("post_ms must be a number");
+
+	const double d_pre = Nan::To<double>(pre_ms).FromJust();
+	const double d_post = Nan::To<double>(post_ms).FromJust();
+	const double max_ms = BURST_CAPTURE_MAX_BYTES / 2.0 / backend_get_sample_rate(rtl_dev, ctx->ControlMutex()) * 1000;
+
+	if(!(d_pre >= 0 && d_post >= 0 && d_pre + d_post <= max_ms))
+		return Nan::ThrowRangeError("pre_ms and post_ms must not be negative, nor capture more than 2 GiB");
+
+	const int id = ctx->Snapshot(d_pre, d_post);
+
+	if(id < 0)
+		return Nan::ThrowError("no read with history is in progress");
+
+	if(id == 0)
+		return Nan::ThrowError("too many snapshots are in progress");
+
+	JS_RTLSDR_RETURN(Nan::New<v8::Number>(id));
 }
 
 // cancel_async(dev_hnd:DeviceHandle)
@@ -649,6 +1155,233 @@ void cancel_async(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
 	JS_RTLSDR_CHECK_DEV(rtl_dev);
 
-	const int err = rtlsdr_cancel_async(rtl_dev);
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	const int err = ctx->Cancel();
 	JS_RTLSDR_CHECK_ERR_NONZERO("rtlsdr_cancel_async");
 }
+
+// resume_async(dev_hnd:DeviceHandle)
+// a read whose listener returned false from a payload event delivers again, starting with what queued meanwhile
+void resume_async(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0];
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	ctx->Resume();
+}
+
+// release_buffer(buf:Buffer|TypedArray) => bool
+// hand a 'data' payload's pool slab back before it is collected; buf must not be used afterwards
+void release_buffer(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> buf = info[0];
+
+	if(!buf->IsArrayBufferView())
+		return Nan::ThrowTypeError("buf must be a Buffer or typed array");
+
+	Nan::TypedArrayContents<uint8_t> contents(buf);
+	const bool released = BufferPool::Release(*contents);
+	JS_RTLSDR_RETURN(released ? Nan::True() : Nan::False());
+}
+
+// get_iq_correction(dev_hnd:DeviceHandle) => {dcI, dcQ, gain, phase, samples}|null
+// null unless a read with dcBlock or iqBalance is active
+void get_iq_correction(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0];
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	iq_correction_estimates_t estimates;
+	if(!ctx->Correction(&estimates)) {
+		JS_RTLSDR_RETURN(Nan::Null());
+		return;
+	}
+
+	Local<Object> ret = Nan::New<Object>();
+	Nan::Set(ret, Nan::New("dcI").ToLocalChecked(), Nan::New<v8::Number>(estimates.dc_i));
+	Nan::Set(ret, Nan::New("dcQ").ToLocalChecked(), Nan::New<v8::Number>(estimates.dc_q));
+	Nan::Set(ret, Nan::New("gain").ToLocalChecked(), Nan::New<v8::Number>(estimates.gain));
+	Nan::Set(ret, Nan::New("phase").ToLocalChecked(), Nan::New<v8::Number>(estimates.phase));
+	Nan::Set(ret, Nan::New("samples").ToLocalChecked(), Nan::New<v8::Number>((double) estimates.samples));
+
+	JS_RTLSDR_RETURN(ret);
+}
+
+// get_record_stats(dev_hnd:DeviceHandle) => {bytesWritten, bytesDropped, writes, writeLatency:{last, mean, max},
+//                                             backlog, maxBacklog, blocks, files, file, direct}|null
+// null unless a read with record is active
+void get_record_stats(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0];
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	recorder_stats_t stats;
+	if(!ctx->RecordStats(&stats)) {
+		JS_RTLSDR_RETURN(Nan::Null());
+		return;
+	}
+
+	Local<Object> latency = Nan::New<Object>();
+	Nan::Set(latency, Nan::New("last").ToLocalChecked(), Nan::New<v8::Number>(stats.write_ms_last));
+	Nan::Set(latency, Nan::New("mean").ToLocalChecked(), Nan::New<v8::Number>(stats.write_ms_mean));
+	Nan::Set(latency, Nan::New("max").ToLocalChecked(), Nan::New<v8::Number>(stats.write_ms_max));
+
+	Local<Object> ret = Nan::New<Object>();
+	Nan::Set(ret, Nan::New("bytesWritten").ToLocalChecked(), Nan::New<v8::Number>((double) stats.bytes_written));
+	Nan::Set(ret, Nan::New("bytesDropped").ToLocalChecked(), Nan::New<v8::Number>((double) stats.bytes_dropped));
+	Nan::Set(ret, Nan::New("writes").ToLocalChecked(), Nan::New<v8::Number>((double) stats.writes));
+	Nan::Set(ret, Nan::New("writeLatency").ToLocalChecked(), latency);
+	Nan::Set(ret, Nan::New("backlog").ToLocalChecked(), Nan::New<v8::Number>((double) stats.backlog));
+	Nan::Set(ret, Nan::New("maxBacklog").ToLocalChecked(), Nan::New<v8::Number>((double) stats.backlog_max));
+	Nan::Set(ret, Nan::New("blocks").ToLocalChecked(), Nan::New<v8::Number>((double) stats.blocks));
+	Nan::Set(ret, Nan::New("files").ToLocalChecked(), Nan::New<v8::Number>(stats.files));
+	Nan::Set(ret, Nan::New("file").ToLocalChecked(),
+	         stats.file.empty() ? (Local<Value>) Nan::Null() : (Local<Value>) Nan::New(stats.file).ToLocalChecked());
+	Nan::Set(ret, Nan::New("direct").ToLocalChecked(), Nan::New(stats.direct));
+
+	JS_RTLSDR_RETURN(ret);
+}
+
+// get_stream_stats(dev_hnd:DeviceHandle, reset:bool = false) => {transfers, bytes, dropped, maxQueueDepth, wakeups,
+//                                                                delivered, coalesced,
+//                                                                sampleRate:{configured, effective, window},
+//                                                                latency:{count, min, mean, p50, p90, p99, p999, max}}
+// counters since the device was opened or last reset; reads them without involving the capture thread
+void get_stream_stats(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0],
+	             reset   = info[1];
+
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	DeviceContext * ctx = get_dev_ctx(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(ctx);
+
+	if(!reset->IsUndefined() && !reset->IsBoolean())
+		return Nan::ThrowTypeError("reset must be a boolean");
+
+	stream_stats_snapshot_t stats;
+	ctx->Stats()->Snapshot(&stats);
+	if(reset->IsTrue()) ctx->Stats()->Reset();
+
+	const uint32_t configured = backend_get_sample_rate(rtl_dev, ctx->ControlMutex());
+	Local<Object> rate = Nan::New<Object>();
+	Nan::Set(rate, Nan::New("configured").ToLocalChecked(), Nan::New<v8::Number>(configured));
+	Nan::Set(rate, Nan::New("effective").ToLocalChecked(), Nan::New<v8::Number>(stats.rate));
+	Nan::Set(rate, Nan::New("window").ToLocalChecked(), Nan::New<v8::Number>(stats.rate_ms));
+
+	Local<Object> latency = Nan::New<Object>();
+	Nan::Set(latency, Nan::New("count").ToLocalChecked(), Nan::New<v8::Number>((double) stats.latency.count));
+	Nan::Set(latency, Nan::New("min").ToLocalChecked(), Nan::New<v8::Number>(stats.latency.min_ms));
+	Nan::Set(latency, Nan::New("mean").ToLocalChecked(), Nan::New<v8::Number>(stats.latency.mean_ms));
+	Nan::Set(latency, Nan::New("p50").ToLocalChecked(), Nan::New<v8::Number>(stats.latency.p50_ms));
+	Nan::Set(latency, Nan::New("p90").ToLocalChecked(), Nan::New<v8::Number>(stats.latency.p90_ms));
+	Nan::Set(latency, Nan::New("p99").ToLocalChecked(), Nan::New<v8::Number>(stats.latency.p99_ms));
+	Nan::Set(latency, Nan::New("p999").ToLocalChecked(), Nan::New<v8::Number>(stats.latency.p999_ms));
+	Nan::Set(latency, Nan::New("max").ToLocalChecked(), Nan::New<v8::Number>(stats.latency.max_ms));
+
+	Local<Object> ret = Nan::New<Object>();
+	Nan::Set(ret, Nan::New("transfers").ToLocalChecked(), Nan::New<v8::Number>((double) stats.transfers));
+	Nan::Set(ret, Nan::New("bytes").ToLocalChecked(), Nan::New<v8::Number>((double) stats.bytes));
+	Nan::Set(ret, Nan::New("dropped").ToLocalChecked(), Nan::New<v8::Number>((double) stats.dropped));
+	Nan::Set(ret, Nan::New("maxQueueDepth").ToLocalChecked(), Nan::New<v8::Number>((double) stats.depth_max));
+	Nan::Set(ret, Nan::New("wakeups").ToLocalChecked(), Nan::New<v8::Number>((double) stats.wakeups));
+	Nan::Set(ret, Nan::New("delivered").ToLocalChecked(), Nan::New<v8::Number>((double) stats.delivered));
+	Nan::Set(ret, Nan::New("coalesced").ToLocalChecked(), Nan::New<v8::Number>((double) stats.coalesced));
+	Nan::Set(ret, Nan::New("sampleRate").ToLocalChecked(), rate);
+	Nan::Set(ret, Nan::New("latency").ToLocalChecked(), latency);
+
+	JS_RTLSDR_RETURN(ret);
+}
+
+// seek_file(dev_hnd:DeviceHandle, sample:int)
+// the next transfer of a file handle starts at sample (clamped to the end); pacing starts over
+void seek_file(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0],
+	             sample  = info[1];
+
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	FileDevice * file = FileDevice::Find(rtl_dev);
+	if(file == NULL)
+		return Nan::ThrowTypeError("dev_hnd must be a file handle");
+
+	if(!sample->IsNumber())
+		return Nan::ThrowTypeError("sample must be a number");
+
+	const double d_sample = Nan::To<double>(sample).FromJust();
+	if(!(d_sample >= 0 && d_sample <= 9007199254740991.0))
+		return Nan::ThrowRangeError("sample must not be negative");
+
+	file->Seek((uint64_t) d_sample);
+}
+
+// get_file_position(dev_hnd:DeviceHandle) => {position, length}
+// in samples; position is the next sample to be read
+void get_file_position(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0];
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	FileDevice * file = FileDevice::Find(rtl_dev);
+	if(file == NULL)
+		return Nan::ThrowTypeError("dev_hnd must be a file handle");
+
+	Local<Object> ret = Nan::New<Object>();
+	Nan::Set(ret, Nan::New("position").ToLocalChecked(), Nan::New<v8::Number>((double) file->Position()));
+	Nan::Set(ret, Nan::New("length").ToLocalChecked(), Nan::New<v8::Number>((double) file->Length()));
+
+	JS_RTLSDR_RETURN(ret);
+}
+
+// set_file_speed(dev_hnd:DeviceHandle, speed:number)
+// 1 for real time, N for N times real time, 0 for unthrottled
+void set_file_speed(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0],
+	             speed   = info[1];
+
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	FileDevice * file = FileDevice::Find(rtl_dev);
+	if(file == NULL)
+		return Nan::ThrowTypeError("dev_hnd must be a file handle");
+
+	if(!speed->IsNumber())
+		return Nan::ThrowTypeError("speed must be a number");
+
+	const double d_speed = Nan::To<double>(speed).FromJust();
+	if(!(d_speed >= 0 && d_speed <= FILE_DEVICE_MAX_SPEED))
+		return Nan::ThrowRangeError("speed must be a number from 0-10000");
+
+	file->SetSpeed(d_speed);
+}
+
+// set_file_loop(dev_hnd:DeviceHandle, loop:bool)
+void set_file_loop(const Nan::FunctionCallbackInfo<v8::Value> & info) {
+	Local<Value> dev_hnd = info[0],
+	             loop    = info[1];
+
+	rtlsdr_dev_t * rtl_dev = get_dev(dev_hnd);
+	JS_RTLSDR_CHECK_DEV(rtl_dev);
+
+	FileDevice * file = FileDevice::Find(rtl_dev);
+	if(file == NULL)
+		return Nan::ThrowTypeError("dev_hnd must be a file handle");
+
+	if(!loop->IsBoolean())
+		return Nan::ThrowTypeError("loop must be a boolean");
+
+	file->SetLoop(Nan::To<bool>(loop).FromJust());
+}
@@ -4,6 +4,8 @@
 #include <nan.h>
 #include <rtl-sdr.h>
 
+#include "addon_env.h"
+
 
 #ifdef JS_RTLSDR_MODULE_IS_UNDER_TEST
 void mock_get_rtlsdr_dev_contents(const Nan::FunctionCallbackInfo<v8::Value> & info);
@@ -25,6 +27,9 @@ void get_xtal_freq(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void get_usb_strings(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void write_eeprom(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void read_eeprom(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void write_eeprom_async(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void read_eeprom_async(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void configure(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void set_center_freq(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void get_center_freq(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void set_freq_correction(const Nan::FunctionCallbackInfo<v8::Value> & info);
@@ -46,11 +51,30 @@ void set_offset_tuning(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void get_offset_tuning(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void reset_buffer(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void read_sync(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void read_into(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void wait_async(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void read_async(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void fan_out(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void sweep(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void capture_group(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void snapshot(const Nan::FunctionCallbackInfo<v8::Value> & info);
 void cancel_async(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void resume_async(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void release_buffer(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void get_iq_correction(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void get_record_stats(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void get_stream_stats(const Nan::FunctionCallbackInfo<v8::Value> & info);
+
+// replay of recordings through a device handle
+void open_file(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void seek_file(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void get_file_position(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void set_file_speed(const Nan::FunctionCallbackInfo<v8::Value> & info);
+void set_file_loop(const Nan::FunctionCallbackInfo<v8::Value> & info);
 
 NAN_MODULE_INIT(InitAll) {
+	AddonEnv::Init(v8::Isolate::GetCurrent());
+
 	#ifdef JS_RTLSDR_MODULE_IS_UNDER_TEST
 	NAN_EXPORT(target, mock_get_rtlsdr_dev_contents);
 	NAN_EXPORT(target, mock_set_rtlsdr_dev_contents);
@@ -70,6 +94,9 @@ NAN_MODULE_INIT(InitAll) {
 	NAN_EXPORT(target, get_usb_strings);
 	NAN_EXPORT(target, write_eeprom);
 	NAN_EXPORT(target, read_eeprom);
+	NAN_EXPORT(target, write_eeprom_async);
+	NAN_EXPORT(target, read_eeprom_async);
+	NAN_EXPORT(target, configure);
 	NAN_EXPORT(target, set_center_freq);
 	NAN_EXPORT(target, get_center_freq);
 	NAN_EXPORT(target, set_freq_correction);
@@ -91,11 +118,33 @@ NAN_MODULE_INIT(InitAll) {
 	NAN_EXPORT(target, get_offset_tuning);
 	NAN_EXPORT(target, reset_buffer);
 	NAN_EXPORT(target, read_sync);
+	NAN_EXPORT(target, read_into);
 	NAN_EXPORT(target, wait_async);
 	NAN_EXPORT(target, read_async);
+	NAN_EXPORT(target, fan_out);
+	NAN_EXPORT(target, sweep);
+	NAN_EXPORT(target, capture_group);
+	NAN_EXPORT(target, snapshot);
 	NAN_EXPORT(target, cancel_async);
+	NAN_EXPORT(target, resume_async);
+	NAN_EXPORT(target, release_buffer);
+	NAN_EXPORT(target, get_iq_correction);
+	NAN_EXPORT(target, get_record_stats);
+	NAN_EXPORT(target, get_stream_stats);
+	NAN_EXPORT(target, open_file);
+	NAN_EXPORT(target, seek_file);
+	NAN_EXPORT(target, get_file_position);
+	NAN_EXPORT(target, set_file_speed);
+	NAN_EXPORT(target, set_file_loop);
 }
 
+// context-aware, so that each worker_threads Worker can load the addon into its own environment
+#ifdef JS_RTLSDR_CONTEXT_AWARE
+NODE_MODULE_INIT(/* exports, module, context */) {
+	InitAll(exports);
+}
+#else
 NODE_MODULE(rtlsdr, InitAll)
+#endif
 
 #endif
@@ -0,0 +1,198 @@
+#include <cstdlib>
+#include <cstring>
+#include "sample_queue.h"
+
+SampleQueue::SampleQueue(size_t depth, overflow_policy_t policy, BufferPool * pool, sample_format_t format,
+                         StreamStats * stats)
+	: slots(depth < 1 ? 1 : depth), policy(policy), format(format), pool(pool), stats(stats) {}
+
+SampleQueue::~SampleQueue() {
+	sample_block_t block;
+	while(this->Pop(block)) this->Discard(block);
+}
+
+bool SampleQueue::Push(const uint8_t * buf, uint32_t len, uint64_t offset, uint8_t edges) {
+	// convert outside the lock so the consumer is never held up by the copy
+	sample_block_t block;
+	if(!this->Reserve(len * (uint32_t) sample_format_size(this->format), block)) return false;
+	block.offset = offset;
+	block.edges = edges;
+	convert_samples(this->format, buf, len, block.data);
+	return this->Enqueue(block);
+}
+
+bool SampleQueue::Push(const float * iq, uint32_t len, int channel, double time_start, double time_end,
+                       uint64_t offset, uint8_t edges) {
+	sample_block_t block;
+	if(!this->Reserve(len * (uint32_t) sample_format_size(this->format), block)) return false;
+	block.channel = channel;
+	block.time_start = time_start;
+	block.time_end = time_end;
+	block.offset = offset;
+	block.edges = edges;
+	encode_samples(this->format, iq, len, block.data);
+	return this->Enqueue(block);
+}
+
+bool SampleQueue::Push(const uint8_t * buf, uint32_t len, const sample_block_t & tags) {
+	sample_block_t block;
+	if(!this->Reserve(len * (uint32_t) sample_format_size(this->format), block)) return false;
+	block.channel = tags.channel;
+	block.time_start = tags.time_start;
+	block.time_end = tags.time_end;
+	block.offset = tags.offset;
+	block.mark = tags.mark;
+	block.edges = tags.edges;
+	convert_samples(this->format, buf, len, block.data);
+	return this->Enqueue(block);
+}
+
+bool SampleQueue::PushEdges(uint64_t offset, uint8_t edges) {
+	sample_block_t block;
+	block.offset = offset;
+	block.edges = edges;
+	return this->Enqueue(block);
+}
+
+bool SampleQueue::PushShared(uint8_t * slab, uint32_t len, BufferPool * pool, const sample_block_t & tags) {
+	sample_block_t block;
+	block.data = slab;
+	block.len = len;
+	block.shared = pool;
+	block.offset = tags.offset;
+	block.arrival_ns = tags.arrival_ns;
+	block.wall_ns = tags.wall_ns;
+	return this->Enqueue(block);
+}
+
+void SampleQueue::Skip() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->counts.transfers++;
+	this->counts.dropped++;
+	if(this->stats != NULL) this->stats->Dropped();
+}
+
+// storage for a block of len bytes: a pool slab if one fits and is free, else the heap; a transfer that gets
+// neither is dropped, and false returned
+bool SampleQueue::Reserve(uint32_t len, sample_block_t & block) {
+	block.len = len;
+	block.data = len <= this->pool->SlabSize() ? this->pool->Acquire() : NULL;
+	block.pooled = block.data != NULL;
+
+	if(!block.pooled) block.data = (uint8_t *) malloc(len > 0 ? len : 1);
+	if(block.data == NULL) {
+		this->Skip();
+		return false;
+	}
+	return true;
+}
+
+bool SampleQueue::Enqueue(sample_block_t & block) {
+	sample_block_t evicted;
+	bool accepted = true;
+
+	if(this->stats != NULL && block.arrival_ns == 0) {
+		block.arrival_ns = this->stats->Arrival();
+		block.wall_ns = this->stats->WallArrival();
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		const size_t depth = this->slots.size();
+
+		this->counts.transfers++;
+		if(block.data != NULL && !block.pooled && block.shared == NULL) this->counts.unpooled++;
+
+		if(this->policy == OVERFLOW_BLOCK) {
+			while(this->count == depth && !this->closed)
+				this->not_full.wait(lock);
+		}
+
+		if(this->closed) {
+			// the read is being torn down; this is not an overflow
+			evicted = block;
+			accepted = false;
+		} else if(this->count == depth && this->policy == OVERFLOW_DROP_NEWEST) {
+			this->counts.dropped++;
+			if(this->stats != NULL) this->stats->Dropped();
+			evicted = block;
+			accepted = false;
+		} else {
+			if(this->count == depth) {
+				// OVERFLOW_DROP_OLDEST
+				evicted = this->slots[this->head];
+				this->head = (this->head + 1) % depth;
+				this->count--;
+				this->counts.dropped++;
+				if(this->stats != NULL) this->stats->Dropped();
+			}
+
+			this->slots[(this->head + this->count) % depth] = block;
+			this->count++;
+
+			if(this->count > this->counts.depth_max)
+				this->counts.depth_max = this->count;
+			if(this->stats != NULL) this->stats->Depth(this->count);
+			this->not_empty.notify_one();
+		}
+	}
+
+	if(evicted.data != NULL) this->Discard(evicted);
+	return accepted;
+}
+
+bool SampleQueue::Pop(sample_block_t & out) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->Take(out);
+}
+
+bool SampleQueue::Wait(sample_block_t & out) {
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while(this->count == 0 && !this->closed) this->not_empty.wait(lock);
+	return this->Take(out);
+}
+
+// caller holds mutex
+bool SampleQueue::Take(sample_block_t & out) {
+	if(this->count == 0) return false;
+
+	out = this->slots[this->head];
+	this->slots[this->head] = sample_block_t();
+	this->head = (this->head + 1) % this->slots.size();
+	this->count--;
+
+	this->not_full.notify_one();
+	return true;
+}
+
+void SampleQueue::Close() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->closed = true;
+	this->not_full.notify_all();
+	this->not_empty.notify_all();
+}
+
+void SampleQueue::Discard(sample_block_t & block) {
+	if(block.shared != NULL)
+		block.shared->Unref(block.data);
+	else if(block.pooled)
+		this->pool->Recycle(block.data);
+	else
+		free(block.data);
+
+	block = sample_block_t();
+}
+
+sample_queue_counts_t SampleQueue::Counts() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->counts;
+}
+
+/* static */ bool SampleQueue::ParsePolicy(const char * name, overflow_policy_t * policy) {
+	if(0 == strcmp(name, "drop-oldest"))      *policy = OVERFLOW_DROP_OLDEST;
+	else if(0 == strcmp(name, "drop-newest")) *policy = OVERFLOW_DROP_NEWEST;
+	else if(0 == strcmp(name, "block"))       *policy = OVERFLOW_BLOCK;
+	else return false;
+
+	return true;
+}
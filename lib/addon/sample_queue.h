@@ -0,0 +1,123 @@
+#ifndef JS_RTLSDR_SAMPLE_QUEUE_GRAB_H
+#define JS_RTLSDR_SAMPLE_QUEUE_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "convert.h"
+#include "stream_stats.h"
+
+// what to do when a transfer arrives and the queue is already full
+typedef enum overflow_policy {
+	OVERFLOW_DROP_OLDEST = 0, // discard the oldest pending transfer to make room
+	OVERFLOW_DROP_NEWEST,     // discard the incoming transfer
+	OVERFLOW_BLOCK            // stall the librtlsdr callback thread until there is room
+} overflow_policy_t;
+
+typedef struct sample_queue_counts {
+	uint64_t transfers = 0; // transfers offered to the queue
+	uint64_t dropped   = 0; // transfers discarded because of overflow
+	uint64_t unpooled  = 0; // transfers copied to the heap because no pool slab fit or was free
+	size_t   depth_max = 0; // high-water mark of pending transfers
+} sample_queue_counts_t;
+
+#define SAMPLE_BLOCK_OPENED (1) // the energy squelch opened at the block's first sample
+#define SAMPLE_BLOCK_CLOSED (2) // the energy squelch closed just after the block's last sample
+
+// one pending transfer; pooled blocks point into a slab of the queue's pool, shared blocks into a slab that the
+// block holds a reference on, and others were malloc()ed. A block with no data only carries squelch edges.
+typedef struct sample_block {
+	uint8_t * data = NULL;
+	uint32_t  len = 0;
+	bool      pooled = false;
+	BufferPool * shared = NULL; // the pool of a shared slab (see BufferPool::Share), which Discard unrefs
+	int       channel = -1; // channelizer channel the samples belong to, or -1 for the whole stream
+	double    time_start = 0; // wall-clock milliseconds the block spans, where known (sweep rows)
+	double    time_end = 0;
+	uint64_t  offset = 0;   // complex samples since the read began, at the block's first sample (squelched reads,
+	                        // captures) or that of the transfer that completed it
+	uint64_t  mark = 0;     // complex samples since the read began, at the trigger (captures)
+	uint8_t   edges = 0;    // SAMPLE_BLOCK_OPENED | SAMPLE_BLOCK_CLOSED
+	int64_t   arrival_ns = 0; // StreamStats::Now() when its transfer reached the capture thread, where counted
+	int64_t   wall_ns = 0;    // StreamStats::WallNow() at the same moment
+} sample_block_t;
+
+// Bounded ring of pending transfers between the librtlsdr callback thread (producer) and the main thread
+// (consumer). Each transfer is copied exactly once, into a slab from the pool, converting it to the queue's sample
+// format on the way; the consumer hands that slab to JS without copying it again. With stats, each block is stamped
+// with the arrival of the transfer being processed, unless it already carries one, and overflow and depth are
+// counted there as well. A fan-out's pipelines also queue references to its shared slabs, and a pipeline thread
+// consumes them with Wait.
+class SampleQueue {
+public:
+	SampleQueue(size_t depth, overflow_policy_t policy, BufferPool * pool, sample_format_t format = SAMPLE_FORMAT_UINT8,
+	            StreamStats * stats = NULL);
+	~SampleQueue();
+
+	// producer side; returns false iff the transfer was dropped or discarded. The queued block holds
+	// len * sample_format_size(Format()) bytes.
+	bool Push(const uint8_t * buf, uint32_t len, uint64_t offset = 0, uint8_t edges = 0);
+
+	// as above, for len interleaved floats that have already been processed (see encode_samples), optionally
+	// tagged with a channelizer channel and the time they span
+	bool Push(const float * iq, uint32_t len, int channel = -1, double time_start = 0, double time_end = 0,
+	          uint64_t offset = 0, uint8_t edges = 0);
+
+	// as above, tagged with the channel, times, offset, mark, and edges of tags
+	bool Push(const uint8_t * buf, uint32_t len, const sample_block_t & tags);
+
+	// a block with no samples, carrying only squelch edges at offset
+	bool PushEdges(uint64_t offset, uint8_t edges);
+
+	// a shared slab of len uint8 bytes, queued as it is, without copying or converting it, tagged with the offset
+	// and arrival times of tags; the block takes over one of the slab's references, which a dropped block gives up
+	bool PushShared(uint8_t * slab, uint32_t len, BufferPool * pool, const sample_block_t & tags);
+
+	// a transfer lost before it reached the queue counts as offered and dropped
+	void Skip(void);
+
+	// consumer side; moves the oldest pending block into out and returns true, or returns false if empty. The
+	// consumer then owns out's storage.
+	bool Pop(sample_block_t & out);
+
+	// as Pop, but waits for a block; returns false once the queue is closed and empty
+	bool Wait(sample_block_t & out);
+
+	// wake and release a producer blocked under OVERFLOW_BLOCK; further pushes are discarded without counting as
+	// overflow
+	void Close(void);
+
+	// give back storage for a block that will not be delivered
+	void Discard(sample_block_t & block);
+
+	sample_queue_counts_t Counts(void);
+	size_t Depth(void) const { return this->slots.size(); }
+	overflow_policy_t Policy(void) const { return this->policy; }
+	sample_format_t Format(void) const { return this->format; }
+
+	static bool ParsePolicy(const char * name, overflow_policy_t * policy);
+
+private:
+	bool Reserve(uint32_t len, sample_block_t & block);
+	bool Enqueue(sample_block_t & block);
+	bool Take(sample_block_t & out);
+
+	std::mutex mutex;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+	std::vector<sample_block_t> slots;
+	size_t head  = 0;
+	size_t count = 0;
+	bool closed  = false;
+	const overflow_policy_t policy;
+	const sample_format_t format;
+	BufferPool * const pool;
+	StreamStats * const stats;
+	sample_queue_counts_t counts;
+};
+
+#endif
@@ -1,24 +1,461 @@
+#include <chrono>
+#include <cmath>
 #include <cstdio>
+#include <cstring>
+#include "device_backend.h"
+#include "device_context.h"
 #include "sample_reader.h"
 
 using v8::Local;
 using v8::Object;
 using v8::Value;
 
+static Resampler * create_resampler(const sample_reader_work_t * work) {
+	if(work->output_rate == 0 || work->output_rate == work->input_rate) return NULL;
+	return new Resampler(work->input_rate, work->output_rate);
+}
+
+static Channelizer * create_channelizer(const sample_reader_work_t * work) {
+	if(work->channel_count == 0) return NULL;
+	return new Channelizer(work->channel_count, work->channels, work->channel_threads);
+}
+
+static SpectrumAnalyzer * create_spectrum(const sample_reader_work_t * work) {
+	if(work->spectrum_size == 0) return NULL;
+	return new SpectrumAnalyzer(work->spectrum_size, work->spectrum_window, work->spectrum_overlap,
+	                            work->spectrum_averages);
+}
+
+static std::vector<Demodulator *> create_demods(const sample_reader_work_t * work) {
+	std::vector<Demodulator *> demods;
+	const uint32_t rate = work->output_rate > 0 ? work->output_rate : work->input_rate;
+
+	for(size_t i = 0; i < work->receivers.size(); i++) demods.push_back(new Demodulator(work->receivers[i], rate));
+	return demods;
+}
+
+static EnergySquelch * create_squelch(const sample_reader_work_t * work) {
+	if(!work->squelch) return NULL;
+	return new EnergySquelch(work->squelch_options);
+}
+
+static BurstCapture * create_capture(const sample_reader_work_t * work) {
+	if(!work->history) return NULL;
+	return new BurstCapture(work->capture_options);
+}
+
+static Recorder * create_recorder(const sample_reader_work_t * work) {
+	if(!work->record) return NULL;
+	return new Recorder(work->record_options);
+}
+
+static Sweeper * create_sweeper(const sample_reader_work_t * work) {
+	if(!work->sweep) return NULL;
+	return new Sweeper(work->sweep_options, work->input_rate);
+}
+
+static SampleRing * create_ring(const sample_reader_work_t * work) {
+	if(work->ring == NULL) return NULL;
+	return new SampleRing(work->ring, work->ring_size, work->format);
+}
+
+static double wall_clock_ms() {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count() / 1000.0;
+}
+
+static size_t transfer_floats(const sample_reader_work_t * work, const Resampler * resampler) {
+	const size_t samples = work->buf_len > 0 ? work->buf_len : BUFFER_POOL_DEFAULT_SLAB_SIZE;
+	return resampler != NULL ? resampler->MaxOutput(samples) : samples;
+}
+
+// queued blocks per transfer: one per delivered channel or receiver, up to one per completed spectrum row, or, when
+// squelched, room for a segment and an edge (a squelch that chatters within a transfer spills onto the heap)
+static size_t blocks_per_transfer(const sample_reader_work_t * work, const Resampler * resampler,
+                                  const SpectrumAnalyzer * spectrum) {
+	if(spectrum != NULL) return spectrum->MaxRows(transfer_floats(work, resampler));
+	if(!work->receivers.empty()) return work->receivers.size();
+	if(work->squelch) return 2;
+	return work->channel_count > 0 ? work->channels.size() : 1;
+}
+
+// one slab per USB buffer librtlsdr may have in flight, plus one per queue slot, each big enough for a resampled,
+// channelized, and converted block or a spectrum row; a sweep only needs room for its rows
+static BufferPool * create_pool(const sample_reader_work_t * work, const Resampler * resampler,
+                                const Channelizer * channelizer, const SpectrumAnalyzer * spectrum,
+                                const std::vector<Demodulator *> & demods, const Sweeper * sweeper) {
+	if(sweeper != NULL)
+		return BufferPool::Create(sweeper->Bins() * sample_format_size(work->format), work->queue_depth + 1);
+
+	// a fan-out's slabs each hold one whole transfer, shared by its pipelines
+	if(work->fan_out_slabs > 0) {
+		const size_t slab_size = work->buf_len > 0 ? work->buf_len : BUFFER_POOL_DEFAULT_SLAB_SIZE;
+		return BufferPool::Create(slab_size, work->fan_out_slabs);
+	}
+
+	// a recording, a ring, or a pipeline that queues the fan-out's slabs themselves needs no slabs of its own
+	if(work->record || work->ring != NULL || work->shared_slabs) return BufferPool::Create(0, 1);
+
+	const size_t floats = transfer_floats(work, resampler);
+	size_t samples = floats;
+	if(channelizer != NULL) samples = channelizer->MaxOutput(floats);
+	if(spectrum != NULL) samples = spectrum->Size();
+
+	if(!demods.empty()) {
+		samples = 0;
+		for(size_t i = 0; i < demods.size(); i++) {
+			const size_t audio = demods[i]->MaxOutput(floats);
+			if(audio > samples) samples = audio;
+		}
+	}
+
+	const size_t slab_size  = samples * sample_format_size(work->format);
+	const size_t slab_count = ((work->buf_num > 0 ? work->buf_num : BUFFER_POOL_DEFAULT_SLAB_COUNT) + work->queue_depth)
+	                          * blocks_per_transfer(work, resampler, spectrum);
+	return BufferPool::Create(slab_size, slab_count);
+}
+
+SampleReader::SampleReader(Nan::Callback * listener, sample_reader_work_t * work,
+                           const std::vector<SampleReader *> & pipelines)
+	: env(AddonEnv::Current()), callback(listener), work(work), resampler(create_resampler(work)),
+	  channelizer(create_channelizer(work)), spectrum(create_spectrum(work)), demods(create_demods(work)),
+	  squelch(create_squelch(work)), capture(create_capture(work)), recorder(create_recorder(work)),
+	  sweeper(create_sweeper(work)), ring(create_ring(work)),
+	  pool(create_pool(work, this->resampler, this->channelizer, this->spectrum, this->demods, this->sweeper)),
+	  queue(work->queue_depth * blocks_per_transfer(work, this->resampler, this->spectrum), work->overflow,
+	        this->pool, work->format, work->stats.get()),
+	  pipelines(pipelines), cancelled(false) {
+	this->async = new uv_async_t;
+	this->env->InitAsync(this->async, &SampleReader::AsyncDeliver, &SampleReader::AsyncClose);
+	this->async->data = this;
+
+	// off the V8 heap, so its storage stays put for as long as the reader holds it
+	Local<v8::ArrayBuffer> timing_buffer =
+		v8::ArrayBuffer::New(v8::Isolate::GetCurrent(), SAMPLE_READER_TIMING_FIELDS * sizeof(double));
+	Local<v8::Float64Array> timing = v8::Float64Array::New(timing_buffer, 0, SAMPLE_READER_TIMING_FIELDS);
+	this->timing.Reset(timing);
+	Nan::TypedArrayContents<double> timing_contents(timing);
+	this->timing_data = *timing_contents;
+
+	if(work->dc_block || work->iq_balance)
+		this->corrector = new IqCorrector(work->dc_block, work->iq_balance);
+
+	this->audio_sample.resize(this->demods.size());
+
+	// drops by the pipeline's policy, like its output queue, so a stalled listener or stage only costs it transfers
+	if(work->pipeline && !work->shared_slabs)
+		this->input = new SampleQueue(work->queue_depth, work->overflow, this->pool, SAMPLE_FORMAT_UINT8,
+		                              work->stats.get());
+
+	if(this->ring != NULL) {
+		Local<Object> atomics = Nan::To<Object>(
+			Nan::Get(Nan::GetCurrentContext()->Global(), Nan::New("Atomics").ToLocalChecked()).ToLocalChecked()
+		).ToLocalChecked();
+
+		Local<Value> notify = Nan::Get(atomics, Nan::New("notify").ToLocalChecked()).ToLocalChecked();
+		if(!notify->IsFunction()) notify = Nan::Get(atomics, Nan::New("wake").ToLocalChecked()).ToLocalChecked();
+		this->notify = new Nan::Callback(notify.As<v8::Function>());
+
+		Local<v8::SharedArrayBuffer> buffer = Nan::New(work->ring_buffer);
+		this->ring_header.Reset(v8::Int32Array::New(buffer, 0, SAMPLE_RING_HEADER_BYTES / sizeof(int32_t)));
+	}
+}
+
+SampleReader::~SampleReader() {
+	sample_block_t block;
+	while(this->queue.Pop(block)) this->queue.Discard(block);
+	delete this->input;
+
+	// slabs still held by JS Buffers keep the pool alive until they are collected
+	this->pool->Orphan();
+
+	delete this->corrector;
+	delete this->resampler;
+	delete this->channelizer;
+	delete this->spectrum;
+	for(size_t i = 0; i < this->demods.size(); i++) delete this->demods[i];
+	delete this->squelch;
+	delete this->capture;
+	delete this->recorder;
+	delete this->sweeper;
+	delete this->ring;
+	delete this->callback;
+	delete this->notify;
+	this->ring_header.Reset();
+	this->work->ring_buffer.Reset();
+	delete this->work;
+	this->timing.Reset();
+}
+
 /* static */ void SampleReader::RTLSDRAsyncCallback(uint8_t * buf, uint32_t len, void * ctx) {
-	const ExecutionProgress * progress = (const ExecutionProgress *) ctx;
-	progress->Send(buf, len);
+	SampleReader * reader = (SampleReader *) ctx;
+	reader->work->stats->Transfer(len);
+
+	// a cancel that raced the start of rtlsdr_read_async is applied here
+	if(reader->cancelled.exchange(false))
+		backend_cancel_async(reader->work->rtl_dev);
+
+	if(reader->pipelines.empty())
+		reader->Consume(buf, len);
+	else
+		reader->Fan(buf, len);
+}
+
+// capture thread, or a pipeline's thread: run one transfer through the read's stages and wake the main thread if
+// they queued anything
+void SampleReader::Consume(const uint8_t * buf, uint32_t len) {
+	// a recording never wakes the main thread
+	if(this->recorder != NULL) {
+		this->Record(buf, len);
+		return;
+	}
+
+	// a ring only needs its consumers woken; an idle squelch or capture ring leaves the main thread asleep
+	if(this->ring != NULL) {
+		this->Share(buf, len);
+	} else if(this->squelch != NULL) {
+		if(!this->Gate(buf, len)) return;
+	} else if(this->capture != NULL) {
+		if(!this->Capture(buf, len)) return;
+	} else {
+		this->Process(buf, len);
+	}
+
+	uv_async_send(this->async);
+}
+
+// capture thread: copy one transfer into a shared slab, the only copy any pipeline needs, and hand each pipeline a
+// reference to it; a pipeline whose queue is full drops by its own policy. The pool holds every slab the pipelines'
+// queues and the raw pipeline's leases can, so only a transfer too big for a slab is lost to all of them.
+void SampleReader::Fan(const uint8_t * buf, uint32_t len) {
+	StreamStats * stats = this->work->stats.get();
+
+	sample_block_t tags;
+	tags.offset = this->next_sample;
+	tags.arrival_ns = stats->Arrival();
+	tags.wall_ns = stats->WallArrival();
+	this->next_sample += len / 2;
+
+	uint8_t * slab = len <= this->pool->SlabSize() ? this->pool->Acquire() : NULL;
+	if(slab == NULL) {
+		for(size_t i = 0; i < this->pipelines.size(); i++) {
+			SampleReader * pipeline = this->pipelines[i];
+			(pipeline->input != NULL ? pipeline->input : &pipeline->queue)->Skip();
+		}
+
+		return;
+	}
+
+	memcpy(slab, buf, len);
+	this->pool->Share(slab, (unsigned) this->pipelines.size());
+
+	for(size_t i = 0; i < this->pipelines.size(); i++) {
+		SampleReader * pipeline = this->pipelines[i];
+
+		if(pipeline->input != NULL) {
+			pipeline->input->PushShared(slab, len, this->pool, tags);
+		} else {
+			pipeline->work->stats->Transfer(len, tags.arrival_ns, tags.wall_ns);
+			pipeline->queue.PushShared(slab, len, this->pool, tags);
+			uv_async_send(pipeline->async);
+		}
+	}
+}
+
+// a pipeline's thread: run each shared transfer through the pipeline's stages, until its fan-out closes the input
+// and it has drained
+void SampleReader::RunPipeline() {
+	sample_block_t block;
+
+	while(this->input->Wait(block)) {
+		if(!this->stopped) {
+			this->work->stats->Transfer(block.len, block.arrival_ns, block.wall_ns);
+			if(block.offset > this->next_sample) this->SkipOutput(block.offset - this->next_sample);
+			this->next_sample = block.offset;
+			this->Consume(block.data, block.len);
+		}
+
+		this->input->Discard(block);
+	}
+
+	std::string record_err;
+	if(this->recorder != NULL && !this->recorder->Close(&record_err)) this->error = record_err;
+}
+
+// capture thread, once the read has ended: let every pipeline finish what it was handed
+void SampleReader::StopPipelines() {
+	for(size_t i = 0; i < this->pipelines.size(); i++) {
+		if(this->pipelines[i]->input != NULL) this->pipelines[i]->input->Close();
+	}
+
+	for(size_t i = 0; i < this->pipeline_threads.size(); i++) this->pipeline_threads[i].join();
+	this->pipeline_threads.clear();
+}
+
+// capture thread: queue the open segments of one transfer, tagged with their squelch edges; returns whether anything
+// was queued
+bool SampleReader::Gate(const uint8_t * buf, uint32_t len) {
+	const std::vector<squelch_segment_t> & segments = this->squelch->Process(buf, len);
+
+	for(size_t i = 0; i < segments.size(); i++) {
+		const squelch_segment_t & segment = segments[i];
+		const uint8_t edges = (segment.opened ? SAMPLE_BLOCK_OPENED : 0) | (segment.closed ? SAMPLE_BLOCK_CLOSED : 0);
+
+		if(segment.len == 0) {
+			this->queue.PushEdges(segment.offset, edges);
+		} else if(this->corrector == NULL) {
+			this->queue.Push(buf + segment.start, segment.len, segment.offset, edges);
+		} else {
+			if(this->scratch.size() < segment.len) this->scratch.resize(len);
+			float * iq = this->scratch.data();
+
+			convert_samples(SAMPLE_FORMAT_FLOAT32, buf + segment.start, segment.len, iq);
+			this->corrector->Process(iq, segment.len);
+			this->queue.Push((const float *) iq, segment.len, -1, 0, 0, segment.offset, edges);
+		}
+	}
+
+	return !segments.empty();
+}
+
+// capture thread: record one transfer in the history ring and queue the captures it completed; returns whether
+// any were
+bool SampleReader::Capture(const uint8_t * buf, uint32_t len) {
+	const std::vector<const burst_capture_t *> & completed = this->capture->Process(buf, len);
+
+	for(size_t i = 0; i < completed.size(); i++) {
+		const burst_capture_t * capture = completed[i];
+
+		sample_block_t tags;
+		tags.channel = capture->id;
+		tags.offset = capture->start / 2;
+		tags.mark = capture->trigger / 2;
+
+		this->queue.Push(capture->data.data(), (uint32_t) capture->data.size(), tags);
+	}
+
+	return !completed.empty();
+}
+
+// capture thread: hand one transfer to the writer; a failed write ends the read, with the reason reported by Execute,
+// or for a pipeline, only the pipeline's recording
+void SampleReader::Record(const uint8_t * buf, uint32_t len) {
+	if(this->recorder->Write(buf, len)) return;
+
+	if(this->work->pipeline)
+		this->stopped = true;
+	else
+		backend_cancel_async(this->work->rtl_dev);
+}
+
+// capture thread: write one transfer into the ring, or count it as dropped if the consumer has left no room
+void SampleReader::Share(const uint8_t * buf, uint32_t len) {
+	const uint64_t index = this->next_sample;
+	this->next_sample += len / 2;
+
+	StreamStats * stats = this->work->stats.get();
+	this->ring->Write(buf, len, index, stats->Arrival() / 1e6, stats->WallArrival() / 1e6);
+}
+
+// capture thread: queue one transfer, through the float correction, resampling, and channelizing, spectrum, or
+// demodulation stages if there are any. Resampled, channel, and audio blocks are indexed in their own stream's
+// samples, so a gap in the index is a gap in what was delivered; spectrum rows keep their last transfer's index.
+void SampleReader::Process(const uint8_t * buf, uint32_t len) {
+	const uint64_t offset = this->next_sample;
+	this->next_sample += len / 2;
+
+	if(this->corrector == NULL && this->resampler == NULL && this->channelizer == NULL && this->spectrum == NULL &&
+	   this->demods.empty()) {
+		this->queue.Push(buf, len, offset);
+		return;
+	}
+
+	// sized by the first transfer; librtlsdr transfers are all the same length
+	if(this->scratch.size() < len) this->scratch.resize(len);
+	float * iq = this->scratch.data();
+
+	convert_samples(SAMPLE_FORMAT_FLOAT32, buf, len, iq);
+	if(this->corrector != NULL) this->corrector->Process(iq, len);
+
+	size_t out = len;
+	if(this->resampler != NULL) out = this->resampler->Process(iq, len);
+
+	// a short transfer may only feed the filters
+	if(out == 0) return;
+
+	if(!this->demods.empty()) {
+		for(size_t i = 0; i < this->demods.size(); i++) {
+			const size_t audio = this->demods[i]->Process(iq, out);
+			if(audio == 0) continue;
+
+			this->queue.Push(this->demods[i]->Output(), (uint32_t) audio, (int) i, 0, 0, this->audio_sample[i]);
+			this->audio_sample[i] += audio;
+		}
+
+		return;
+	}
+
+	if(this->spectrum != NULL) {
+		const size_t rows = this->spectrum->Process(iq, out);
+		for(size_t i = 0; i < rows; i++)
+			this->queue.Push(this->spectrum->Row(i), (uint32_t) this->spectrum->Size(), -1, 0, 0, offset);
+		return;
+	}
+
+	if(this->channelizer == NULL) {
+		this->queue.Push((const float *) iq, (uint32_t) out, -1, 0, 0, this->output_sample);
+		this->output_sample += out / 2;
+		return;
+	}
+
+	const size_t per_channel = this->channelizer->Process(iq, out);
+	if(per_channel == 0) return;
+
+	const std::vector<unsigned> & channels = this->channelizer->Selected();
+	for(size_t i = 0; i < channels.size(); i++) {
+		this->queue.Push(this->channelizer->Output(i), (uint32_t) per_channel, (int) channels[i], 0, 0,
+		                 this->output_sample);
+	}
+
+	this->output_sample += per_channel / 2;
 }
 
-void SampleReader::Execute(const SampleReader::ExecutionProgress & progress) {
+// capture thread: a fan-out pipeline's input lost samples complex samples; advance the output indices by what they
+// would have become, so the loss shows in every stream's index
+void SampleReader::SkipOutput(uint64_t samples) {
+	double ratio = 1;
+	if(this->resampler != NULL) ratio = this->resampler->OutputRate() / this->work->input_rate;
+	if(this->channelizer != NULL) ratio /= this->work->channel_count;
+	this->output_sample += (uint64_t) llround(samples * ratio);
+
+	for(size_t i = 0; i < this->audio_sample.size(); i++) {
+		const double audio_ratio = (double) this->work->receivers[i].audio_rate / this->work->input_rate;
+		this->audio_sample[i] += (uint64_t) llround(samples * audio_ratio);
+	}
+}
+
+void SampleReader::Execute() {
+	this->work->stats->Begin();
+
+	if(this->sweeper != NULL) {
+		this->Sweep();
+		return;
+	}
+
+	// each pipeline with stages streams on a thread of its own while the fan-out reads
+	for(size_t i = 0; i < this->pipelines.size(); i++) {
+		if(this->pipelines[i]->input != NULL)
+			this->pipeline_threads.push_back(std::thread(&SampleReader::RunPipeline, this->pipelines[i]));
+	}
+
 	int err;
-	void * ctx = (void *) &progress;
+	void * ctx = (void *) this;
 
 	if(this->work->wait)
-		err = rtlsdr_wait_async(this->work->rtl_dev, &SampleReader::RTLSDRAsyncCallback, ctx);
+		err = backend_wait_async(this->work->rtl_dev, &SampleReader::RTLSDRAsyncCallback, ctx);
 	else
-		err = rtlsdr_read_async(this->work->rtl_dev, &SampleReader::RTLSDRAsyncCallback, ctx,
-		                        this->work->buf_num, this->work->buf_len);
+		err = backend_read_async(this->work->rtl_dev, &SampleReader::RTLSDRAsyncCallback, ctx,
+		                         this->work->buf_num, this->work->buf_len);
 
 	if(err != 0) {
 		char msg[60];
@@ -27,40 +464,357 @@ void SampleReader::Execute(const SampleReader::ExecutionProgress & progress) {
 			err
 		);
 
-		this->SetErrorMessage(msg);
+		this->error = msg;
 	}
+
+	this->StopPipelines();
+
+	// flush and close the last file before 'done', so the recording is complete by then
+	std::string record_err;
+	if(this->recorder != NULL && !this->recorder->Close(&record_err)) this->error = record_err;
 }
 
-void SampleReader::HandleProgressCallback(const uint8_t * buf, size_t len) {
-	Nan::HandleScope scope;
+// capture thread: sweep until the requested number of sweeps is done or the reader is cancelled, queueing each
+// row with the wall-clock time it took
+void SampleReader::Sweep() {
+	rtlsdr_dev_t * rtl_dev = this->work->rtl_dev;
+	const uint32_t sweeps = this->work->sweep_options.sweeps;
+
+	int err = backend_reset_buffer(rtl_dev, *this->work->control);
+	if(err != 0) {
+		char msg[60];
+		sprintf(msg, "rtlsdr_reset_buffer returned error code %i", err);
+		this->error = msg;
+		return;
+	}
 
-	Local<Value> argv[] = {
-		Nan::New("data").ToLocalChecked(),
-		Nan::CopyBuffer((char *) buf, len).ToLocalChecked()
-	};
+	// sized once; each row is copied into a slab by the queue
+	std::vector<float> row(this->sweeper->Bins());
 
-	this->callback->Call(2, argv);
+	for(uint32_t n = 0; sweeps == 0 || n < sweeps; n++) {
+		const double started = wall_clock_ms();
+
+		err = this->sweeper->Sweep(rtl_dev, *this->work->control, this->cancelled, row.data(), &this->error);
+		if(this->cancelled) {
+			this->error.clear();
+			return;
+		}
+
+		if(err != 0) return;
+
+		this->queue.Push(row.data(), (uint32_t) row.size(), -1, started, wall_clock_ms());
+		uv_async_send(this->async);
+	}
+}
+
+void SampleReader::Abort(const char * msg) {
+	this->error = msg;
+	this->Finish();
+}
+
+// the last thing the capture thread does with a reader; the main thread may free it right after
+void SampleReader::Finish() {
+	std::lock_guard<std::mutex> lock(this->finish_mutex);
+	this->finished = true;
+	uv_async_send(this->async);
+}
+
+void SampleReader::Cancel(bool release) {
+	this->cancelled = true;
+	if(release) {
+		this->queue.Close();
+		if(this->input != NULL) this->input->Close();
+		if(this->recorder != NULL) this->recorder->Release();
+		for(size_t i = 0; i < this->pipelines.size(); i++) this->pipelines[i]->Cancel(true);
+	}
+}
+
+int SampleReader::Snapshot(double pre_ms, double post_ms) {
+	if(this->capture == NULL) return -1;
+
+	// whole complex samples
+	const double samples_per_ms = this->work->input_rate / 1000.0;
+	return this->capture->Snapshot(2 * (size_t) (pre_ms * samples_per_ms), 2 * (size_t) (post_ms * samples_per_ms));
+}
+
+bool SampleReader::RecordStats(recorder_stats_t * out) {
+	// a fan-out's are its first recording pipeline's
+	for(size_t i = 0; i < this->pipelines.size(); i++) {
+		if(this->pipelines[i]->RecordStats(out)) return true;
+	}
+
+	if(this->recorder == NULL) return false;
+	this->recorder->Stats(out);
+	return true;
+}
+
+bool SampleReader::Correction(iq_correction_estimates_t * out) {
+	for(size_t i = 0; i < this->pipelines.size(); i++) {
+		if(this->pipelines[i]->Correction(out)) return true;
+	}
+
+	if(this->corrector == NULL) return false;
+
+	*out = this->corrector->Estimates();
+	return true;
+}
+
+/* static */ NAUV_WORK_CB(SampleReader::AsyncDeliver) {
+	SampleReader * reader = static_cast<SampleReader *>(async->data);
+	bool finished;
+
+	// read before draining, so that everything queued before Finish is delivered ahead of 'done'
+	{
+		std::lock_guard<std::mutex> lock(reader->finish_mutex);
+		finished = reader->finished;
+	}
+
+	// a ring's consumers wait on its write counter, which the capture thread has already advanced
+	if(reader->ring != NULL) reader->Notify();
+
+	// a paused reader completes once it has been resumed and drained
+	if(reader->Deliver() && finished) reader->Complete();
 }
 
-void SampleReader::HandleOKCallback() {
+// wake every consumer blocked in Atomics.wait on the ring's write counter
+void SampleReader::Notify() {
 	Nan::HandleScope scope;
-	Local<Value> argv[] = {Nan::New("done").ToLocalChecked()};
-	this->callback->Call(1, argv);
 
-	delete this->work;
-	this->work = NULL;
+	Local<Value> argv[] = {Nan::New(this->ring_header), Nan::New<v8::Number>(SAMPLE_RING_WRITE)};
+	this->notify->Call(2, argv);
 }
 
-void SampleReader::HandleErrorCallback() {
+void SampleReader::Resume() {
+	for(size_t i = 0; i < this->pipelines.size(); i++) this->pipelines[i]->Resume();
+
+	if(!this->paused) return;
+
+	this->paused = false;
+	uv_async_send(this->async);
+}
+
+// drain pending transfers to the listener until the queue is empty or the listener pauses, then report any overflow
+// since the last drain; returns whether the queue was drained
+bool SampleReader::Deliver() {
 	Nan::HandleScope scope;
 
-	Local<Value> argv[] = {
-		Nan::New("error").ToLocalChecked(),
-		Nan::New<v8::String>(this->ErrorMessage()).ToLocalChecked()
-	};
+	StreamStats * stats = this->work->stats.get();
+	sample_block_t block;
+	uint64_t delivered = 0;
+
+	while(!this->paused && this->queue.Pop(block)) {
+		// squelch edges ride on the segments' blocks; a block lost to overflow takes its edges with it, so they are
+		// re-derived here to always alternate
+		if(this->squelch != NULL) {
+			const uint64_t samples = block.len / sample_format_size(this->work->format) / 2;
+
+			if((block.edges & SAMPLE_BLOCK_OPENED) || (!this->gate_open && samples > 0)) {
+				if(this->gate_open) this->EmitEdge("squelch-close", this->gate_end);
+				this->EmitEdge("squelch-open", block.offset);
+				this->gate_open = true;
+			}
+
+			if(samples == 0) {
+				if((block.edges & SAMPLE_BLOCK_CLOSED) && this->gate_open) {
+					this->EmitEdge("squelch-close", block.offset);
+					this->gate_open = false;
+				}
+
+				continue;
+			}
+
+			this->gate_end = block.offset + samples;
+		}
+
+		Local<Object> buffer;
+
+		if(block.shared != NULL && block.shared->LentCount() >= this->work->queue_depth) {
+			// JS already holds as many of the fan-out's slabs as this pipeline may lend, however slowly it lets go of
+			// them, so this one is copied and goes straight back to the other pipelines
+			buffer = Nan::CopyBuffer((const char *) block.data, block.len).ToLocalChecked();
+			block.shared->Unref(block.data);
+		} else if(block.shared != NULL) {
+			// the fan-out's own slab, whose lease takes over the block's reference
+			const uintptr_t generation = block.shared->Lend(block.data);
+			block.shared->Unref(block.data);
+			buffer = Nan::NewBuffer((char *) block.data, block.len,
+			                        &SampleReader::FreePooledBuffer, (void *) generation).ToLocalChecked();
+			Nan::AdjustExternalMemory((int) block.shared->SlabSize());
+		} else if(block.pooled) {
+			const uintptr_t generation = this->pool->Lend(block.data);
+			buffer = Nan::NewBuffer((char *) block.data, block.len,
+			                        &SampleReader::FreePooledBuffer, (void *) generation).ToLocalChecked();
+			Nan::AdjustExternalMemory((int) this->pool->SlabSize());
+		} else {
+			// malloc()ed; the Buffer takes ownership
+			buffer = Nan::NewBuffer((char *) block.data, block.len).ToLocalChecked();
+		}
+
+		stats->Delivered(block.arrival_ns);
+		delivered++;
+
+		Local<Value> ret;
+
+		if(this->capture != NULL) {
+			Local<Object> capture = Nan::New<Object>();
+			if(block.channel > 0)
+				Nan::Set(capture, Nan::New("id").ToLocalChecked(), Nan::New<v8::Number>(block.channel));
+			Nan::Set(capture, Nan::New("trigger").ToLocalChecked(),
+			         Nan::New(block.channel > 0 ? "snapshot" : "power").ToLocalChecked());
+			Nan::Set(capture, Nan::New("offset").ToLocalChecked(), Nan::New<v8::Number>((double) block.offset));
+			Nan::Set(capture, Nan::New("triggerOffset").ToLocalChecked(), Nan::New<v8::Number>((double) block.mark));
+			Nan::Set(capture, Nan::New("samples").ToLocalChecked(), this->View(buffer, block.len));
+
+			Local<Value> argv[] = {Nan::New("capture").ToLocalChecked(), capture};
+			ret = this->callback->Call(2, argv);
+		} else if(this->sweeper != NULL) {
+			Local<Object> sweep = Nan::New<Object>();
+			Nan::Set(sweep, Nan::New("bins").ToLocalChecked(), this->View(buffer, block.len));
+			Nan::Set(sweep, Nan::New("start").ToLocalChecked(),
+			         Nan::New<v8::Number>(this->work->sweep_options.start));
+			Nan::Set(sweep, Nan::New("binWidth").ToLocalChecked(), Nan::New<v8::Number>(this->sweeper->BinWidth()));
+			Nan::Set(sweep, Nan::New("startTime").ToLocalChecked(), Nan::New<v8::Number>(block.time_start));
+			Nan::Set(sweep, Nan::New("endTime").ToLocalChecked(), Nan::New<v8::Number>(block.time_end));
 
+			Local<Value> argv[] = {Nan::New("sweep").ToLocalChecked(), sweep};
+			ret = this->callback->Call(2, argv);
+		} else if(block.channel < 0) {
+			const char * event = this->spectrum != NULL ? "spectrum" : "data";
+			Local<Value> argv[] = {
+				Nan::New(event).ToLocalChecked(),
+				this->View(buffer, block.len),
+				this->Timing(block)
+			};
+
+			ret = this->callback->Call(3, argv);
+		} else if(!this->demods.empty()) {
+			Local<Object> audio = Nan::New<Object>();
+			Nan::Set(audio, Nan::New("receiver").ToLocalChecked(), Nan::New<v8::Number>(block.channel));
+			Nan::Set(audio, Nan::New("samples").ToLocalChecked(), this->View(buffer, block.len));
+
+			Local<Value> argv[] = {Nan::New("audio").ToLocalChecked(), audio, this->Timing(block)};
+			ret = this->callback->Call(3, argv);
+		} else {
+			Local<Object> channel = Nan::New<Object>();
+			Nan::Set(channel, Nan::New("channel").ToLocalChecked(), Nan::New<v8::Number>(block.channel));
+			Nan::Set(channel, Nan::New("samples").ToLocalChecked(), this->View(buffer, block.len));
+
+			Local<Value> argv[] = {Nan::New("channel").ToLocalChecked(), channel, this->Timing(block)};
+			ret = this->callback->Call(3, argv);
+		}
+
+		// a listener that cannot take more now says so with false, as Readable#push does
+		if(!ret.IsEmpty() && ret->IsFalse()) this->paused = true;
+
+		if((block.edges & SAMPLE_BLOCK_CLOSED) && this->gate_open) {
+			this->EmitEdge("squelch-close", this->gate_end);
+			this->gate_open = false;
+		}
+	}
+
+	stats->Drained(delivered);
+
+	sample_queue_counts_t counts = this->queue.Counts();
+
+	// a pipeline with stages drops by its policy at its input as well
+	if(this->input != NULL) {
+		const sample_queue_counts_t input = this->input->Counts();
+		counts.transfers = input.transfers;
+		counts.dropped += input.dropped;
+	}
+
+	if(counts.dropped > this->dropped_reported) {
+		Local<Object> overflow = Nan::New<Object>();
+		Nan::Set(overflow, Nan::New("dropped").ToLocalChecked(),
+		         Nan::New<v8::Number>((double) (counts.dropped - this->dropped_reported)));
+		Nan::Set(overflow, Nan::New("totalDropped").ToLocalChecked(), Nan::New<v8::Number>((double) counts.dropped));
+		Nan::Set(overflow, Nan::New("totalTransfers").ToLocalChecked(), Nan::New<v8::Number>((double) counts.transfers));
+		Nan::Set(overflow, Nan::New("queueDepth").ToLocalChecked(), Nan::New<v8::Number>((double) this->queue.Depth()));
+
+		this->dropped_reported = counts.dropped;
+
+		Local<Value> argv[] = {Nan::New("overflow").ToLocalChecked(), overflow};
+		this->callback->Call(2, argv);
+	}
+
+	return !this->paused;
+}
+
+void SampleReader::EmitEdge(const char * event, uint64_t offset) {
+	Local<Value> argv[] = {Nan::New(event).ToLocalChecked(), Nan::New<v8::Number>((double) offset)};
 	this->callback->Call(2, argv);
+}
 
-	delete this->work;
-	this->work = NULL;
+// the typed array 'data' carries for this read's format; it keeps buffer, and so the slab lease, alive
+Local<Object> SampleReader::View(Local<Object> buffer, uint32_t len) {
+	if(this->work->format == SAMPLE_FORMAT_UINT8) return buffer;
+
+	Local<v8::Uint8Array> bytes = buffer.As<v8::Uint8Array>();
+	Local<v8::ArrayBuffer> backing = bytes->Buffer();
+	const size_t offset = bytes->ByteOffset();
+
+	if(this->work->format == SAMPLE_FORMAT_INT16)
+		return v8::Int16Array::New(backing, offset, len / sizeof(int16_t));
+
+	return v8::Float32Array::New(backing, offset, len / sizeof(float));
+}
+
+// the reader's timing array, filled in for block; valid until the next payload is delivered
+Local<Value> SampleReader::Timing(const sample_block_t & block) {
+	this->timing_data[SAMPLE_READER_TIMING_INDEX] = (double) block.offset;
+	this->timing_data[SAMPLE_READER_TIMING_MONOTONIC] = block.arrival_ns / 1e6;
+	this->timing_data[SAMPLE_READER_TIMING_REALTIME] = block.wall_ns / 1e6;
+	return Nan::New(this->timing);
+}
+
+// emit 'done' or 'error', then close the async handle; AsyncClose frees the reader
+void SampleReader::Complete() {
+	Nan::HandleScope scope;
+
+	if(this->ring != NULL) {
+		this->ring->Finish(!this->error.empty());
+		this->Notify();
+	}
+
+	// a fan-out's pipelines have run their last transfer; each now completes once it has delivered its queue, with
+	// the fan-out's error unless it has one of its own, and the device resumes them in its place until then
+	for(size_t i = 0; i < this->pipelines.size(); i++) {
+		SampleReader * pipeline = this->pipelines[i];
+		if(pipeline->error.empty()) pipeline->error = this->error;
+
+		if(this->owner != NULL)
+			this->owner->Delivering(pipeline);
+		else
+			pipeline->Resume();
+
+		pipeline->Finish();
+	}
+
+	if(this->callback == NULL) {
+		// a fan-out's listeners are its pipelines'
+	} else if(this->error.empty()) {
+		Local<Value> argv[] = {Nan::New("done").ToLocalChecked()};
+		this->callback->Call(1, argv);
+	} else {
+		Local<Value> argv[] = {
+			Nan::New("error").ToLocalChecked(),
+			Nan::New<v8::String>(this->error).ToLocalChecked()
+		};
+
+		this->callback->Call(2, argv);
+	}
+
+	if(this->owner != NULL) this->owner->Completed(this);
+	this->env->CloseAsync(this->async);
+}
+
+/* static */ void SampleReader::FreePooledBuffer(char * data, void * hint) {
+	const size_t slab_size = BufferPool::Return((uint8_t *) data, (uintptr_t) hint);
+	if(slab_size > 0) Nan::AdjustExternalMemory(-((int) slab_size));
+}
+
+/* static */ void SampleReader::AsyncClose(uv_handle_t * handle) {
+	SampleReader * reader = static_cast<SampleReader *>(handle->data);
+	delete reinterpret_cast<uv_async_t *>(handle);
+	delete reader;
 }
@@ -4,12 +4,75 @@
 #include <rtl-sdr.h>
 #include <node.h>
 #include <nan.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "addon_env.h"
+#include "buffer_pool.h"
+#include "burst_capture.h"
+#include "channelizer.h"
+#include "demod.h"
+#include "energy_squelch.h"
+#include "iq_correct.h"
+#include "recorder.h"
+#include "resampler.h"
+#include "sample_queue.h"
+#include "sample_ring.h"
+#include "spectrum.h"
+#include "stream_stats.h"
+#include "sweep.h"
+
+#define SAMPLE_READER_DEFAULT_QUEUE_DEPTH (32)
+#define SAMPLE_READER_MAX_PIPELINES       (16)
+
+// the fields of the Float64Array passed after each payload, describing the transfer the payload came from
+#define SAMPLE_READER_TIMING_INDEX     (0) // complex samples since the read began, at the payload's first sample
+#define SAMPLE_READER_TIMING_MONOTONIC (1) // CLOCK_MONOTONIC milliseconds when the transfer reached the capture thread
+#define SAMPLE_READER_TIMING_REALTIME  (2) // CLOCK_REALTIME milliseconds since the Unix epoch at the same moment
+#define SAMPLE_READER_TIMING_FIELDS    (3)
+
+class DeviceContext;
 
 typedef struct sample_reader_work {
-	rtlsdr_dev_t *  rtl_dev;
-	uint32_t        buf_num; // for read_async only (i.e. wait = false)
-	uint32_t        buf_len; // for read_async only (i.e. wait = false)
-	bool            wait = false;
+	rtlsdr_dev_t *    rtl_dev;
+	std::mutex *      control = NULL;     // rtl_dev's control mutex (see DeviceContext::ControlMutex)
+	std::shared_ptr<StreamStats> stats; // the device's counters (see DeviceContext::Stats)
+	uint32_t          buf_num; // for read_async only (i.e. wait = false)
+	uint32_t          buf_len; // for read_async only (i.e. wait = false)
+	bool              wait = false;
+	size_t            queue_depth = SAMPLE_READER_DEFAULT_QUEUE_DEPTH;
+	overflow_policy_t overflow = OVERFLOW_BLOCK;
+	sample_format_t   format = SAMPLE_FORMAT_UINT8;
+	bool              dc_block = false;   // remove the DC offset on the capture thread
+	bool              iq_balance = false; // correct I/Q gain and phase imbalance on the capture thread
+	uint32_t          input_rate = 0;     // the device's sample rate when the read was requested
+	uint32_t          output_rate = 0;    // resample to this rate on the capture thread; 0 to deliver input_rate
+	unsigned          channel_count = 0;  // split the stream into this many channels; 0 to deliver it whole
+	std::vector<unsigned> channels;       // the channels to deliver, when channel_count > 0
+	unsigned          channel_threads = 1;
+	size_t            spectrum_size = 0;  // deliver averaged power spectra of this many bins instead of samples
+	spectrum_window_t spectrum_window = SPECTRUM_WINDOW_HANN;
+	double            spectrum_overlap = 0;
+	unsigned          spectrum_averages = 1;
+	std::vector<demod_options_t> receivers; // demodulate the stream into audio, one stream per receiver
+	bool              squelch = false;    // forward only the windows whose power opens an EnergySquelch
+	energy_squelch_options_t squelch_options;
+	bool              history = false;    // keep a BurstCapture ring and deliver only triggered captures
+	burst_capture_options_t capture_options;
+	bool              record = false;     // write raw transfers to disk through a Recorder instead of delivering them
+	recorder_options_t record_options;
+	bool              sweep = false;      // run a Sweeper with rtlsdr_read_sync instead of reading a stream
+	sweep_options_t   sweep_options;
+	uint8_t *         ring = NULL;        // write transfers into a SampleRing over these ring_size bytes instead
+	size_t            ring_size = 0;
+	Nan::Persistent<v8::SharedArrayBuffer> ring_buffer; // the ring's storage, held until the reader is freed
+	size_t            fan_out_slabs = 0;  // fan each transfer out to pipelines through a pool of this many slabs
+	bool              pipeline = false;   // one of a fan-out's pipelines, fed shared slabs instead of librtlsdr buffers
+	bool              shared_slabs = false; // a raw uint8 pipeline, which delivers the shared slabs themselves
 } sample_reader_work_t;
 
 typedef struct sample_buffer {
@@ -17,21 +80,137 @@ typedef struct sample_buffer {
 	uint32_t  len;
 } sample_buffer_t;
 
-class SampleReader : public Nan::AsyncProgressWorkerBase<uint8_t> {
+// One rtlsdr_read_async / rtlsdr_wait_async run, or one sweep, executed on its device's capture thread (see
+// DeviceContext). The capture thread runs each transfer through the stages work asks for and queues the results;
+// the main thread delivers them to the listener, then frees the reader after 'done' or 'error'.
+class SampleReader {
 public:
 	static void RTLSDRAsyncCallback(uint8_t * buf, uint32_t len, void * ctx);
 
-	SampleReader(Nan::Callback * listener, sample_reader_work_t * work)
-		: Nan::AsyncProgressWorkerBase<uint8_t>(listener), work(work) {}
-	~SampleReader() {}
+	// a fan-out, whose work has fan_out_slabs, takes no listener and feeds pipelines, each made with work->pipeline
+	SampleReader(Nan::Callback * listener, sample_reader_work_t * work,
+	             const std::vector<SampleReader *> & pipelines = std::vector<SampleReader *>());
+
+	// capture thread
+	void Execute(void);
+	void Abort(const char * msg);
+	void Finish(void);
+
+	// any thread: stop the read at the next transfer; if release is true, also unblock a producer stalled on a
+	// full queue and discard whatever arrives afterwards
+	void Cancel(bool release);
+
+	// any thread: the active DC / I/Q correction, or false if this read does not correct samples
+	bool Correction(iq_correction_estimates_t * out);
+
+	// any thread: capture pre_ms before the next transfer to post_ms after it; returns the snapshot's id, 0 if too
+	// many snapshots are pending, or -1 if this read keeps no history
+	int Snapshot(double pre_ms, double post_ms);
+
+	// any thread: the active recording's statistics, or false if this read does not record
+	bool RecordStats(recorder_stats_t * out);
+
+	// main thread: deliver again after the listener paused, and drain what has queued meanwhile
+	void Resume(void);
+
+	// main thread: the DeviceContext to tell when this reader completes, or NULL
+	void SetOwner(DeviceContext * owner) { this->owner = owner; }
+
+	// whether this reader sweeps with rtlsdr_read_sync rather than streaming with rtlsdr_read_async, so that
+	// rtlsdr_cancel_async does not apply to it
+	bool Sweeping(void) const { return this->sweeper != NULL; }
 
-	void Execute(const ExecutionProgress & progress);
-	void HandleProgressCallback(const uint8_t * buf, size_t len);
-	void HandleOKCallback(void);
-	void HandleErrorCallback(void);
+	// main thread: the free callback of a Buffer over a pool slab, whose hint is the slab's lease generation
+	static void FreePooledBuffer(char * data, void * hint);
 
 private:
+	~SampleReader();
+
+	static NAUV_WORK_CB(AsyncDeliver);
+	static void AsyncClose(uv_handle_t * handle);
+
+	// DC / I/Q correction, resampling, and channelizing, power spectra, or demodulation, then conversion to
+	// work->format into BufferPool slabs sized from buf_num/buf_len
+	void Process(const uint8_t * buf, uint32_t len);
+	void SkipOutput(uint64_t samples);
+
+	// squelch: queue only a transfer's open segments, waking the main thread only for those, with their edges for
+	// 'squelch-open' / 'squelch-close'
+	bool Gate(const uint8_t * buf, uint32_t len);
+
+	// history: record into a BurstCapture ring, and queue each triggered capture as one 'capture' block
+	bool Capture(const uint8_t * buf, uint32_t len);
+
+	void Consume(const uint8_t * buf, uint32_t len);
+
+	// fan-out: copy each transfer once into a slab shared by the pipelines, each a reader with its own listener,
+	// stages, queue, and drop policy; a pipeline with stages runs them on a thread of its own (RunPipeline), and a
+	// raw uint8 one queues the slabs themselves, so none can hold up the capture or the others
+	void Fan(const uint8_t * buf, uint32_t len);
+	void RunPipeline(void);
+	void StopPipelines(void);
+
+	// record: hand every transfer to a Recorder's writer thread; only 'done' or 'error' are delivered
+	void Record(const uint8_t * buf, uint32_t len);
+
+	// ring: write every transfer, converted and stamped, into a SampleRing over a SharedArrayBuffer; the main
+	// thread's only part is to Notify the ring's consumers once per wakeup, since a native thread cannot wake a V8
+	// Atomics.wait
+	void Share(const uint8_t * buf, uint32_t len);
+	void Notify(void);
+
+	// sweep: retune with rtlsdr_read_sync and queue each completed row for a 'sweep' event
+	void Sweep(void);
+
+	// main thread: emit queued blocks as payloads (external Buffers over pool slabs, or views of them, that go back
+	// to the pool when collected or passed to release_buffer), each followed by the one timing Float64Array, then
+	// report overflow. A listener that returns false pauses delivery until Resume; blocks then wait in the queue,
+	// where the overflow policy stalls or drops natively once it is full, so a slow consumer never grows the JS heap.
+	bool Deliver(void);
+	void EmitEdge(const char * event, uint64_t offset);
+	v8::Local<v8::Object> View(v8::Local<v8::Object> buffer, uint32_t len);
+	v8::Local<v8::Value> Timing(const sample_block_t & block);
+	void Complete(void);
+
+	AddonEnv * const       env;
+	Nan::Callback *        callback;
 	sample_reader_work_t * work;
+	Resampler *            resampler;   // before pool, which is sized from these
+	Channelizer *          channelizer;
+	SpectrumAnalyzer *     spectrum;
+	std::vector<Demodulator *> demods;
+	EnergySquelch *        squelch;
+	BurstCapture *         capture;
+	Recorder *             recorder;
+	Sweeper *              sweeper;
+	SampleRing *           ring;
+	BufferPool *           pool;
+	SampleQueue            queue;
+	IqCorrector *          corrector = NULL;
+	std::vector<float>     scratch; // capture thread only
+	uint64_t               next_sample = 0; // capture thread: complex samples since the read began
+	uint64_t               output_sample = 0; // capture thread: complex samples the float stages have put out, per
+	                                          // channel when channelized
+	std::vector<uint64_t>  audio_sample; // capture thread: per receiver, audio samples put out
+	Nan::Persistent<v8::Float64Array> timing; // main thread
+	double *               timing_data;
+	Nan::Callback *        notify = NULL; // main thread: Atomics.notify (Atomics.wake before Node.js 11), for a ring
+	Nan::Persistent<v8::Int32Array> ring_header; // main thread
+	uv_async_t *           async;
+	uint64_t               dropped_reported = 0;
+	DeviceContext *        owner = NULL;      // main thread
+	bool                   paused = false;    // main thread: the listener asked for no more payloads for now
+	bool                   gate_open = false; // main thread: the squelch state JS has been told about
+	uint64_t               gate_end = 0;      // main thread: offset just past the last delivered squelched block
+	std::vector<SampleReader *> pipelines; // a fan-out's, which it finishes when it completes
+	std::vector<std::thread> pipeline_threads; // capture thread
+	SampleQueue *          input = NULL;  // a pipeline's shared slabs, waiting for its thread
+	bool                   stopped = false; // pipeline thread: a failed recording takes no more transfers
+	std::atomic<bool>      cancelled;
+	std::string            error;
+
+	std::mutex             finish_mutex;
+	bool                   finished = false;
 };
 
 #endif
@@ -0,0 +1,69 @@
+#include <cstring>
+#include "sample_ring.h"
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "the header's counters must be plain int32s");
+
+SampleRing::SampleRing(uint8_t * memory, size_t size, sample_format_t format)
+	: memory(memory), records(memory + SAMPLE_RING_HEADER_BYTES),
+	  capacity((uint32_t) (size - SAMPLE_RING_HEADER_BYTES)), format(format) {
+	memset(memory, 0, SAMPLE_RING_HEADER_BYTES);
+
+	this->Field(SAMPLE_RING_FORMAT).store((int32_t) format, std::memory_order_relaxed);
+	this->Field(SAMPLE_RING_CAPACITY).store((int32_t) this->capacity, std::memory_order_relaxed);
+	this->Field(SAMPLE_RING_STATE).store(SAMPLE_RING_STATE_RUNNING, std::memory_order_release);
+}
+
+/* static */ bool SampleRing::Fits(size_t size, size_t record_bytes) {
+	if(size < SAMPLE_RING_HEADER_BYTES) return false;
+
+	const size_t capacity = size - SAMPLE_RING_HEADER_BYTES;
+	if(capacity < SAMPLE_RING_MIN_CAPACITY || capacity > SAMPLE_RING_MAX_CAPACITY) return false;
+	if((capacity & (capacity - 1)) != 0) return false;
+
+	// an empty ring must take any record wherever the last one ended, padding and all
+	return capacity >= 2 * record_bytes;
+}
+
+/* static */ size_t SampleRing::RecordBytes(size_t len, sample_format_t format) {
+	const size_t payload = len * sample_format_size(format);
+	return SAMPLE_RING_RECORD_BYTES + (payload + SAMPLE_RING_RECORD_BYTES - 1) / SAMPLE_RING_RECORD_BYTES
+	                                  * SAMPLE_RING_RECORD_BYTES;
+}
+
+bool SampleRing::Write(const uint8_t * buf, uint32_t len, uint64_t index, double monotonic_ms, double realtime_ms) {
+	const uint32_t need = (uint32_t) SampleRing::RecordBytes(len, this->format);
+
+	// only this thread moves the write counter; the read counter is acquired so the consumer's reads of the space
+	// it released are over before it is written again
+	const uint32_t write = (uint32_t) this->Field(SAMPLE_RING_WRITE).load(std::memory_order_relaxed);
+	const uint32_t read = (uint32_t) this->Field(SAMPLE_RING_READ).load(std::memory_order_acquire);
+
+	const uint32_t at = write & (this->capacity - 1);
+	const uint32_t to_end = this->capacity - at;
+	const uint32_t padding = to_end < need ? to_end : 0;
+
+	if(this->capacity - (write - read) < padding + need) {
+		this->Field(SAMPLE_RING_DROPPED).fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	uint8_t * record = this->records + at;
+	if(padding > 0) {
+		*(int32_t *) record = SAMPLE_RING_PADDING;
+		record = this->records;
+	}
+
+	const double timing[] = {(double) index, monotonic_ms, realtime_ms};
+	((int32_t *) record)[0] = (int32_t) (len * sample_format_size(this->format));
+	((int32_t *) record)[1] = 0;
+	memcpy(record + 2 * sizeof(int32_t), timing, sizeof(timing));
+	convert_samples(this->format, buf, len, record + SAMPLE_RING_RECORD_BYTES);
+
+	this->Field(SAMPLE_RING_WRITE).store((int32_t) (write + padding + need), std::memory_order_release);
+	return true;
+}
+
+void SampleRing::Finish(bool failed) {
+	this->Field(SAMPLE_RING_STATE).store(failed ? SAMPLE_RING_STATE_ERROR : SAMPLE_RING_STATE_DONE,
+	                                     std::memory_order_release);
+}
@@ -0,0 +1,67 @@
+#ifndef JS_RTLSDR_SAMPLE_RING_GRAB_H
+#define JS_RTLSDR_SAMPLE_RING_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#include "convert.h"
+
+// the header's int32 fields, as indices into an Int32Array over it; lib/api/ring.js reads the same layout
+#define SAMPLE_RING_WRITE    (0)  // bytes committed by the producer, modulo 2^32; consumers Atomics.wait on it
+#define SAMPLE_RING_READ     (16) // bytes released by the consumer, modulo 2^32, on a cache line of its own
+#define SAMPLE_RING_STATE    (32) // a SAMPLE_RING_STATE_*
+#define SAMPLE_RING_FORMAT   (33) // the sample_format_t of every payload
+#define SAMPLE_RING_CAPACITY (34) // bytes of records after the header
+#define SAMPLE_RING_DROPPED  (35) // transfers dropped because the ring was full, modulo 2^32
+
+#define SAMPLE_RING_STATE_RUNNING (0)
+#define SAMPLE_RING_STATE_DONE    (1)
+#define SAMPLE_RING_STATE_ERROR   (2)
+
+#define SAMPLE_RING_HEADER_BYTES (256)
+#define SAMPLE_RING_MIN_CAPACITY (4096)
+#define SAMPLE_RING_MAX_CAPACITY (1 << 30)
+
+// every record starts with: int32 payload bytes (SAMPLE_RING_PADDING: skip to the end of the ring), int32 unused,
+// then float64 index, monotonic, and realtime, as in SampleReader's timing array; records are padded to this size
+#define SAMPLE_RING_RECORD_BYTES (32)
+#define SAMPLE_RING_PADDING      (-1)
+
+// A single-producer, single-consumer ring of sample records in memory the caller owns, such as a SharedArrayBuffer
+// that consumers in other threads read with Atomics. The producer, a capture thread, writes each transfer as one
+// record, converted to the ring's format, and publishes it by advancing the write counter with release semantics;
+// the consumer advances the read counter the same way once it is done with a record. Neither ever waits for the
+// other: a transfer that does not fit is dropped whole and counted. Each counter runs modulo 2^32 over a capacity
+// that is a power of two, and a record that would straddle the end is preceded by a padding record instead.
+class SampleRing {
+public:
+	// lay out an empty, running ring over size bytes at memory, which must be 8-byte aligned and Fits
+	SampleRing(uint8_t * memory, size_t size, sample_format_t format);
+
+	// whether size bytes hold the header and a power-of-two capacity with room for two records of record_bytes
+	static bool Fits(size_t size, size_t record_bytes);
+
+	// the bytes a record of len bytes of uint8 I/Q takes once converted to format, header and padding included
+	static size_t RecordBytes(size_t len, sample_format_t format);
+
+	// producer: append a record of len bytes of uint8 I/Q, converted, whose first complex sample is index; false if
+	// it was dropped for want of room
+	bool Write(const uint8_t * buf, uint32_t len, uint64_t index, double monotonic_ms, double realtime_ms);
+
+	// producer, or any thread once the producer is done: no more records will come
+	void Finish(bool failed);
+
+	uint32_t Dropped(void) const { return (uint32_t) this->Field(SAMPLE_RING_DROPPED).load(std::memory_order_relaxed); }
+	uint32_t Capacity(void) const { return this->capacity; }
+
+private:
+	std::atomic<int32_t> & Field(size_t index) const { return ((std::atomic<int32_t> *) this->memory)[index]; }
+
+	uint8_t * const         memory;
+	uint8_t * const         records;
+	const uint32_t          capacity;
+	const sample_format_t   format;
+};
+
+#endif
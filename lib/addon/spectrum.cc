@@ -0,0 +1,115 @@
+#include <cmath>
+#include <cstring>
+#include "spectrum.h"
+
+#define SPECTRUM_POWER_FLOOR (1e-20f) // -200 dB, so an all-zero bin stays finite
+
+bool parse_spectrum_window(const char * name, spectrum_window_t * window) {
+	if(0 == strcmp(name, "rectangular"))          *window = SPECTRUM_WINDOW_RECTANGULAR;
+	else if(0 == strcmp(name, "hann"))            *window = SPECTRUM_WINDOW_HANN;
+	else if(0 == strcmp(name, "hamming"))         *window = SPECTRUM_WINDOW_HAMMING;
+	else if(0 == strcmp(name, "blackman"))        *window = SPECTRUM_WINDOW_BLACKMAN;
+	else if(0 == strcmp(name, "blackman-harris")) *window = SPECTRUM_WINDOW_BLACKMAN_HARRIS;
+	else return false;
+
+	return true;
+}
+
+const char * spectrum_window_name(spectrum_window_t window) {
+	switch(window) {
+		case SPECTRUM_WINDOW_HANN:            return "hann";
+		case SPECTRUM_WINDOW_HAMMING:         return "hamming";
+		case SPECTRUM_WINDOW_BLACKMAN:        return "blackman";
+		case SPECTRUM_WINDOW_BLACKMAN_HARRIS: return "blackman-harris";
+		default:                              return "rectangular";
+	}
+}
+
+std::vector<float> spectrum_window_coefficients(spectrum_window_t window, size_t size) {
+	// generalized cosine windows: sum over j of (-1)^j * a[j] * cos(2 pi j n / size)
+	static const double terms[][4] = {
+		{1.0, 0, 0, 0},
+		{0.5, 0.5, 0, 0},
+		{0.54, 0.46, 0, 0},
+		{0.42, 0.5, 0.08, 0},
+		{0.35875, 0.48829, 0.14128, 0.01168}
+	};
+
+	const double * a = terms[window];
+	std::vector<float> out(size);
+
+	for(size_t n = 0; n < size; n++) {
+		const double x = 2 * M_PI * n / size;
+		out[n] = (float) (a[0] - a[1] * cos(x) + a[2] * cos(2 * x) - a[3] * cos(3 * x));
+	}
+
+	return out;
+}
+
+static size_t hop_for(size_t size, double overlap) {
+	const size_t overlapped = (size_t) (overlap * size);
+	return overlapped < size ? size - overlapped : 1;
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(size_t size, spectrum_window_t window, double overlap, unsigned averages)
+	: size(size), hop(hop_for(size, overlap)), averages(averages), plan(FftPlan::Get(size)),
+	  window(2 * size), frame(2 * size), power(size, 0.0f) {
+	const std::vector<float> coefficients = spectrum_window_coefficients(window, size);
+	double sum = 0;
+
+	for(size_t n = 0; n < size; n++) {
+		this->window[2 * n] = this->window[2 * n + 1] = coefficients[n];
+		sum += coefficients[n];
+	}
+
+	this->scale = (float) (1.0 / (averages * sum * sum));
+}
+
+size_t SpectrumAnalyzer::Process(const float * iq, size_t len) {
+	this->rows.clear();
+	this->pending.insert(this->pending.end(), iq, iq + 2 * (len / 2));
+
+	const size_t available = this->pending.size() / 2;
+	size_t start = 0;
+
+	for(; start + this->size <= available; start += this->hop) this->Frame(&this->pending[2 * start]);
+
+	// keep the overlapped tail for the next call
+	this->pending.erase(this->pending.begin(), this->pending.begin() + 2 * start);
+
+	return this->rows.size() / this->size;
+}
+
+// window, transform, and accumulate one frame; emit a row once enough have accumulated
+void SpectrumAnalyzer::Frame(const float * iq) {
+	float * x = this->frame.data();
+	const float * w = this->window.data();
+	const size_t len = 2 * this->size;
+
+	for(size_t i = 0; i < len; i++) x[i] = iq[i] * w[i];
+	this->plan->Forward(x);
+
+	float * p = this->power.data();
+	for(size_t k = 0; k < this->size; k++) p[k] += x[2 * k] * x[2 * k] + x[2 * k + 1] * x[2 * k + 1];
+
+	if(++this->frames < this->averages) return;
+	this->frames = 0;
+
+	// rotate by half so that the negative frequencies come first
+	const size_t half = this->size / 2;
+	const size_t start = this->rows.size();
+	this->rows.resize(start + this->size);
+	float * row = &this->rows[start];
+
+	for(size_t k = 0; k < this->size; k++) {
+		const float mean = p[(k + half) % this->size] * this->scale;
+		row[k] = 10.0f * log10f(mean > SPECTRUM_POWER_FLOOR ? mean : SPECTRUM_POWER_FLOOR);
+	}
+
+	memset(p, 0, this->size * sizeof(float));
+}
+
+size_t SpectrumAnalyzer::MaxRows(size_t len) const {
+	const size_t frames = (len / 2 + this->size) / this->hop + 1;
+	return frames / this->averages + 1;
+}
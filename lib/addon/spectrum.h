@@ -0,0 +1,65 @@
+#ifndef JS_RTLSDR_SPECTRUM_GRAB_H
+#define JS_RTLSDR_SPECTRUM_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+#include "fft.h"
+
+#define SPECTRUM_MAX_AVERAGES (65536)
+
+typedef enum spectrum_window {
+	SPECTRUM_WINDOW_RECTANGULAR = 0,
+	SPECTRUM_WINDOW_HANN,
+	SPECTRUM_WINDOW_HAMMING,
+	SPECTRUM_WINDOW_BLACKMAN,
+	SPECTRUM_WINDOW_BLACKMAN_HARRIS
+} spectrum_window_t;
+
+bool parse_spectrum_window(const char * name, spectrum_window_t * window);
+const char * spectrum_window_name(spectrum_window_t window);
+
+// the size window coefficients, symmetric about size / 2
+std::vector<float> spectrum_window_coefficients(spectrum_window_t window, size_t size);
+
+// Averaged power spectra of interleaved complex float samples. Frames of `size` samples start every
+// size * (1 - overlap) samples; each is windowed and transformed, and every `averages` frames the mean power of each
+// bin becomes one row of dB values. Rows run from -rate / 2 to just under +rate / 2 (the DC bin is row[size / 2]),
+// and a full-scale complex tone centered on a bin reads 0 dB.
+class SpectrumAnalyzer {
+public:
+	// size must satisfy FftPlan::ValidSize, overlap must be in [0, 1), and averages must be at least 1
+	SpectrumAnalyzer(size_t size, spectrum_window_t window, double overlap, unsigned averages);
+
+	// analyze len interleaved floats; returns how many rows were completed, available from Row until the next call
+	size_t Process(const float * iq, size_t len);
+
+	const float * Row(size_t i) const { return &this->rows[i * this->size]; }
+
+	// the most rows Process can complete for len floats of input
+	size_t MaxRows(size_t len) const;
+
+	size_t Size(void) const { return this->size; }
+	size_t Hop(void) const { return this->hop; }
+	unsigned Averages(void) const { return this->averages; }
+
+private:
+	void Frame(const float * iq);
+
+	const size_t size;
+	const size_t hop;           // samples between frame starts
+	const unsigned averages;
+	std::shared_ptr<const FftPlan> plan;
+	std::vector<float> window;  // 2 * size: each coefficient once per I and Q lane
+	float scale;                // 1 / (averages * (sum of the window)^2)
+
+	std::vector<float> pending; // input the next frame starts at, and everything after it
+	std::vector<float> frame;
+	std::vector<float> power;   // running sum over this row's frames
+	unsigned frames = 0;
+	std::vector<float> rows;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "stream_aligner.h"
+
+StreamAligner::StreamAligner(size_t streams, const stream_aligner_options_t & opts)
+	: streams(streams), block(opts.block), rate(opts.rate), by_time(opts.by_time), max_backlog(opts.max_backlog) {
+	for(size_t i = 0; i < streams && i < opts.offsets.size(); i++) this->streams[i].lead = opts.offsets[i];
+
+	if(!this->by_time) {
+		for(size_t i = 0; i < streams; i++) this->streams[i].skip = 2 * this->streams[i].lead;
+		this->aligned = true;
+	}
+}
+
+bool StreamAligner::Push(size_t index, const uint8_t * buf, uint32_t len, int64_t arrival_ns) {
+	stream_t & stream = this->streams[index];
+
+	if(!stream.started) {
+		// the transfer's first sample was taken a transfer's worth of samples before it arrived
+		stream.start_ns = arrival_ns;
+		if(this->rate > 0) stream.start_ns -= (int64_t) llround(len / 2 / this->rate * 1e9);
+
+		stream.started = true;
+		this->started++;
+	}
+
+	if(stream.skip > 0 && this->aligned) {
+		const uint32_t skipped = (uint32_t) std::min<uint64_t>(stream.skip, len);
+		buf += skipped;
+		len -= skipped;
+		stream.skip -= skipped;
+	}
+
+	stream.staged.insert(stream.staged.end(), buf, buf + len);
+	if(!this->aligned && this->started == this->streams.size()) this->Align();
+
+	if(this->max_backlog == 0 || this->Available(stream) <= 2 * this->max_backlog) return true;
+
+	// the stream with the least staged is the one the rest are waiting for
+	this->lagging = 0;
+	for(size_t i = 1; i < this->streams.size(); i++)
+		if(this->Available(this->streams[i]) < this->Available(this->streams[this->lagging])) this->lagging = i;
+
+	return false;
+}
+
+bool StreamAligner::Pop(uint8_t * out, uint64_t * index) {
+	if(!this->aligned) return false;
+
+	const size_t bytes = this->BlockBytes();
+	for(size_t i = 0; i < this->streams.size(); i++)
+		if(this->streams[i].skip > 0 || this->Available(this->streams[i]) < bytes) return false;
+
+	for(size_t i = 0; i < this->streams.size(); i++) {
+		stream_t & stream = this->streams[i];
+		memcpy(out + i * bytes, stream.staged.data() + stream.head, bytes);
+		stream.head += bytes;
+
+		// compact once the consumed part outweighs what is left, so staging stays amortized O(1) per byte
+		if(stream.head >= stream.staged.size() - stream.head) {
+			stream.staged.erase(stream.staged.begin(), stream.staged.begin() + stream.head);
+			stream.head = 0;
+		}
+	}
+
+	*index = this->next_index;
+	this->next_index += this->block;
+	return true;
+}
+
+// every stream has started: skip each up to the moment the last one started, plus its offset
+void StreamAligner::Align() {
+	int64_t origin = this->streams[0].start_ns;
+	for(size_t i = 1; i < this->streams.size(); i++) origin = std::max(origin, this->streams[i].start_ns);
+
+	for(size_t i = 0; i < this->streams.size(); i++) {
+		stream_t & stream = this->streams[i];
+		stream.lead += (uint64_t) llround((origin - stream.start_ns) * this->rate / 1e9);
+		stream.skip = 2 * stream.lead;
+		this->Skip(stream);
+	}
+
+	this->aligned = true;
+}
+
+void StreamAligner::Skip(stream_t & stream) {
+	const size_t skipped = (size_t) std::min<uint64_t>(stream.skip, this->Available(stream));
+	stream.head += skipped;
+	stream.skip -= skipped;
+}
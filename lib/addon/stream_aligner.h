@@ -0,0 +1,66 @@
+#ifndef JS_RTLSDR_STREAM_ALIGNER_GRAB_H
+#define JS_RTLSDR_STREAM_ALIGNER_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+typedef struct stream_aligner_options {
+	uint32_t block = 0;      // complex samples per stream in each matched block
+	double   rate = 0;       // the streams' common sample rate, for aligning by arrival time
+	bool     by_time = true; // align the streams' starts by the arrival of their first transfers
+	std::vector<uint64_t> offsets; // further complex samples to skip at the start of each stream; empty for none
+	uint64_t max_backlog = 0; // complex samples a stream may hold while waiting for the others; 0 for no limit
+} stream_aligner_options_t;
+
+// Lines up several streams of offset-binary uint8 I/Q, sampled on one clock but started at different moments, and
+// cuts them into matched blocks: the n-th block holds the same `block` complex samples of every stream, from group
+// sample n * block on. Stream i's group sample 0 is its own sample Lead(i). Aligning by time, the leads are worked
+// out once every stream has delivered its first transfer: the stream whose first sample arrived last starts the
+// group, and every other stream skips the samples it took before then. The offsets are added on top, to apply a
+// finer calibration (e.g. from cross-correlating a common reference). Each stream's samples are staged until the
+// others catch up; Push fails once one stream would have to stage more than max_backlog samples.
+class StreamAligner {
+public:
+	StreamAligner(size_t streams, const stream_aligner_options_t & opts);
+
+	// append the next transfer of stream `index`, which arrived at arrival_ns (StreamStats::Now()); false if that
+	// leaves the stream too far ahead of the others, with the stream holding them up in Lagging()
+	bool Push(size_t index, const uint8_t * buf, uint32_t len, int64_t arrival_ns);
+
+	// move the next matched block into out, Streams() * BlockBytes() bytes of it, stream by stream, and its first
+	// group sample into index; false if some stream has not got that far yet
+	bool Pop(uint8_t * out, uint64_t * index);
+
+	bool Aligned(void) const { return this->aligned; }
+	uint64_t Lead(size_t stream) const { return this->streams[stream].lead; }
+	size_t Lagging(void) const { return this->lagging; }
+	size_t Streams(void) const { return this->streams.size(); }
+	uint32_t BlockBytes(void) const { return 2 * this->block; }
+
+private:
+	typedef struct stream {
+		std::vector<uint8_t> staged;
+		size_t   head = 0;        // bytes of staged already taken
+		uint64_t skip = 0;        // bytes still to skip before the stream's group sample 0
+		uint64_t lead = 0;        // complex samples skipped in all
+		int64_t  start_ns = 0;    // when the stream's first sample was taken, by its first transfer's arrival
+		bool     started = false;
+	} stream_t;
+
+	void Align(void);
+	void Skip(stream_t & stream);
+	size_t Available(const stream_t & stream) const { return stream.staged.size() - stream.head; }
+
+	std::vector<stream_t> streams;
+	const uint32_t block;
+	const double   rate;
+	const bool     by_time;
+	const uint64_t max_backlog;
+	bool     aligned = false;
+	size_t   started = 0;
+	size_t   lagging = 0;
+	uint64_t next_index = 0;
+};
+
+#endif
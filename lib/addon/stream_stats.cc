@@ -0,0 +1,144 @@
+#include <cmath>
+#include <cstring>
+#include "stream_stats.h"
+
+#define SUB_COUNT ((uint64_t) 1 << STREAM_STATS_SUB_BITS)
+
+StreamStats::StreamStats() {
+	this->Begin();
+	this->Reset();
+}
+
+void StreamStats::Begin() {
+	this->capture.first_ns.store(0, std::memory_order_relaxed);
+	this->capture.last_ns.store(0, std::memory_order_relaxed);
+	this->capture.last_wall_ns.store(0, std::memory_order_relaxed);
+	this->capture.read_bytes.store(0, std::memory_order_relaxed);
+}
+
+void StreamStats::Transfer(uint32_t len) {
+	this->Transfer(len, StreamStats::Now(), StreamStats::WallNow());
+}
+
+void StreamStats::Transfer(uint32_t len, int64_t arrival_ns, int64_t wall_ns) {
+	this->capture.transfers.fetch_add(1, std::memory_order_relaxed);
+	this->capture.bytes.fetch_add(len, std::memory_order_relaxed);
+
+	// the first transfer's samples were taken before the read's clock starts, so only later ones count toward rate
+	if(this->capture.first_ns.load(std::memory_order_relaxed) == 0)
+		this->capture.first_ns.store(arrival_ns, std::memory_order_relaxed);
+	else
+		this->capture.read_bytes.fetch_add(len, std::memory_order_relaxed);
+
+	this->capture.last_ns.store(arrival_ns, std::memory_order_relaxed);
+	this->capture.last_wall_ns.store(wall_ns, std::memory_order_relaxed);
+}
+
+// the capture thread is the only writer, so a plain compare and store is enough
+void StreamStats::Depth(size_t depth) {
+	if(depth > this->capture.depth_max.load(std::memory_order_relaxed))
+		this->capture.depth_max.store(depth, std::memory_order_relaxed);
+}
+
+void StreamStats::Drained(uint64_t blocks) {
+	if(blocks == 0) return;
+
+	this->main.wakeups++;
+	this->main.coalesced += blocks - 1;
+}
+
+void StreamStats::Delivered(int64_t arrival_ns) {
+	this->main.delivered++;
+
+	// blocks that did not come from a streamed transfer (sweep rows) have no arrival time
+	if(arrival_ns <= 0) return;
+
+	const int64_t elapsed_ns = StreamStats::Now() - arrival_ns;
+	const uint64_t us = elapsed_ns > 0 ? (uint64_t) elapsed_ns / 1000 : 0;
+
+	this->main.buckets[StreamStats::Bucket(us)]++;
+	this->main.count++;
+	this->main.sum_us += us;
+	if(us < this->main.min_us) this->main.min_us = us;
+	if(us > this->main.max_us) this->main.max_us = us;
+}
+
+void StreamStats::Snapshot(stream_stats_snapshot_t * out) const {
+	out->transfers = this->capture.transfers.load(std::memory_order_relaxed);
+	out->bytes = this->capture.bytes.load(std::memory_order_relaxed);
+	out->dropped = this->capture.dropped.load(std::memory_order_relaxed);
+	out->depth_max = (size_t) this->capture.depth_max.load(std::memory_order_relaxed);
+	out->wakeups = this->main.wakeups;
+	out->delivered = this->main.delivered;
+	out->coalesced = this->main.coalesced;
+
+	const int64_t first_ns = this->capture.first_ns.load(std::memory_order_relaxed);
+	const int64_t last_ns = this->capture.last_ns.load(std::memory_order_relaxed);
+	const uint64_t read_bytes = this->capture.read_bytes.load(std::memory_order_relaxed);
+
+	out->rate_ms = last_ns > first_ns ? (last_ns - first_ns) / 1e6 : 0;
+	out->rate = out->rate_ms > 0 ? read_bytes / 2.0 / (out->rate_ms / 1000) : 0;
+
+	stream_latency_t & latency = out->latency;
+	latency = stream_latency_t();
+	latency.count = this->main.count;
+	if(latency.count == 0) return;
+
+	latency.min_ms = this->main.min_us / 1000.0;
+	latency.max_ms = this->main.max_us / 1000.0;
+	latency.mean_ms = (double) this->main.sum_us / latency.count / 1000.0;
+
+	const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+	double * values[] = {&latency.p50_ms, &latency.p90_ms, &latency.p99_ms, &latency.p999_ms};
+	size_t q = 0;
+	uint64_t seen = 0;
+
+	// the smallest bucket holding at least that fraction of the samples, reported as the most it could hold
+	for(size_t b = 0; b < STREAM_STATS_BUCKETS && q < 4; b++) {
+		seen += this->main.buckets[b];
+
+		while(q < 4 && seen >= (uint64_t) std::ceil(quantiles[q] * latency.count)) {
+			uint64_t us = StreamStats::BucketMax(b);
+			if(us > this->main.max_us) us = this->main.max_us;
+			if(us < this->main.min_us) us = this->main.min_us;
+
+			*values[q++] = us / 1000.0;
+		}
+	}
+}
+
+void StreamStats::Reset() {
+	this->capture.transfers.store(0, std::memory_order_relaxed);
+	this->capture.bytes.store(0, std::memory_order_relaxed);
+	this->capture.dropped.store(0, std::memory_order_relaxed);
+	this->capture.depth_max.store(0, std::memory_order_relaxed);
+
+	// the rate is measured from here on, if a read is streaming
+	this->capture.first_ns.store(this->capture.last_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	this->capture.read_bytes.store(0, std::memory_order_relaxed);
+
+	memset(&this->main, 0, sizeof(this->main));
+	this->main.min_us = UINT64_MAX;
+}
+
+// values below SUB_COUNT get a bucket each; above that, each power of two [2^m, 2^(m+1)) is split into SUB_COUNT
+// buckets 2^(m - SUB_BITS) wide
+/* static */ size_t StreamStats::Bucket(uint64_t us) {
+	if(us < SUB_COUNT) return (size_t) us;
+
+	unsigned m = STREAM_STATS_SUB_BITS;
+	while(m + 1 < STREAM_STATS_MAX_BITS && (us >> (m + 1)) != 0) m++;
+
+	if((us >> (m + 1)) != 0) return STREAM_STATS_BUCKETS - 1;
+
+	const unsigned shift = m - STREAM_STATS_SUB_BITS;
+	return (size_t) (SUB_COUNT * (shift + 1) + ((us >> shift) - SUB_COUNT));
+}
+
+/* static */ uint64_t StreamStats::BucketMax(size_t bucket) {
+	if(bucket < SUB_COUNT) return bucket;
+
+	const unsigned shift = (unsigned) (bucket / SUB_COUNT) - 1;
+	const uint64_t sub = SUB_COUNT + bucket % SUB_COUNT;
+	return ((sub + 1) << shift) - 1;
+}
@@ -0,0 +1,122 @@
+#ifndef JS_RTLSDR_STREAM_STATS_GRAB_H
+#define JS_RTLSDR_STREAM_STATS_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+
+#define STREAM_STATS_SUB_BITS  (5)  // 32 buckets per power of two, so a recorded latency is within about 3%
+#define STREAM_STATS_MAX_BITS  (40) // latencies up to 2^40 us (about 12 days); longer ones land in the last bucket
+#define STREAM_STATS_BUCKETS   ((STREAM_STATS_MAX_BITS - STREAM_STATS_SUB_BITS + 1) << STREAM_STATS_SUB_BITS)
+#define STREAM_STATS_LINE_SIZE (64)
+
+typedef struct stream_latency {
+	uint64_t count = 0;
+	double   min_ms = 0;
+	double   mean_ms = 0;
+	double   p50_ms = 0;
+	double   p90_ms = 0;
+	double   p99_ms = 0;
+	double   p999_ms = 0;
+	double   max_ms = 0;
+} stream_latency_t;
+
+typedef struct stream_stats_snapshot {
+	uint64_t transfers = 0;  // transfers librtlsdr handed to the capture thread
+	uint64_t bytes = 0;      // bytes in them
+	uint64_t dropped = 0;    // queued blocks discarded because of overflow
+	size_t   depth_max = 0;  // high-water mark of blocks pending in a read's queue
+	uint64_t wakeups = 0;    // times the main thread drained a read's queue
+	uint64_t delivered = 0;  // blocks handed to JS listeners
+	uint64_t coalesced = 0;  // blocks that shared a wakeup with an earlier one
+	double   rate = 0;       // complex samples per second arriving during the latest read
+	double   rate_ms = 0;    // the span rate was measured over
+	stream_latency_t latency; // from a transfer reaching the capture thread to its block reaching JS
+} stream_stats_snapshot_t;
+
+// Per-device streaming counters. The capture thread and the main thread each write only their own half, on separate
+// cache lines, so neither ever waits on the other: the capture thread's half is relaxed atomics, which a snapshot
+// only loads, and the main thread's half, including an HDR-style histogram of log-linear microsecond latency
+// buckets, is only touched on the main thread. Kept by the DeviceContext and shared with each reader, so that a
+// reader still delivering after its device was closed has somewhere to count.
+class StreamStats {
+public:
+	StreamStats();
+
+	// CLOCK_MONOTONIC nanoseconds (steady_clock)
+	static int64_t Now(void) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// CLOCK_REALTIME nanoseconds since the Unix epoch (system_clock)
+	static int64_t WallNow(void) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	// capture thread: a read is starting; its effective rate is measured from its first transfer
+	void Begin(void);
+
+	// capture thread: a transfer of len bytes arrived; its arrival time is Arrival() and WallArrival() until the
+	// next one
+	void Transfer(uint32_t len);
+
+	// as above, for a transfer that reached the capture thread earlier, at arrival_ns and wall_ns, and is only now
+	// being processed on another thread (a fan-out pipeline's)
+	void Transfer(uint32_t len, int64_t arrival_ns, int64_t wall_ns);
+
+	// capture thread: when the transfer being processed arrived, by Now() and by WallNow(), or 0 outside a
+	// streaming read
+	int64_t Arrival(void) const { return this->capture.last_ns.load(std::memory_order_relaxed); }
+	int64_t WallArrival(void) const { return this->capture.last_wall_ns.load(std::memory_order_relaxed); }
+
+	// capture thread, with the queue's lock held: a block was discarded / the queue holds depth blocks
+	void Dropped(void) { this->capture.dropped.fetch_add(1, std::memory_order_relaxed); }
+	void Depth(size_t depth);
+
+	// main thread: a drain of a read's queue delivered blocks blocks
+	void Drained(uint64_t blocks);
+
+	// main thread: a block that arrived at arrival_ns is being handed to JS
+	void Delivered(int64_t arrival_ns);
+
+	// main thread
+	void Snapshot(stream_stats_snapshot_t * out) const;
+
+	// main thread: start every counter over; a capture-thread update racing it may land on either side
+	void Reset(void);
+
+	// the histogram bucket of a latency in microseconds, and the largest latency a bucket holds
+	static size_t Bucket(uint64_t us);
+	static uint64_t BucketMax(size_t bucket);
+
+private:
+	struct capture_counters {
+		std::atomic<uint64_t> transfers;
+		std::atomic<uint64_t> bytes;
+		std::atomic<uint64_t> dropped;
+		std::atomic<uint64_t> depth_max;
+		std::atomic<int64_t>  first_ns; // the latest read's first transfer
+		std::atomic<int64_t>  last_ns;  // its latest transfer
+		std::atomic<int64_t>  last_wall_ns; // the same, by the wall clock
+		std::atomic<uint64_t> read_bytes; // bytes after its first transfer
+	} capture;
+
+	// keeps the two halves off each other's cache lines without relying on over-aligned allocation
+	char padding[STREAM_STATS_LINE_SIZE];
+
+	struct main_counters {
+		uint64_t wakeups;
+		uint64_t delivered;
+		uint64_t coalesced;
+		uint64_t count;
+		uint64_t sum_us;
+		uint64_t min_us;
+		uint64_t max_us;
+		uint64_t buckets[STREAM_STATS_BUCKETS];
+	} main;
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include <cmath>
+#include <cstdio>
+#include "convert.h"
+#include "device_backend.h"
+#include "sweep.h"
+
+// the smallest FFT that resolves bins of at most bin_width Hz
+static size_t fft_size_for(double bin_width, uint32_t sample_rate) {
+	size_t size = FFT_MIN_SIZE;
+	while(size < FFT_MAX_SIZE && sample_rate / (double) size > bin_width) size *= 2;
+	return size;
+}
+
+// librtlsdr bulk transfers are multiples of 512 bytes
+static size_t transfer_bytes(double ms, uint32_t sample_rate) {
+	const size_t bytes = 2 * (size_t) ceil(ms * sample_rate / 1000);
+	return (bytes + 511) / 512 * 512;
+}
+
+/* static */ bool Sweeper::Valid(const sweep_options_t & opts, uint32_t sample_rate, std::string * err) {
+	if(opts.stop <= opts.start) {
+		*err = "sweep.stop must be above sweep.start";
+		return false;
+	}
+
+	if(!(opts.bin_width >= sample_rate / (double) FFT_MAX_SIZE && opts.bin_width <= sample_rate / (double) FFT_MIN_SIZE)) {
+		*err = "sweep.binWidth must be from 1/65536 to 1/16 of the device's sample rate";
+		return false;
+	}
+
+	const double bins = ceil((opts.stop - opts.start) / (sample_rate / (double) fft_size_for(opts.bin_width, sample_rate)));
+	if(bins > SWEEP_MAX_BINS) {
+		*err = "the sweep would have more than 16777216 bins; narrow it or widen sweep.binWidth";
+		return false;
+	}
+
+	return true;
+}
+
+// FFT frames averaged per dwell
+static unsigned dwell_frames(double dwell_ms, uint32_t sample_rate, size_t fft_size) {
+	const double frames = ceil(dwell_ms * sample_rate / 1000 / fft_size);
+	return frames > 1 ? (unsigned) frames : 1;
+}
+
+Sweeper::Sweeper(const sweep_options_t & opts, uint32_t sample_rate)
+	: opts(opts), sample_rate(sample_rate), fft_size(fft_size_for(opts.bin_width, sample_rate)),
+	  bin_width(sample_rate / (double) this->fft_size),
+	  spectrum(this->fft_size, opts.window, 0, dwell_frames(opts.dwell_ms, sample_rate, this->fft_size)) {
+	this->crop_offset = (size_t) (this->fft_size * opts.crop / 2);
+	this->bins_per_hop = this->fft_size - 2 * this->crop_offset;
+	this->bins = (size_t) ceil((opts.stop - opts.start) / this->bin_width);
+	this->hops = (this->bins + this->bins_per_hop - 1) / this->bins_per_hop;
+
+	this->settle_bytes = opts.settle_ms > 0 ? transfer_bytes(opts.settle_ms, sample_rate) : 0;
+	this->dwell_bytes = 2 * this->fft_size * this->spectrum.Averages();
+
+	this->raw.resize(this->settle_bytes + (this->dwell_bytes + 511) / 512 * 512);
+	this->iq.resize(this->dwell_bytes);
+}
+
+// the center frequency that puts bin crop_offset of the hop's FFT on its first bin of the row
+uint32_t Sweeper::HopFrequency(size_t hop) const {
+	const double first = this->opts.start + (double) hop * this->bins_per_hop * this->bin_width;
+	return (uint32_t) lrint(first + (double) (this->fft_size / 2 - this->crop_offset) * this->bin_width);
+}
+
+int Sweeper::Sweep(rtlsdr_dev_t * dev, std::mutex & control, const std::atomic<bool> & cancelled, float * row,
+                   std::string * err) {
+	for(size_t hop = 0; hop < this->hops && !cancelled; hop++) {
+		const uint32_t freq = this->HopFrequency(hop);
+
+		int result = backend_set_center_freq(dev, control, freq);
+		if(result != 0) {
+			char msg[80];
+			sprintf(msg, "rtlsdr_set_center_freq returned error code %i at %u Hz", result, freq);
+			*err = msg;
+			return result;
+		}
+
+		result = this->Read(dev, this->raw.size(), cancelled, err);
+		if(result != 0 || cancelled) return result;
+
+		convert_samples(SAMPLE_FORMAT_FLOAT32, &this->raw[this->settle_bytes], this->dwell_bytes, this->iq.data());
+		this->spectrum.Process(this->iq.data(), this->iq.size()); // exactly one row
+
+		const size_t from = hop * this->bins_per_hop;
+		const size_t count = this->bins - from < this->bins_per_hop ? this->bins - from : this->bins_per_hop;
+		const float * bins = this->spectrum.Row(0) + this->crop_offset;
+		for(size_t i = 0; i < count; i++) row[from + i] = bins[i];
+	}
+
+	return 0;
+}
+
+// fill raw[0, len) with rtlsdr_read_sync, a chunk at a time
+int Sweeper::Read(rtlsdr_dev_t * dev, size_t len, const std::atomic<bool> & cancelled, std::string * err) {
+	for(size_t got = 0; got < len && !cancelled;) {
+		const size_t want = len - got < SWEEP_READ_CHUNK ? len - got : SWEEP_READ_CHUNK;
+		int n_read = 0;
+
+		const int result = backend_read_sync(dev, &this->raw[got], (int) want, &n_read);
+		if(result != 0 || n_read <= 0) {
+			char msg[60];
+			sprintf(msg, "rtlsdr_read_sync returned error code %i during a sweep", result);
+			*err = msg;
+			return result != 0 ? result : -1;
+		}
+
+		got += (size_t) n_read;
+	}
+
+	return 0;
+}
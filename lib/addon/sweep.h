@@ -0,0 +1,71 @@
+#ifndef JS_RTLSDR_SWEEP_GRAB_H
+#define JS_RTLSDR_SWEEP_GRAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <rtl-sdr.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "spectrum.h"
+
+#define SWEEP_READ_CHUNK (262144)   // bytes per rtlsdr_read_sync call
+#define SWEEP_MAX_BINS   (16777216)
+
+typedef struct sweep_options {
+	uint32_t          start = 0;         // Hz; the first bin's frequency
+	uint32_t          stop = 0;          // Hz; bins are added until one reaches stop
+	double            bin_width = 0;     // Hz; the FFT is the smallest that resolves at least this finely
+	double            dwell_ms = 100;    // per hop, after settling
+	double            settle_ms = 5;     // samples discarded after each retune while the PLL and filters settle
+	double            crop = 0.25;       // fraction of each hop's bins dropped, half from each edge
+	spectrum_window_t window = SPECTRUM_WINDOW_HANN;
+	uint32_t          sweeps = 0;        // 0 to sweep until cancelled
+} sweep_options_t;
+
+// rtl_power-style wideband scanner. The range is covered by hops of the device's sample rate: each hop retunes
+// with rtlsdr_set_center_freq, discards settle_ms of samples, averages dwell_ms of samples into one power spectrum,
+// and keeps the middle (1 - crop) of its bins, away from the tuner's filter roll-off. The hops' bins are stitched
+// into one row of dB values per sweep, row[n] being the power at start + n * BinWidth().
+class Sweeper {
+public:
+	// sample_rate is the device's; opts must satisfy Sweeper::Valid
+	Sweeper(const sweep_options_t & opts, uint32_t sample_rate);
+
+	// whether opts can be planned at sample_rate; if not, err says why
+	static bool Valid(const sweep_options_t & opts, uint32_t sample_rate, std::string * err);
+
+	// capture thread: run one sweep into row, which must hold Bins() floats, retuning dev under its control mutex.
+	// Returns 0, or a librtlsdr error with a description in err; stops early, returning 0, once cancelled is set.
+	int Sweep(rtlsdr_dev_t * dev, std::mutex & control, const std::atomic<bool> & cancelled, float * row,
+	          std::string * err);
+
+	size_t   FftSize(void) const { return this->fft_size; }
+	double   BinWidth(void) const { return this->bin_width; }
+	size_t   Bins(void) const { return this->bins; }
+	size_t   Hops(void) const { return this->hops; }
+	size_t   BinsPerHop(void) const { return this->bins_per_hop; }
+	uint32_t HopFrequency(size_t hop) const;
+
+private:
+	int Read(rtlsdr_dev_t * dev, size_t len, const std::atomic<bool> & cancelled, std::string * err);
+
+	const sweep_options_t opts;
+	const uint32_t sample_rate;
+	size_t fft_size = FFT_MIN_SIZE;
+	double bin_width;
+	size_t bins;
+	size_t bins_per_hop;
+	size_t crop_offset;        // bins dropped from the low edge of each hop
+	size_t hops;
+	size_t settle_bytes;
+	size_t dwell_bytes;
+
+	SpectrumAnalyzer spectrum; // one row per dwell
+	std::vector<uint8_t> raw;  // one hop of samples, settling included
+	std::vector<float> iq;
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <nan.h>
 #include <rtl-sdr.h>
 
+#include "device_context.h"
 #include "sample_reader.h"
 
 using v8::Local;
@@ -28,15 +29,32 @@ using v8::Object;
 	errmsg += std::to_string(err); \
 	return Nan::ThrowError(errmsg.c_str()); }
 
+#define JS_RTLSDR_CHECK_ACCEPTING(ctx) if(!ctx->Accepting()) \
+	return Nan::ThrowError("a read is already in progress on this device (cancel it first)");
+
 #define JS_RTLSDR_RETURN(thing) info.GetReturnValue().Set(thing)
 
+// DeviceHandle internal fields
+#define JS_RTLSDR_HANDLE_FIELD_DEV (0) // rtlsdr_dev_t *
+#define JS_RTLSDR_HANDLE_FIELD_CTX (1) // DeviceContext *
+#define JS_RTLSDR_HANDLE_FIELD_COUNT (2)
+
 rtlsdr_dev_t * get_dev(Local<Value> dev_hnd_val) {
 	if(!dev_hnd_val->IsObject()) return NULL;
 
 	Local<Object> dev_hnd = Nan::To<Object>(dev_hnd_val).ToLocalChecked();
-	if(dev_hnd->InternalFieldCount() != 1) return NULL;
+	if(dev_hnd->InternalFieldCount() != JS_RTLSDR_HANDLE_FIELD_COUNT) return NULL;
+
+	return (rtlsdr_dev_t *) Nan::GetInternalFieldPointer(dev_hnd, JS_RTLSDR_HANDLE_FIELD_DEV);
+}
+
+DeviceContext * get_dev_ctx(Local<Value> dev_hnd_val) {
+	if(!dev_hnd_val->IsObject()) return NULL;
+
+	Local<Object> dev_hnd = Nan::To<Object>(dev_hnd_val).ToLocalChecked();
+	if(dev_hnd->InternalFieldCount() != JS_RTLSDR_HANDLE_FIELD_COUNT) return NULL;
 
-	return (rtlsdr_dev_t *) Nan::GetInternalFieldPointer(dev_hnd, 0);
+	return (DeviceContext *) Nan::GetInternalFieldPointer(dev_hnd, JS_RTLSDR_HANDLE_FIELD_CTX);
 }
 
 #endif
@@ -0,0 +1,68 @@
+const librtlsdr = require('../addon/');
+const EventEmitter = require('events');
+
+/**
+ * One read of a device shared by several independently configured pipelines (see {@link RTLSDR#fanOut}). The
+ * capture thread copies each transfer once, into a slab of a native pool that every pipeline holds a reference to;
+ * each pipeline has its own processing, queue, overflow policy, and listeners, on
+ * {@link RTLSDR.FanOut#pipelines}, and the slab returns to the pool once the last of them is done with it.
+ * @extends EventEmitter
+ * @emits RTLSDR.FanOut~done
+ */
+class FanOut extends EventEmitter {
+	constructor(device, bufNum, bufLen, pipelines) {
+		super();
+
+		device.assertOpen();
+		if (!Array.isArray(pipelines)) throw new TypeError('pipelines must be an array of objects');
+
+		this.device = device;
+		this.running = pipelines.length;
+
+		/**
+		 * Per pipeline, in the order given, the emitter of its events: those of {@link RTLSDR#read}, with the
+		 * pipeline's own options, ending in its own {@link RTLSDR~event:done} or {@link RTLSDR~event:error}.
+		 * @type {EventEmitter[]}
+		 */
+		this.pipelines = pipelines.map(() => new EventEmitter());
+
+		const listeners = this.pipelines.map(pipeline => (ev, arg, timing) => {
+			pipeline.emit(ev, arg, timing);
+			if (ev === 'done' || ev === 'error') this.finishedOne();
+		});
+
+		librtlsdr.reset_buffer(device.device);
+		librtlsdr.fan_out(device.device, listeners, bufNum, bufLen, pipelines);
+	}
+
+	/** @private */
+	finishedOne() {
+		this.running -= 1;
+		if (this.running === 0) this.emit('done');
+	}
+
+	/**
+	 * Every pipeline has emitted its final `done` or `error` event.
+	 * @event RTLSDR.FanOut~done
+	 */
+
+	/**
+	 * Whether every pipeline has emitted its final `done` or `error` event.
+	 * @return {Boolean} `true` iff the fan-out has finished
+	 */
+	isFinished() {
+		return this.running === 0;
+	}
+
+	/**
+	 * End the read, and with it every pipeline. Each still emits what it has queued, followed by its
+	 * {@link RTLSDR~event:done}; the device may start a new read right away.
+	 * @return {RTLSDR.FanOut} `this`
+	 */
+	cancel() {
+		if (this.running > 0 && this.device.isOpen()) librtlsdr.cancel_async(this.device.device);
+		return this;
+	}
+}
+
+module.exports = FanOut;
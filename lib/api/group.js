@@ -0,0 +1,91 @@
+const librtlsdr = require('../addon/');
+const EventEmitter = require('events');
+
+/**
+ * A synchronized capture across several open devices that share a reference clock (see {@link RTLSDR.group}).
+ * Every device streams on its own capture thread; the group resets all of their buffers, starts all of their reads
+ * together, lines the streams up by sample index, and emits matched, equal-length blocks from every device at once.
+ * @extends EventEmitter
+ * @emits RTLSDR.CaptureGroup~aligned
+ * @emits RTLSDR.CaptureGroup~data
+ * @emits RTLSDR.CaptureGroup~overflow
+ * @emits RTLSDR.CaptureGroup~error
+ * @emits RTLSDR.CaptureGroup~done
+ */
+class CaptureGroup extends EventEmitter {
+	constructor(devices, bufNum, bufLen, options) {
+		super();
+
+		if (!Array.isArray(devices)) throw new TypeError('devices must be an array of RTLSDR instances');
+		devices.forEach(device => device.assertOpen());
+
+		this.devices = devices.slice();
+		this.finished = false;
+
+		const forward = (ev, arg, timing) => {
+			if (ev === 'done' || ev === 'error') this.finished = true;
+			this.emit(ev, arg, timing);
+		};
+
+		librtlsdr.capture_group(this.devices.map(device => device.device), forward, bufNum, bufLen, options);
+	}
+
+	/**
+	 * The devices' reads have started and been lined up. Emitted once, before the first
+	 * {@link RTLSDR.CaptureGroup~event:data}.
+	 * @event RTLSDR.CaptureGroup~aligned
+	 * @param {Number[]} leads - per device, in the order given, the complex samples of its stream that were skipped
+	 * so that group sample 0 is the same instant on every device, including its `offsets` entry
+	 */
+
+	/**
+	 * The next matched block. Each device's samples are a view of one slab in a native pool, in the order the
+	 * devices were given, and hold the same `blockSize` complex samples of every stream. The slab returns to the pool
+	 * when every view is garbage collected, or sooner when any one of them is passed to {@link RTLSDR#release}.
+	 * @event RTLSDR.CaptureGroup~data
+	 * @param {Array<(Uint8Array|Int16Array|Float32Array)>} blocks - per device, its samples in the group's `format`
+	 * @param {RTLSDR~Timing} timing - as for a single device, with `timing[0]` counting group samples, so blocks
+	 * follow one another without a gap when it advances by `blockSize`
+	 */
+
+	/**
+	 * Matched blocks were discarded because the group's queue was full. Only emitted under the `'drop-oldest'` and
+	 * `'drop-newest'` overflow policies.
+	 * @event RTLSDR.CaptureGroup~overflow
+	 * @param {Object} counts - overflow counters, as for {@link RTLSDR~event:overflow}, counting blocks
+	 */
+
+	/**
+	 * A device's read failed, or one device fell so far behind the others that the streams could not be kept in
+	 * step. The group has been cancelled, and nothing more is emitted.
+	 * @event RTLSDR.CaptureGroup~error
+	 * @param {String} errorMsg - the error message that was raised
+	 */
+
+	/**
+	 * The group has finished, after {@link RTLSDR.CaptureGroup#cancel}, a device's {@link RTLSDR#cancel}, or a
+	 * device being closed. Every block captured before then has been emitted.
+	 * @event RTLSDR.CaptureGroup~done
+	 */
+
+	/**
+	 * Whether the group has emitted its final `done` or `error` event.
+	 * @return {Boolean} `true` iff the group has finished
+	 */
+	isFinished() {
+		return this.finished;
+	}
+
+	/**
+	 * End the capture on every device. Blocks already matched are still emitted, followed by
+	 * {@link RTLSDR.CaptureGroup~event:done}; each device may start a new read right away.
+	 * @return {RTLSDR.CaptureGroup} `this`
+	 */
+	cancel() {
+		const open = this.devices.filter(device => device.isOpen());
+		if (!this.finished && open.length > 0) librtlsdr.cancel_async(open[0].device);
+		return this;
+	}
+}
+
+module.exports = CaptureGroup;
@@ -1,5 +1,9 @@
 const librtlsdr = require('../addon/');
 const EventEmitter = require('events');
+const stream = require('./stream');
+const CaptureGroup = require('./group');
+const FanOut = require('./fanout');
+const RingReader = require('./ring');
 
 /** @private */
 function simpleClone(obj) {
@@ -10,14 +14,58 @@ function simpleClone(obj) {
 	return result;
 }
 
+/** @private */
+const SETTINGS = ['sampleRate', 'directSampling', 'offsetTuning', 'freqCorrection', 'centerFreq', 'bandwidth', 'gain',
+	'agc', 'testmode'];
+
+/**
+ * Start a native call that reports through a node-style callback, throwing synchronously for bad arguments. With a
+ * callback, it is passed straight through; without one, a promise of the result is returned.
+ * @private
+ */
+function settle(callback, start) {
+	if (typeof callback === 'function') {
+		start((err, result) => callback(err || null, result));
+		return undefined;
+	}
+
+	let done;
+	const result = new Promise((resolve, reject) => {
+		done = (err, value) => (err ? reject(err) : resolve(value));
+	});
+
+	start(done);
+	return result;
+}
+
 /**
  * EventEmitter abstraction of an RTLSDR device. Virtually all methods are subject to I/O-related exceptions.
  *
- * @param {Number} deviceIndex - the zero-based index of the device to open
- * @throws {TypeError} `deviceIndex` is not a number
+ * Each open device owns a native capture thread that runs librtlsdr's blocking read loop, so streaming does not
+ * occupy one of libuv's threadpool threads, and a control thread for settings and EEPROM access that should not
+ * block the event loop (see {@link RTLSDR#configure}).
+ *
+ * A recording can stand in for a device: given a path instead of an index, the instance replays the file through
+ * the same methods and events (see {@link RTLSDR.openFile}).
+ *
+ * @param {(Number|String)} deviceIndex - the zero-based index of the device to open, or the path of a recording
+ * @param {RTLSDR~ThreadOptions} [threadOptions] - optional scheduling for the device's capture thread
+ * @param {RTLSDR~ReplayOptions} [replayOptions] - how to replay the recording, when `deviceIndex` is a path
+ * @throws {TypeError} `deviceIndex` is neither a number nor a string
+ * @throws {TypeError} a thread option has the wrong type
+ * @throws {RangeError} a thread option is out of range
+ * @throws {Error} the thread options could not be applied (e.g. insufficient privilege for `realtimePriority`)
  * @see {@link https://nodejs.org/api/events.html EventEmitter API} for information on how to consume events
  * @extends EventEmitter
  * @emits RTLSDR~data
+ * @emits RTLSDR~channel
+ * @emits RTLSDR~spectrum
+ * @emits RTLSDR~audio
+ * @emits RTLSDR~squelch-open
+ * @emits RTLSDR~squelch-close
+ * @emits RTLSDR~capture
+ * @emits RTLSDR~sweep
+ * @emits RTLSDR~overflow
  * @emits RTLSDR~error
  * @emits RTLSDR~done
  * @example <caption>Basic usage: setup and read RF samples for ~5 seconds</caption>
@@ -31,7 +79,7 @@ function simpleClone(obj) {
  * setTimeout(() => { device.cancel(); }, 5000);
  */
 class RTLSDR extends EventEmitter {
-	constructor(deviceIndex) {
+	constructor(deviceIndex, threadOptions, replayOptions) {
 		super();
 
 		/**
@@ -105,9 +153,35 @@ class RTLSDR extends EventEmitter {
 		 */
 		Object.defineProperty(this, 'lastAGC', { writable: true });
 
-		this.device = librtlsdr.open(this.deviceIndex);
+		if (typeof deviceIndex === 'string') {
+			this.device = librtlsdr.open_file(deviceIndex, replayOptions, threadOptions);
+		} else {
+			this.device = librtlsdr.open(this.deviceIndex, threadOptions);
+		}
 	}
 
+	/**
+	 * Scheduling for a device's native capture thread, applied when the device is opened.
+	 * @typedef {Object} RTLSDR~ThreadOptions
+	 * @property {(Number|Number[])} [cpu] - pin the thread to this CPU (or any of these CPUs); Linux only
+	 * @property {Number} [realtimePriority] - run the thread under `SCHED_FIFO` at this priority (1-99); usually
+	 * requires `CAP_SYS_NICE` or root
+	 * @property {Number} [nice] - the thread's nice value (-20-19); Linux only
+	 */
+
+	/**
+	 * How a recording is replayed. The file holds raw 8-bit offset-binary I/Q (`.cu8`, as written by the `record`
+	 * read option); a SigMF `.sigmf-meta` sidecar beside it, or given as the path, supplies its sample rate and
+	 * frequency.
+	 * @typedef {Object} RTLSDR~ReplayOptions
+	 * @property {Number} [sampleRate] - the recording's sample rate in Hz; required without a sidecar, and overrides
+	 * the sidecar's
+	 * @property {Number} [centerFreq] - the recording's center frequency in Hz; overrides the sidecar's
+	 * @property {Number} [speed=1] - 1 to deliver samples as fast as the hardware did, N for N times that, or 0 for
+	 * as fast as the read keeps up (0-10000)
+	 * @property {Boolean} [loop=false] - start over at the end of the recording instead of finishing the read
+	 */
+
 	/**
 	 * Ensure that the device is open.
 	 * @throws {Error} the device is closed
@@ -135,7 +209,8 @@ class RTLSDR extends EventEmitter {
 	}
 
 	/**
-	 * Close the device (if it is open). Most other methods should not be called after calling this. Idempotent.
+	 * Close the device (if it is open). Any read in progress is cancelled and the device's capture thread is joined.
+	 * Most other methods should not be called after calling this. Idempotent.
 	 */
 	destroy() {
 		if (this.isOpen()) {
@@ -213,7 +288,7 @@ class RTLSDR extends EventEmitter {
 	 */
 	readEEPROMSync(offset, length) {
 		this.assertOpen();
-		librtlsdr.read_eeprom(this.device, offset, length);
+		return librtlsdr.read_eeprom(this.device, offset, length);
 	}
 
 	/**
@@ -223,24 +298,20 @@ class RTLSDR extends EventEmitter {
 	 */
 
 	/**
-	 * Asynchronously read the device's EEPROM. Convenience wrapper via `setTimeout`.
+	 * Asynchronously read the device's EEPROM, on the device's control thread (see {@link RTLSDR#configure}).
 	 * @param {Number} offset - as in {@link RTLSDR#readEEPROMSync}
 	 * @param {Number} length - as in {@link RTLSDR#readEEPROMSync}
-	 * @param {RTLSDR~readEEPROMCallback} callback - node-style callback to handle the result
+	 * @param {RTLSDR~readEEPROMCallback} [callback] - node-style callback to handle the result
+	 * @return {(Promise<Buffer>|undefined)} the requested EEPROM bytes, if there is no `callback`
 	 * @throws {Error} the device is closed
 	 * @throws {TypeError} `offset` is not a number
 	 * @throws {RangeError} `offset` is not 0-255
 	 * @throws {TypeError} `length` (len) is not a number
-	 * @throws {RangeError} `length` (len) is not 0-255
+	 * @throws {RangeError} `length` (len) is not 0-65535
 	 */
 	readEEPROM(offset, length, callback) {
-		setImmediate(() => {
-			try {
-				callback(null, this.readEEPROMSync(offset, length));
-			} catch (err) {
-				callback(err);
-			}
-		});
+		this.assertOpen();
+		return settle(callback, cb => librtlsdr.read_eeprom_async(this.device, offset, length, cb));
 	}
 
 	/**
@@ -266,26 +337,92 @@ class RTLSDR extends EventEmitter {
 	 */
 
 	/**
-	 * Asynchronously write the device's EEPROM. Convenience wrapper via `setTimeout`.
+	 * Asynchronously write the device's EEPROM, on the device's control thread (see {@link RTLSDR#configure}).
+	 * `buf` is copied before this returns.
 	 * @param {Buffer} buf - the bytes to write
 	 * @param {Number} offset - as in {@link RTLSDR#writeEEPROMSync}
 	 * @param {Number} length - as in {@link RTLSDR#writeEEPROMSync}
-	 * @param {RTLSDR~writeEEPROMCallback} callback - node-style callback to handle the result
+	 * @param {RTLSDR~writeEEPROMCallback} [callback] - node-style callback to handle the result
+	 * @return {(Promise|undefined)} settles when the write has, if there is no `callback`
 	 * @throws {Error} the device is closed
 	 * @throws {TypeError} buf (data) is not a buffer
 	 * @throws {TypeError} `offset` is not a number
 	 * @throws {RangeError} `offset` is not 0-255
 	 * @throws {TypeError} `length` (len) is not a number
-	 * @throws {RangeError} `length` (len) is not 0-255
+	 * @throws {RangeError} `length` (len) is not 0-65535, or is longer than `buf`
 	 */
 	writeEEPROM(buf, offset, length, callback) {
-		setImmediate(() => {
-			try {
-				this.writeEEPROM(buf, offset, length);
-				callback();
-			} catch (err) {
-				callback(err);
+		this.assertOpen();
+		return settle(callback, cb => librtlsdr.write_eeprom_async(this.device, buf, offset, length, cb));
+	}
+
+	/**
+	 * Device settings to apply together with {@link RTLSDR#configure}. Each is optional, and takes what the matching
+	 * setter takes.
+	 * @typedef {Object} RTLSDR~Settings
+	 * @property {Number} [sampleRate] - as for {@link RTLSDR#sampleRate}
+	 * @property {Number} [directSampling] - as for {@link RTLSDR#directSampling}
+	 * @property {Boolean} [offsetTuning] - as for {@link RTLSDR#offsetTuning}
+	 * @property {Number} [freqCorrection] - as for {@link RTLSDR#freqCorrection}
+	 * @property {Number} [centerFreq] - as for {@link RTLSDR#centerFreq}
+	 * @property {(Number|String)} [bandwidth] - as for {@link RTLSDR#tunerBandwidth}
+	 * @property {(Number|String)} [gain] - `'auto'`, or a gain in centibels (cB), rounded to the nearest
+	 * supported gain as {@link RTLSDR#tunerGain} rounds it, which also selects manual gain
+	 * @property {Boolean} [agc] - as for {@link RTLSDR#agc}
+	 * @property {Boolean} [testmode] - as for {@link RTLSDR#testmode}
+	 */
+
+	/**
+	 * Apply a batch of settings on the device's control thread, without blocking the event loop on the USB
+	 * control transfers. The thread runs commands one at a time in the order they were made, alongside any read in
+	 * progress. The batch is applied as a unit, sample rate and input first, then tuning, bandwidth, and gain; it
+	 * stops at the first setting librtlsdr rejects. A batch made while an earlier one is still waiting its turn is
+	 * merged into it, later values winning, so a burst of retunes costs one retune.
+	 * @param {RTLSDR~Settings} settings - what to change
+	 * @return {Promise} resolves once the settings (and any merged into them) are applied; rejects with
+	 * librtlsdr's error, or if the device closes first
+	 * @throws {Error} the device is closed
+	 * @throws {TypeError} a setting is unknown or has the wrong type
+	 * @throws {RangeError} a setting is out of range
+	 * @example <caption>Hop between two channels 50 times a second while streaming</caption>
+	 * let hop = 0;
+	 * setInterval(() => device.configure({ centerFreq: (hop++ % 2) ? 433.92e6 : 868.3e6 }), 20);
+	 */
+	configure(settings) {
+		this.assertOpen();
+
+		if (typeof settings !== 'object' || settings === null) {
+			throw new TypeError('settings must be an object');
+		}
+
+		const native = {};
+		Object.keys(settings).forEach((key) => {
+			if (SETTINGS.indexOf(key) < 0) throw new TypeError(`unknown setting: ${key}`);
+			if (key !== 'gain' && key !== 'bandwidth') native[key] = settings[key];
+		});
+
+		if (settings.gain === 'auto') {
+			native.gainMode = 0;
+		} else if (typeof settings.gain === 'number') {
+			native.gainMode = 1;
+			native.gain = this.nearestTunerGain(settings.gain);
+		} else if (typeof settings.gain !== 'undefined') {
+			throw new TypeError("gain must be 'auto' or a number");
+		}
+
+		if (settings.bandwidth === 'auto') {
+			native.bandwidth = 0;
+		} else if (typeof settings.bandwidth !== 'undefined') {
+			native.bandwidth = settings.bandwidth;
+		}
+
+		return settle(undefined, cb => librtlsdr.configure(this.device, native, cb)).then(() => {
+			if (typeof native.gainMode !== 'undefined') this.lastGainMode = native.gainMode;
+			if (typeof settings.bandwidth !== 'undefined') {
+				this.lastBandwidth = native.bandwidth === 0 ? 'auto' : native.bandwidth;
 			}
+			if (typeof settings.agc !== 'undefined') this.lastAGC = settings.agc;
+			if (typeof settings.testmode !== 'undefined') this.lastTestmode = settings.testmode;
 		});
 	}
 
@@ -297,7 +434,8 @@ class RTLSDR extends EventEmitter {
 	 */
 
 	/**
-	 * Set the device's center frequency.
+	 * Set the device's center frequency. This waits for the USB control transfer; {@link RTLSDR#configure} retunes
+	 * without blocking the event loop.
 	 * @method RTLSDR#centerFreq(2)
 	 * @param {Number} freq - the center frequency to tune on the RTL device, in integer Hz
 	 * @return {RTLSDR} `this`
@@ -608,7 +746,9 @@ class RTLSDR extends EventEmitter {
 	 */
 
 	/**
-	 * Set the device's direct sampling mode. Used in conjunction with {@link RTLSDR#centerFreq} when active.
+	 * Set the device's direct sampling mode. Used in conjunction with {@link RTLSDR#centerFreq} when active. Samples
+	 * still arrive as complex baseband about the center frequency, so the native DSP read options (such as `demod`
+	 * for HF AM, SSB, and CW) apply unchanged.
 	 * @method RTLSDR#directSampling(2)
 	 * @see {@link https://github.com/steve-m/librtlsdr/blob/8b4d755ba1b889510fba30f627ee08736203070d/include/rtl-sdr.h#L304 rtlsdr_set_direct_sampling}
 	 * @param {Number} mode - `0` off, `1` activate I-ADC input, `2` activate Q-ADC input
@@ -664,13 +804,146 @@ class RTLSDR extends EventEmitter {
 	readSync(length) {
 		this.assertOpen();
 		librtlsdr.reset_buffer(this.device);
-		return librtlsdr.read_sync(length);
+		return librtlsdr.read_sync(this.device, length);
 	}
 
 	/**
-	 * An asynchronous read has returned some samples.
+	 * Read samples into a buffer the caller owns, on the device's capture thread, without blocking the event loop
+	 * or allocating. The first read after opening the device or after a streaming read resets the device's buffer;
+	 * later ones continue where the last left off, so a poller can refill one buffer indefinitely. Reads queue
+	 * behind one another and ahead of a later {@link RTLSDR#read}, which they may not overlap.
+	 * @param {Buffer|TypedArray} buffer - where to put the samples; must not be used until the promise settles
+	 * @param {Number} [offset=0] - the byte offset into `buffer` to read to
+	 * @param {Number} [length] - how many bytes to try to read; the rest of `buffer` by default
+	 * @return {Promise<Number>} how many bytes were read, which may be fewer than requested; rejects if
+	 * rtlsdr_read_sync fails or the device closes first
+	 * @throws {Error} the device is closed
+	 * @throws {Error} a read is already in progress
+	 * @throws {TypeError} `buffer` is not a Buffer or typed array, or `offset` or `length` is not a non-negative
+	 * integer
+	 * @throws {RangeError} `length` is 0, or `offset + length` runs past the end of `buffer`
+	 * @example <caption>Poll 16 KiB at a time into the same buffer</caption>
+	 * const buf = Buffer.alloc(16384);
+	 * const poll = () => device.readInto(buf).then((n) => { process(buf.slice(0, n)); return poll(); });
+	 * poll();
+	 */
+	readInto(buffer, offset, length) {
+		this.assertOpen();
+
+		const start = offset === undefined ? 0 : offset;
+		let len = length;
+		if (len === undefined && ArrayBuffer.isView(buffer)) len = buffer.byteLength - start;
+
+		return settle(undefined, cb => librtlsdr.read_into(this.device, buffer, start, len, cb));
+	}
+
+	/**
+	 * An asynchronous read has returned some samples. The payload is a view of a slab in a native pool sized from the
+	 * `bufNum` and `bufLen` given to {@link RTLSDR#read}; the slab returns to the pool when the payload is garbage
+	 * collected, or sooner via {@link RTLSDR#release}. Its type follows the read's `format` option (see
+	 * {@link RTLSDR~ReadOptions}).
 	 * @event RTLSDR~data
-	 * @param {Buffer} buffer - the RF sample bytes
+	 * @param {Buffer|Int16Array|Float32Array} samples - the RF samples
+	 * @param {RTLSDR~Timing} timing - when the transfer holding the first of these samples arrived
+	 */
+
+	/**
+	 * The receive time and stream position of a delivered block, passed after the payload of every
+	 * {@link RTLSDR~event:data}, {@link RTLSDR~event:channel}, {@link RTLSDR~event:spectrum} and
+	 * {@link RTLSDR~event:audio} event. It is one Float64Array per read, overwritten before each event, so copy what
+	 * must outlive the listener.
+	 *
+	 * - `timing[0]` is the index of the block's first sample in the stream it belongs to, counted from the start of
+	 *   the read: the device's complex samples for a plain read, the resampled stream's with `outputRate`, a
+	 *   channel's with `channels`, and the receiver's audio samples with `demod`. A block follows its predecessor
+	 *   without a gap when `timing[0]` equals the predecessor's index plus its sample count (complex samples, or
+	 *   audio samples for `audio`); blocks dropped by the `overflow` policy leave exactly that gap. Samples librtlsdr
+	 *   never saw are not counted, and only show in the timestamps. A `spectrum` row carries the device index of
+	 *   the first sample of the last transfer that went into it.
+	 * - `timing[1]` is the CLOCK_MONOTONIC time the transfer arrived, in milliseconds, for intervals and rates.
+	 * - `timing[2]` is the CLOCK_REALTIME time the transfer arrived, in milliseconds since the epoch, comparable to
+	 *   `Date.now()` and to other hosts.
+	 *
+	 * For `spectrum` and `audio` events, which may span several transfers, the timing is that of the last transfer
+	 * that went into the block.
+	 * @typedef {Float64Array} RTLSDR~Timing
+	 */
+
+	/**
+	 * A channelized read (see the `channels` option of {@link RTLSDR~ReadOptions}) has returned samples for one
+	 * channel. Each transfer yields one `channel` event per selected channel, in the order they were selected, instead
+	 * of a {@link RTLSDR~event:data} event. The samples are pooled like `data` payloads and may be passed to
+	 * {@link RTLSDR#release}.
+	 * @event RTLSDR~channel
+	 * @param {Object} block - the channel's samples
+	 * @param {Number} block.channel - the channel number, from 0 to `channels.count - 1`
+	 * @param {Buffer|Int16Array|Float32Array} block.samples - the channel's complex baseband, at the input rate
+	 * divided by `channels.count`
+	 * @param {RTLSDR~Timing} timing - when the transfer the samples came from arrived
+	 */
+
+	/**
+	 * A spectrum read (see the `spectrum` option of {@link RTLSDR~ReadOptions}) has averaged another power spectrum,
+	 * emitted instead of {@link RTLSDR~event:data}. The row is pooled like `data` payloads and may be passed to
+	 * {@link RTLSDR#release}.
+	 * @event RTLSDR~spectrum
+	 * @param {Float32Array} bins - `spectrum.size` power levels in dB relative to a full-scale complex tone, from
+	 * half the sample rate below the center frequency (`bins[0]`) to just under half the sample rate above it; the
+	 * center frequency is `bins[spectrum.size / 2]`
+	 * @param {RTLSDR~Timing} timing - when the transfer that completed the average arrived
+	 */
+
+	/**
+	 * A demodulating read (see the `demod` option of {@link RTLSDR~ReadOptions}) has produced audio for one receiver.
+	 * Each transfer yields up to one `audio` event per receiver, in the order they were given, instead of a
+	 * {@link RTLSDR~event:data} event. The samples are pooled like `data` payloads and may be passed to
+	 * {@link RTLSDR#release}.
+	 * @event RTLSDR~audio
+	 * @param {Object} block - the receiver's audio
+	 * @param {Number} block.receiver - the receiver's index in the `demod` array, or 0 for a single receiver
+	 * @param {Int16Array|Float32Array} block.samples - mono PCM at the receiver's `audioRate`
+	 * @param {RTLSDR~Timing} timing - when the transfer that completed the audio arrived
+	 */
+
+	/**
+	 * A squelched read (see the `squelch` option of {@link RTLSDR~ReadOptions}) has opened: the
+	 * {@link RTLSDR~event:data} events that follow, up to the next {@link RTLSDR~event:squelch-close}, are one
+	 * contiguous stretch of signal.
+	 * @event RTLSDR~squelch-open
+	 * @param {Number} offset - the index of the stretch's first complex sample, counted from the start of the read
+	 */
+
+	/**
+	 * A squelched read has closed again; nothing more is emitted until the next {@link RTLSDR~event:squelch-open}.
+	 * @event RTLSDR~squelch-close
+	 * @param {Number} offset - the index just past the stretch's last complex sample, counted from the start of the
+	 * read
+	 */
+
+	/**
+	 * A read with history (see the `history` option of {@link RTLSDR~ReadOptions}) has finished a capture, either
+	 * because its power trigger fired or because {@link RTLSDR#snapshot} asked for one. A capture is one contiguous
+	 * stretch of the stream, converted to the read's `format`.
+	 * @event RTLSDR~capture
+	 * @param {Object} capture - the captured stretch
+	 * @param {Number} [capture.id] - the id {@link RTLSDR#snapshot} returned; absent for a power trigger
+	 * @param {String} capture.trigger - `'snapshot'` or `'power'`
+	 * @param {Number} capture.offset - the index of the capture's first complex sample, counted from the start of
+	 * the read
+	 * @param {Number} capture.triggerOffset - the index of the complex sample the trigger fired at
+	 * @param {Buffer|Int16Array|Float32Array} capture.samples - the captured I/Q, pooled like `data` payloads when
+	 * small enough, so it may be passed to {@link RTLSDR#release}
+	 */
+
+	/**
+	 * Transfers were discarded because the pending-transfer queue was full. Only emitted under the `'drop-oldest'`
+	 * and `'drop-newest'` overflow policies (see {@link RTLSDR~ReadOptions}).
+	 * @event RTLSDR~overflow
+	 * @param {Object} counts - overflow counters
+	 * @param {Number} counts.dropped - transfers dropped since the previous `overflow` event
+	 * @param {Number} counts.totalDropped - transfers dropped since the read began
+	 * @param {Number} counts.totalTransfers - transfers received from librtlsdr since the read began
+	 * @param {Number} counts.queueDepth - the configured queue depth
 	 */
 
 	/**
@@ -684,18 +957,139 @@ class RTLSDR extends EventEmitter {
 	 * @event RTLSDR~done
 	 */
 
+	/**
+	 * Options controlling how transfers travel from librtlsdr to the `data` event. Transfers are held in a bounded
+	 * native queue until the event loop can emit them.
+	 * @typedef {Object} RTLSDR~ReadOptions
+	 * @property {Number} [queueDepth=32] - how many transfers may be pending at once (1-4096)
+	 * @property {String} [overflow='block'] - what to do with a transfer that arrives while the queue is full:
+	 * `'drop-oldest'` discards the oldest pending transfer, `'drop-newest'` discards the arriving transfer, and
+	 * `'block'` stalls the librtlsdr callback until there is room (no samples are dropped by the queue, but librtlsdr
+	 * may overrun its own USB buffers if the stall is long)
+	 * @property {String} [format='uint8'] - the type of each `data` payload, converted natively off the event loop:
+	 * `'uint8'` is a Buffer of raw offset-binary I/Q bytes; `'int16'` is an Int16Array of interleaved I/Q scaled to
+	 * ±32640; `'float32'` is a Float32Array of interleaved I/Q from -1.0 to 1.0; `'float32-planar'` is a Float32Array
+	 * holding every I sample in its first half and every Q sample in its second half
+	 * @property {Boolean} [dcBlock=false] - natively remove the DC offset (the spike at the center frequency) with a
+	 * running-average estimate
+	 * @property {Boolean} [iqBalance=false] - natively correct I/Q gain and phase imbalance with an adaptive blind
+	 * estimator; the correction is most useful with a float or int16 `format`, since `'uint8'` requantizes the result
+	 * @property {Number} [outputRate] - natively filter and decimate the stream to this complex sample rate in Hz, no
+	 * higher than {@link RTLSDR#sampleRate}, so that only the rate you need reaches the event loop. Uses a CIC
+	 * decimator for large factors, half-band stages, and a polyphase resampler for fractional ratios such as
+	 * 2.4 MS/s to 48 kS/s; ratios that are not a fraction with a denominator of at most 1024 are approximated. The
+	 * sample rate must be set before the read starts.
+	 * @property {Object} [channels] - natively split the band (after any `outputRate` resampling) into equal channels
+	 * with a polyphase filter bank, emitting {@link RTLSDR~event:channel} events in place of `data` events. Channel
+	 * `k` is centered `k / count` of the sample rate above the center frequency, so channels past `count / 2` are the
+	 * negative frequencies, and each is decimated by `count`. Use a float or int16 `format`: channels of a uint8
+	 * read are requantized to 8 bits.
+	 * @property {Number} channels.count - how many channels to split the band into (2-1024)
+	 * @property {Number[]} [channels.select] - which channels to deliver; defaults to all of them. Each costs one
+	 * `count`-point DFT bin per output sample, so a few channels of a large bank stay cheap
+	 * @property {Number} [channels.threads=1] - how many threads share the filter bank (1-64)
+	 * @property {Object} [spectrum] - natively reduce the stream (after any `outputRate` resampling) to averaged
+	 * power spectra, emitting {@link RTLSDR~event:spectrum} events in place of `data` events; `format` is ignored.
+	 * Cannot be combined with `channels`.
+	 * @property {Number} spectrum.size - bins per spectrum, a power of two from 16 to 65536
+	 * @property {String} [spectrum.window='hann'] - `'rectangular'`, `'hann'`, `'hamming'`, `'blackman'`, or
+	 * `'blackman-harris'`
+	 * @property {Number} [spectrum.overlap=0] - the fraction of each FFT frame shared with the next, at least 0 and
+	 * less than 1
+	 * @property {Number} [spectrum.averages=1] - how many FFT frames are averaged into each spectrum (1-65536)
+	 * @property {Object|Object[]} [demod] - natively demodulate the stream (after any `outputRate` resampling) into
+	 * audio, emitting {@link RTLSDR~event:audio} events in place of `data` events. Give one receiver's options, or an
+	 * array of up to 64 receivers, each with its own mode, that tune their own parts of the band. Every receiver
+	 * shares the same chain: it mixes its channel down to 0 Hz, decimates and filters it, demodulates it (a polar
+	 * discriminator for FM, the envelope less its carrier for AM, or a BFO for SSB and CW), then resamples to
+	 * `audioRate` and applies any de-emphasis and AGC. `format` defaults to `'float32'` (audio from -1.0 to 1.0) and
+	 * may also be `'int16'`. The sample rate must be set before the read starts. Works the same in
+	 * {@link RTLSDR#directSampling} mode, where offsets are from the HF center frequency. Cannot be combined with
+	 * `channels` or `spectrum`.
+	 * @property {String} [demod.mode='wbfm'] - `'wbfm'` (broadcast FM), `'nbfm'` (narrowband FM), `'am'`, `'usb'`,
+	 * `'lsb'`, or `'cw'`
+	 * @property {Number} [demod.offset=0] - the channel's offset from the center frequency in Hz; for `'usb'` and
+	 * `'lsb'`, the offset of the suppressed carrier
+	 * @property {Number} [demod.bandwidth] - the channel's width in Hz; 200000 for `'wbfm'`, 16000 for `'nbfm'`,
+	 * 10000 for `'am'`, 2800 for `'usb'` and `'lsb'` (one sideband, above or below the offset), and 500 for `'cw'`
+	 * @property {Number} [demod.deviation] - the FM deviation in Hz that demodulates to full scale; 75000 for
+	 * `'wbfm'`, 5000 for `'nbfm'`
+	 * @property {Number} [demod.deemphasis] - the de-emphasis time constant in microseconds, or 0 for none; 75 for
+	 * `'wbfm'` (use 50 in Europe), 0 for `'nbfm'`
+	 * @property {Number} [demod.squelch] - mute the audio while the channel's power is below this many dBFS; the
+	 * squelch closes again 3 dB below it. Off by default
+	 * @property {Number} [demod.pitch=700] - `'cw'` only: the tone in Hz that a carrier at `offset` is heard as
+	 * @property {Boolean} [demod.agc] - level the audio with automatic gain control (fast attack, half-second
+	 * decay); on by default for `'am'`, `'usb'`, `'lsb'`, and `'cw'`, off for FM
+	 * @property {Number} [demod.audioRate=48000] - the audio sample rate in Hz (1000-384000)
+	 * @property {Object} [squelch] - only forward the stretches of the stream whose power is above a level. Each
+	 * transfer is measured natively, a window at a time, and windows below the level are dropped on the capture
+	 * thread, so an idle channel does not wake the event loop at all. Open stretches arrive as ordinary `data`
+	 * events between {@link RTLSDR~event:squelch-open} and {@link RTLSDR~event:squelch-close}, which carry sample
+	 * offsets from the start of the read; `dcBlock` and `iqBalance` apply only to the forwarded samples. Cannot be
+	 * combined with `outputRate`, `channels`, `spectrum`, or `demod`.
+	 * @property {Number} squelch.level - the mean power, in dB relative to a full-scale complex sample (-100 to 0),
+	 * at which the squelch opens
+	 * @property {Number} [squelch.hysteresis=3] - how many dB below `level` the power must fall to close it again
+	 * @property {Number} [squelch.window=2048] - complex samples per open/close decision (16-1048576); windows do not
+	 * span transfers
+	 * @property {Object} [history] - keep the last few seconds of raw samples in a native ring instead of emitting
+	 * them, and emit {@link RTLSDR~event:capture} events for the stretches around each trigger: the power detector
+	 * opening, or a call to {@link RTLSDR#snapshot}. The ring is allocated once when the read starts, and while
+	 * nothing is triggered each transfer costs one copy into it and never wakes the event loop. A capture may reach
+	 * further back than the trigger by up to the ring's length, and forward as far as it likes. The sample rate must
+	 * be set before the read starts. Cannot be combined with `outputRate`, `channels`, `spectrum`, `demod`,
+	 * `squelch`, `dcBlock`, or `iqBalance`.
+	 * @property {Number} history.seconds - how many seconds of samples the ring holds, at most 2 GiB of them
+	 * @property {Number} [history.pre=250] - milliseconds before a power trigger to capture, up to `seconds`
+	 * @property {Number} [history.post=250] - milliseconds after a power trigger to capture
+	 * @property {Object} [history.trigger] - capture whenever the power rises above a level, measured as for
+	 * `squelch` and with the same `level`, `hysteresis`, and `window` options. A burst that starts while the
+	 * previous one is still being captured is part of that capture. Without it, only snapshots capture anything
+	 * @property {Object} [record] - write the raw stream to disk natively instead of emitting it. The capture thread
+	 * copies each transfer into large blocks allocated once, and a dedicated writer thread writes each full block
+	 * with a single write, so disk latency spikes are absorbed by the blocks rather than stalling librtlsdr or the
+	 * event loop. The data files are raw offset-binary I/Q (`.cu8`), each with a SigMF `.sigmf-meta` sidecar that
+	 * records the sample rate, center frequency, tuner gain, and start time the recording was made with. Only
+	 * {@link RTLSDR~event:done}, or {@link RTLSDR~event:error} if a write fails, is emitted; watch progress with
+	 * {@link RTLSDR#recordStats}. When every block is waiting to be written, `overflow: 'block'` stalls the
+	 * librtlsdr callback until one is free, and either drop policy discards the arriving samples. The sample rate
+	 * must be set before the read starts. Cannot be combined with a `format` other than `'uint8'`, `outputRate`,
+	 * `channels`, `spectrum`, `demod`, `squelch`, `history`, `dcBlock`, or `iqBalance`.
+	 * @property {String} record.path - the files' path without an extension: `path.cu8` and `path.sigmf-meta`, or
+	 * `path-0000.cu8`, `path-0001.cu8`, and so on when rotating
+	 * @property {Number} [record.blockSize=1048576] - bytes per write, a multiple of 4096 up to 64 MiB
+	 * @property {Number} [record.blocks=16] - how many blocks to allocate (2-4096), which bounds the backlog; at most
+	 * 4 GiB in all
+	 * @property {Boolean} [record.direct=false] - bypass the page cache with `O_DIRECT` where the platform and file
+	 * system support it
+	 * @property {Number} [record.rotateBytes=0] - start a new file every this many bytes; 0 for no limit
+	 * @property {Number} [record.rotateSeconds=0] - start a new file every this many seconds of samples; 0 for no
+	 * limit. With both limits, files rotate at whichever comes first
+	 */
+
 	/**
 	 * Deprecated; use {@link RTLSDR#read}. Asynchronously receive samples. This method calls the deprecated `rtlsdr_wait_async`
 	 * function in librtlsdr, but _that_ function now simply calls `rtlsdr_read_async` with `0` for `buf_num` and
 	 * `buf_len`. This method will cause {@link RTLSDR~event:data} to begin being emitted on `this`.
 	 * @see {@link https://github.com/steve-m/librtlsdr/blob/8b4d755ba1b889510fba30f627ee08736203070d/include/rtl-sdr.h#L342 rtlsdr_wait_async}
+	 * @param {RTLSDR~ReadOptions} [options] - optional queueing and sample format options
 	 * @return {RTLSDR} `this`
 	 * @throws {Error} the device is closed
+	 * @throws {Error} a read is already in progress
+	 * @throws {Error} `outputRate` was given but the sample rate has not been set
+	 * @throws {Error} both `channels` and `spectrum` were given
+	 * @throws {Error} `demod` was given with `channels` or `spectrum`, or before the sample rate was set
+	 * @throws {Error} `squelch` was given with `outputRate`, `channels`, `spectrum`, or `demod`
+	 * @throws {Error} `history` was given with another processing option, or before the sample rate was set
+	 * @throws {Error} `record` was given with another processing option, or before the sample rate was set
+	 * @throws {TypeError} an option has the wrong type
+	 * @throws {RangeError} an option is out of range
 	 */
-	wait() {
+	wait(options) {
 		this.assertOpen();
 		librtlsdr.reset_buffer(this.device);
-		librtlsdr.wait_async(this.device, (ev, arg) => { this.emit(ev, arg); });
+		librtlsdr.wait_async(this.device, (ev, arg, timing) => { this.emit(ev, arg, timing); }, options);
 		return this;
 	}
 
@@ -704,18 +1098,529 @@ class RTLSDR extends EventEmitter {
 	 * Total buffer size per read will be `bufNum * bufLen`.
 	 * @param {Number} [bufNum] - optional librtlsdr buffer count; default is 15 (librtlsdr behavior)
 	 * @param {Number} [bufLen] - optional librtlsdr buffer length; default is `16 \* 32 \* 512` (librtlsdr behavior); must be a multiple of 512, and _should_ be a multiple of 16384
+	 * @param {RTLSDR~ReadOptions} [options] - optional queueing and sample format options
 	 * @return {RTLSDR} `this`
 	 * @throws {Error} the device is closed
+	 * @throws {Error} a read is already in progress
+	 * @throws {Error} `outputRate` was given but the sample rate has not been set
+	 * @throws {Error} both `channels` and `spectrum` were given
+	 * @throws {Error} `demod` was given with `channels` or `spectrum`, or before the sample rate was set
+	 * @throws {Error} `squelch` was given with `outputRate`, `channels`, `spectrum`, or `demod`
+	 * @throws {Error} `history` was given with another processing option, or before the sample rate was set
+	 * @throws {Error} `record` was given with another processing option, or before the sample rate was set
+	 * @throws {TypeError} an option has the wrong type
+	 * @throws {RangeError} an option is out of range
+	 * @example <caption>Never stall librtlsdr; count what the event loop could not keep up with</caption>
+	 * device
+	 * 	.on('overflow', counts => console.warn(`lost ${counts.dropped} transfers`))
+	 * 	.read(15, 262144, { queueDepth: 64, overflow: 'drop-oldest' });
+	 * @example <caption>Receive a 48 kS/s complex baseband</caption>
+	 * device
+	 * 	.sampleRate(2400000)
+	 * 	.read(15, 262144, { format: 'float32', outputRate: 48000 });
+	 * @example <caption>Receive three 25 kHz channels of a 2.4 MS/s band</caption>
+	 * device
+	 * 	.sampleRate(2400000)
+	 * 	.on('channel', ({ channel, samples }) => demodulate(channel, samples))
+	 * 	.read(15, 262144, { format: 'float32', channels: { count: 96, select: [0, 4, 92], threads: 2 } });
+	 * @example <caption>Receive about 10 averaged 1024-bin spectra per second</caption>
+	 * device
+	 * 	.sampleRate(2048000)
+	 * 	.on('spectrum', bins => plot(bins))
+	 * 	.read(15, 262144, { spectrum: { size: 1024, window: 'blackman-harris', overlap: 0.5, averages: 400 } });
+	 * @example <caption>Listen to two broadcast FM stations 400 kHz either side of the center frequency</caption>
+	 * device
+	 * 	.sampleRate(2400000)
+	 * 	.centerFreq(98.5e6)
+	 * 	.on('audio', ({ receiver, samples }) => speakers[receiver].write(samples))
+	 * 	.read(15, 262144, { demod: [{ mode: 'wbfm', offset: -400e3 }, { mode: 'wbfm', offset: 400e3 }] });
+	 * @example <caption>Monitor 40 m SSB and CW in direct-sampling mode</caption>
+	 * device
+	 * 	.directSampling(2)
+	 * 	.sampleRate(240000)
+	 * 	.centerFreq(7.1e6)
+	 * 	.on('audio', ({ receiver, samples }) => speakers[receiver].write(samples))
+	 * 	.read(15, 32768, { demod: [{ mode: 'lsb', offset: 50e3 }, { mode: 'cw', offset: -70e3 }] });
+	 * @example <caption>Record only the bursts on an otherwise idle channel</caption>
+	 * device
+	 * 	.on('squelch-open', offset => recorder.begin(offset))
+	 * 	.on('data', samples => recorder.write(samples))
+	 * 	.on('squelch-close', offset => recorder.end(offset))
+	 * 	.read(15, 262144, { squelch: { level: -25, hysteresis: 4, window: 4096 } });
+	 * @example <caption>Keep the last 10 seconds, and save 100 ms either side of every burst</caption>
+	 * device
+	 * 	.sampleRate(2048000)
+	 * 	.on('capture', ({ triggerOffset, samples }) => save(`burst-${triggerOffset}.cu8`, samples))
+	 * 	.read(15, 262144, { history: { seconds: 10, pre: 100, post: 100, trigger: { level: -30 } } });
+	 * @example <caption>Record to hour-long files without involving the event loop</caption>
+	 * device
+	 * 	.sampleRate(2048000)
+	 * 	.centerFreq(433.92e6)
+	 * 	.on('error', msg => console.error(`recording stopped: ${msg}`))
+	 * 	.read(15, 262144, { record: { path: '/data/ism', rotateSeconds: 3600, blocks: 64 } });
+	 * setInterval(() => console.log(device.recordStats()), 10000);
+	 * @example <caption>Receive normalized complex samples</caption>
+	 * device
+	 * 	.on('data', (iq) => {
+	 * 		for (let n = 0; n < iq.length; n += 2) process(iq[n], iq[n + 1]);
+	 * 	})
+	 * 	.read(15, 262144, { format: 'float32' });
+	 * @example <caption>Detect dropped blocks</caption>
+	 * let expected = 0;
+	 * device
+	 * 	.on('data', (samples, timing) => {
+	 * 		if (timing[0] !== expected) console.warn(`lost ${timing[0] - expected} samples`);
+	 * 		expected = timing[0] + samples.length / 2;
+	 * 	})
+	 * 	.read(15, 262144, { queueDepth: 64, overflow: 'drop-oldest' });
 	 */
-	read(bufNum, bufLen) {
+	read(bufNum, bufLen, options) {
 		this.assertOpen();
 		librtlsdr.reset_buffer(this.device);
-		librtlsdr.read_async(this.device, (ev, arg) => { this.emit(ev, arg); }, bufNum, bufLen);
+		const forward = (ev, arg, timing) => { this.emit(ev, arg, timing); };
+		librtlsdr.read_async(this.device, forward, bufNum, bufLen, options);
 		return this;
 	}
 
 	/**
-	 * Cancel asynchronous reads that were initiated with {@link RTLSDR#read} or {@link RTLSDR#wait}.
+	 * Start a read whose samples bypass the event loop: the capture thread writes each transfer, converted to
+	 * `format` and stamped as for {@link RTLSDR~Timing}, into a lock-free ring in a SharedArrayBuffer, which a
+	 * {@link RTLSDR.RingReader} in a Worker consumes in place, blocking in `Atomics.wait` while it is empty. Nothing
+	 * is copied between threads, and the event loop of the thread that started the read only wakes the reader,
+	 * once per wakeup however many transfers arrived. The capture thread never waits for the reader: a transfer that
+	 * finds the ring full is dropped whole and counted. Only {@link RTLSDR~event:done} or {@link RTLSDR~event:error}
+	 * is emitted on `this`; {@link RTLSDR#cancel} ends the read as usual.
+	 * @param {Number} [bufNum] - librtlsdr buffer count, as for {@link RTLSDR#read}
+	 * @param {Number} [bufLen] - librtlsdr buffer length, as for {@link RTLSDR#read}
+	 * @param {RTLSDR~RingOptions} [options] - the ring's size and the read's options
+	 * @return {SharedArrayBuffer} the ring, to pass to a Worker
+	 * @throws {Error} the device is closed
+	 * @throws {Error} a read is already in progress
+	 * @throws {Error} a processing option other than `format` was given, or `format` was `'float32-planar'`
+	 * @throws {TypeError} an option has the wrong type
+	 * @throws {RangeError} an option is out of range, or `ringSize` is not a power of two with room for two
+	 * transfers
+	 * @example <caption>Hand float samples to a DSP Worker</caption>
+	 * const ring = device.readShared(15, 262144, { format: 'float32', ringSize: 1 << 24 });
+	 * const worker = new Worker('./dsp.js', { workerData: ring });
+	 * device.on('done', () => console.log('capture ended'));
+	 */
+	readShared(bufNum, bufLen, options) {
+		this.assertOpen();
+
+		const opts = simpleClone(options || {});
+		const formatBytes = { int16: 2, float32: 4 }[opts.format] || 1;
+		const transferBytes = (bufLen || 16 * 32 * 512) * formatBytes;
+		const ring = new SharedArrayBuffer(RingReader.bufferSize(transferBytes, opts.ringSize));
+
+		delete opts.ringSize;
+		opts.ring = ring;
+
+		librtlsdr.reset_buffer(this.device);
+		librtlsdr.read_async(this.device, (ev, arg) => { this.emit(ev, arg); }, bufNum, bufLen, opts);
+		return ring;
+	}
+
+	/**
+	 * Options for {@link RTLSDR#readShared}: `queueDepth`, `overflow`, and `format` from {@link RTLSDR~ReadOptions},
+	 * which may not be `'float32-planar'`, plus the following. The other processing options do not apply.
+	 * @typedef {Object} RTLSDR~RingOptions
+	 * @property {Number} [ringSize] - bytes of records in the ring, a power of two from 4096 to 1 GiB that holds at
+	 * least two transfers with their 32-byte record headers; by default, the smallest that holds eight
+	 */
+
+	/**
+	 * Start one read that feeds several pipelines at once, e.g. a recorder, a spectrum display, and demodulators on
+	 * the same dongle, without each of them copying or reprocessing the samples in JS. The capture thread copies each
+	 * transfer once, into a slab the pipelines share. The first pipeline that delivers raw `'uint8'` samples, with no
+	 * processing options, delivers the slabs themselves as its `data` Buffers, up to `queueDepth` of them at once
+	 * until they are collected or passed to {@link RTLSDR#release}, and copies beyond that; every other pipeline runs
+	 * its processing on a native thread of its own. Each pipeline queues and drops on its own, under its own
+	 * `queueDepth` and `overflow`, so a slow listener or stage only ever loses its own pipeline's blocks, counted in
+	 * its own {@link RTLSDR~event:overflow}. Nothing is emitted on `this`; {@link RTLSDR#cancel} ends every pipeline.
+	 * @param {Number} [bufNum] - librtlsdr buffer count, as for {@link RTLSDR#read}
+	 * @param {Number} [bufLen] - librtlsdr buffer length, as for {@link RTLSDR#read}
+	 * @param {RTLSDR~PipelineOptions[]} pipelines - from 1 to 16 pipelines' options
+	 * @return {RTLSDR.FanOut} the running read, whose `pipelines` emit each pipeline's events
+	 * @throws {Error} the device is closed
+	 * @throws {Error} a read is already in progress
+	 * @throws {Error} a pipeline was given `squelch`, `history`, or `ring`
+	 * @throws {TypeError} `pipelines` is not an array of objects, or an option has the wrong type
+	 * @throws {RangeError} there are too few or too many pipelines, or an option is out of range
+	 * @see {@link RTLSDR#read} for the errors its options may raise
+	 * @example <caption>Record, plot, and listen to the same capture</caption>
+	 * const [raw, display, audio] = device
+	 * 	.sampleRate(2400000)
+	 * 	.fanOut(15, 262144, [
+	 * 		{ queueDepth: 64 },
+	 * 		{ spectrum: { size: 1024, averages: 100 }, overflow: 'drop-newest' },
+	 * 		{ demod: { mode: 'wbfm' } },
+	 * 	]).pipelines;
+	 * raw.on('data', buffer => file.write(buffer));
+	 * display.on('spectrum', bins => plot(bins));
+	 * audio.on('audio', ({ samples }) => speaker.write(samples));
+	 */
+	fanOut(bufNum, bufLen, pipelines) {
+		this.assertOpen();
+		return new FanOut(this, bufNum, bufLen, pipelines);
+	}
+
+	/**
+	 * Options for one pipeline of {@link RTLSDR#fanOut}: those of {@link RTLSDR~ReadOptions} except `squelch`,
+	 * `history`, and `ring`. `overflow` is `'drop-oldest'` by default and may not be `'block'`, since a pipeline that
+	 * stalled the capture thread would stall every other pipeline with it. A `record` pipeline that fails to write
+	 * stops recording and reports the error when the read ends, while the others carry on.
+	 * @typedef {Object} RTLSDR~PipelineOptions
+	 */
+
+	/**
+	 * Start a read whose samples arrive through a Readable stream with flow control, instead of as events on `this`.
+	 * When the stream's buffer reaches `highWaterMark`, delivery stops in the addon: further blocks wait in the
+	 * read's native queue (`queueDepth`), and once that is full too the read's `overflow` policy applies there,
+	 * stalling librtlsdr or dropping blocks, so a slow consumer never grows the JS heap. Delivery resumes when the
+	 * consumer drains the stream. The stream ends when the read finishes or is cancelled, emits `'error'` if the read
+	 * fails, and passes on {@link RTLSDR~event:overflow}, {@link RTLSDR~event:squelch-open}, and
+	 * {@link RTLSDR~event:squelch-close}. Destroying it cancels the read.
+	 * @param {RTLSDR~StreamOptions} [options] - buffering, stream mode, and read options
+	 * @return {stream.Readable} the stream of samples
+	 * @throws {Error} the device is closed
+	 * @throws {Error} a read is already in progress
+	 * @throws {Error} `channels`, `history`, or several `demod` receivers were given without `objectMode`
+	 * @throws {Error} `record` was given
+	 * @throws {TypeError} an option has the wrong type
+	 * @throws {RangeError} an option is out of range
+	 * @see {@link RTLSDR#read} for the errors its options may raise
+	 * @example <caption>Write raw samples to a file at whatever pace the disk allows, dropping the oldest
+	 * blocks natively if it falls 64 transfers behind</caption>
+	 * device
+	 * 	.createReadStream({ bufLen: 262144, queueDepth: 64, overflow: 'drop-oldest' })
+	 * 	.on('overflow', counts => console.warn(`lost ${counts.dropped} transfers`))
+	 * 	.pipe(fs.createWriteStream('capture.cu8'));
+	 */
+	createReadStream(options) {
+		this.assertOpen();
+		return new stream.SampleStream(this, options);
+	}
+
+	/**
+	 * Start a read and iterate over its samples with `for await`. Each value is what the matching event would
+	 * carry: a `data` or `spectrum` payload, or a `channel`, `audio`, or `capture` event's object. The iterator
+	 * reads from a stream as {@link RTLSDR#createReadStream} makes in object mode, so samples that are not taken
+	 * wait natively under the same flow control; leaving the loop early cancels the read.
+	 * @param {RTLSDR~StreamOptions} [options] - buffering and read options; `objectMode` is always on
+	 * @return {AsyncIterator} the samples; rejects with the read's error if it fails
+	 * @throws {Error} the device is closed
+	 * @throws {Error} a read is already in progress
+	 * @throws {TypeError} an option has the wrong type
+	 * @throws {RangeError} an option is out of range
+	 * @example <caption>Process 48 kS/s complex baseband, one block at a time</caption>
+	 * for await (const iq of device.samples({ format: 'float32', outputRate: 48000, highWaterMark: 8 })) {
+	 * 	await decode(iq);
+	 * }
+	 */
+	samples(options) {
+		this.assertOpen();
+		const opts = simpleClone(options || {});
+		opts.objectMode = true;
+		return new stream.SampleIterator(new stream.SampleStream(this, opts));
+	}
+
+	/**
+	 * Options for {@link RTLSDR#createReadStream} and {@link RTLSDR#samples}: any of {@link RTLSDR~ReadOptions},
+	 * plus the following.
+	 * @typedef {Object} RTLSDR~StreamOptions
+	 * @property {Number} [bufNum] - librtlsdr buffer count, as for {@link RTLSDR#read}
+	 * @property {Number} [bufLen] - librtlsdr buffer length, as for {@link RTLSDR#read}
+	 * @property {Boolean} [objectMode=false] - whether each chunk is a whole payload (a Buffer or typed array, or
+	 * the object a `channel`, `audio`, or `capture` event carries) rather than bytes. Needed for `channels`,
+	 * `history`, and more than one `demod` receiver
+	 * @property {Number} [highWaterMark] - how much the stream buffers before delivery pauses: chunks in object
+	 * mode (default 16), otherwise bytes (default four transfers' worth)
+	 */
+
+	/**
+	 * Capture the stretch of a read with history around now (see the `history` option of
+	 * {@link RTLSDR~ReadOptions}): `preMs` before the next transfer, taken from the ring, through `postMs` after it.
+	 * The capture arrives as a {@link RTLSDR~event:capture} event carrying the returned promise's id, and the
+	 * promise resolves with it. Up to 16 snapshots may be in progress at once.
+	 * @param {Number} preMs - milliseconds before now to capture; cut to what the ring holds
+	 * @param {Number} postMs - milliseconds after now to capture
+	 * @return {Promise<Object>} the {@link RTLSDR~event:capture} event's argument; rejects if the read finishes
+	 * first, or with the read's error if it fails
+	 * @throws {Error} the device is closed
+	 * @throws {Error} no read with history is in progress
+	 * @throws {Error} 16 snapshots are already in progress
+	 * @throws {TypeError} `preMs` or `postMs` is not a number
+	 * @throws {RangeError} `preMs` or `postMs` is negative, or together they span more than 2 GiB of samples
+	 * @example <caption>Save the 5 seconds before a user's button press, and 1 second after</caption>
+	 * button.on('press', () => device.snapshot(5000, 1000).then(({ samples }) => save('press.cu8', samples)));
+	 */
+	snapshot(preMs, postMs) {
+		this.assertOpen();
+		const id = librtlsdr.snapshot(this.device, preMs, postMs);
+
+		return new Promise((resolve, reject) => {
+			const finish = () => {
+				this.removeListener('capture', onCapture);
+				this.removeListener('done', onDone);
+				this.removeListener('error', onError);
+			};
+			const onCapture = (capture) => {
+				if (capture.id !== id) return;
+				finish();
+				resolve(capture);
+			};
+			const onDone = () => {
+				finish();
+				reject(new Error('the read finished before the snapshot was captured'));
+			};
+			const onError = (msg) => {
+				finish();
+				reject(new Error(msg));
+			};
+
+			this.on('capture', onCapture);
+			this.on('done', onDone);
+			this.on('error', onError);
+		});
+	}
+
+	/**
+	 * Scan a frequency range much wider than the sample rate, like `rtl_power`, without blocking the event loop. The
+	 * device's capture thread hops across the range with `rtlsdr_set_center_freq`, discards the samples taken while
+	 * each hop settles, averages a power spectrum over each dwell, and keeps the middle of each spectrum, away from
+	 * the tuner's filter roll-off. Each completed sweep is emitted as one {@link RTLSDR~event:sweep} row. Stop with
+	 * {@link RTLSDR#cancel}, or give `sweeps`; either way {@link RTLSDR~event:done} follows. The device is left tuned
+	 * to the last hop. The sample rate must be set first, and sets how much of the range each hop covers.
+	 * @param {RTLSDR~SweepOptions} options - the range and how to scan it
+	 * @return {RTLSDR} `this`
+	 * @throws {Error} the device is closed
+	 * @throws {Error} a read or sweep is already in progress
+	 * @throws {Error} the sample rate has not been set
+	 * @throws {TypeError} an option has the wrong type
+	 * @throws {RangeError} an option is out of range
+	 * @example <caption>Scan the FM broadcast band in 10 kHz bins</caption>
+	 * device
+	 * 	.sampleRate(2400000)
+	 * 	.on('sweep', ({ bins, start, binWidth }) => {
+	 * 		const peak = bins.indexOf(Math.max(...bins));
+	 * 		console.log(`strongest at ${(start + peak * binWidth) / 1e6} MHz`);
+	 * 	})
+	 * 	.sweep({ start: 88e6, stop: 108e6, binWidth: 10e3, dwell: 50 });
+	 */
+	sweep(options) {
+		this.assertOpen();
+		librtlsdr.sweep(this.device, (ev, arg) => { this.emit(ev, arg); }, options);
+		return this;
+	}
+
+	/**
+	 * A sweep started with {@link RTLSDR#sweep} has covered its range.
+	 * @event RTLSDR~sweep
+	 * @param {Object} row - the sweep's stitched spectrum
+	 * @param {Float32Array} row.bins - power levels in dB relative to a full-scale complex tone; `bins[n]` is the
+	 * power at `start + n * binWidth` Hz. The row is pooled like `data` payloads and may be passed to
+	 * {@link RTLSDR#release}
+	 * @param {Number} row.start - the frequency of `bins[0]` in Hz
+	 * @param {Number} row.binWidth - the spacing of the bins in Hz
+	 * @param {Number} row.startTime - when the sweep began, in milliseconds since the epoch
+	 * @param {Number} row.endTime - when the sweep finished, in milliseconds since the epoch
+	 */
+
+	/**
+	 * How {@link RTLSDR#sweep} scans.
+	 * @typedef {Object} RTLSDR~SweepOptions
+	 * @property {Number} start - the lowest frequency in Hz
+	 * @property {Number} stop - the highest frequency in Hz; the row ends at the first bin that reaches it
+	 * @property {Number} binWidth - the widest acceptable bin in Hz; the FFT size is the smallest power of two whose
+	 * bins are no wider, so the actual width may be narrower. From 1/65536 to 1/16 of the sample rate
+	 * @property {Number} [dwell=100] - milliseconds of samples averaged at each hop (1-60000)
+	 * @property {Number} [settle=5] - milliseconds of samples discarded after each retune (0-10000)
+	 * @property {Number} [crop=0.25] - the fraction of each hop's bins discarded, half from each edge (0-0.99)
+	 * @property {String} [window='hann'] - `'rectangular'`, `'hann'`, `'hamming'`, `'blackman'`, or
+	 * `'blackman-harris'`
+	 * @property {Number} [sweeps=0] - how many sweeps to make; 0 to sweep until cancelled
+	 * @property {Number} [queueDepth=32] - how many rows may be pending at once (1-4096)
+	 * @property {String} [overflow='block'] - as in {@link RTLSDR~ReadOptions}
+	 */
+
+	/**
+	 * Return a {@link RTLSDR~event:data} payload's memory to the native pool without waiting for garbage collection,
+	 * keeping steady-state streaming allocation-free. The payload's contents may be overwritten by later samples, so it
+	 * must not be used after this call. Release each payload at most once.
+	 * @param {Buffer|Int16Array|Float32Array} buffer - a payload received from a `data` event
+	 * @return {Boolean} `true` iff the payload's memory was returned to a pool
+	 * @throws {TypeError} `buffer` is not a Buffer or typed array
+	 * @example
+	 * device.on('data', (buffer) => {
+	 * 	consume(buffer);
+	 * 	device.release(buffer);
+	 * });
+	 */
+	release(buffer) {
+		return librtlsdr.release_buffer(buffer);
+	}
+
+	/**
+	 * The DC offset and I/Q imbalance being corrected by the current read, for monitoring. Only available while a
+	 * read started with the `dcBlock` or `iqBalance` option (see {@link RTLSDR~ReadOptions}) is running.
+	 * @return {?RTLSDR~IQCorrection} the current estimates, or `null` if no correcting read is running
+	 * @throws {Error} the device is closed
+	 */
+	iqCorrection() {
+		this.assertOpen();
+		return librtlsdr.get_iq_correction(this.device);
+	}
+
+	/**
+	 * How the current recording is keeping up with the disk. Only available while a read started with the `record`
+	 * option (see {@link RTLSDR~ReadOptions}) is running.
+	 * @return {?RTLSDR~RecordStats} the recording's counters, or `null` if no recording read is running
+	 * @throws {Error} the device is closed
+	 */
+	recordStats() {
+		this.assertOpen();
+		return librtlsdr.get_record_stats(this.device);
+	}
+
+	/**
+	 * Counters kept by a native recording.
+	 * @typedef {Object} RTLSDR~RecordStats
+	 * @property {Number} bytesWritten - bytes written to data files so far
+	 * @property {Number} bytesDropped - bytes discarded because every block was waiting to be written, under a drop
+	 * `overflow` policy
+	 * @property {Number} writes - how many blocks have been written
+	 * @property {Object} writeLatency - how long each block's write took, in milliseconds
+	 * @property {Number} writeLatency.last - the latest write
+	 * @property {Number} writeLatency.mean - the mean over every write
+	 * @property {Number} writeLatency.max - the slowest write
+	 * @property {Number} backlog - full blocks waiting to be written
+	 * @property {Number} maxBacklog - the most blocks that have waited at once; nearing `blocks` means the disk is
+	 * barely keeping up
+	 * @property {Number} blocks - the configured block count
+	 * @property {Number} files - how many data files have been started
+	 * @property {?String} file - the data file being written, if any
+	 * @property {Boolean} direct - whether that file is being written with `O_DIRECT`
+	 */
+
+	/**
+	 * How streaming on this device is keeping up, from the USB transfers to the listeners. The counters are kept
+	 * natively, with no locks between the capture thread and the event loop, so calling this never holds up the
+	 * stream. They accumulate over every read since the device was opened, or since the last call with `reset`.
+	 * @param {Boolean} [reset=false] - start the counters over after reading them
+	 * @return {RTLSDR~StreamStats} the counters
+	 * @throws {Error} the device is closed
+	 * @throws {TypeError} `reset` is not a boolean
+	 * @example <caption>Log a minute's worth of health at a time</caption>
+	 * setInterval(() => {
+	 * 	const { dropped, latency, sampleRate } = device.stats(true);
+	 * 	console.log(`dropped ${dropped}, p99 ${latency.p99} ms, ${sampleRate.effective / 1e6} MS/s`);
+	 * }, 60000);
+	 */
+	stats(reset) {
+		this.assertOpen();
+		return librtlsdr.get_stream_stats(this.device, reset);
+	}
+
+	/**
+	 * Streaming counters kept for a device.
+	 * @typedef {Object} RTLSDR~StreamStats
+	 * @property {Number} transfers - transfers librtlsdr handed over from the dongle
+	 * @property {Number} bytes - bytes in those transfers
+	 * @property {Number} dropped - blocks discarded because a read's queue was full, under a drop `overflow` policy
+	 * (see {@link RTLSDR~ReadOptions}); also reported by {@link RTLSDR~event:overflow}
+	 * @property {Number} maxQueueDepth - the most blocks that have waited for the event loop at once; nearing a
+	 * read's `queueDepth` means JS is barely keeping up
+	 * @property {Number} wakeups - how many times the event loop was woken to deliver blocks
+	 * @property {Number} delivered - blocks emitted to listeners, as `data`, `channel`, `spectrum`, `audio`,
+	 * `capture`, or `sweep` events
+	 * @property {Number} coalesced - blocks that were emitted in the same wakeup as an earlier one, because the event
+	 * loop was busy when they arrived
+	 * @property {Object} sampleRate - how fast samples are really arriving
+	 * @property {Number} sampleRate.configured - the device's sample rate setting
+	 * @property {Number} sampleRate.effective - complex samples per second received during the latest read; well
+	 * below `configured` means the dongle or USB bus is losing transfers before they reach the process
+	 * @property {Number} sampleRate.window - the milliseconds `effective` was measured over
+	 * @property {Object} latency - milliseconds from a transfer reaching the capture thread to its block being
+	 * emitted, from a histogram with about 3% resolution; sweep rows are not included
+	 * @property {Number} latency.count - how many blocks were measured
+	 * @property {Number} latency.min - the shortest
+	 * @property {Number} latency.mean - the mean
+	 * @property {Number} latency.p50 - the median
+	 * @property {Number} latency.p90 - the 90th percentile
+	 * @property {Number} latency.p99 - the 99th percentile
+	 * @property {Number} latency.p999 - the 99.9th percentile
+	 * @property {Number} latency.max - the longest
+	 */
+
+	/**
+	 * Move a replay to the given sample. The next transfer starts there (or at the end, if the recording is shorter)
+	 * and pacing starts over, so a read in progress carries on from the new position.
+	 * @param {Number} sample - the zero-based sample to continue from
+	 * @return {RTLSDR} `this`
+	 * @throws {Error} the device is closed
+	 * @throws {TypeError} this instance is not replaying a recording, or `sample` is not a number
+	 * @throws {RangeError} `sample` is negative
+	 */
+	seek(sample) {
+		this.assertOpen();
+		librtlsdr.seek_file(this.device, sample);
+		return this;
+	}
+
+	/**
+	 * Where a replay is.
+	 * @return {{position: Number, length: Number}} the next sample to be read and the samples in the recording
+	 * @throws {Error} the device is closed
+	 * @throws {TypeError} this instance is not replaying a recording
+	 */
+	position() {
+		this.assertOpen();
+		return librtlsdr.get_file_position(this.device);
+	}
+
+	/**
+	 * Change how fast a replay delivers samples; takes effect with the next transfer.
+	 * @param {Number} speed - 1 for real time, N for N times real time, or 0 for unthrottled (0-10000)
+	 * @return {RTLSDR} `this`
+	 * @throws {Error} the device is closed
+	 * @throws {TypeError} this instance is not replaying a recording, or `speed` is not a number
+	 * @throws {RangeError} `speed` is out of range
+	 */
+	speed(speed) {
+		this.assertOpen();
+		librtlsdr.set_file_speed(this.device, speed);
+		return this;
+	}
+
+	/**
+	 * Choose whether a replay starts over at the end of the recording or finishes the read there.
+	 * @param {Boolean} loop - whether to loop
+	 * @return {RTLSDR} `this`
+	 * @throws {Error} the device is closed
+	 * @throws {TypeError} this instance is not replaying a recording, or `loop` is not a boolean
+	 */
+	loop(loop) {
+		this.assertOpen();
+		librtlsdr.set_file_loop(this.device, loop);
+		return this;
+	}
+
+	/**
+	 * Running estimates used by the native DC / I/Q correction. All values are in the normalized -1.0 to 1.0 scale.
+	 * @typedef {Object} RTLSDR~IQCorrection
+	 * @property {Number} dcI - the DC offset removed from I
+	 * @property {Number} dcQ - the DC offset removed from Q
+	 * @property {Number} gain - the estimated Q/I amplitude ratio (1 when balanced or when `iqBalance` is off)
+	 * @property {Number} phase - the estimated quadrature phase error in radians
+	 * @property {Number} samples - complex samples corrected so far
+	 */
+
+	/**
+	 * Cancel asynchronous reads that were initiated with {@link RTLSDR#read} or {@link RTLSDR#wait}, or a sweep
+	 * initiated with {@link RTLSDR#sweep}. Samples already
+	 * received are still emitted, followed by {@link RTLSDR~event:done}; a new read may be started right away and
+	 * will begin once the cancelled one has wound down.
 	 * @return {RTLSDR} `this`
 	 * @throws {Error} the device is closed
 	 */
@@ -760,10 +1665,92 @@ RTLSDR.indexBySerial = serial => librtlsdr.get_index_by_serial(serial);
 /**
  * Static convenience function to create (and open) a new RTLSDR instance.
  * @param {Number} index - the index of the RTLSDR device to open
+ * @param {RTLSDR~ThreadOptions} [threadOptions] - optional scheduling for the device's capture thread
  * @return {RTLSDR} a new RTLSDR instance for the specified index
  * @throws {TypeError} `index` is not a number
  */
-RTLSDR.open = index => new RTLSDR(index);
+RTLSDR.open = (index, threadOptions) => new RTLSDR(index, threadOptions);
+
+/**
+ * Static convenience function to create an RTLSDR instance that replays a recording instead of reading a device.
+ * Reads, sweeps, and every read option work as they would on hardware; settings are kept but change nothing, except
+ * that the sample rate is the recording's. A non-looping read finishes at the end of the file.
+ * @param {String} path - the recording (`.cu8`) or its SigMF sidecar (`.sigmf-meta`)
+ * @param {RTLSDR~ReplayOptions} [replayOptions] - how to replay it
+ * @param {RTLSDR~ThreadOptions} [threadOptions] - optional scheduling for the replay's capture thread
+ * @return {RTLSDR} a new RTLSDR instance for the recording
+ * @throws {TypeError} `path` is not a non-empty string, or an option has the wrong type
+ * @throws {RangeError} an option is out of range
+ * @throws {Error} the recording could not be opened, or has no sample rate
+ * @example <caption>Replay a recording at four times real time, demodulating as it goes</caption>
+ * RTLSDR.openFile('/data/capture.sigmf-meta', { speed: 4 })
+ * 	.on('audio', ({ samples }) => speaker.write(samples))
+ * 	.on('done', () => console.log('end of recording'))
+ * 	.read(15, 262144, { demod: { mode: 'wbfm' } });
+ */
+RTLSDR.openFile = (path, replayOptions, threadOptions) => new RTLSDR(path, threadOptions, replayOptions);
+
+/**
+ * Options for a {@link RTLSDR.group} capture.
+ * @typedef {Object} RTLSDR~GroupOptions
+ * @property {Number} [blockSize] - complex samples per device in each matched block (1-1048576); defaults to half
+ * of `bufLen`
+ * @property {String} [align='time'] - how to find each device's first group sample: `'time'` lines up the devices'
+ * first transfers by their arrival times, as closely as USB timing allows, and `'index'` takes every device's
+ * first sample as its first group sample
+ * @property {Number[]} [offsets] - further complex samples of each device's stream to skip, one per device in the
+ * order given, applied on top of `align`; for a finer calibration, e.g. from cross-correlating a reference signal
+ * @property {Number} [queueDepth=32] - how many matched blocks may be pending at once (1-4096)
+ * @property {String} [overflow='block'] - as in {@link RTLSDR~ReadOptions}, for matched blocks
+ * @property {String} [format='uint8'] - `'uint8'`, `'int16'`, or `'float32'`, as in {@link RTLSDR~ReadOptions}
+ */
+
+/**
+ * Capture from several open devices in step, for receivers that share a reference clock (e.g. a coherent array of
+ * dongles). Every device must be idle and set to the same sample rate. Their buffers are reset and their reads
+ * started back to back, each on the device's own capture thread; the streams are then lined up and cut into blocks
+ * of the same `blockSize` samples from every device, emitted together. Cancelling the group, or any of its devices,
+ * or closing one, ends the whole capture. A device that falls further behind the others than its transfer buffers
+ * and the group's queue allow fails the group.
+ * @param {RTLSDR[]} devices - from 2 to 32 distinct, open devices
+ * @param {Number} [bufNum] - librtlsdr buffer count per device, as in {@link RTLSDR#read}
+ * @param {Number} [bufLen] - librtlsdr buffer length, as in {@link RTLSDR#read}
+ * @param {RTLSDR~GroupOptions} [options] - block size, alignment, queueing and format
+ * @return {RTLSDR.CaptureGroup} the running group
+ * @throws {TypeError} `devices` is not an array, one of them is closed, or an option has the wrong type
+ * @throws {RangeError} there are too few or too many devices, or an option is out of range
+ * @throws {Error} a device appears twice or is busy, or the sample rates differ
+ * @example <caption>Capture from two coherent receivers for a second</caption>
+ * const devices = [0, 1].map(index => RTLSDR.open(index).sampleRate(2.4e6).centerFreq(1090e6));
+ * const group = RTLSDR.group(devices, 15, 65536, { blockSize: 32768 })
+ * 	.on('aligned', leads => console.log('leads', leads))
+ * 	.on('data', (blocks, timing) => {
+ * 		correlate(blocks[0], blocks[1], timing[0]);
+ * 		devices[0].release(blocks[0]); // returns every device's block
+ * 	});
+ *
+ * setTimeout(() => group.cancel(), 1000);
+ */
+RTLSDR.group = (devices, bufNum, bufLen, options) => new CaptureGroup(devices, bufNum, bufLen, options);
+
+/**
+ * The class of the object {@link RTLSDR.group} returns.
+ * @type {RTLSDR.CaptureGroup}
+ */
+RTLSDR.CaptureGroup = CaptureGroup;
+
+/**
+ * The class of the object {@link RTLSDR#fanOut} returns.
+ * @type {RTLSDR.FanOut}
+ */
+RTLSDR.FanOut = FanOut;
+
+/**
+ * The consumer of the ring {@link RTLSDR#readShared} returns; also `require('js-rtlsdr/lib/api/ring')`, which
+ * does not load the addon.
+ * @type {RTLSDR.RingReader}
+ */
+RTLSDR.RingReader = RingReader;
 
 /**
  * Convenience method to list all available RTLSDR devices, their names, and their USB strings.
@@ -0,0 +1,202 @@
+// the layout of lib/addon/sample_ring.h; this module does not load the addon, so a Worker can use it on its own
+
+/** @private */
+const HEADER_BYTES = 256;
+/** @private */
+const RECORD_BYTES = 32;
+/** @private */
+const PADDING = -1;
+
+/** @private */
+const WRITE = 0;
+/** @private */
+const READ = 16;
+/** @private */
+const STATE = 32;
+/** @private */
+const FORMAT = 33;
+/** @private */
+const CAPACITY = 34;
+/** @private */
+const DROPPED = 35;
+
+/** @private */
+const STATE_RUNNING = 0;
+/** @private */
+const STATE_ERROR = 2;
+
+/** @private */
+const MIN_CAPACITY = 4096;
+/** @private */
+const MAX_CAPACITY = 1 << 30;
+
+/** @private */
+const ARRAY_TYPES = [Uint8Array, Int16Array, Float32Array];
+
+/** @private */
+function recordBytes(payloadBytes) {
+	return RECORD_BYTES + Math.ceil(payloadBytes / RECORD_BYTES) * RECORD_BYTES;
+}
+
+/**
+ * The consumer of a ring filled by {@link RTLSDR#readShared}, in any thread: construct it over the
+ * SharedArrayBuffer that `readShared` returned, after passing the buffer to a Worker with `postMessage` or
+ * `workerData`, which shares it rather than copying it. The capture thread writes each transfer into the ring as
+ * it arrives; a reader takes them in order, straight out of the shared memory, and blocks in `Atomics.wait` while
+ * the ring is empty. Only one reader may consume a ring at a time. Transfers that arrive while the ring is full are
+ * dropped whole and counted in {@link RTLSDR.RingReader#dropped}.
+ *
+ * Blocking waits belong in a Worker: the main thread wakes waiting readers, so a reader on the main thread must poll
+ * with a `timeout` of `0` instead.
+ * @param {SharedArrayBuffer} ring - the buffer returned by {@link RTLSDR#readShared}
+ * @throws {TypeError} `ring` is not a SharedArrayBuffer
+ * @throws {RangeError} `ring` is not laid out as a sample ring
+ * @example <caption>Consume samples in a Worker</caption>
+ * // main thread
+ * const ring = device.sampleRate(2048000).readShared(15, 262144, { format: 'float32' });
+ * new Worker('./dsp.js', { workerData: ring });
+ *
+ * // dsp.js
+ * const { workerData } = require('worker_threads');
+ * const RingReader = require('js-rtlsdr/lib/api/ring');
+ * for (const { samples, index } of new RingReader(workerData)) process(samples, index);
+ */
+class RingReader {
+	constructor(ring) {
+		if (!(ring instanceof SharedArrayBuffer)) throw new TypeError('ring must be a SharedArrayBuffer');
+
+		const header = new Int32Array(ring, 0, HEADER_BYTES / 4);
+		const capacity = header[CAPACITY];
+		const Type = ARRAY_TYPES[header[FORMAT]];
+
+		if (ring.byteLength !== HEADER_BYTES + capacity || capacity < MIN_CAPACITY || Type === undefined) {
+			throw new RangeError('ring is not a sample ring');
+		}
+
+		this.ring = ring;
+		this.header = header;
+		this.capacity = capacity;
+		this.Type = Type;
+		this.words = new Int32Array(ring);
+		this.doubles = new Float64Array(ring);
+		this.position = Atomics.load(header, READ);
+		this.taken = 0;
+	}
+
+	/**
+	 * The next transfer, or `null` once the read has finished and every transfer has been taken, or when `timeout`
+	 * runs out first. The transfer's samples are a view of the ring itself, valid until the next call, which hands
+	 * their space back to the capture thread; copy them to keep them longer.
+	 * @param {Number} [timeout=Infinity] - the most milliseconds to wait for a transfer; `0` to never wait
+	 * @return {?RTLSDR~RingRecord} the transfer
+	 */
+	read(timeout) {
+		this.release();
+
+		const deadline = timeout === undefined ? Infinity : Date.now() + timeout;
+
+		for (;;) {
+			const write = Atomics.load(this.header, WRITE);
+			if (write !== this.position) break;
+
+			// the state is set after the last record is published, so nothing can follow it
+			if (Atomics.load(this.header, STATE) !== STATE_RUNNING) {
+				if (Atomics.load(this.header, WRITE) === this.position) return null;
+				break;
+			}
+
+			const remaining = deadline - Date.now();
+			if (remaining <= 0) return null;
+
+			Atomics.wait(this.header, WRITE, write, remaining);
+		}
+
+		let at = this.position & (this.capacity - 1);
+		if (this.words[(HEADER_BYTES + at) / 4] === PADDING) {
+			this.position = (this.position + this.capacity - at) | 0;
+			at = 0;
+		}
+
+		const start = HEADER_BYTES + at;
+		const payloadBytes = this.words[start / 4];
+		this.taken = recordBytes(payloadBytes);
+
+		return {
+			samples: new this.Type(this.ring, start + RECORD_BYTES, payloadBytes / this.Type.BYTES_PER_ELEMENT),
+			index: this.doubles[start / 8 + 1],
+			monotonic: this.doubles[start / 8 + 2],
+			realtime: this.doubles[start / 8 + 3]
+		};
+	}
+
+	/**
+	 * A transfer taken from the ring.
+	 * @typedef {Object} RTLSDR~RingRecord
+	 * @property {(Uint8Array|Int16Array|Float32Array)} samples - interleaved I/Q in the read's `format`, over the
+	 * ring's memory
+	 * @property {Number} index - complex samples since the read began, at the transfer's first sample; a jump
+	 * between transfers means some were dropped
+	 * @property {Number} monotonic - `CLOCK_MONOTONIC` milliseconds when the transfer reached the capture thread
+	 * @property {Number} realtime - `CLOCK_REALTIME` milliseconds since the Unix epoch at the same moment
+	 */
+
+	/** @private */
+	release() {
+		if (this.taken === 0) return;
+
+		this.position = (this.position + this.taken) | 0;
+		this.taken = 0;
+		Atomics.store(this.header, READ, this.position);
+	}
+
+	/**
+	 * Take every transfer until the read finishes, blocking while the ring is empty.
+	 * @return {Iterator<RTLSDR~RingRecord>} the transfers
+	 */
+	*[Symbol.iterator]() {
+		for (let record = this.read(); record !== null; record = this.read()) yield record;
+	}
+
+	/**
+	 * Whether the read has finished, so that no more transfers will be written.
+	 * @type {Boolean}
+	 */
+	get finished() {
+		return Atomics.load(this.header, STATE) !== STATE_RUNNING;
+	}
+
+	/**
+	 * Whether the read ended in an error; the device's {@link RTLSDR~event:error} carries the message.
+	 * @type {Boolean}
+	 */
+	get failed() {
+		return Atomics.load(this.header, STATE) === STATE_ERROR;
+	}
+
+	/**
+	 * Transfers dropped so far because the ring was full.
+	 * @type {Number}
+	 */
+	get dropped() {
+		return Atomics.load(this.header, DROPPED) >>> 0;
+	}
+}
+
+/**
+ * The size of the SharedArrayBuffer for a ring of `capacity` bytes, or by default the smallest one that holds
+ * eight transfers of `transferBytes` once converted.
+ * @private
+ */
+RingReader.bufferSize = (transferBytes, capacity) => {
+	if (capacity !== undefined && typeof capacity !== 'number') throw new TypeError('ringSize must be a number');
+
+	let size = capacity;
+	if (size === undefined) {
+		size = MIN_CAPACITY;
+		while (size < 8 * recordBytes(transferBytes) && size < MAX_CAPACITY) size *= 2;
+	}
+
+	return HEADER_BYTES + size;
+};
+
+module.exports = RingReader;
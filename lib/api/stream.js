@@ -0,0 +1,149 @@
+const librtlsdr = require('../addon/');
+const Readable = require('stream').Readable;
+
+/** @private */
+const PASSED_THROUGH = ['squelch-open', 'squelch-close', 'overflow'];
+
+/** @private */
+function toBuffer(samples) {
+	if (Buffer.isBuffer(samples)) return samples;
+	return Buffer.from(samples.buffer, samples.byteOffset, samples.byteLength);
+}
+
+/**
+ * A Readable over one native read. The addon's listener returns what `push` returns, so once the stream's buffer
+ * reaches its high water mark the addon stops delivering and blocks wait in the read's native queue; `_read`
+ * resumes it. When that queue is full too, the read's `overflow` policy stalls librtlsdr or drops blocks natively.
+ * @private
+ */
+class SampleStream extends Readable {
+	constructor(sdr, options) {
+		const opts = options || {};
+		const objectMode = opts.objectMode === true;
+
+		if (!objectMode && (opts.channels || opts.history || (Array.isArray(opts.demod) && opts.demod.length > 1))) {
+			throw new Error('channels, history, and more than one demod receiver need objectMode');
+		}
+
+		if (opts.record) throw new Error('a recording read delivers nothing to stream');
+
+		let highWaterMark = opts.highWaterMark;
+		if (highWaterMark === undefined && !objectMode) highWaterMark = 4 * (opts.bufLen || 16 * 32 * 512);
+
+		super({ objectMode, highWaterMark });
+
+		this.sdr = sdr;
+		this.objectMode = objectMode;
+		this.nativePaused = false;
+		this.readFinished = false;
+
+		librtlsdr.reset_buffer(sdr.device);
+		librtlsdr.read_async(sdr.device, (ev, arg) => this.deliver(ev, arg), opts.bufNum, opts.bufLen, opts);
+	}
+
+	deliver(ev, arg) {
+		if (PASSED_THROUGH.indexOf(ev) >= 0) {
+			this.emit(ev, arg);
+			return undefined;
+		}
+
+		if (ev === 'done' || ev === 'error') {
+			this.readFinished = true;
+			if (this.destroyed) return undefined;
+
+			if (ev === 'error') this.destroy(new Error(arg));
+			else this.push(null);
+			return undefined;
+		}
+
+		// what arrives after destroy is only drained, so that the read can wind down
+		if (this.destroyed) {
+			if (ev === 'data') librtlsdr.release_buffer(arg);
+			return undefined;
+		}
+
+		let chunk = arg;
+		if (!this.objectMode) chunk = toBuffer(ev === 'data' || ev === 'spectrum' ? arg : arg.samples);
+
+		const more = this.push(chunk);
+		if (!more) this.nativePaused = true;
+		return more;
+	}
+
+	_read() {
+		if (!this.nativePaused) return;
+
+		this.nativePaused = false;
+		if (this.sdr.isOpen()) librtlsdr.resume_async(this.sdr.device);
+	}
+
+	_destroy(err, callback) {
+		if (!this.readFinished && this.sdr.isOpen()) librtlsdr.cancel_async(this.sdr.device);
+		callback(err);
+	}
+}
+
+/**
+ * An async iterator over a {@link SampleStream} in object mode. Each `next` takes one chunk, waiting for the next
+ * `readable` if there is none; `return` (a `break` out of `for await`) destroys the stream, which cancels the read.
+ * @private
+ */
+class SampleIterator {
+	constructor(stream) {
+		this.stream = stream;
+		this.ended = false;
+		this.error = null;
+		this.waiting = null;
+		this.last = Promise.resolve();
+
+		const wake = () => {
+			const waiting = this.waiting;
+			this.waiting = null;
+			if (waiting) waiting();
+		};
+
+		stream.on('readable', wake);
+		stream.on('end', () => { this.ended = true; wake(); });
+		stream.on('error', (err) => { this.error = err; wake(); });
+	}
+
+	take() {
+		return new Promise((resolve, reject) => {
+			const attempt = () => {
+				if (this.error) {
+					const err = this.error;
+					this.error = null;
+					this.ended = true;
+					reject(err);
+					return;
+				}
+
+				const chunk = this.ended ? null : this.stream.read();
+				if (chunk !== null) resolve({ value: chunk, done: false });
+				else if (this.ended) resolve({ value: undefined, done: true });
+				else this.waiting = attempt;
+			};
+
+			attempt();
+		});
+	}
+
+	next() {
+		// calls that overlap take chunks in the order they were made
+		const result = this.last.then(() => this.take());
+		this.last = result.catch(() => {});
+		return result;
+	}
+
+	return() {
+		this.ended = true;
+		this.stream.destroy();
+		return Promise.resolve({ value: undefined, done: true });
+	}
+
+	[Symbol.asyncIterator]() {
+		return this;
+	}
+}
+
+module.exports = { SampleStream, SampleIterator };
@@ -15,7 +15,7 @@ void mock_get_rtlsdr_dev_contents(const Nan::FunctionCallbackInfo<Value> & info)
 	if(dev_hnd_val->IsObject()) {
 		Local<Object> dev_hnd = Nan::To<Object>(dev_hnd_val).ToLocalChecked();
 
-		if(dev_hnd->InternalFieldCount() == 1) {
+		if(dev_hnd->InternalFieldCount() == 2) {
 			rtl_dev = (rtlsdr_dev_t *) Nan::GetInternalFieldPointer(dev_hnd, 0);
 		}
 	}
@@ -48,6 +48,21 @@ void mock_get_rtlsdr_dev_contents(const Nan::FunctionCallbackInfo<Value> & info)
 	SET_DEV_FIELD(mockContent, rtl_dev, buffer_ready);
 	SET_DEV_FIELD(mockContent, rtl_dev, open);
 	SET_DEV_FIELD(mockContent, rtl_dev, has_eeprom);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_eeprom_delay_ms);
+
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_synthetic);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_paced);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_tone_offset);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_tone_amplitude);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_noise_amplitude);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_burst_period_ms);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_burst_ms);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_jitter_us);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_drop_every);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_transfers);
+	SET_DEV_FIELD(mockContent, rtl_dev, mock_dropped);
+	Nan::Set(mockContent, Nan::New("mock_samples").ToLocalChecked(),
+	         Nan::New<v8::Number>((double) rtl_dev->mock_samples));
 
 	info.GetReturnValue().Set(mockContent);
 }
@@ -62,7 +77,7 @@ void mock_set_rtlsdr_dev_contents(const Nan::FunctionCallbackInfo<Value> & info)
 	if(dev_hnd_val->IsObject()) {
 		Local<Object> dev_hnd = Nan::To<Object>(dev_hnd_val).ToLocalChecked();
 
-		if(dev_hnd->InternalFieldCount() == 1) {
+		if(dev_hnd->InternalFieldCount() == 2) {
 			rtl_dev = (rtlsdr_dev_t *) Nan::GetInternalFieldPointer(dev_hnd, 0);
 		}
 	}
@@ -131,6 +146,36 @@ void mock_set_rtlsdr_dev_contents(const Nan::FunctionCallbackInfo<Value> & info)
 	} else if(0 == field_str.compare("has_eeprom")) {
 		if(!val->IsBoolean()) return Nan::ThrowTypeError("val must be a boolean for that field");
 		rtl_dev->has_eeprom = Nan::To<bool>(val).FromJust();
+	} else if(0 == field_str.compare("mock_synthetic")) {
+		if(!val->IsBoolean()) return Nan::ThrowTypeError("val must be a boolean for that field");
+		rtl_dev->mock_synthetic = Nan::To<bool>(val).FromJust();
+	} else if(0 == field_str.compare("mock_paced")) {
+		if(!val->IsBoolean()) return Nan::ThrowTypeError("val must be a boolean for that field");
+		rtl_dev->mock_paced = Nan::To<bool>(val).FromJust();
+	} else if(0 == field_str.compare("mock_tone_offset")) {
+		if(!val->IsNumber()) return Nan::ThrowTypeError("val must be a number for that field");
+		rtl_dev->mock_tone_offset = Nan::To<double>(val).FromJust();
+	} else if(0 == field_str.compare("mock_tone_amplitude")) {
+		if(!val->IsNumber()) return Nan::ThrowTypeError("val must be a number for that field");
+		rtl_dev->mock_tone_amplitude = Nan::To<double>(val).FromJust();
+	} else if(0 == field_str.compare("mock_noise_amplitude")) {
+		if(!val->IsNumber()) return Nan::ThrowTypeError("val must be a number for that field");
+		rtl_dev->mock_noise_amplitude = Nan::To<double>(val).FromJust();
+	} else if(0 == field_str.compare("mock_burst_period_ms")) {
+		if(!val->IsNumber()) return Nan::ThrowTypeError("val must be a number for that field");
+		rtl_dev->mock_burst_period_ms = Nan::To<uint32_t>(val).FromJust();
+	} else if(0 == field_str.compare("mock_burst_ms")) {
+		if(!val->IsNumber()) return Nan::ThrowTypeError("val must be a number for that field");
+		rtl_dev->mock_burst_ms = Nan::To<uint32_t>(val).FromJust();
+	} else if(0 == field_str.compare("mock_jitter_us")) {
+		if(!val->IsNumber()) return Nan::ThrowTypeError("val must be a number for that field");
+		rtl_dev->mock_jitter_us = Nan::To<uint32_t>(val).FromJust();
+	} else if(0 == field_str.compare("mock_eeprom_delay_ms")) {
+		if(!val->IsNumber()) return Nan::ThrowTypeError("val must be a number for that field");
+		rtl_dev->mock_eeprom_delay_ms = Nan::To<uint32_t>(val).FromJust();
+	} else if(0 == field_str.compare("mock_drop_every")) {
+		if(!val->IsNumber()) return Nan::ThrowTypeError("val must be a number for that field");
+		rtl_dev->mock_drop_every = Nan::To<uint32_t>(val).FromJust();
 	} else {
 		return Nan::ThrowError("don't know how to set that field");
 	}
@@ -153,7 +198,7 @@ void mock_is_device_handle(const Nan::FunctionCallbackInfo<v8::Value> & info) {
 	if(dev_hnd_val->IsObject()) {
 		Local<Object> dev_hnd = Nan::To<Object>(dev_hnd_val).ToLocalChecked();
 
-		if(dev_hnd->InternalFieldCount() == 1) {
+		if(dev_hnd->InternalFieldCount() == 2) {
 			rtl_dev = (rtlsdr_dev_t *) Nan::GetInternalFieldPointer(dev_hnd, 0);
 		}
 	}
@@ -168,7 +213,7 @@ void mock_get_written_eeprom(const Nan::FunctionCallbackInfo<v8::Value> & info)
 	if(dev_hnd_val->IsObject()) {
 		Local<Object> dev_hnd = Nan::To<Object>(dev_hnd_val).ToLocalChecked();
 
-		if(dev_hnd->InternalFieldCount() == 1) {
+		if(dev_hnd->InternalFieldCount() == 2) {
 			rtl_dev = (rtlsdr_dev_t *) Nan::GetInternalFieldPointer(dev_hnd, 0);
 		}
 	}
@@ -1,5 +1,21 @@
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
 const should = require('chai').should();
 const rtlsdr = require('bindings')('js-rtlsdr-addon-mocked.node');
+const RingReader = require('../../lib/api/ring');
+
+// lib/api drives whichever addon lib/addon loads; hand it the mocked one
+const addonPath = require.resolve('../../lib/addon/');
+require.cache[addonPath] = { id: addonPath, filename: addonPath, loaded: true, exports: rtlsdr };
+const RTLSDR = require('../../lib/api');
+
+let Worker;
+try {
+	({ Worker } = require('worker_threads'));
+} catch (e) {
+	Worker = null; // before Node.js 11.7, or without --experimental-worker
+}
 
 describe('rtlsdr_wrapper addon', () => {
 	beforeEach(() => rtlsdr.mock_set_device_count(1));
@@ -92,6 +108,152 @@ describe('rtlsdr_wrapper addon', () => {
 		it('throws if index does not exist', () => {
 			(() => rtlsdr.open(2)).should.throw();
 		});
+
+		it('throws if opts is not an object', () => {
+			(() => rtlsdr.open(0, 'hi mom')).should.throw(TypeError);
+		});
+
+		it('throws if thread options are of the wrong type', () => {
+			(() => rtlsdr.open(0, { cpu: 'hi mom' })).should.throw(TypeError);
+			(() => rtlsdr.open(0, { cpu: [0, 'hi mom'] })).should.throw(TypeError);
+			(() => rtlsdr.open(0, { realtimePriority: 'hi mom' })).should.throw(TypeError);
+			(() => rtlsdr.open(0, { nice: 'hi mom' })).should.throw(TypeError);
+		});
+
+		it('throws if thread options are out of range', () => {
+			(() => rtlsdr.open(0, { cpu: -1 })).should.throw(RangeError);
+			(() => rtlsdr.open(0, { cpu: [0, 1024] })).should.throw(RangeError);
+			(() => rtlsdr.open(0, { realtimePriority: 0 })).should.throw(RangeError);
+			(() => rtlsdr.open(0, { realtimePriority: 100 })).should.throw(RangeError);
+			(() => rtlsdr.open(0, { nice: 20 })).should.throw(RangeError);
+		});
+
+		it('applies a nice value to the capture thread', () => {
+			const dev = rtlsdr.open(0, { nice: 5 });
+			rtlsdr.mock_is_device_handle(dev).should.equal(true);
+			rtlsdr.close(dev);
+		});
+	});
+
+	describe('open_file(path, opts, thread_opts)', () => {
+		let dir;
+		let base;
+		const recording = Buffer.alloc(65536);
+		for (let i = 0; i < recording.length; i++) recording[i] = i % 251;
+
+		beforeEach(() => {
+			dir = fs.mkdtempSync(path.join(os.tmpdir(), 'js-rtlsdr-'));
+			base = path.join(dir, 'rec');
+			fs.writeFileSync(`${base}.cu8`, recording);
+			fs.writeFileSync(`${base}.sigmf-meta`, JSON.stringify({
+				global: { 'core:datatype': 'cu8', 'core:sample_rate': 256000, 'core:dataset': 'rec.cu8' },
+				captures: [{ 'core:sample_start': 0, 'core:frequency': 100e6 }],
+			}));
+		});
+
+		afterEach(() => {
+			fs.readdirSync(dir).forEach(name => fs.unlinkSync(path.join(dir, name)));
+			fs.rmdirSync(dir);
+		});
+
+		it('replays a recording through the device calls, then finishes', (done) => {
+			const dev = rtlsdr.open_file(`${base}.sigmf-meta`, { speed: 0 });
+			rtlsdr.get_sample_rate(dev).should.equal(256000);
+			rtlsdr.get_center_freq(dev).should.equal(100e6);
+			rtlsdr.get_usb_strings(dev).product.should.equal('file replay');
+			rtlsdr.get_file_position(dev).should.deep.equal({ position: 0, length: 32768 });
+
+			const bufs = [];
+			rtlsdr.read_async(dev, (ev, data) => {
+				switch (ev) {
+				case 'data':
+					bufs.push(Buffer.from(data));
+					break;
+				case 'done':
+					Buffer.concat(bufs).equals(recording).should.equal(true);
+					rtlsdr.get_file_position(dev).position.should.equal(32768);
+					rtlsdr.close(dev);
+					done();
+					break;
+				default: done(`should not have emitted ${ev}`);
+				}
+			}, 1, 16384);
+		});
+
+		it('loops and seeks until cancelled', (done) => {
+			const dev = rtlsdr.open_file(`${base}.cu8`, { sampleRate: 256000, speed: 0, loop: true });
+
+			let transfers = 0;
+			rtlsdr.read_async(dev, (ev, data) => {
+				switch (ev) {
+				case 'data':
+					if (++transfers === 8) {
+						rtlsdr.seek_file(dev, 1000);
+					} else if (transfers === 12) {
+						rtlsdr.cancel_async(dev);
+					} else if (transfers > 8 && transfers < 12) {
+						data.length.should.equal(16384);
+					}
+					break;
+				case 'done':
+					transfers.should.be.at.least(12);
+					rtlsdr.close(dev);
+					done();
+					break;
+				default: done(`should not have emitted ${ev}`);
+				}
+			}, 1, 16384);
+		});
+
+		it('keeps settings but refuses a sample rate other than the recording\'s', () => {
+			const dev = rtlsdr.open_file(`${base}.cu8`, { sampleRate: 256000, centerFreq: 433.92e6 });
+			rtlsdr.get_center_freq(dev).should.equal(433.92e6);
+			rtlsdr.set_center_freq(dev, 144e6);
+			rtlsdr.get_center_freq(dev).should.equal(144e6);
+			should.not.exist(rtlsdr.set_sample_rate(dev, 256000));
+			(() => rtlsdr.set_sample_rate(dev, 2048000)).should.throw(Error);
+			(() => rtlsdr.read_eeprom(dev, 0, 8)).should.throw(Error);
+			rtlsdr.close(dev);
+		});
+
+		it('throws if the recording cannot be opened or described', () => {
+			(() => rtlsdr.open_file(path.join(dir, 'missing.cu8'), { sampleRate: 256000 })).should.throw(Error);
+			rtlsdr.close(rtlsdr.open_file(`${base}.cu8`));
+			fs.unlinkSync(`${base}.sigmf-meta`);
+			(() => rtlsdr.open_file(`${base}.cu8`)).should.throw(Error, /sample rate/);
+		});
+
+		it('throws if path or opts are malformed', () => {
+			(() => rtlsdr.open_file(0)).should.throw(TypeError);
+			(() => rtlsdr.open_file('')).should.throw(TypeError);
+			(() => rtlsdr.open_file(`${base}.cu8`, 'hi mom')).should.throw(TypeError);
+			(() => rtlsdr.open_file(`${base}.cu8`, { speed: 'fast' })).should.throw(TypeError);
+			(() => rtlsdr.open_file(`${base}.cu8`, { loop: 1 })).should.throw(TypeError);
+			(() => rtlsdr.open_file(`${base}.cu8`, { speed: -1 })).should.throw(RangeError);
+			(() => rtlsdr.open_file(`${base}.cu8`, { speed: 10001 })).should.throw(RangeError);
+			(() => rtlsdr.open_file(`${base}.cu8`, { sampleRate: 0 })).should.throw(RangeError);
+			(() => rtlsdr.open_file(`${base}.cu8`, {}, { nice: 20 })).should.throw(RangeError);
+		});
+
+		it('rejects file calls on a device handle', () => {
+			const dev = rtlsdr.open(0);
+			(() => rtlsdr.seek_file(dev, 0)).should.throw(TypeError);
+			(() => rtlsdr.get_file_position(dev)).should.throw(TypeError);
+			(() => rtlsdr.set_file_speed(dev, 1)).should.throw(TypeError);
+			(() => rtlsdr.set_file_loop(dev, true)).should.throw(TypeError);
+			rtlsdr.close(dev);
+		});
+
+		it('throws if seek, speed, or loop arguments are malformed', () => {
+			const dev = rtlsdr.open_file(`${base}.cu8`);
+			(() => rtlsdr.seek_file(dev, '0')).should.throw(TypeError);
+			(() => rtlsdr.seek_file(dev, -1)).should.throw(RangeError);
+			(() => rtlsdr.set_file_speed(dev, 10001)).should.throw(RangeError);
+			(() => rtlsdr.set_file_loop(dev, 'yes')).should.throw(TypeError);
+			rtlsdr.seek_file(dev, 1e9);
+			rtlsdr.get_file_position(dev).position.should.equal(32768);
+			rtlsdr.close(dev);
+		});
 	});
 
 	describe('open-device functions', () => {
@@ -114,6 +276,36 @@ describe('rtlsdr_wrapper addon', () => {
 				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_return_error', -1);
 				(() => rtlsdr.close(dev)).should.throw();
 			});
+
+			it('invalidates the handle even if rtlsdr_close errors', () => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_return_error', -1);
+				(() => rtlsdr.close(dev)).should.throw(Error, /rtlsdr_close/);
+				rtlsdr.mock_is_device_handle(dev).should.equal(false);
+				(() => rtlsdr.get_center_freq(dev)).should.throw(TypeError, /currently-open handle/);
+				(() => rtlsdr.read_async(dev, () => {})).should.throw(TypeError, /currently-open handle/);
+			});
+
+			it('cancels an active read and still emits its done event', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let closed = false;
+				rtlsdr.read_async(dev, (ev) => {
+					switch (ev) {
+					case 'data':
+						if (!closed) {
+							closed = true;
+							rtlsdr.close(dev);
+							rtlsdr.mock_is_device_handle(dev).should.equal(false);
+						}
+						break;
+					case 'done':
+						closed.should.equal(true);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				});
+			});
 		});
 
 		describe('set_xtal_freq(dev_hnd, rtl_freq, tuner_freq)', () => {
@@ -303,6 +495,186 @@ describe('rtlsdr_wrapper addon', () => {
 			});
 		});
 
+		describe('write_eeprom_async(dev_hnd, data, offset, len, callback)', () => {
+			it('writes the EEPROM data via rtlsdr_write_eeprom on the control thread', (done) => {
+				const str = 'the quick brown fox';
+				const data = Buffer.from(str, 'ascii');
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'has_eeprom', true);
+
+				let calledBack = false;
+				rtlsdr.write_eeprom_async(dev, data, 10, str.length, (err) => {
+					calledBack = true;
+					(err === null).should.be.true;
+					rtlsdr.mock_get_written_eeprom(dev).slice(10, 10 + str.length).toString('ascii').should.equal(str);
+					done();
+				});
+
+				// the data was copied, so changing it now changes nothing
+				data.fill(0);
+				calledBack.should.be.false;
+			});
+
+			it('calls back with an error if rtlsdr_write_eeprom errors', (done) => {
+				rtlsdr.write_eeprom_async(dev, Buffer.from([1]), 0, 1, (err) => {
+					err.should.be.an.instanceof(Error);
+					err.message.should.match(/no EEPROM was found/);
+					done();
+				});
+			});
+
+			it('throws if its arguments are invalid', () => {
+				(() => rtlsdr.write_eeprom_async({}, Buffer.from([1]), 0, 1, () => {})).should.throw(TypeError);
+				(() => rtlsdr.write_eeprom_async(dev, [1], 0, 1, () => {})).should.throw(TypeError);
+				(() => rtlsdr.write_eeprom_async(dev, Buffer.from([1]), 256, 1, () => {})).should.throw(RangeError);
+				(() => rtlsdr.write_eeprom_async(dev, Buffer.from([1]), 0, 2, () => {})).should.throw(RangeError);
+				(() => rtlsdr.write_eeprom_async(dev, Buffer.from([1]), 0, 1)).should.throw(TypeError);
+			});
+		});
+
+		describe('read_eeprom_async(dev_hnd, offset, len, callback)', () => {
+			it('reads the EEPROM via rtlsdr_read_eeprom on the control thread', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'has_eeprom', true);
+
+				rtlsdr.read_eeprom_async(dev, 3, 40, (err, buf) => {
+					(err === null).should.be.true;
+					buf.length.should.equal(40);
+					buf.toString('ascii', 0, 37).should.equal('Mock RTLSDR read_eeprom Contents 3+40');
+					done();
+				});
+			});
+
+			it('calls back with an error if rtlsdr_read_eeprom errors', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_return_error', -1);
+
+				rtlsdr.read_eeprom_async(dev, 0, 40, (err) => {
+					err.should.be.an.instanceof(Error);
+					err.message.should.match(/the device handle is invalid/);
+					done();
+				});
+			});
+
+			it('throws if its arguments are invalid', () => {
+				(() => rtlsdr.read_eeprom_async({}, 0, 1, () => {})).should.throw(TypeError);
+				(() => rtlsdr.read_eeprom_async(dev, true, 1, () => {})).should.throw(TypeError);
+				(() => rtlsdr.read_eeprom_async(dev, 0, 65536, () => {})).should.throw(RangeError);
+				(() => rtlsdr.read_eeprom_async(dev, 0, 1)).should.throw(TypeError);
+			});
+		});
+
+		describe('configure(dev_hnd, settings, callback)', () => {
+			it('applies a batch of settings on the control thread', (done) => {
+				let calledBack = false;
+
+				rtlsdr.configure(dev, {
+					sampleRate: 1024000,
+					centerFreq: 162400000,
+					bandwidth: 300000,
+					gainMode: 1,
+					gain: 496,
+					agc: true,
+				}, (err, batches) => {
+					calledBack = true;
+					(err === null).should.be.true;
+					batches.should.equal(1);
+
+					const c = rtlsdr.mock_get_rtlsdr_dev_contents(dev);
+					c.should.have.property('sample_rate', 1024000);
+					c.should.have.property('center_freq', 162400000);
+					c.should.have.property('tuner_bandwidth', 300000);
+					c.should.have.property('tuner_gain_mode', 1);
+					c.should.have.property('tuner_gain', 496);
+					c.should.have.property('agc_mode', 1);
+					c.should.have.property('freq_correction', 0);
+					done();
+				});
+
+				calledBack.should.be.false;
+			});
+
+			it('merges batches queued behind a running command, in order', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'has_eeprom', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_eeprom_delay_ms', 50);
+
+				const order = [];
+				rtlsdr.read_eeprom_async(dev, 0, 40, () => order.push('eeprom'));
+
+				const check = (i) => (err, batches) => {
+					(err === null).should.be.true;
+					batches.should.equal(3);
+					order.push(i);
+
+					if (order.length === 4) {
+						order.should.deep.equal(['eeprom', 0, 1, 2]);
+
+						const c = rtlsdr.mock_get_rtlsdr_dev_contents(dev);
+						c.should.have.property('center_freq', 102000000);
+						c.should.have.property('tuner_gain_mode', 0);
+						c.should.have.property('freq_correction', 7);
+						done();
+					}
+				};
+
+				rtlsdr.configure(dev, { centerFreq: 100000000, gainMode: 1, gain: 300 }, check(0));
+				rtlsdr.configure(dev, { centerFreq: 101000000, freqCorrection: 7 }, check(1));
+				rtlsdr.configure(dev, { centerFreq: 102000000, gainMode: 0 }, check(2));
+			});
+
+			it('applies settings while a read streams', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+
+				let configured = false;
+				rtlsdr.read_async(dev, (ev) => {
+					if (ev === 'done') {
+						configured.should.be.true;
+						done();
+					}
+				}, 4, 16384);
+
+				rtlsdr.configure(dev, { centerFreq: 433920000 }, (err) => {
+					(err === null).should.be.true;
+					rtlsdr.mock_get_rtlsdr_dev_contents(dev).should.have.property('center_freq', 433920000);
+					configured = true;
+					rtlsdr.cancel_async(dev);
+				});
+			});
+
+			it('calls back with an error naming the librtlsdr call that failed', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_return_error', -5);
+
+				rtlsdr.configure(dev, { centerFreq: 100000000, gainMode: 1 }, (err) => {
+					err.should.be.an.instanceof(Error);
+					err.message.should.equal('rtlsdr_set_tuner_gain_mode failed with code -5');
+					done();
+				});
+			});
+
+			it('calls back with an error for commands the device closes before running', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'has_eeprom', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_eeprom_delay_ms', 50);
+				rtlsdr.read_eeprom_async(dev, 0, 40, () => {});
+
+				rtlsdr.configure(dev, { centerFreq: 100000000 }, (err) => {
+					err.should.be.an.instanceof(Error);
+					err.message.should.match(/closed/);
+					done();
+				});
+
+				rtlsdr.close(dev);
+			});
+
+			it('throws if its arguments are invalid', () => {
+				(() => rtlsdr.configure({}, {}, () => {})).should.throw(TypeError);
+				(() => rtlsdr.configure(dev, 'hi mom', () => {})).should.throw(TypeError);
+				(() => rtlsdr.configure(dev, { centerFreq: 'hi mom' }, () => {})).should.throw(TypeError);
+				(() => rtlsdr.configure(dev, { agc: 1 }, () => {})).should.throw(TypeError);
+				(() => rtlsdr.configure(dev, { centerFreq: 0 }, () => {})).should.throw(RangeError);
+				(() => rtlsdr.configure(dev, { gainMode: 2 }, () => {})).should.throw(RangeError);
+				(() => rtlsdr.configure(dev, { directSampling: 1.5 }, () => {})).should.throw(RangeError);
+				(() => rtlsdr.configure(dev, {})).should.throw(TypeError);
+			});
+		});
+
 		describe('set_center_freq(dev_hnd, center_freq)', () => {
 			it('sets the center freq via rtlsdr_set_center_freq', () => {
 				let c;
@@ -781,6 +1153,125 @@ describe('rtlsdr_wrapper addon', () => {
 			});
 		});
 
+		describe('read_into(dev_hnd, buf, offset, len, callback)', () => {
+			it('reads into the given buffer at offset on the capture thread', (done) => {
+				const buf = Buffer.alloc(30, 'x');
+				let calledBack = false;
+
+				rtlsdr.read_into(dev, buf, 5, 20, (err, n) => {
+					calledBack = true;
+					(err === null).should.be.true;
+					n.should.equal(20);
+					buf.toString('ascii').should.equal('xxxxxddddddddddddddddddddxxxxx');
+					done();
+				});
+
+				calledBack.should.be.false;
+			});
+
+			it('resets the device buffer before the first read only', (done) => {
+				const buf = Buffer.alloc(10);
+
+				rtlsdr.read_into(dev, buf, 0, 10, (err) => {
+					(err === null).should.be.true;
+					rtlsdr.mock_get_rtlsdr_dev_contents(dev).should.have.property('buffer_ready', true);
+
+					// a later read continues without another reset, and so fails if the device's buffer is not ready
+					rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+					rtlsdr.read_into(dev, buf, 0, 10, (err2) => {
+						err2.should.be.an.instanceof(Error);
+						done();
+					});
+				});
+			});
+
+			it('reads into a typed array and reports short reads', (done) => {
+				const arr = new Uint8Array(16);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_sync_read_discount', 6);
+
+				rtlsdr.read_into(dev, arr, 0, 16, (err, n) => {
+					n.should.equal(10);
+					arr[9].should.equal('d'.charCodeAt(0));
+					arr[10].should.equal(0);
+					done();
+				});
+			});
+
+			it('runs reads in the order they were made', (done) => {
+				const order = [];
+				const buf = Buffer.alloc(8);
+
+				for (let i = 0; i < 3; i++) {
+					rtlsdr.read_into(dev, buf, 0, 8, () => {
+						order.push(i);
+						if (order.length === 3) {
+							order.should.deep.equal([0, 1, 2]);
+							done();
+						}
+					});
+				}
+			});
+
+			it('calls back with an error if rtlsdr_read_sync errors', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_return_error', -8);
+
+				rtlsdr.read_into(dev, Buffer.alloc(8), 0, 8, (err) => {
+					err.should.be.an.instanceof(Error);
+					err.message.should.match(/-8/);
+					done();
+				});
+			});
+
+			it('throws if dev_hnd is not an open device handle', () => {
+				(() => rtlsdr.read_into({}, Buffer.alloc(8), 0, 8, () => {})).should.throw(TypeError);
+			});
+
+			it('throws if its arguments have the wrong types', () => {
+				(() => rtlsdr.read_into(dev, 'hi mom', 0, 8, () => {})).should.throw(TypeError);
+				(() => rtlsdr.read_into(dev, Buffer.alloc(8), -1, 8, () => {})).should.throw(TypeError);
+				(() => rtlsdr.read_into(dev, Buffer.alloc(8), 0, 1.5, () => {})).should.throw(TypeError);
+				(() => rtlsdr.read_into(dev, Buffer.alloc(8), 0, 8)).should.throw(TypeError);
+			});
+
+			it('throws if offset and len do not fit in buf', () => {
+				(() => rtlsdr.read_into(dev, Buffer.alloc(8), 0, 0, () => {})).should.throw(RangeError);
+				(() => rtlsdr.read_into(dev, Buffer.alloc(8), 4, 5, () => {})).should.throw(RangeError);
+			});
+
+			it('throws if a streaming read is in progress', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+				rtlsdr.read_async(dev, (ev) => {
+					if (ev === 'done') done();
+				}, 2, 512);
+
+				(() => rtlsdr.read_into(dev, Buffer.alloc(8), 0, 8, () => {})).should.throw(Error);
+				rtlsdr.cancel_async(dev);
+			});
+
+			it('calls back with an error if the device closes before the read runs', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_paced', true);
+
+				let calls = 0;
+				let errors = 0;
+
+				// each read is paced to take a while, so the later ones are still queued when close aborts them
+				for (let i = 0; i < 4; i++) {
+					rtlsdr.read_into(dev, Buffer.alloc(65536), 0, 65536, (err) => {
+						calls++;
+						if (err) errors++;
+						if (calls === 4) {
+							errors.should.be.above(0);
+							done();
+						}
+					});
+				}
+
+				rtlsdr.close(dev);
+			});
+		});
+
 		describe('wait_async(dev_hnd, listener)', () => {
 			it('emits reads via rtlsdr_wait_async', (done) => {
 				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
@@ -894,6 +1385,71 @@ describe('rtlsdr_wrapper addon', () => {
 				});
 			});
 
+			it('emits paced I/Q from the mock\'s synthetic source', (done) => {
+				rtlsdr.set_sample_rate(dev, 256000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_tone_offset', 32000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				const started = Date.now();
+				let bufCount = 0;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'data':
+						data.length.should.equal(16384);
+						data.some(x => x !== 'd'.charCodeAt(0)).should.equal(true);
+						if (++bufCount === 4) rtlsdr.cancel_async(dev);
+						break;
+					case 'done': {
+						// 8192 samples per transfer at 256 kS/s is 32 ms
+						(Date.now() - started).should.be.at.least(120);
+						const contents = rtlsdr.mock_get_rtlsdr_dev_contents(dev);
+						contents.mock_transfers.should.be.at.least(4);
+						contents.mock_samples.should.equal(contents.mock_transfers * 8192);
+						done();
+						break;
+					}
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 4, 16384);
+			});
+
+			it('passes each payload\'s sample index and receive times in one reused Float64Array', (done) => {
+				rtlsdr.set_sample_rate(dev, 256000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				const started = Date.now();
+				let first = null;
+				let expected = 0;
+				let lastMonotonic = 0;
+				let bufCount = 0;
+				rtlsdr.read_async(dev, (ev, data, timing) => {
+					switch (ev) {
+					case 'data':
+						timing.should.be.an.instanceof(Float64Array);
+						timing.length.should.equal(3);
+						if (first === null) first = timing;
+						timing.should.equal(first);
+
+						timing[0].should.equal(expected);
+						expected += data.length / 2;
+
+						timing[1].should.be.at.least(lastMonotonic);
+						lastMonotonic = timing[1];
+						timing[2].should.be.within(started - 1, Date.now() + 1);
+
+						if (++bufCount === 4) rtlsdr.cancel_async(dev);
+						break;
+					case 'done':
+						bufCount.should.be.at.least(4);
+						done();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 4, 16384);
+			});
+
 			it('throws if dev_hnd is not an open device handle', () => {
 				(() => rtlsdr.read_async({}, (() => {}))).should.throw();
 			});
@@ -929,6 +1485,1354 @@ describe('rtlsdr_wrapper addon', () => {
 			});
 		});
 
+		describe('read_async(dev_hnd, listener, buf_num, buf_len, opts)', () => {
+			it('delivers every transfer under the default block policy', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let bufCount = 0;
+				rtlsdr.read_async(dev, (ev) => {
+					switch (ev) {
+					case 'data':
+						if (++bufCount === 50) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						bufCount.should.be.at.least(50);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 512, { queueDepth: 2 });
+			});
+
+			it('emits overflow counts when transfers are dropped', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let bufCount = 0;
+				let dropped = 0;
+				let last = null;
+				rtlsdr.read_async(dev, (ev, arg) => {
+					switch (ev) {
+					case 'data':
+						arg.length.should.equal(512);
+						if (++bufCount === 20) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'overflow':
+						arg.dropped.should.be.above(0);
+						arg.queueDepth.should.equal(1);
+						dropped += arg.dropped;
+						arg.totalDropped.should.equal(dropped);
+						last = arg;
+						break;
+					case 'done':
+						should.exist(last);
+						last.totalTransfers.should.be.at.least(bufCount + dropped);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 512, { queueDepth: 1, overflow: 'drop-newest' });
+			});
+
+			it('throws if opts is not an object', () => {
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, 'hi mom')).should.throw(TypeError);
+			});
+
+			it('throws if a read is already in progress', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				rtlsdr.read_async(dev, (ev) => {
+					if (ev === 'done') done();
+				});
+
+				(() => rtlsdr.read_async(dev, (() => {}))).should.throw(Error);
+				rtlsdr.cancel_async(dev);
+			});
+
+			it('accepts a new read once the previous one is cancelled', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let finished = 0;
+				const listener = (ev) => {
+					// the second read finds the mock's buffer cancelled, so it may end in either event
+					if (ev === 'done' || ev === 'error') {
+						if (++finished === 2) done();
+					}
+				};
+
+				rtlsdr.read_async(dev, listener);
+				rtlsdr.cancel_async(dev);
+				(() => rtlsdr.read_async(dev, listener)).should.not.throw();
+			});
+
+			it('throws if queueDepth is not an integer from 1-4096', () => {
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { queueDepth: 'hi mom' })).should.throw(TypeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { queueDepth: 0 })).should.throw(RangeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { queueDepth: 4097 })).should.throw(RangeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { queueDepth: 2.7 })).should.throw(RangeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { queueDepth: -1 })).should.throw(RangeError);
+			});
+
+			it('throws if overflow is not a known policy', () => {
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { overflow: 1 })).should.throw(TypeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { overflow: 'hi mom' })).should.throw(RangeError);
+			});
+
+			it('delivers Float32Arrays for the float32 format', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let checked = false;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'data':
+						if (checked) break;
+						checked = true;
+						data.should.be.an.instanceof(Float32Array);
+						data.length.should.equal(512);
+						// the mock fills transfers with 'd' (100)
+						data[0].should.be.closeTo((100 - 127.5) / 127.5, 1e-6);
+						rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						checked.should.equal(true);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 512, { format: 'float32' });
+			});
+
+			it('delivers Int16Arrays for the int16 format', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let checked = false;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'data':
+						if (checked) break;
+						checked = true;
+						data.should.be.an.instanceof(Int16Array);
+						data.length.should.equal(512);
+						data[0].should.equal((100 * 256) - 32640);
+						rtlsdr.release_buffer(data).should.equal(true);
+						rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						checked.should.equal(true);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 512, { format: 'int16' });
+			});
+
+			it('throws if format is not a known format', () => {
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { format: 8 })).should.throw(TypeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { format: 'float64' })).should.throw(RangeError);
+			});
+
+			it('removes the DC offset when dcBlock is set', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let checked = false;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'data':
+						if (checked) break;
+						checked = true;
+						// the mock's constant 'd' samples are all DC
+						data[0].should.be.closeTo(0, 1e-6);
+						data[1].should.be.closeTo(0, 1e-6);
+						rtlsdr.get_iq_correction(dev).dcI.should.be.closeTo((100 - 127.5) / 127.5, 1e-6);
+						rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						checked.should.equal(true);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 512, { format: 'float32', dcBlock: true, iqBalance: true });
+			});
+
+			it('throws if dcBlock or iqBalance is not a boolean', () => {
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { dcBlock: 1 })).should.throw(TypeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { iqBalance: 'hi mom' })).should.throw(TypeError);
+			});
+
+			it('resamples to outputRate', (done) => {
+				rtlsdr.set_sample_rate(dev, 2400000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let floats = 0;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'data':
+						data.should.be.an.instanceof(Float32Array);
+						// 8192 complex samples in per transfer, decimated by 50
+						data.length.should.be.at.most(2 * 200);
+						floats += data.length;
+						if (floats >= 2000) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						floats.should.be.at.least(2000);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 16384, { format: 'float32', outputRate: 48000 });
+			});
+
+			it('indexes resampled blocks in output samples, so consecutive blocks leave no gap', (done) => {
+				rtlsdr.set_sample_rate(dev, 2400000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let expected = 0;
+				let blocks = 0;
+				rtlsdr.read_async(dev, (ev, data, timing) => {
+					switch (ev) {
+					case 'data':
+						timing[0].should.equal(expected);
+						expected += data.length / 2;
+						if (++blocks === 10) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						blocks.should.be.at.least(10);
+						done();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 1, 16384, { format: 'float32', outputRate: 48000, queueDepth: 64 });
+			});
+
+			it('throws if outputRate is not a number from 1 to the sample rate', () => {
+				rtlsdr.set_sample_rate(dev, 2400000);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { outputRate: '48k' })).should.throw(TypeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { outputRate: 0 })).should.throw(RangeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { outputRate: 2400001 })).should.throw(RangeError);
+			});
+
+			it('throws if outputRate is given before the sample rate is set', () => {
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { outputRate: 48000 })).should.throw(Error);
+			});
+
+			it('emits one channel event per selected channel', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				// the mock's constant samples are all DC, so they land in channel 0
+				const dc = (100 - 127.5) / 127.5;
+				const seen = [];
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'channel':
+						data.samples.should.be.an.instanceof(Float32Array);
+						// 256 complex samples in per transfer, decimated by 4
+						data.samples.length.should.equal(2 * 64);
+						seen.push(data.channel);
+
+						if (seen.length > 2) {
+							const last = data.samples.length - 2;
+							data.samples[last].should.be.closeTo(data.channel === 0 ? dc : 0, 0.001);
+							data.samples[last + 1].should.be.closeTo(data.channel === 0 ? dc : 0, 0.001);
+						}
+
+						if (seen.length === 6) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						seen.slice(0, 6).should.deep.equal([0, 2, 0, 2, 0, 2]);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 512, { format: 'float32', channels: { count: 4, select: [0, 2], threads: 2 } });
+			});
+
+			it('throws if channels is malformed', () => {
+				const read = channels => rtlsdr.read_async(dev, (() => {}), 0, 0, { channels });
+
+				(() => read(4)).should.throw(TypeError);
+				(() => read({})).should.throw(TypeError);
+				(() => read({ count: 1 })).should.throw(RangeError);
+				(() => read({ count: 1025 })).should.throw(RangeError);
+				(() => read({ count: 4, select: 0 })).should.throw(TypeError);
+				(() => read({ count: 4, select: ['0'] })).should.throw(TypeError);
+				(() => read({ count: 4, select: [4] })).should.throw(RangeError);
+				(() => read({ count: 4, select: [] })).should.throw(RangeError);
+				(() => read({ count: 4, threads: 'two' })).should.throw(TypeError);
+				(() => read({ count: 4, threads: 0 })).should.throw(RangeError);
+			});
+
+			it('emits averaged power spectra', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				// the mock's constant samples are all DC: |I + jQ|^2 = 2 * ((100 - 127.5) / 127.5)^2
+				const dc = 10 * Math.log10(2 * Math.pow((100 - 127.5) / 127.5, 2));
+				let rows = 0;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'spectrum':
+						data.should.be.an.instanceof(Float32Array);
+						data.length.should.equal(64);
+						data[32].should.be.closeTo(dc, 0.01);
+						data[0].should.be.below(-100);
+						data[63].should.be.below(-100);
+
+						// 256 complex samples per transfer make 4 frames, or 2 rows
+						if (++rows === 4) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						rows.should.be.at.least(4);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 512, { spectrum: { size: 64, window: 'rectangular', averages: 2 } });
+			});
+
+			it('throws if spectrum is malformed', () => {
+				const read = spectrum => rtlsdr.read_async(dev, (() => {}), 0, 0, { spectrum });
+
+				(() => read(1024)).should.throw(TypeError);
+				(() => read({})).should.throw(TypeError);
+				(() => read({ size: 1000 })).should.throw(RangeError);
+				(() => read({ size: 8 })).should.throw(RangeError);
+				(() => read({ size: 131072 })).should.throw(RangeError);
+				(() => read({ size: 64, window: 1 })).should.throw(TypeError);
+				(() => read({ size: 64, window: 'kaiser' })).should.throw(RangeError);
+				(() => read({ size: 64, overlap: '50%' })).should.throw(TypeError);
+				(() => read({ size: 64, overlap: 1 })).should.throw(RangeError);
+				(() => read({ size: 64, averages: 0 })).should.throw(RangeError);
+			});
+
+			it('throws if channels and spectrum are combined', () => {
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, {
+					channels: { count: 4 },
+					spectrum: { size: 64 }
+				})).should.throw(Error);
+			});
+
+			it('emits one audio event per receiver', (done) => {
+				rtlsdr.set_sample_rate(dev, 240000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				// the mock's constant samples are an unmodulated carrier at the center frequency; the squelch of the
+				// second receiver sits above its -10.3 dBFS
+				const seen = [];
+				let samples = 0;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'audio':
+						data.samples.should.be.an.instanceof(Float32Array);
+						// 8192 complex samples in per transfer at 240 kS/s, out at 48 kS/s
+						data.samples.length.should.be.at.most(1700);
+						seen.push(data.receiver);
+
+						if (data.receiver === 1) {
+							for (let n = 0; n < data.samples.length; n++) data.samples[n].should.equal(0);
+						} else if (seen.length > 4) {
+							const last = data.samples.length - 1;
+							data.samples[last].should.be.closeTo(0, 0.01);
+							samples += data.samples.length;
+						}
+
+						if (seen.length === 8) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						seen.slice(0, 8).should.deep.equal([0, 1, 0, 1, 0, 1, 0, 1]);
+						samples.should.be.at.least(1000);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 16384, { demod: [{ mode: 'wbfm' }, { mode: 'nbfm', offset: 50e3, squelch: -5 }] });
+			});
+
+			it('emits int16 audio', (done) => {
+				rtlsdr.set_sample_rate(dev, 240000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'audio':
+						data.receiver.should.equal(0);
+						data.samples.should.be.an.instanceof(Int16Array);
+						rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 16384, { format: 'int16', demod: { mode: 'nbfm', audioRate: 8000 } });
+			});
+
+			it('demodulates AM, SSB, and CW in direct-sampling mode', (done) => {
+				rtlsdr.set_direct_sampling(dev, 2);
+				rtlsdr.set_sample_rate(dev, 240000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				const seen = [];
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'audio':
+						data.samples.should.be.an.instanceof(Float32Array);
+						seen.push(data.receiver);
+						for (let n = 0; n < data.samples.length; n++) data.samples[n].should.be.within(-1, 1);
+						if (seen.length === 8) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						seen.slice(0, 8).should.deep.equal([0, 1, 2, 3, 0, 1, 2, 3]);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 16384, {
+					demod: [
+						{ mode: 'am', offset: 10e3 },
+						{ mode: 'usb', offset: 20e3 },
+						{ mode: 'lsb', offset: -20e3 },
+						{ mode: 'cw', offset: 0, pitch: 600, agc: false }
+					]
+				});
+			});
+
+			it('throws if demod is malformed', () => {
+				rtlsdr.set_sample_rate(dev, 240000);
+				const read = demod => rtlsdr.read_async(dev, (() => {}), 0, 0, { demod });
+
+				(() => read('wbfm')).should.throw(TypeError);
+				(() => read([])).should.throw(RangeError);
+				(() => read({ mode: 1 })).should.throw(TypeError);
+				(() => read({ mode: 'fm' })).should.throw(RangeError);
+				(() => read({ mode: 'usb', offset: 119e3 })).should.throw(RangeError);
+				(() => read({ mode: 'cw', pitch: 0 })).should.throw(RangeError);
+				(() => read({ mode: 'cw', agc: 1 })).should.throw(TypeError);
+				(() => read({ offset: '10k' })).should.throw(TypeError);
+				(() => read({ offset: 130e3 })).should.throw(RangeError);
+				(() => read({ offset: 50e3 })).should.throw(RangeError);
+				(() => read({ mode: 'nbfm', deviation: 0 })).should.throw(RangeError);
+				(() => read({ deemphasis: -1 })).should.throw(RangeError);
+				(() => read({ squelch: 'on' })).should.throw(TypeError);
+				(() => read({ audioRate: 250000 })).should.throw(RangeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, {
+					format: 'uint8',
+					demod: {}
+				})).should.throw(RangeError);
+			});
+
+			it('stays quiet while the squelch is shut', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				// the mock's constant samples are at -10.3 dBFS
+				const seen = [];
+				rtlsdr.read_async(dev, (ev) => {
+					switch (ev) {
+					case 'done':
+						seen.should.deep.equal([]);
+						done();
+						break;
+					default: seen.push(ev);
+					}
+				}, 1, 16384, { squelch: { level: -5 } });
+
+				setTimeout(() => rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false), 50);
+			});
+
+			it('brackets open segments with squelch events', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				const seen = [];
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'squelch-open':
+						data.should.equal(0);
+						seen.push(ev);
+						break;
+					case 'data':
+						data.should.be.an.instanceof(Int16Array);
+						data.length.should.equal(16384);
+						seen.push(ev);
+						if (seen.length === 3) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						seen.slice(0, 3).should.deep.equal(['squelch-open', 'data', 'data']);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 16384, { format: 'int16', squelch: { level: -20, window: 1024 } });
+			});
+
+			it('throws if squelch is malformed or combined with another native stage', () => {
+				const read = squelch => rtlsdr.read_async(dev, (() => {}), 0, 0, { squelch });
+
+				(() => read(-20)).should.throw(TypeError);
+				(() => read({})).should.throw(TypeError);
+				(() => read({ level: 3 })).should.throw(RangeError);
+				(() => read({ level: -20, hysteresis: -1 })).should.throw(RangeError);
+				(() => read({ level: -20, window: 8 })).should.throw(RangeError);
+
+				rtlsdr.set_sample_rate(dev, 240000);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, {
+					outputRate: 48000,
+					squelch: { level: -20 }
+				})).should.throw(Error);
+			});
+
+			it('captures around a power trigger from a history read', (done) => {
+				rtlsdr.set_sample_rate(dev, 240000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				// the constant -10.3 dBFS samples trigger at once, with nothing yet behind them, and keep the detector
+				// open, so there is exactly one capture: 10 ms, 2400 samples, from the start of the read
+				const captures = [];
+				rtlsdr.read_async(dev, (ev, capture) => {
+					switch (ev) {
+					case 'capture':
+						captures.push(capture);
+						rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						captures.length.should.equal(1);
+						captures[0].trigger.should.equal('power');
+						captures[0].should.not.have.property('id');
+						captures[0].offset.should.equal(0);
+						captures[0].triggerOffset.should.equal(0);
+						captures[0].samples.should.be.an.instanceof(Buffer);
+						captures[0].samples.length.should.equal(4800);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 16384, { history: { seconds: 1, pre: 10, post: 10, trigger: { level: -20 } } });
+			});
+
+			it('throws if history is malformed, combined with another native stage, or before the rate is set', () => {
+				const read = history => rtlsdr.read_async(dev, (() => {}), 0, 0, { history });
+
+				(() => read({ seconds: 1 })).should.throw(Error);
+
+				rtlsdr.set_sample_rate(dev, 240000);
+				(() => read(1)).should.throw(TypeError);
+				(() => read({})).should.throw(TypeError);
+				(() => read({ seconds: 0 })).should.throw(RangeError);
+				(() => read({ seconds: 1e6 })).should.throw(RangeError);
+				(() => read({ seconds: 1, pre: 1001 })).should.throw(RangeError);
+				(() => read({ seconds: 1, post: -1 })).should.throw(RangeError);
+				(() => read({ seconds: 1, trigger: -20 })).should.throw(TypeError);
+				(() => read({ seconds: 1, trigger: { level: 3 } })).should.throw(RangeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, {
+					dcBlock: true,
+					history: { seconds: 1 }
+				})).should.throw(Error);
+			});
+
+			it('records transfers natively to a .cu8 file with a SigMF sidecar', (done) => {
+				const dir = fs.mkdtempSync(path.join(os.tmpdir(), 'js-rtlsdr-'));
+				const base = path.join(dir, 'rec');
+
+				rtlsdr.set_sample_rate(dev, 240000);
+				rtlsdr.set_center_freq(dev, 100e6);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				rtlsdr.read_async(dev, (ev) => {
+					switch (ev) {
+					case 'done': {
+						should.not.exist(rtlsdr.get_record_stats(dev));
+
+						const data = fs.readFileSync(`${base}.cu8`);
+						data.length.should.be.above(0);
+						(data.length % 16384).should.equal(0);
+						data.every(b => b === 100).should.equal(true);
+
+						const meta = JSON.parse(fs.readFileSync(`${base}.sigmf-meta`, 'utf8'));
+						meta.global['core:datatype'].should.equal('cu8');
+						meta.global['core:sample_rate'].should.equal(240000);
+						meta.global['core:dataset'].should.equal('rec.cu8');
+						meta.captures[0]['core:global_index'].should.equal(0);
+						meta.captures[0]['core:frequency'].should.equal(100e6);
+
+						fs.unlinkSync(`${base}.cu8`);
+						fs.unlinkSync(`${base}.sigmf-meta`);
+						fs.rmdirSync(dir);
+						done();
+						break;
+					}
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 1, 16384, { record: { path: base, blockSize: 4096, blocks: 4 } });
+
+				setTimeout(() => {
+					const stats = rtlsdr.get_record_stats(dev);
+					stats.blocks.should.equal(4);
+					stats.files.should.equal(1);
+					stats.file.should.equal(`${base}.cu8`);
+					stats.writes.should.be.above(0);
+					stats.writeLatency.max.should.be.at.least(stats.writeLatency.mean);
+					rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+				}, 20);
+			});
+
+			it('reports a recording that cannot write as an error', (done) => {
+				rtlsdr.set_sample_rate(dev, 240000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				rtlsdr.read_async(dev, (ev, msg) => {
+					switch (ev) {
+					case 'error':
+						msg.should.match(/^could not open /);
+						done();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 1, 16384, { record: { path: '/nonexistent-js-rtlsdr-dir/rec', blockSize: 4096, blocks: 2 } });
+			});
+
+			it('throws if record is malformed, combined with another native stage, or before the rate is set', () => {
+				const read = record => rtlsdr.read_async(dev, (() => {}), 0, 0, { record });
+
+				(() => read({ path: '/tmp/rec' })).should.throw(Error);
+
+				rtlsdr.set_sample_rate(dev, 240000);
+				(() => read('/tmp/rec')).should.throw(TypeError);
+				(() => read({})).should.throw(TypeError);
+				(() => read({ path: '' })).should.throw(TypeError);
+				(() => read({ path: '/tmp/rec', blockSize: 1000 })).should.throw(RangeError);
+				(() => read({ path: '/tmp/rec', blockSize: 128 << 20 })).should.throw(RangeError);
+				(() => read({ path: '/tmp/rec', blocks: 1 })).should.throw(RangeError);
+				(() => read({ path: '/tmp/rec', blockSize: 64 << 20, blocks: 128 })).should.throw(RangeError);
+				(() => read({ path: '/tmp/rec', direct: 1 })).should.throw(TypeError);
+				(() => read({ path: '/tmp/rec', rotateBytes: -1 })).should.throw(RangeError);
+				(() => read({ path: '/tmp/rec', rotateBytes: 1 })).should.throw(RangeError);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, {
+					format: 'float32',
+					record: { path: '/tmp/rec' }
+				})).should.throw(Error);
+			});
+
+			it('throws if demod is given before the sample rate is set, or with channels', () => {
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, { demod: {} })).should.throw(Error);
+				rtlsdr.set_sample_rate(dev, 240000);
+				(() => rtlsdr.read_async(dev, (() => {}), 0, 0, {
+					channels: { count: 4 },
+					demod: {}
+				})).should.throw(Error);
+			});
+
+			it('writes transfers into a SharedArrayBuffer ring, stamped with their indices', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				const ring = new SharedArrayBuffer(256 + (1 << 20));
+				let reader;
+				let taken = 0;
+				let next = 0;
+
+				rtlsdr.read_async(dev, (ev) => {
+					switch (ev) {
+					case 'done':
+						reader.finished.should.equal(true);
+						reader.failed.should.equal(false);
+						while (reader.read(0) !== null) taken++;
+						taken.should.be.at.least(20);
+						done();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 4, 16384, { format: 'int16', ring });
+
+				reader = new RingReader(ring);
+
+				const poll = () => {
+					for (let record = reader.read(0); record !== null && taken < 20; record = reader.read(0)) {
+						record.samples.should.be.an.instanceof(Int16Array);
+						record.samples.length.should.equal(16384);
+						record.samples.buffer.should.equal(ring);
+						record.index.should.be.at.least(next);
+						(record.index % 8192).should.equal(0);
+						record.monotonic.should.be.above(0);
+						record.realtime.should.be.above(0);
+
+						next = record.index + 8192;
+						taken++;
+					}
+
+					if (taken < 20) setTimeout(poll, 1);
+					else rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+				};
+
+				setTimeout(poll, 1);
+			});
+
+			(Worker ? it : it.skip)('wakes a Worker blocked on the ring, which loads the addon itself', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				const ring = new SharedArrayBuffer(256 + (1 << 20));
+				rtlsdr.read_async(dev, (ev) => {
+					if (ev !== 'done') done(`should not have emitted ${ev}`);
+				}, 4, 16384, { ring });
+
+				const worker = new Worker(`
+					const { parentPort, workerData } = require('worker_threads');
+					const addon = require(workerData.addon);
+					const RingReader = require(workerData.ring);
+
+					let taken = 0;
+					for (const record of new RingReader(workerData.buffer)) if (record.samples.length > 0) taken++;
+					parentPort.postMessage({ taken, devices: addon.get_device_count() });
+				`, {
+					eval: true,
+					workerData: {
+						addon: path.join(__dirname, '../../build/Release/js-rtlsdr-addon-mocked.node'),
+						ring: require.resolve('../../lib/api/ring'),
+						buffer: ring
+					}
+				});
+
+				worker.on('message', (result) => {
+					result.taken.should.be.above(0);
+					result.devices.should.equal(1);
+					done();
+				});
+				worker.on('error', done);
+
+				setTimeout(() => rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false), 50);
+			});
+
+			it('throws if ring is not a SharedArrayBuffer, too small, or combined with another native stage', () => {
+				const read = (ring, opts) => rtlsdr.read_async(dev, (() => {}), 0, 16384,
+					Object.assign({ ring }, opts));
+
+				(() => read(new ArrayBuffer(256 + 65536))).should.throw(TypeError);
+				(() => read(new SharedArrayBuffer(256 + 65536 + 4096))).should.throw(RangeError);
+				(() => read(new SharedArrayBuffer(256 + 32768))).should.throw(RangeError);
+				(() => read(new SharedArrayBuffer(256 + 65536), { format: 'float32' })).should.throw(RangeError);
+				(() => read(new SharedArrayBuffer(256 + 65536), { format: 'float32-planar' })).should.throw(Error);
+				(() => read(new SharedArrayBuffer(256 + 65536), { dcBlock: true })).should.throw(Error);
+				(() => read(new SharedArrayBuffer(256 + 65536), { squelch: { level: -20 } })).should.throw(Error);
+				(() => new RingReader(new SharedArrayBuffer(256 + 65536))).should.throw(RangeError);
+			});
+		});
+
+		describe('snapshot(dev_hnd, pre_ms, post_ms)', () => {
+			it('captures around now from the history ring', (done) => {
+				rtlsdr.set_sample_rate(dev, 240000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let id;
+				rtlsdr.read_async(dev, (ev, capture) => {
+					switch (ev) {
+					case 'capture':
+						capture.id.should.equal(id);
+						capture.trigger.should.equal('snapshot');
+						(capture.triggerOffset - capture.offset).should.equal(2400);
+						capture.samples.length.should.equal(9600);
+						rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						id.should.be.above(0);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, 1, 16384, { history: { seconds: 1 } });
+
+				// long enough for the read to be running and the ring to hold 10 ms
+				setTimeout(() => { id = rtlsdr.snapshot(dev, 10, 10); }, 50);
+			});
+
+			it('rejects a pending RTLSDR#snapshot with the error of a read that fails', () => {
+				const device = new RTLSDR(0);
+				rtlsdr.set_sample_rate(device.device, 240000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(device.device, 'buffer_ready', true);
+				device.read(1, 16384, { history: { seconds: 1 } });
+
+				// the read is running; ask for more after now than it will get before failing
+				return new Promise(resolve => setTimeout(resolve, 50))
+					.then(() => {
+						const pending = device.snapshot(10, 10000);
+						rtlsdr.mock_set_rtlsdr_dev_contents(device.device, 'mock_return_error', -1);
+						return pending;
+					})
+					.then(() => { throw new Error('should not have resolved'); }, (err) => {
+						err.should.be.an.instanceof(Error);
+						err.message.should.not.be.empty;
+						device.listenerCount('capture').should.equal(0);
+						device.listenerCount('error').should.equal(0);
+						device.destroy();
+					});
+			});
+
+			it('throws without a read with history, or with bad arguments', () => {
+				rtlsdr.set_sample_rate(dev, 240000);
+				(() => rtlsdr.snapshot(dev, 10, 10)).should.throw(Error);
+				(() => rtlsdr.snapshot(dev, '10', 10)).should.throw(TypeError);
+				(() => rtlsdr.snapshot(dev, 10, -1)).should.throw(RangeError);
+			});
+		});
+
+		describe('sweep(dev_hnd, listener, opts)', () => {
+			const opts = { start: 100e6, stop: 110e6, binWidth: 10e3, dwell: 5 };
+
+			it('emits one stitched row per sweep, then done', (done) => {
+				rtlsdr.set_sample_rate(dev, 2048000);
+
+				let sweeps = 0;
+				rtlsdr.sweep(dev, (ev, row) => {
+					switch (ev) {
+					case 'sweep':
+						row.bins.should.be.an.instanceof(Float32Array);
+						// ceil(10 MHz / 8 kHz) bins of 2.048 MS/s / 256
+						row.bins.length.should.equal(1250);
+						row.start.should.equal(100e6);
+						row.binWidth.should.equal(8000);
+						row.endTime.should.be.at.least(row.startTime);
+						sweeps++;
+						break;
+					case 'done':
+						sweeps.should.equal(3);
+						// 7 hops of 192 bins
+						rtlsdr.mock_get_rtlsdr_dev_contents(dev).center_freq.should.equal(100e6 + (6 * 192 + 96) * 8000);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, Object.assign({ sweeps: 3 }, opts));
+			});
+
+			it('stops when cancelled', (done) => {
+				rtlsdr.set_sample_rate(dev, 2048000);
+
+				rtlsdr.sweep(dev, (ev) => {
+					switch (ev) {
+					case 'sweep':
+						rtlsdr.cancel_async(dev);
+						break;
+					case 'done':
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, opts);
+			});
+
+			it('emits an error if the device fails mid-sweep', (done) => {
+				rtlsdr.set_sample_rate(dev, 2048000);
+
+				rtlsdr.sweep(dev, (ev, msg) => {
+					switch (ev) {
+					case 'sweep':
+						rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_return_error', -5);
+						break;
+					case 'error':
+						msg.should.match(/error code -5/);
+						rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_return_error', 0);
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				}, opts);
+			});
+
+			it('throws if the sample rate is not set', () => {
+				(() => rtlsdr.sweep(dev, (() => {}), opts)).should.throw(Error);
+			});
+
+			it('throws if opts is malformed', () => {
+				rtlsdr.set_sample_rate(dev, 2048000);
+				const sweep = o => rtlsdr.sweep(dev, (() => {}), Object.assign({}, opts, o));
+
+				(() => rtlsdr.sweep(dev, (() => {}))).should.throw(TypeError);
+				(() => sweep({ start: undefined })).should.throw(TypeError);
+				(() => sweep({ start: -1 })).should.throw(RangeError);
+				(() => sweep({ stop: 99e6 })).should.throw(RangeError);
+				(() => sweep({ binWidth: '10k' })).should.throw(TypeError);
+				(() => sweep({ binWidth: 10 })).should.throw(RangeError);
+				(() => sweep({ binWidth: 1e6 })).should.throw(RangeError);
+				(() => sweep({ dwell: 0 })).should.throw(RangeError);
+				(() => sweep({ settle: -1 })).should.throw(RangeError);
+				(() => sweep({ crop: 1 })).should.throw(RangeError);
+				(() => sweep({ window: 'kaiser' })).should.throw(RangeError);
+				(() => sweep({ sweeps: -1 })).should.throw(RangeError);
+				(() => sweep({ queueDepth: 0 })).should.throw(RangeError);
+			});
+		});
+
+		describe('capture_group(dev_hnds, listener, buf_num, buf_len, opts)', () => {
+			let other;
+			beforeEach(() => {
+				rtlsdr.mock_set_device_count(2);
+				other = rtlsdr.open(1);
+
+				[dev, other].forEach((d) => {
+					rtlsdr.set_sample_rate(d, 256000);
+					rtlsdr.mock_set_rtlsdr_dev_contents(d, 'mock_synthetic', true);
+				});
+			});
+
+			afterEach(() => {
+				if (rtlsdr.mock_is_device_handle(other)) rtlsdr.close(other);
+			});
+
+			it('emits the leads once, then matched, equal-length blocks from every device together', (done) => {
+				let leads = null;
+				let expected = 0;
+				let blocks = 0;
+				rtlsdr.capture_group([dev, other], (ev, arg, timing) => {
+					switch (ev) {
+					case 'aligned':
+						should.not.exist(leads);
+						blocks.should.equal(0);
+						leads = arg;
+						leads.should.have.length(2);
+						leads.forEach(lead => lead.should.be.at.least(0));
+						break;
+					case 'data':
+						should.exist(leads);
+						arg.should.have.length(2);
+						arg.forEach((samples) => {
+							samples.should.be.an.instanceof(Uint8Array);
+							samples.length.should.equal(2 * 4096);
+							samples.buffer.should.equal(arg[0].buffer);
+						});
+
+						timing.should.be.an.instanceof(Float64Array);
+						timing[0].should.equal(expected);
+						expected += 4096;
+
+						rtlsdr.release_buffer(arg[0]).should.equal(true);
+						if (++blocks === 6) rtlsdr.cancel_async(dev);
+						break;
+					case 'done':
+						blocks.should.be.at.least(6);
+						done();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 4, 16384, { blockSize: 4096 });
+			});
+
+			it('lines the streams up by index, skipping each device\'s offset', (done) => {
+				// the mocks' synthetic sources are identical, so the second device runs 5 samples ahead of the first
+				rtlsdr.capture_group([dev, other], (ev, arg) => {
+					switch (ev) {
+					case 'aligned':
+						arg.should.deep.equal([0, 5]);
+						break;
+					case 'data':
+						arg[1].subarray(0, 2 * (4096 - 5)).every((x, i) => x === arg[0][i + 10]).should.equal(true);
+						rtlsdr.cancel_async(other);
+						break;
+					case 'done':
+						done();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 4, 16384, { blockSize: 4096, align: 'index', offsets: [0, 5] });
+			});
+
+			it('converts every device\'s block to the group\'s format', (done) => {
+				let blocks = 0;
+				rtlsdr.capture_group([dev, other], (ev, arg) => {
+					switch (ev) {
+					case 'aligned': break;
+					case 'data':
+						arg.forEach((samples) => {
+							samples.should.be.an.instanceof(Int16Array);
+							samples.length.should.equal(2 * 2048);
+						});
+						if (++blocks === 1) rtlsdr.cancel_async(dev);
+						break;
+					case 'done':
+						done();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 4, 16384, { blockSize: 2048, format: 'int16' });
+			});
+
+			it('emits an error and stops every device if one fails', (done) => {
+				rtlsdr.capture_group([dev, other], (ev, arg) => {
+					switch (ev) {
+					case 'aligned': break;
+					case 'data':
+						rtlsdr.mock_set_rtlsdr_dev_contents(other, 'mock_return_error', -5);
+						break;
+					case 'error':
+						arg.should.match(/-5/);
+						rtlsdr.mock_set_rtlsdr_dev_contents(other, 'mock_return_error', 0);
+						rtlsdr.mock_get_rtlsdr_dev_contents(dev).buffer_ready.should.equal(false);
+						done();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 4, 16384);
+			});
+
+			it('leaves its devices free for a new read once done', (done) => {
+				rtlsdr.capture_group([dev, other], (ev) => {
+					if (ev === 'data') rtlsdr.cancel_async(dev);
+					if (ev !== 'done') return;
+
+					rtlsdr.reset_buffer(other);
+					rtlsdr.read_async(other, (ev2) => {
+						if (ev2 === 'data') rtlsdr.cancel_async(other);
+						if (ev2 === 'done') done();
+					}, 4, 16384);
+				}, 4, 16384);
+			});
+
+			it('throws if dev_hnds is not an array of 2 or more distinct, open devices', () => {
+				const listener = () => {};
+				(() => rtlsdr.capture_group(dev, listener)).should.throw(TypeError);
+				(() => rtlsdr.capture_group([dev], listener)).should.throw(RangeError);
+				(() => rtlsdr.capture_group([dev, {}], listener)).should.throw(TypeError);
+				(() => rtlsdr.capture_group([dev, dev], listener)).should.throw(/only appear once/);
+			});
+
+			it('throws if a read is already in progress on one of the devices', (done) => {
+				rtlsdr.reset_buffer(other);
+				rtlsdr.read_async(other, (ev) => {
+					if (ev === 'done') done();
+				});
+
+				(() => rtlsdr.capture_group([dev, other], () => {})).should.throw(/already in progress/);
+				rtlsdr.cancel_async(other);
+			});
+
+			it('throws if listener is not a function', () => {
+				(() => rtlsdr.capture_group([dev, other], 'nope')).should.throw(TypeError);
+			});
+
+			it('throws if the devices\' sample rates differ', () => {
+				rtlsdr.set_sample_rate(other, 1024000);
+				(() => rtlsdr.capture_group([dev, other], () => {})).should.throw(/same sample rate/);
+			});
+
+			it('throws if an option is invalid', () => {
+				const capture = opts => () => rtlsdr.capture_group([dev, other], () => {}, 4, 16384, opts);
+				capture({ blockSize: 0 }).should.throw(RangeError);
+				capture({ align: 'phase' }).should.throw(RangeError);
+				capture({ align: 1 }).should.throw(TypeError);
+				capture({ offsets: [0] }).should.throw(RangeError);
+				capture({ offsets: [0, -1] }).should.throw(RangeError);
+				capture({ offsets: 5 }).should.throw(TypeError);
+				capture({ format: 'float32-planar' }).should.throw(RangeError);
+				capture({ queueDepth: 0 }).should.throw(RangeError);
+			});
+		});
+
+		describe('fan_out(dev_hnd, listeners, buf_num, buf_len, pipelines)', () => {
+			beforeEach(() => {
+				rtlsdr.set_sample_rate(dev, 256000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+			});
+
+			it('hands every transfer to each pipeline, each with its own format and listener', (done) => {
+				const seen = [[], [], []];
+				let finished = 0;
+				const listener = n => (ev, arg, timing) => {
+					switch (ev) {
+					case 'data':
+					case 'spectrum':
+						seen[n].push({ samples: arg, index: timing[0] });
+						if (n === 0 && seen[0].length === 4) rtlsdr.cancel_async(dev);
+						break;
+					case 'done':
+						if (++finished < 3) break;
+
+						seen[0].forEach(({ samples, index }, i) => {
+							samples.should.be.an.instanceof(Buffer);
+							samples.length.should.equal(16384);
+							index.should.equal(8192 * i);
+						});
+						seen[1].length.should.be.above(0);
+						seen[1].forEach(({ samples, index }) => {
+							samples.should.be.an.instanceof(Float32Array);
+							samples.length.should.equal(16384);
+							samples[0].should.be.closeTo((seen[0][index / 8192].samples[0] - 127.5) / 127.5, 1e-6);
+						});
+						seen[2].length.should.be.above(0);
+						seen[2].forEach(({ samples }) => samples.should.be.an.instanceof(Float32Array));
+						done();
+						break;
+					default: done(`pipeline ${n} should not have emitted ${ev}`);
+					}
+				};
+
+				rtlsdr.fan_out(dev, [listener(0), listener(1), listener(2)], 4, 16384, [
+					{},
+					{ format: 'float32' },
+					{ spectrum: { size: 1024 } },
+				]);
+			});
+
+			it('delivers the shared slabs themselves to the raw pipeline, for release_buffer to return', (done) => {
+				let released = 0;
+				rtlsdr.fan_out(dev, [(ev, data) => {
+					if (ev === 'data') {
+						rtlsdr.release_buffer(data).should.equal(true);
+						rtlsdr.release_buffer(data).should.equal(false);
+						if (++released === 3) rtlsdr.cancel_async(dev);
+					}
+
+					if (ev === 'done') done();
+				}, () => {}], 4, 16384, [{}, { format: 'int16' }]);
+			});
+
+			it('keeps the other pipelines streaming while the raw listener holds on to every Buffer', (done) => {
+				const held = [];
+				let expected = 0;
+				let finished = 0;
+				const finish = () => {
+					if (++finished < 2) return;
+					held.length.should.be.at.least(12);
+					rtlsdr.release_buffer(held[0]).should.equal(true);
+					rtlsdr.release_buffer(held[1]).should.equal(true);
+					rtlsdr.release_buffer(held[held.length - 1]).should.equal(false);
+					expected.should.be.at.least(12 * 8192);
+					done();
+				};
+
+				rtlsdr.fan_out(dev, [(ev, data) => {
+					if (ev === 'data') held.push(data);
+					if (ev === 'done') finish();
+				}, (ev, samples, timing) => {
+					switch (ev) {
+					case 'data':
+						timing[0].should.equal(expected);
+						expected += samples.length / 2;
+						if (expected === 12 * 8192) rtlsdr.cancel_async(dev);
+						break;
+					case 'done':
+						finish();
+						break;
+					default: done(`should not have emitted ${ev}`);
+					}
+				}], 2, 16384, [{ queueDepth: 2 }, { format: 'int16', queueDepth: 2 }]);
+			});
+
+			it('lets a paused pipeline drop by its own policy without holding up the others', (done) => {
+				let raw = 0;
+				let paused = 0;
+				let dropped = 0;
+				let finished = 0;
+				const finish = () => {
+					if (++finished < 2) return;
+					raw.should.be.at.least(8);
+					dropped.should.be.above(0);
+					done();
+				};
+
+				rtlsdr.fan_out(dev, [(ev) => {
+					if (ev === 'data' && ++raw === 8) {
+						rtlsdr.resume_async(dev);
+						rtlsdr.cancel_async(dev);
+					}
+
+					if (ev === 'done') finish();
+				}, (ev, arg) => {
+					switch (ev) {
+					case 'data': return ++paused > 1;
+					case 'overflow':
+						dropped += arg.dropped;
+						return undefined;
+					case 'done':
+						finish();
+						return undefined;
+					default:
+						done(`should not have emitted ${ev}`);
+						return undefined;
+					}
+				}], 4, 16384, [{}, { format: 'int16', queueDepth: 1 }]);
+			});
+
+			it('leaves the device free for a new read once every pipeline is done', (done) => {
+				let finished = 0;
+				const listener = (ev) => {
+					if (ev === 'data') rtlsdr.cancel_async(dev);
+					if (ev !== 'done' || ++finished < 2) return;
+
+					rtlsdr.reset_buffer(dev);
+					rtlsdr.read_async(dev, (ev2) => {
+						if (ev2 === 'data') rtlsdr.cancel_async(dev);
+						if (ev2 === 'done') done();
+					}, 4, 16384);
+				};
+
+				rtlsdr.fan_out(dev, [listener, listener], 4, 16384, [{}, { dcBlock: true }]);
+			});
+
+			it('throws if listeners is not an array of one function per pipeline', () => {
+				const listener = () => {};
+				(() => rtlsdr.fan_out(dev, listener, 4, 16384, [{}])).should.throw(TypeError);
+				(() => rtlsdr.fan_out(dev, [listener, 5], 4, 16384, [{}, {}])).should.throw(TypeError);
+				(() => rtlsdr.fan_out(dev, [listener], 4, 16384, [{}, {}])).should.throw(RangeError);
+			});
+
+			it('throws if pipelines is not an array of 1-16 pipelines\' options', () => {
+				const fan = (pipelines, count) => () => {
+					const listeners = new Array(count === undefined ? 1 : count).fill(() => {});
+					rtlsdr.fan_out(dev, listeners, 4, 16384, pipelines);
+				};
+
+				fan({}).should.throw(TypeError);
+				fan([5]).should.throw(TypeError);
+				fan([], 0).should.throw(RangeError);
+				fan(new Array(17).fill({}), 17).should.throw(RangeError);
+				fan([{ queueDepth: 0 }]).should.throw(RangeError);
+				fan([{ overflow: 'block' }]).should.throw(RangeError);
+				fan([{ squelch: { level: -20 } }]).should.throw(/cannot use squelch/);
+				fan([{ history: { seconds: 1 } }]).should.throw(/cannot use squelch/);
+			});
+		});
+
+		describe('release_buffer(buf)', () => {
+			it('returns a data Buffer to its pool exactly once', (done) => {
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				const bufs = [];
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'data':
+						bufs.push(data);
+						if (bufs.length === 2) rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', false);
+						break;
+					case 'done':
+						bufs.forEach((buf) => {
+							buf.length.should.equal(15 * 512);
+							rtlsdr.release_buffer(buf).should.equal(true);
+							rtlsdr.release_buffer(buf).should.equal(false);
+						});
+
+						done();
+						break;
+					default: done('should not have reached default case');
+					}
+				});
+			});
+
+			it('returns false for a Buffer that did not come from a pool', () => {
+				rtlsdr.release_buffer(Buffer.alloc(512)).should.equal(false);
+			});
+
+			it('throws if buf is not a Buffer', () => {
+				(() => rtlsdr.release_buffer('hi mom')).should.throw(TypeError);
+			});
+		});
+
+		describe('get_iq_correction(dev_hnd)', () => {
+			it('returns null when no correcting read is active', () => {
+				should.not.exist(rtlsdr.get_iq_correction(dev));
+			});
+		});
+
+		describe('get_record_stats(dev_hnd)', () => {
+			it('returns null when no recording read is active', () => {
+				should.not.exist(rtlsdr.get_record_stats(dev));
+			});
+		});
+
+		describe('get_stream_stats(dev_hnd, reset)', () => {
+			it('starts at zero', () => {
+				const stats = rtlsdr.get_stream_stats(dev);
+				['transfers', 'bytes', 'dropped', 'maxQueueDepth', 'delivered']
+					.forEach(key => stats[key].should.equal(0));
+				stats.latency.should.have.property('count', 0);
+				stats.sampleRate.should.have.property('effective', 0);
+			});
+
+			it('counts a paced read\'s transfers, deliveries, rate, and latency', (done) => {
+				rtlsdr.set_sample_rate(dev, 256000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let bufCount = 0;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'data':
+						rtlsdr.release_buffer(data);
+						if (++bufCount === 6) rtlsdr.cancel_async(dev);
+						break;
+					case 'done': {
+						const stats = rtlsdr.get_stream_stats(dev, true);
+						stats.transfers.should.be.at.least(6);
+						stats.bytes.should.equal(stats.transfers * 16384);
+						stats.delivered.should.equal(bufCount);
+						stats.dropped.should.equal(0);
+						stats.maxQueueDepth.should.be.at.least(1);
+						(stats.wakeups + stats.coalesced).should.equal(stats.delivered);
+						stats.sampleRate.configured.should.equal(256000);
+						stats.sampleRate.effective.should.be.within(200000, 320000);
+						stats.latency.count.should.equal(bufCount);
+						stats.latency.p50.should.be.within(stats.latency.min, stats.latency.max);
+
+						rtlsdr.get_stream_stats(dev).transfers.should.equal(0);
+						done();
+						break;
+					}
+					default: done(`should not have emitted ${ev}`);
+					}
+				}, 4, 16384);
+			});
+
+			it('throws if reset is not a boolean', () => {
+				(() => rtlsdr.get_stream_stats(dev, 1)).should.throw(TypeError);
+			});
+
+			it('throws if dev_hnd is not an open device handle', () => {
+				(() => rtlsdr.get_stream_stats({})).should.throw();
+			});
+		});
+
+		describe('resume_async(dev_hnd)', () => {
+			it('resumes a read whose listener paused it, after it overflowed natively', (done) => {
+				rtlsdr.set_sample_rate(dev, 256000);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_synthetic', true);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'mock_paced', false);
+				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
+
+				let bufCount = 0;
+				let dropped = 0;
+				rtlsdr.read_async(dev, (ev, data) => {
+					switch (ev) {
+					case 'data':
+						rtlsdr.release_buffer(data);
+						if (++bufCount === 1) {
+							setTimeout(() => {
+								bufCount.should.equal(1);
+								rtlsdr.resume_async(dev);
+							}, 50);
+							return false;
+						}
+
+						if (bufCount === 3) rtlsdr.cancel_async(dev);
+						return true;
+					case 'overflow':
+						dropped += data.dropped;
+						return undefined;
+					case 'done':
+						bufCount.should.be.at.least(3);
+						dropped.should.be.above(0);
+						rtlsdr.get_stream_stats(dev).maxQueueDepth.should.equal(2);
+						done();
+						return undefined;
+					default:
+						done(`should not have emitted ${ev}`);
+						return undefined;
+					}
+				}, 4, 16384, { queueDepth: 2, overflow: 'drop-oldest' });
+			});
+
+			it('is harmless when nothing is paused', () => {
+				rtlsdr.resume_async(dev);
+			});
+
+			it('throws if dev_hnd is not an open device handle', () => {
+				(() => rtlsdr.resume_async({})).should.throw();
+			});
+		});
+
 		describe('cancel_async(dev_hnd)', () => {
 			it('cancels async reads via rtlsdr_cancel_async', () => {
 				rtlsdr.mock_set_rtlsdr_dev_contents(dev, 'buffer_ready', true);
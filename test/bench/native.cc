@@ -0,0 +1,232 @@
+// Native throughput benchmarks for the capture-thread stages, run against the mock's synthetic source. Each case
+// prints one JSON object per line, so runs can be collected and compared:
+//
+//   {"suite":"native","name":"queue/float32","bufLen":262144,"iterations":1200,"msps":410.2,"transfersPerSec":3129.4,
+//    "nsPerTransfer":319551.1,"bytesCopiedPerSec":3281020211,"allocsPerSec":0,"allocBytesPerSec":0}
+//
+// msps counts complex input samples. bytesCopiedPerSec is the stage's output written per second; allocs count every
+// operator new in the timed loop, which should be zero on the streaming path. JS_RTLSDR_BENCH_SECONDS sets the time
+// spent per case (default 0.5) and JS_RTLSDR_BENCH_FILTER runs only cases whose name contains it.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "rtl-sdr.h"
+#include "../../lib/addon/buffer_pool.h"
+#include "../../lib/addon/channelizer.h"
+#include "../../lib/addon/convert.h"
+#include "../../lib/addon/demod.h"
+#include "../../lib/addon/energy_squelch.h"
+#include "../../lib/addon/iq_correct.h"
+#include "../../lib/addon/resampler.h"
+#include "../../lib/addon/sample_queue.h"
+#include "../../lib/addon/spectrum.h"
+
+#define BENCH_SAMPLE_RATE (2400000)
+
+static std::atomic<uint64_t> alloc_count(0);
+static std::atomic<uint64_t> alloc_bytes(0);
+
+void * operator new(size_t size) {
+	alloc_count++;
+	alloc_bytes += size;
+
+	void * p = malloc(size > 0 ? size : 1);
+	if(p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void * p) noexcept {
+	free(p);
+}
+
+void operator delete(void * p, size_t) noexcept {
+	free(p);
+}
+
+static double bench_seconds() {
+	const char * env = getenv("JS_RTLSDR_BENCH_SECONDS");
+	const double seconds = env != NULL ? atof(env) : 0;
+	return seconds > 0 ? seconds : 0.5;
+}
+
+static bool bench_selected(const std::string & name) {
+	const char * filter = getenv("JS_RTLSDR_BENCH_FILTER");
+	return filter == NULL || name.find(filter) != std::string::npos;
+}
+
+// one transfer of buf_len bytes from a noisy synthetic tone, as the capture thread would see it
+static std::vector<uint8_t> synthetic_transfer(uint32_t buf_len) {
+	rtlsdr_dev_t * dev = NULL;
+	rtlsdr_open(&dev, 0);
+	rtlsdr_set_sample_rate(dev, BENCH_SAMPLE_RATE);
+	rtlsdr_reset_buffer(dev);
+	dev->mock_synthetic = true;
+	dev->mock_paced = false;
+	dev->mock_tone_offset = 150000;
+
+	std::vector<uint8_t> buf(buf_len);
+	int n_read = 0;
+	rtlsdr_read_sync(dev, buf.data(), (int) buf_len, &n_read);
+	delete dev;
+	return buf;
+}
+
+// Run body (which handles one buf_len-byte transfer and returns the bytes it wrote) until the time budget is spent,
+// after a short warm-up, and print the result.
+template <typename Body> static void bench(const std::string & name, uint32_t buf_len, Body body) {
+	if(!bench_selected(name)) return;
+
+	using clock = std::chrono::steady_clock;
+	const double budget = bench_seconds();
+
+	for(int i = 0; i < 3; i++) body();
+
+	const uint64_t allocs_before = alloc_count, alloc_bytes_before = alloc_bytes;
+	const clock::time_point started = clock::now();
+	uint64_t iterations = 0, bytes_out = 0;
+	double elapsed = 0;
+
+	// check the clock every few transfers, so small transfers are not dominated by it
+	while(elapsed < budget) {
+		for(int i = 0; i < 8; i++) bytes_out += body();
+		iterations += 8;
+		elapsed = std::chrono::duration<double>(clock::now() - started).count();
+	}
+
+	const double allocs = (double) (alloc_count - allocs_before);
+	const double allocated = (double) (alloc_bytes - alloc_bytes_before);
+
+	printf("{\"suite\":\"native\",\"name\":\"%s\",\"bufLen\":%u,\"iterations\":%llu,\"msps\":%.3f,"
+	       "\"transfersPerSec\":%.1f,\"nsPerTransfer\":%.1f,\"bytesCopiedPerSec\":%.0f,\"allocsPerSec\":%.1f,"
+	       "\"allocBytesPerSec\":%.0f}\n",
+	       name.c_str(), buf_len, (unsigned long long) iterations, iterations * (buf_len / 2.0) / elapsed / 1e6,
+	       iterations / elapsed, elapsed * 1e9 / iterations, bytes_out / elapsed, allocs / elapsed,
+	       allocated / elapsed);
+	fflush(stdout);
+}
+
+static void bench_source(uint32_t buf_len) {
+	rtlsdr_dev_t * dev = NULL;
+	rtlsdr_open(&dev, 0);
+	rtlsdr_set_sample_rate(dev, BENCH_SAMPLE_RATE);
+	rtlsdr_reset_buffer(dev);
+	dev->mock_synthetic = true;
+	dev->mock_paced = false;
+
+	std::vector<uint8_t> buf(buf_len);
+	bench("mock/synthetic", buf_len, [&]() {
+		int n_read = 0;
+		rtlsdr_read_sync(dev, buf.data(), (int) buf_len, &n_read);
+		return (size_t) n_read;
+	});
+
+	delete dev;
+}
+
+static void bench_convert(const std::vector<uint8_t> & in) {
+	const uint32_t buf_len = (uint32_t) in.size();
+	const sample_format_t formats[] = {SAMPLE_FORMAT_INT16, SAMPLE_FORMAT_FLOAT32, SAMPLE_FORMAT_FLOAT32_PLANAR};
+
+	for(size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		const sample_format_t format = formats[f];
+		std::vector<uint8_t> out(buf_len * sample_format_size(format));
+
+		bench(std::string("convert/") + sample_format_name(format), buf_len, [&]() {
+			convert_samples(format, in.data(), buf_len, out.data());
+			return out.size();
+		});
+	}
+}
+
+// the 'data' path: every transfer is copied once into a pooled slab, then popped and handed back
+static void bench_queue(const std::vector<uint8_t> & in) {
+	const uint32_t buf_len = (uint32_t) in.size();
+	const sample_format_t formats[] = {SAMPLE_FORMAT_UINT8, SAMPLE_FORMAT_FLOAT32};
+
+	for(size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		const sample_format_t format = formats[f];
+		BufferPool * pool = BufferPool::Create(buf_len * sample_format_size(format), 4);
+
+		{
+			SampleQueue queue(4, OVERFLOW_BLOCK, pool, format);
+			sample_block_t block;
+
+			bench(std::string("queue/") + sample_format_name(format), buf_len, [&]() {
+				queue.Push(in.data(), buf_len);
+				queue.Pop(block);
+				const size_t len = block.len;
+				queue.Discard(block);
+				return len;
+			});
+		}
+
+		pool->Orphan();
+	}
+}
+
+static void bench_stages(const std::vector<uint8_t> & in) {
+	const uint32_t buf_len = (uint32_t) in.size();
+	std::vector<float> iq(buf_len), work(buf_len);
+	convert_samples(SAMPLE_FORMAT_FLOAT32, in.data(), buf_len, iq.data());
+
+	IqCorrector corrector(true, true);
+	bench("iq-correct", buf_len, [&]() {
+		memcpy(work.data(), iq.data(), buf_len * sizeof(float));
+		corrector.Process(work.data(), buf_len);
+		return buf_len * sizeof(float);
+	});
+
+	Resampler resampler(BENCH_SAMPLE_RATE, 48000);
+	work.resize(std::max(work.size(), resampler.MaxOutput(buf_len)));
+	bench("resample/48000", buf_len, [&]() {
+		memcpy(work.data(), iq.data(), buf_len * sizeof(float));
+		return resampler.Process(work.data(), buf_len) * sizeof(float);
+	});
+
+	energy_squelch_options_t squelch_opts;
+	EnergySquelch squelch(squelch_opts);
+	bench("squelch", buf_len, [&]() {
+		squelch.Process(in.data(), buf_len);
+		return (size_t) 0;
+	});
+
+	SpectrumAnalyzer analyzer(1024, SPECTRUM_WINDOW_HANN, 0.5, 16);
+	bench("spectrum/1024", buf_len, [&]() {
+		return analyzer.Process(iq.data(), buf_len) * analyzer.Size() * sizeof(float);
+	});
+
+	Channelizer channelizer(16, std::vector<unsigned>{0, 3, 12}, 1);
+	bench("channelize/16x3", buf_len, [&]() {
+		return channelizer.Process(iq.data(), buf_len) * channelizer.Selected().size() * sizeof(float);
+	});
+
+	demod_options_t wbfm;
+	wbfm.mode = DEMOD_MODE_WBFM;
+	wbfm.offset = 150000;
+	Demodulator fm(wbfm, BENCH_SAMPLE_RATE);
+	bench("demod/wbfm", buf_len, [&]() {
+		return fm.Process(iq.data(), buf_len) * sizeof(float);
+	});
+}
+
+int main() {
+	const uint32_t buf_lens[] = {16384, 65536, 262144};
+
+	for(size_t i = 0; i < sizeof(buf_lens) / sizeof(buf_lens[0]); i++) {
+		const std::vector<uint8_t> in = synthetic_transfer(buf_lens[i]);
+
+		bench_source(buf_lens[i]);
+		bench_convert(in);
+		bench_queue(in);
+		bench_stages(in);
+	}
+
+	return 0;
+}
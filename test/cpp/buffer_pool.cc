@@ -0,0 +1,127 @@
+#include "catch.hpp"
+#include "../../lib/addon/buffer_pool.h"
+
+SCENARIO("BufferPool lends fixed slabs and takes them back") {
+	GIVEN("a pool of two 100-byte slabs") {
+		BufferPool * pool = BufferPool::Create(100, 2);
+
+		THEN("slabs are distinct and aligned, and the pool runs dry") {
+			uint8_t * a = pool->Acquire();
+			uint8_t * b = pool->Acquire();
+
+			REQUIRE(a != NULL);
+			REQUIRE(b != NULL);
+			REQUIRE(a != b);
+			REQUIRE(((uintptr_t) a) % BUFFER_POOL_ALIGNMENT == 0);
+			REQUIRE(((uintptr_t) b) % BUFFER_POOL_ALIGNMENT == 0);
+			REQUIRE(pool->Acquire() == NULL);
+
+			pool->Recycle(a);
+			REQUIRE(pool->FreeCount() == 1);
+			pool->Recycle(b);
+			pool->Orphan();
+		}
+
+		WHEN("a slab is lent and its Buffer is collected") {
+			uint8_t * a = pool->Acquire();
+			uintptr_t generation = pool->Lend(a);
+
+			THEN("the slab comes back") {
+				REQUIRE(pool->FreeCount() == 1);
+				REQUIRE(BufferPool::Return(a, generation) == 100);
+				REQUIRE(pool->FreeCount() == 2);
+				pool->Orphan();
+			}
+		}
+
+		WHEN("a slab is explicitly released, then lent again before the old Buffer is collected") {
+			uint8_t * a = pool->Acquire();
+			uintptr_t old_generation = pool->Lend(a);
+
+			REQUIRE(BufferPool::Release(a));
+			REQUIRE(!BufferPool::Release(a));
+
+			uint8_t * again = pool->Acquire();
+			uint8_t * other = pool->Acquire();
+			uint8_t * reused = again == a ? again : other;
+			uintptr_t new_generation = pool->Lend(reused);
+			pool->Recycle(reused == again ? other : again);
+
+			THEN("collecting the old Buffer does not free the new lease") {
+				REQUIRE(reused == a);
+				BufferPool::Return(a, old_generation);
+				REQUIRE(pool->FreeCount() == 1);
+
+				BufferPool::Return(a, new_generation);
+				REQUIRE(pool->FreeCount() == 2);
+				pool->Orphan();
+			}
+		}
+	}
+
+	GIVEN("a pool of one slab shared by three holders") {
+		BufferPool * pool = BufferPool::Create(100, 1);
+		uint8_t * a = pool->Acquire();
+		pool->Share(a, 3);
+
+		THEN("it comes back only once every holder has let go") {
+			pool->Unref(a);
+			pool->Unref(a);
+			REQUIRE(pool->FreeCount() == 0);
+
+			pool->Unref(a);
+			REQUIRE(pool->FreeCount() == 1);
+			pool->Orphan();
+		}
+
+		WHEN("one holder lends it to JS and lets go") {
+			uintptr_t generation = pool->Lend(a);
+			pool->Unref(a);
+			pool->Unref(a);
+			pool->Unref(a);
+
+			THEN("it comes back once the Buffer is collected too") {
+				REQUIRE(pool->FreeCount() == 0);
+				REQUIRE(pool->LentCount() == 1);
+				REQUIRE(BufferPool::Return(a, generation) == 100);
+				REQUIRE(pool->FreeCount() == 1);
+				REQUIRE(pool->LentCount() == 0);
+				pool->Orphan();
+			}
+		}
+
+		WHEN("the Buffer is collected before the other holders let go") {
+			uintptr_t generation = pool->Lend(a);
+			pool->Unref(a);
+			REQUIRE(BufferPool::Return(a, generation) == 100);
+
+			THEN("it comes back with the last of them") {
+				REQUIRE(pool->FreeCount() == 0);
+				pool->Unref(a);
+				REQUIRE(pool->FreeCount() == 0);
+				pool->Unref(a);
+				REQUIRE(pool->FreeCount() == 1);
+				pool->Orphan();
+			}
+		}
+
+		WHEN("the pool is orphaned while holders remain") {
+			pool->Orphan();
+
+			THEN("the last holder frees it") {
+				pool->Unref(a);
+				pool->Unref(a);
+				pool->Unref(a);
+			}
+		}
+	}
+
+	GIVEN("memory that does not belong to any pool") {
+		uint8_t foreign[16];
+
+		THEN("it is neither released nor returned") {
+			REQUIRE(!BufferPool::Release(foreign));
+			REQUIRE(BufferPool::Return(foreign, 1) == 0);
+		}
+	}
+}
@@ -0,0 +1,123 @@
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/burst_capture.h"
+
+// a transfer of len bytes whose byte i holds (from + i) % 251, so any byte says where in the stream it came from
+static std::vector<uint8_t> counter_transfer(uint64_t from, size_t len) {
+	std::vector<uint8_t> buf(len);
+	for(size_t i = 0; i < len; i++) buf[i] = (uint8_t) ((from + i) % 251);
+	return buf;
+}
+
+static bool holds_stream(const burst_capture_t * capture) {
+	for(size_t i = 0; i < capture->data.size(); i++) {
+		if(capture->data[i] != (uint8_t) ((capture->start + i) % 251)) return false;
+	}
+
+	return true;
+}
+
+SCENARIO("BurstCapture captures contiguous stretches around a trigger") {
+	burst_capture_options_t opts;
+	opts.history = 3000; // not a multiple of the transfer size, so the ring wraps mid-transfer
+
+	GIVEN("a ring that has wrapped several times") {
+		BurstCapture capture(opts);
+		uint64_t offset = 0;
+
+		for(int i = 0; i < 7; i++, offset += 1024) {
+			const std::vector<uint8_t> buf = counter_transfer(offset, 1024);
+			capture.Process(buf.data(), 1024);
+		}
+
+		WHEN("a snapshot reaches back into the ring and forward over two transfers") {
+			const int id = capture.Snapshot(2500, 1500);
+			REQUIRE(id == 1);
+
+			const std::vector<uint8_t> a = counter_transfer(offset, 1024);
+			const size_t done_a = capture.Process(a.data(), 1024).size();
+			const std::vector<uint8_t> b = counter_transfer(offset + 1024, 1024);
+			const std::vector<const burst_capture_t *> done = capture.Process(b.data(), 1024);
+
+			THEN("it completes on the second transfer holding the stream in order") {
+				REQUIRE(done_a == 0);
+				REQUIRE(done.size() == 1);
+				REQUIRE(done[0]->id == id);
+				REQUIRE(done[0]->trigger == offset);
+				REQUIRE(done[0]->start == offset - 2500);
+				REQUIRE(done[0]->data.size() == 4000);
+				REQUIRE(holds_stream(done[0]));
+			}
+		}
+
+		WHEN("a snapshot asks for more than the ring holds") {
+			capture.Snapshot(10000, 0);
+			const std::vector<uint8_t> buf = counter_transfer(offset, 1024);
+			const std::vector<const burst_capture_t *> done = capture.Process(buf.data(), 1024);
+
+			THEN("its pre-trigger part is cut to the ring") {
+				REQUIRE(done.size() == 1);
+				REQUIRE(done[0]->start == offset - 3000);
+				REQUIRE(done[0]->data.size() == 3000);
+				REQUIRE(holds_stream(done[0]));
+			}
+		}
+	}
+
+	GIVEN("a fresh capture") {
+		BurstCapture capture(opts);
+
+		WHEN("more snapshots are asked for than may be pending") {
+			for(int i = 0; i < BURST_CAPTURE_MAX_SNAPSHOTS; i++) REQUIRE(capture.Snapshot(0, 4096) == i + 1);
+
+			THEN("the extra one is refused until a capture completes") {
+				REQUIRE(capture.Snapshot(0, 4096) == 0);
+
+				std::vector<uint8_t> buf = counter_transfer(0, 4096);
+				REQUIRE(capture.Process(buf.data(), 4096).size() == BURST_CAPTURE_MAX_SNAPSHOTS);
+
+				// the next Process releases the slots that just completed
+				buf = counter_transfer(4096, 4096);
+				REQUIRE(capture.Snapshot(0, 4096) == 0);
+				capture.Process(buf.data(), 4096);
+				REQUIRE(capture.Snapshot(0, 4096) == BURST_CAPTURE_MAX_SNAPSHOTS + 1);
+			}
+		}
+	}
+}
+
+SCENARIO("BurstCapture triggers on the power detector") {
+	burst_capture_options_t opts;
+	opts.history = 8192;
+	opts.trigger = true;
+	opts.detector.level = -20;
+	opts.detector.window = 256;
+	opts.pre = 1024;
+	opts.post = 2048;
+
+	GIVEN("quiet transfers, then one with a burst from its 1024th sample") {
+		BurstCapture capture(opts);
+		std::vector<uint8_t> quiet(4096, 127), loud(4096, 127);
+
+		for(size_t n = 1024; n < 2048; n++) {
+			loud[2 * n] = n % 2 ? 255 : 0;
+			loud[2 * n + 1] = 255;
+		}
+
+		WHEN("they are processed") {
+			capture.Process(quiet.data(), 4096);
+			const std::vector<const burst_capture_t *> done = capture.Process(loud.data(), 4096);
+
+			THEN("a capture opens pre bytes before the burst and runs post bytes past it") {
+				REQUIRE(done.size() == 1);
+				REQUIRE(done[0]->id == 0);
+				REQUIRE(done[0]->trigger == 4096 + 2048);
+				REQUIRE(done[0]->start == 4096 + 1024);
+				REQUIRE(done[0]->data.size() == 3072);
+				REQUIRE(done[0]->data[0] == 127);
+				REQUIRE(done[0]->data[1024] == 0);
+				REQUIRE(done[0]->data[1025] == 255);
+			}
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#include <cmath>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/channelizer.h"
+
+// run a complex tone at freq (cycles per sample) through channelizer in chunks; returns every selected channel's
+// output, concatenated per channel
+static std::vector<std::vector<float> > channelize_tone(Channelizer & channelizer, double freq, size_t chunks) {
+	const size_t chunk = 4000; // deliberately not a multiple of the channel count
+	std::vector<std::vector<float> > out(channelizer.Selected().size());
+	std::vector<float> iq(2 * chunk);
+	size_t n = 0;
+
+	for(size_t c = 0; c < chunks; c++) {
+		for(size_t k = 0; k < chunk; k++, n++) {
+			iq[2 * k] = (float) (0.5 * cos(2 * M_PI * freq * n));
+			iq[2 * k + 1] = (float) (0.5 * sin(2 * M_PI * freq * n));
+		}
+
+		const size_t len = channelizer.Process(iq.data(), iq.size());
+		REQUIRE(len <= channelizer.MaxOutput(iq.size()));
+
+		for(size_t i = 0; i < out.size(); i++)
+			out[i].insert(out[i].end(), channelizer.Output(i), channelizer.Output(i) + len);
+	}
+
+	return out;
+}
+
+// mean magnitude over the second half, past the filter's startup
+static double magnitude(const std::vector<float> & iq) {
+	const size_t pairs = iq.size() / 2;
+	double sum = 0;
+
+	for(size_t k = pairs / 2; k < pairs; k++) sum += hypot(iq[2 * k], iq[2 * k + 1]);
+	return sum / (pairs - pairs / 2);
+}
+
+SCENARIO("Channelizer splits a band into decimated channels") {
+	std::vector<unsigned> selected;
+	selected.push_back(0);
+	selected.push_back(3);
+	selected.push_back(5);
+	selected.push_back(93); // -3
+
+	GIVEN("96 channels and a tone at the center of channel 3") {
+		Channelizer channelizer(96, selected, 1);
+		const std::vector<std::vector<float> > out = channelize_tone(channelizer, 3.0 / 96, 24);
+
+		THEN("each channel is decimated by 96") {
+			REQUIRE(out[0].size() / 2 == Approx(24 * 4000 / 96.0).margin(1));
+		}
+
+		THEN("only channel 3 carries the tone") {
+			REQUIRE(magnitude(out[1]) == Approx(0.5).epsilon(0.01));
+			REQUIRE(magnitude(out[0]) < 0.0005);
+			REQUIRE(magnitude(out[2]) < 0.0005);
+			REQUIRE(magnitude(out[3]) < 0.0005);
+		}
+	}
+
+	GIVEN("a tone at the center of channel -3") {
+		Channelizer channelizer(96, selected, 1);
+		const std::vector<std::vector<float> > out = channelize_tone(channelizer, -3.0 / 96, 24);
+
+		THEN("it lands in channel 93") {
+			REQUIRE(magnitude(out[3]) == Approx(0.5).epsilon(0.01));
+			REQUIRE(magnitude(out[1]) < 0.0005);
+		}
+	}
+
+	GIVEN("the same input split across four threads") {
+		Channelizer single(96, selected, 1);
+		Channelizer threaded(96, selected, 4);
+		const std::vector<std::vector<float> > a = channelize_tone(single, 5.2 / 96, 8);
+		const std::vector<std::vector<float> > b = channelize_tone(threaded, 5.2 / 96, 8);
+
+		THEN("the output is identical") {
+			for(size_t i = 0; i < selected.size(); i++) REQUIRE(a[i] == b[i]);
+		}
+	}
+}
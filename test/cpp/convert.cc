@@ -0,0 +1,130 @@
+#include <cstring>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/convert.h"
+
+static const convert_kernel_t all_kernels[] = {CONVERT_KERNEL_LUT, CONVERT_KERNEL_SSE2, CONVERT_KERNEL_AVX2};
+
+SCENARIO("convert_samples maps offset-binary bytes onto each format") {
+	uint8_t in[4] = {0, 255, 127, 128};
+
+	GIVEN("int16 output") {
+		int16_t out[4];
+		convert_samples(SAMPLE_FORMAT_INT16, in, 4, out);
+
+		THEN("the range is symmetric about 127.5") {
+			REQUIRE(out[0] == -32640);
+			REQUIRE(out[1] == 32640);
+			REQUIRE(out[2] == -128);
+			REQUIRE(out[3] == 128);
+		}
+	}
+
+	GIVEN("float32 output") {
+		float out[4];
+		convert_samples(SAMPLE_FORMAT_FLOAT32, in, 4, out);
+
+		THEN("the range is -1.0 to 1.0") {
+			REQUIRE(out[0] == Approx(-1.0));
+			REQUIRE(out[1] == Approx(1.0));
+			REQUIRE(out[2] == Approx(-0.5 / 127.5));
+			REQUIRE(out[3] == Approx(0.5 / 127.5));
+		}
+	}
+
+	GIVEN("planar float32 output") {
+		float out[4];
+		convert_samples(SAMPLE_FORMAT_FLOAT32_PLANAR, in, 4, out);
+
+		THEN("every I precedes every Q") {
+			REQUIRE(out[0] == Approx(-1.0));
+			REQUIRE(out[1] == Approx(-0.5 / 127.5));
+			REQUIRE(out[2] == Approx(1.0));
+			REQUIRE(out[3] == Approx(0.5 / 127.5));
+		}
+	}
+
+	GIVEN("uint8 output") {
+		uint8_t out[4];
+		convert_samples(SAMPLE_FORMAT_UINT8, in, 4, out);
+
+		THEN("the bytes are copied unchanged") {
+			for(int i = 0; i < 4; i++) REQUIRE(out[i] == in[i]);
+		}
+	}
+}
+
+SCENARIO("every conversion kernel agrees with the lookup table") {
+	// odd lengths and lengths off the vector width exercise the scalar tails
+	const size_t lens[] = {1, 2, 15, 16, 17, 31, 33, 64, 255, 1001};
+	std::vector<uint8_t> in(1001);
+	for(size_t i = 0; i < in.size(); i++) in[i] = (uint8_t) (i * 7 + 3);
+
+	for(size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+		const size_t len = lens[l];
+
+		for(int f = SAMPLE_FORMAT_UINT8; f <= SAMPLE_FORMAT_FLOAT32_PLANAR; f++) {
+			const sample_format_t format = (sample_format_t) f;
+			const size_t size = len * sample_format_size(format);
+			std::vector<uint8_t> expected(size);
+			convert_samples_with(CONVERT_KERNEL_LUT, format, in.data(), len, expected.data());
+
+			for(size_t k = 0; k < 3; k++) {
+				std::vector<uint8_t> out(size + 1, 0xa5);
+				convert_samples_with(all_kernels[k], format, in.data(), len, out.data());
+
+				CAPTURE(len);
+				CAPTURE(f);
+				CAPTURE(k);
+				REQUIRE(0 == memcmp(expected.data(), out.data(), size));
+				REQUIRE(out[size] == 0xa5);
+			}
+		}
+	}
+}
+
+SCENARIO("sample formats are parsed by name") {
+	sample_format_t format;
+
+	REQUIRE(parse_sample_format("float32-planar", &format));
+	REQUIRE(format == SAMPLE_FORMAT_FLOAT32_PLANAR);
+	REQUIRE(sample_format_size(format) == 4);
+	REQUIRE(parse_sample_format("int16", &format));
+	REQUIRE(sample_format_size(format) == 2);
+	REQUIRE(!parse_sample_format("float64", &format));
+	REQUIRE(convert_kernel_supported(CONVERT_KERNEL_LUT));
+}
+
+SCENARIO("encode_samples is the inverse of convert_samples") {
+	uint8_t in[4] = {0, 255, 100, 200};
+	float iq[4];
+	convert_samples(SAMPLE_FORMAT_FLOAT32, in, 4, iq);
+
+	GIVEN("uint8 and int16 output") {
+		uint8_t bytes[4];
+		int16_t words[4], expected[4];
+		encode_samples(SAMPLE_FORMAT_UINT8, iq, 4, bytes);
+		encode_samples(SAMPLE_FORMAT_INT16, iq, 4, words);
+		convert_samples(SAMPLE_FORMAT_INT16, in, 4, expected);
+
+		THEN("the original samples come back") {
+			for(int i = 0; i < 4; i++) REQUIRE(bytes[i] == in[i]);
+			for(int i = 0; i < 4; i++) REQUIRE(words[i] == expected[i]);
+		}
+	}
+
+	GIVEN("out-of-range input") {
+		float loud[2] = {-2.0f, 2.0f};
+		uint8_t bytes[2];
+		int16_t words[2];
+		encode_samples(SAMPLE_FORMAT_UINT8, loud, 2, bytes);
+		encode_samples(SAMPLE_FORMAT_INT16, loud, 2, words);
+
+		THEN("it saturates") {
+			REQUIRE(bytes[0] == 0);
+			REQUIRE(bytes[1] == 255);
+			REQUIRE(words[0] == -32768);
+			REQUIRE(words[1] == 32767);
+		}
+	}
+}
@@ -0,0 +1,263 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/demod.h"
+
+// complex FM signal at offset Hz, modulated by a tone of tone_hz at deviation Hz, of the given amplitude
+static std::vector<float> fm_signal(double rate, double offset, double tone_hz, double deviation, double amplitude,
+                                    size_t pairs) {
+	std::vector<float> iq(2 * pairs);
+	double phase = 0;
+
+	for(size_t n = 0; n < pairs; n++) {
+		iq[2 * n] = (float) (amplitude * cos(phase));
+		iq[2 * n + 1] = (float) (amplitude * sin(phase));
+
+		const double freq = offset + deviation * sin(2 * M_PI * tone_hz * n / rate);
+		phase = fmod(phase + 2 * M_PI * freq / rate, 2 * M_PI);
+	}
+
+	return iq;
+}
+
+// complex AM signal at offset Hz: a carrier of the given amplitude, modulated by a tone of tone_hz to depth
+static std::vector<float> am_signal(double rate, double offset, double tone_hz, double depth, double amplitude,
+                                    size_t pairs) {
+	std::vector<float> iq(2 * pairs);
+
+	for(size_t n = 0; n < pairs; n++) {
+		const double a = amplitude * (1 + depth * sin(2 * M_PI * tone_hz * n / rate));
+		iq[2 * n] = (float) (a * cos(2 * M_PI * offset * n / rate));
+		iq[2 * n + 1] = (float) (a * sin(2 * M_PI * offset * n / rate));
+	}
+
+	return iq;
+}
+
+// feed iq through demod a transfer at a time, collecting the audio
+static std::vector<float> demodulate(Demodulator & demod, const std::vector<float> & iq) {
+	const size_t chunk = 16384;
+	std::vector<float> audio;
+
+	for(size_t i = 0; i < iq.size(); i += chunk) {
+		const size_t len = iq.size() - i < chunk ? iq.size() - i : chunk;
+		const size_t out = demod.Process(&iq[i], len);
+		REQUIRE(out <= demod.MaxOutput(len));
+		audio.insert(audio.end(), demod.Output(), demod.Output() + out);
+	}
+
+	return audio;
+}
+
+static double rms(const std::vector<float> & x, size_t from) {
+	double sum = 0;
+	for(size_t n = from; n < x.size(); n++) sum += x[n] * x[n];
+	return sqrt(sum / (x.size() - from));
+}
+
+// frequency of the tone in x from index from on, by counting zero crossings
+static double tone_frequency(const std::vector<float> & x, size_t from, double rate) {
+	size_t crossings = 0;
+	for(size_t n = from + 1; n < x.size(); n++) crossings += (x[n - 1] < 0) != (x[n] < 0);
+	return crossings / 2.0 / ((x.size() - from - 1) / rate);
+}
+
+SCENARIO("Mixer shifts a tone to DC") {
+	GIVEN("a tone at 123.4 kHz of 2.4 MS/s") {
+		const size_t pairs = 10000;
+		std::vector<float> iq = fm_signal(2400000, 123400, 1, 0, 1, pairs);
+		Mixer mixer(123400, 2400000);
+
+		WHEN("it is mixed in uneven pieces") {
+			mixer.Process(iq.data(), 2 * 999, iq.data());
+			mixer.Process(&iq[2 * 999], iq.size() - 2 * 999, &iq[2 * 999]);
+
+			THEN("every sample is the same phasor") {
+				double worst = 0;
+				for(size_t n = 0; n < pairs; n++) worst = fmax(worst, hypot(iq[2 * n] - 1, iq[2 * n + 1]));
+				REQUIRE(worst < 1e-4);
+			}
+		}
+	}
+}
+
+SCENARIO("Demodulator recovers FM audio") {
+	GIVEN("a broadcast FM station 300 kHz above center, modulated by 1 kHz at half deviation") {
+		const std::vector<float> iq = fm_signal(2400000, 300000, 1000, 37500, 0.5, 240000);
+
+		demod_options_t opts;
+		opts.mode = DEMOD_MODE_WBFM;
+		opts.offset = 300000;
+		opts.deemphasis = 0;
+
+		Demodulator demod(opts, 2400000);
+
+		THEN("it plans a 240 kHz IF") {
+			REQUIRE(demod.IfRate() == 240000);
+		}
+
+		WHEN("it is demodulated") {
+			const std::vector<float> audio = demodulate(demod, iq);
+
+			THEN("a tenth of a second of 48 kHz audio holds a half-scale 1 kHz tone") {
+				REQUIRE(audio.size() == Approx(4800).margin(10));
+				REQUIRE(rms(audio, 1000) == Approx(0.5 / sqrt(2)).epsilon(0.02));
+
+				REQUIRE(tone_frequency(audio, 1000, 48000) == Approx(1000).epsilon(0.02));
+			}
+		}
+	}
+
+	GIVEN("the same station, demodulated with 75 us de-emphasis") {
+		demod_options_t opts;
+		opts.offset = 300000;
+
+		THEN("a 10 kHz tone is cut relative to a 1 kHz tone as the one-pole filter predicts") {
+			Demodulator low(opts, 2400000), high(opts, 2400000);
+			const double low_rms = rms(demodulate(low, fm_signal(2400000, 300000, 1000, 37500, 0.5, 240000)), 1000);
+			const double high_rms = rms(demodulate(high, fm_signal(2400000, 300000, 10000, 37500, 0.5, 240000)), 1000);
+
+			// |a / (1 - (1 - a) e^-jw)| at 48 kHz
+			const double a = 1 - exp(-1 / (48000 * 75e-6));
+			const double w1 = 2 * M_PI * 1000 / 48000, w10 = 2 * M_PI * 10000 / 48000;
+			const double predicted = hypot(1 - (1 - a) * cos(w1), (1 - a) * sin(w1))
+			                         / hypot(1 - (1 - a) * cos(w10), (1 - a) * sin(w10));
+			REQUIRE(high_rms / low_rms == Approx(predicted).epsilon(0.02));
+		}
+	}
+}
+
+SCENARIO("Demodulator squelch mutes a quiet channel") {
+	GIVEN("an NBFM receiver squelched at -40 dBFS") {
+		demod_options_t opts;
+		opts.mode = DEMOD_MODE_NBFM;
+		opts.offset = -50000;
+		opts.squelch = true;
+		opts.squelch_level = -40;
+
+		Demodulator demod(opts, 1024000);
+
+		WHEN("the channel holds only faint noise") {
+			std::vector<float> iq(2 * 102400);
+			srand(99);
+			for(size_t i = 0; i < iq.size(); i++) iq[i] = 0.001f * ((float) rand() / RAND_MAX - 0.5f);
+
+			THEN("the audio is silent") {
+				const std::vector<float> audio = demodulate(demod, iq);
+				REQUIRE(audio.size() > 0);
+				REQUIRE(rms(audio, 0) == 0);
+			}
+		}
+
+		WHEN("a station keys up") {
+			const std::vector<float> audio = demodulate(demod, fm_signal(1024000, -50000, 1000, 2500, 0.5, 102400));
+
+			THEN("the squelch opens after its first window") {
+				REQUIRE(rms(audio, 1000) == Approx(0.5 / sqrt(2)).epsilon(0.05));
+			}
+		}
+	}
+}
+
+SCENARIO("Demodulator recovers AM, SSB, and CW audio") {
+	GIVEN("an airband AM station 20 kHz above center, modulated 50% by 1 kHz") {
+		demod_options_t opts;
+		opts.mode = DEMOD_MODE_AM;
+		opts.offset = 20000;
+		opts.agc = 0;
+
+		WHEN("it is demodulated without AGC") {
+			Demodulator demod(opts, 240000);
+			const std::vector<float> audio = demodulate(demod, am_signal(240000, 20000, 1000, 0.5, 0.2, 48000));
+
+			THEN("the carrier is removed and the tone is left at its modulation depth") {
+				REQUIRE(rms(audio, 4800) == Approx(0.2 * 0.5 / sqrt(2)).epsilon(0.05));
+				REQUIRE(tone_frequency(audio, 4800, 48000) == Approx(1000).epsilon(0.02));
+			}
+		}
+
+		WHEN("two seconds of a faint copy are demodulated with AGC") {
+			opts.agc = 1;
+			Demodulator demod(opts, 240000);
+			const std::vector<float> audio = demodulate(demod, am_signal(240000, 20000, 1000, 0.5, 0.001, 480000));
+
+			THEN("once the gain has recovered from the carrier's onset, the tone's peaks are at the AGC's target") {
+				float peak = 0;
+				for(size_t n = audio.size() - 9600; n < audio.size(); n++) peak = fmaxf(peak, fabsf(audio[n]));
+				REQUIRE(peak == Approx(DEMOD_AGC_TARGET).epsilon(0.1));
+			}
+		}
+	}
+
+	GIVEN("a 1 kHz tone 1 kHz above a suppressed carrier 20 kHz above center") {
+		const std::vector<float> iq = fm_signal(240000, 21000, 1, 0, 0.1, 48000);
+
+		demod_options_t opts;
+		opts.offset = 20000;
+		opts.agc = 0;
+
+		THEN("USB hears the tone") {
+			opts.mode = DEMOD_MODE_USB;
+			Demodulator demod(opts, 240000);
+			const std::vector<float> audio = demodulate(demod, iq);
+
+			REQUIRE(rms(audio, 4800) == Approx(0.1 / sqrt(2)).epsilon(0.1));
+			REQUIRE(tone_frequency(audio, 4800, 48000) == Approx(1000).epsilon(0.02));
+		}
+
+		THEN("LSB rejects it") {
+			opts.mode = DEMOD_MODE_LSB;
+			Demodulator demod(opts, 240000);
+			REQUIRE(rms(demodulate(demod, iq), 4800) < 0.1 / sqrt(2) / 100);
+		}
+	}
+
+	GIVEN("an unmodulated CW carrier 20 kHz above center") {
+		demod_options_t opts;
+		opts.mode = DEMOD_MODE_CW;
+		opts.offset = 20000;
+
+		WHEN("it is demodulated") {
+			Demodulator demod(opts, 240000);
+			const std::vector<float> audio = demodulate(demod, fm_signal(240000, 20000, 1, 0, 0.01, 48000));
+
+			THEN("it is heard as a 700 Hz tone, levelled by the AGC") {
+				REQUIRE(tone_frequency(audio, 4800, 48000) == Approx(700).epsilon(0.02));
+				REQUIRE(rms(audio, 4800) == Approx(DEMOD_AGC_TARGET / sqrt(2)).epsilon(0.1));
+			}
+		}
+	}
+}
+
+SCENARIO("Demodulator options are checked") {
+	std::string err;
+	demod_options_t opts;
+
+	REQUIRE(Demodulator::Valid(opts, 2400000, &err));
+
+	opts.offset = 1150000;
+	REQUIRE_FALSE(Demodulator::Valid(opts, 2400000, &err));
+
+	opts.offset = 0;
+	opts.audio_rate = 48000;
+	REQUIRE_FALSE(Demodulator::Valid(opts, 32000, &err));
+
+	opts.mode = DEMOD_MODE_USB;
+	opts.offset = 1198000;
+	REQUIRE_FALSE(Demodulator::Valid(opts, 2400000, &err));
+	opts.mode = DEMOD_MODE_LSB;
+	REQUIRE(Demodulator::Valid(opts, 2400000, &err));
+
+	opts.offset = 0;
+	opts.mode = DEMOD_MODE_CW;
+	opts.pitch = 23900;
+	REQUIRE_FALSE(Demodulator::Valid(opts, 2400000, &err));
+
+	demod_mode_t mode;
+	REQUIRE(parse_demod_mode("cw", &mode));
+	REQUIRE(mode == DEMOD_MODE_CW);
+	REQUIRE(parse_demod_mode("nbfm", &mode));
+	REQUIRE(mode == DEMOD_MODE_NBFM);
+	REQUIRE_FALSE(parse_demod_mode("fm", &mode));
+}
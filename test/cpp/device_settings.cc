@@ -0,0 +1,108 @@
+#include <mutex>
+#include <string>
+#include "catch.hpp"
+#include "rtl-sdr.h"
+#include "../../lib/addon/device_settings.h"
+
+static void set(device_settings_t * settings, device_setting_t setting, int64_t value) {
+	settings->set[setting] = true;
+	settings->value[setting] = value;
+}
+
+SCENARIO("merge_device_settings folds later batches into a pending one") {
+	device_settings_t pending, later;
+	set(&pending, DEVICE_SETTING_CENTER_FREQ, 100000000);
+	set(&pending, DEVICE_SETTING_TUNER_GAIN_MODE, 1);
+	set(&pending, DEVICE_SETTING_TUNER_GAIN, 300);
+
+	GIVEN("a later retune and bandwidth") {
+		set(&later, DEVICE_SETTING_CENTER_FREQ, 101000000);
+		set(&later, DEVICE_SETTING_TUNER_BANDWIDTH, 200000);
+		merge_device_settings(&pending, later);
+
+		THEN("later's values win and the rest are kept") {
+			REQUIRE(pending.value[DEVICE_SETTING_CENTER_FREQ] == 101000000);
+			REQUIRE(pending.set[DEVICE_SETTING_TUNER_BANDWIDTH]);
+			REQUIRE(pending.value[DEVICE_SETTING_TUNER_BANDWIDTH] == 200000);
+			REQUIRE(pending.value[DEVICE_SETTING_TUNER_GAIN] == 300);
+			REQUIRE(!pending.set[DEVICE_SETTING_SAMPLE_RATE]);
+		}
+	}
+
+	GIVEN("a later switch to automatic gain") {
+		set(&later, DEVICE_SETTING_TUNER_GAIN_MODE, 0);
+		merge_device_settings(&pending, later);
+
+		THEN("the pending manual gain is dropped, as applying it would undo the switch") {
+			REQUIRE(pending.value[DEVICE_SETTING_TUNER_GAIN_MODE] == 0);
+			REQUIRE(!pending.set[DEVICE_SETTING_TUNER_GAIN]);
+		}
+	}
+
+	GIVEN("a later manual gain") {
+		set(&later, DEVICE_SETTING_TUNER_GAIN_MODE, 1);
+		set(&later, DEVICE_SETTING_TUNER_GAIN, 400);
+		merge_device_settings(&pending, later);
+
+		THEN("it replaces the pending one") {
+			REQUIRE(pending.set[DEVICE_SETTING_TUNER_GAIN]);
+			REQUIRE(pending.value[DEVICE_SETTING_TUNER_GAIN] == 400);
+		}
+	}
+}
+
+SCENARIO("apply_device_settings applies a batch through librtlsdr") {
+	rtlsdr_dev_t * dev;
+	REQUIRE(rtlsdr_open(&dev, 0) == 0);
+
+	device_settings_t settings;
+	set(&settings, DEVICE_SETTING_SAMPLE_RATE, 1024000);
+	set(&settings, DEVICE_SETTING_CENTER_FREQ, 162400000);
+	set(&settings, DEVICE_SETTING_TUNER_BANDWIDTH, 300000);
+	set(&settings, DEVICE_SETTING_TUNER_GAIN_MODE, 1);
+	set(&settings, DEVICE_SETTING_TUNER_GAIN, 496);
+	set(&settings, DEVICE_SETTING_AGC_MODE, 1);
+
+	std::mutex control;
+	std::string err;
+
+	GIVEN("a device that accepts every setting") {
+		THEN("each is set, and the others are left alone") {
+			REQUIRE(apply_device_settings(dev, control, settings, &err) == 0);
+			REQUIRE(err.empty());
+			REQUIRE(dev->sample_rate == 1024000);
+			REQUIRE(dev->center_freq == 162400000);
+			REQUIRE(dev->tuner_bandwidth == 300000);
+			REQUIRE(dev->tuner_gain_mode == 1);
+			REQUIRE(dev->tuner_gain == 496);
+			REQUIRE(dev->agc_mode == 1);
+			REQUIRE(dev->freq_correction == 0);
+			REQUIRE(dev->testmode == 0);
+		}
+	}
+
+	GIVEN("a device that fails every call") {
+		dev->mock_return_error = -5;
+
+		THEN("it stops at the first setting, and says which call failed") {
+			REQUIRE(apply_device_settings(dev, control, settings, &err) == -5);
+			REQUIRE(err == "rtlsdr_set_sample_rate failed with code -5");
+			REQUIRE(dev->center_freq == 0);
+		}
+	}
+
+	GIVEN("a batch whose only failing calls are ones the synchronous setters ignore") {
+		device_settings_t tuning;
+		set(&tuning, DEVICE_SETTING_CENTER_FREQ, 100000000);
+		set(&tuning, DEVICE_SETTING_FREQ_CORRECTION, 12);
+		dev->mock_return_error = -1;
+
+		THEN("it succeeds") {
+			REQUIRE(apply_device_settings(dev, control, tuning, &err) == 0);
+			REQUIRE(err.empty());
+		}
+	}
+
+	dev->mock_return_error = 0;
+	rtlsdr_close(dev);
+}
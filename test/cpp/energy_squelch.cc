@@ -0,0 +1,112 @@
+#include <cmath>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/energy_squelch.h"
+
+// a transfer of pairs complex samples: silence (I 127/128 alternating, Q 127: about -45 dBFS) with a +3 dBFS
+// burst over [burst_from, burst_to)
+static std::vector<uint8_t> burst_transfer(size_t pairs, size_t burst_from, size_t burst_to) {
+	std::vector<uint8_t> buf(2 * pairs);
+
+	for(size_t n = 0; n < pairs; n++) {
+		const bool loud = n >= burst_from && n < burst_to;
+		buf[2 * n] = loud ? (n % 2 ? 255 : 0) : (n % 2 ? 128 : 127);
+		buf[2 * n + 1] = loud ? 255 : 127;
+	}
+
+	return buf;
+}
+
+SCENARIO("EnergySquelch forwards only the windows above its level") {
+	energy_squelch_options_t opts;
+	opts.level = -20;
+	opts.window = 256;
+
+	GIVEN("a transfer with a burst over windows 2 and 3 of 8") {
+		EnergySquelch squelch(opts);
+		const std::vector<uint8_t> buf = burst_transfer(2048, 512, 1024);
+
+		WHEN("it is gated") {
+			const std::vector<squelch_segment_t> segments = squelch.Process(buf.data(), (uint32_t) buf.size());
+
+			THEN("one segment covers the burst, opening and closing within the transfer") {
+				REQUIRE(segments.size() == 1);
+				REQUIRE(segments[0].start == 1024);
+				REQUIRE(segments[0].len == 1024);
+				REQUIRE(segments[0].offset == 512);
+				REQUIRE(segments[0].opened);
+				REQUIRE(segments[0].closed);
+				REQUIRE_FALSE(squelch.Open());
+			}
+		}
+	}
+
+	GIVEN("a burst that spans two transfers") {
+		EnergySquelch squelch(opts);
+		const std::vector<uint8_t> first = burst_transfer(2048, 1536, 2048);
+		const std::vector<uint8_t> second = burst_transfer(2048, 0, 256);
+
+		WHEN("both are gated, then a quiet one") {
+			const std::vector<squelch_segment_t> a = squelch.Process(first.data(), (uint32_t) first.size());
+			const std::vector<squelch_segment_t> b = squelch.Process(second.data(), (uint32_t) second.size());
+			const std::vector<squelch_segment_t> c = squelch.Process(second.data(), (uint32_t) second.size());
+
+			THEN("the first opens, the second continues and closes, and the squelch stays shut") {
+				REQUIRE(a.size() == 1);
+				REQUIRE(a[0].offset == 1536);
+				REQUIRE(a[0].opened);
+				REQUIRE_FALSE(a[0].closed);
+
+				REQUIRE(b.size() == 1);
+				REQUIRE(b[0].offset == 2048);
+				REQUIRE(b[0].len == 512);
+				REQUIRE_FALSE(b[0].opened);
+				REQUIRE(b[0].closed);
+
+				// the second transfer's burst reopens it at offset 4096
+				REQUIRE(c.size() == 1);
+				REQUIRE(c[0].offset == 4096);
+				REQUIRE(c[0].opened);
+			}
+		}
+
+		WHEN("the burst ends exactly at the transfer boundary") {
+			const std::vector<uint8_t> quiet = burst_transfer(2048, 0, 0);
+			squelch.Process(first.data(), (uint32_t) first.size());
+			const std::vector<squelch_segment_t> b = squelch.Process(quiet.data(), (uint32_t) quiet.size());
+
+			THEN("the close is a bare edge at the start of the next transfer") {
+				REQUIRE(b.size() == 1);
+				REQUIRE(b[0].len == 0);
+				REQUIRE(b[0].offset == 2048);
+				REQUIRE(b[0].closed);
+			}
+		}
+	}
+
+	GIVEN("a signal between the open and close levels") {
+		// 204/51 alternating at I with Q at 127 gives (153^2 + 1) / 255^2, about -4.4 dBFS; with the level at -2
+		// and 3 dB of hysteresis it cannot open the squelch, but keeps it open once a burst has opened it
+		opts.level = -2;
+		EnergySquelch squelch(opts);
+
+		std::vector<uint8_t> buf = burst_transfer(1024, 0, 256);
+		for(size_t n = 256; n < 1024; n++) {
+			buf[2 * n] = n % 2 ? 204 : 51;
+			buf[2 * n + 1] = 127;
+		}
+
+		THEN("the squelch holds open after the burst") {
+			const std::vector<squelch_segment_t> segments = squelch.Process(buf.data(), (uint32_t) buf.size());
+			REQUIRE(segments.size() == 1);
+			REQUIRE(segments[0].len == 2048);
+			REQUIRE_FALSE(segments[0].closed);
+			REQUIRE(squelch.Open());
+		}
+
+		THEN("without the burst it stays shut") {
+			const std::vector<uint8_t> mid(buf.begin() + 512, buf.end());
+			REQUIRE(squelch.Process(mid.data(), (uint32_t) mid.size()).empty());
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/fft.h"
+
+// the largest error of plan's transform of noise against a direct DFT, relative to the largest bin
+static double fft_error(size_t size) {
+	std::vector<float> iq(2 * size);
+	srand(1234);
+	for(size_t i = 0; i < iq.size(); i++) iq[i] = (float) rand() / RAND_MAX - 0.5f;
+
+	std::vector<float> out(iq);
+	FftPlan::Get(size)->Forward(out.data());
+
+	double worst = 0, largest = 0;
+
+	for(size_t k = 0; k < size; k++) {
+		double re = 0, im = 0;
+
+		for(size_t n = 0; n < size; n++) {
+			const double angle = -2 * M_PI * (double) ((k * n) % size) / size;
+			re += iq[2 * n] * cos(angle) - iq[2 * n + 1] * sin(angle);
+			im += iq[2 * n] * sin(angle) + iq[2 * n + 1] * cos(angle);
+		}
+
+		worst = fmax(worst, hypot(out[2 * k] - re, out[2 * k + 1] - im));
+		largest = fmax(largest, hypot(re, im));
+	}
+
+	return worst / largest;
+}
+
+SCENARIO("FftPlan matches a direct DFT") {
+	GIVEN("sizes with an even and an odd number of radix-2 stages") {
+		THEN("every bin agrees to float precision") {
+			REQUIRE(fft_error(16) < 1e-5);
+			REQUIRE(fft_error(32) < 1e-5);
+			REQUIRE(fft_error(64) < 1e-5);
+			REQUIRE(fft_error(512) < 1e-5);
+			REQUIRE(fft_error(2048) < 1e-5);
+		}
+	}
+
+	GIVEN("a unit complex tone in bin 5 of 256") {
+		const size_t size = 256;
+		std::vector<float> iq(2 * size);
+
+		for(size_t n = 0; n < size; n++) {
+			iq[2 * n] = (float) cos(2 * M_PI * 5 * n / size);
+			iq[2 * n + 1] = (float) sin(2 * M_PI * 5 * n / size);
+		}
+
+		FftPlan::Get(size)->Forward(iq.data());
+
+		THEN("all of its energy is in bin 5") {
+			REQUIRE(iq[2 * 5] == Approx(size));
+			for(size_t k = 0; k < size; k++) {
+				if(k != 5) REQUIRE(hypot(iq[2 * k], iq[2 * k + 1]) < 1e-3);
+			}
+		}
+	}
+}
+
+SCENARIO("FftPlan shares one plan per size") {
+	REQUIRE(FftPlan::Get(1024) == FftPlan::Get(1024));
+	REQUIRE(FftPlan::Get(1024)->Size() == 1024);
+	REQUIRE(FftPlan::ValidSize(16));
+	REQUIRE(FftPlan::ValidSize(65536));
+	REQUIRE_FALSE(FftPlan::ValidSize(8));
+	REQUIRE_FALSE(FftPlan::ValidSize(1000));
+	REQUIRE_FALSE(FftPlan::ValidSize(131072));
+}
@@ -0,0 +1,209 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/device_backend.h"
+#include "../../lib/addon/file_device.h"
+
+static std::string temp_dir() {
+	char path[] = "/tmp/js-rtlsdr-file-device-XXXXXX";
+	REQUIRE(mkdtemp(path) != NULL);
+	return path;
+}
+
+// a recording of len bytes whose byte i holds i % 251, so any byte says where in the file it came from
+static void write_recording(const std::string & path, size_t len) {
+	std::ofstream out(path.c_str(), std::ios::binary);
+	for(size_t i = 0; i < len; i++) out.put((char) (i % 251));
+}
+
+static void write_meta(const std::string & path, const std::string & dataset) {
+	std::ofstream out(path.c_str());
+	out << "{\n"
+	       "    \"global\": {\n"
+	       "        \"core:datatype\": \"cu8\",\n"
+	       "        \"core:sample_rate\": 256000,\n"
+	       "        \"core:version\": \"1.0.0\",\n"
+	       "        \"core:dataset\": \"" << dataset << "\"\n"
+	       "    },\n"
+	       "    \"captures\": [{\"core:sample_start\": 0, \"core:frequency\": 100000000}],\n"
+	       "    \"annotations\": []\n"
+	       "}\n";
+}
+
+typedef struct replay {
+	FileDevice * dev;
+	std::vector<uint8_t> bytes;
+	std::vector<uint32_t> lens;
+	size_t limit; // cancel once this many bytes have arrived
+} replay_t;
+
+static void collect(unsigned char * buf, uint32_t len, void * ctx) {
+	replay_t * replay = (replay_t *) ctx;
+	replay->bytes.insert(replay->bytes.end(), buf, buf + len);
+	replay->lens.push_back(len);
+	if(replay->bytes.size() >= replay->limit) replay->dev->CancelAsync();
+}
+
+static bool holds_stream(const std::vector<uint8_t> & bytes, uint64_t from, uint64_t size) {
+	for(size_t i = 0; i < bytes.size(); i++) {
+		if(bytes[i] != (uint8_t) (((from + i) % size) % 251)) return false;
+	}
+
+	return true;
+}
+
+static double replay_ms(FileDevice * dev, replay_t * replay, uint32_t buf_len) {
+	const auto started = std::chrono::steady_clock::now();
+	REQUIRE(dev->ReadAsync(&collect, replay, buf_len) == 0);
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+SCENARIO("FileDevice replays a recording through the librtlsdr calls") {
+	const std::string dir = temp_dir();
+	write_recording(dir + "/rec.cu8", 5000);
+	write_meta(dir + "/rec.sigmf-meta", "rec.cu8");
+
+	file_device_options_t opts;
+	opts.speed = 0;
+
+	GIVEN("a recording with a SigMF sidecar") {
+		std::string err;
+		FileDevice * dev = FileDevice::Open(dir + "/rec.sigmf-meta", opts, &err);
+		REQUIRE(dev != NULL);
+
+		THEN("its rate, frequency, and length come from the metadata and the file") {
+			REQUIRE(dev->SampleRate() == 256000);
+			REQUIRE(dev->settings.center_freq == 100000000);
+			REQUIRE(dev->Length() == 2500);
+			REQUIRE(dev->Path() == dir + "/rec.cu8");
+		}
+
+		THEN("the backend answers for it and leaves librtlsdr alone") {
+			rtlsdr_dev_t * hnd = dev->Handle();
+			std::mutex control;
+			REQUIRE(FileDevice::Find(hnd) == dev);
+			REQUIRE(backend_get_sample_rate(hnd, control) == 256000);
+			REQUIRE(backend_set_sample_rate(hnd, control, 256000) == 0);
+			REQUIRE(backend_set_sample_rate(hnd, control, 2048000) == -EINVAL);
+			REQUIRE(backend_set_center_freq(hnd, control, 433920000) == 0);
+			REQUIRE(backend_get_center_freq(hnd, control) == 433920000);
+			REQUIRE(backend_get_tuner_type(hnd, control) == RTLSDR_TUNER_UNKNOWN);
+
+			uint8_t eeprom[8];
+			REQUIRE(backend_read_eeprom(hnd, control, eeprom, 0, 8) < 0);
+		}
+
+		WHEN("it is read unthrottled to the end") {
+			replay_t replay = {dev, {}, {}, SIZE_MAX};
+			replay_ms(dev, &replay, 1024);
+
+			THEN("every byte arrives once, in order, with a short last transfer") {
+				REQUIRE(replay.bytes.size() == 5000);
+				REQUIRE(holds_stream(replay.bytes, 0, 5000));
+				REQUIRE(replay.lens.size() == 5);
+				REQUIRE(replay.lens.back() == 904);
+				REQUIRE(dev->Position() == 2500);
+			}
+
+			THEN("a read_sync at the end is empty") {
+				uint8_t buf[512];
+				int n_read = -1;
+				REQUIRE(dev->ReadSync(buf, sizeof(buf), &n_read) == 0);
+				REQUIRE(n_read == 0);
+			}
+		}
+
+		WHEN("it seeks and reads synchronously") {
+			dev->Seek(2000);
+			std::vector<uint8_t> buf(2048);
+			int n_read = 0;
+			REQUIRE(dev->ReadSync(buf.data(), (int) buf.size(), &n_read) == 0);
+
+			THEN("the read starts at the sample and stops short at the end") {
+				REQUIRE(n_read == 1000);
+				buf.resize(1000);
+				REQUIRE(holds_stream(buf, 4000, 5000));
+			}
+		}
+
+		WHEN("it loops") {
+			dev->SetLoop(true);
+			dev->Seek(2400);
+			replay_t replay = {dev, {}, {}, 12 * 1024};
+			replay_ms(dev, &replay, 1024);
+
+			THEN("transfers stay whole and the stream wraps around the end") {
+				REQUIRE(replay.bytes.size() == 12 * 1024);
+				for(size_t i = 0; i < replay.lens.size(); i++) REQUIRE(replay.lens[i] == 1024);
+				REQUIRE(holds_stream(replay.bytes, 4800, 5000));
+				REQUIRE(dev->Position() == ((4800 + 12 * 1024) % 5000) / 2);
+			}
+		}
+
+		WHEN("it is paced in real time and then at four times that") {
+			// 2048 samples per transfer at 256 kS/s is 8 ms; 8 transfers take 64 ms in real time
+			dev->SetLoop(true);
+			dev->SetSpeed(1);
+			replay_t real_time = {dev, {}, {}, 8 * 4096};
+			const double real_time_ms = replay_ms(dev, &real_time, 4096);
+
+			dev->SetSpeed(4);
+			replay_t fast = {dev, {}, {}, 8 * 4096};
+			const double fast_ms = replay_ms(dev, &fast, 4096);
+
+			THEN("transfers arrive no sooner than hardware would deliver them") {
+				REQUIRE(real_time_ms >= 60);
+				REQUIRE(fast_ms >= 15);
+				REQUIRE(fast_ms < real_time_ms);
+			}
+		}
+
+		backend_close(dev->Handle());
+		REQUIRE(FileDevice::Find(dev->Handle()) == NULL);
+	}
+
+	GIVEN("a bare recording") {
+		WHEN("it is opened without a sample rate") {
+			std::string err;
+			write_recording(dir + "/bare.cu8", 1024);
+			FileDevice * dev = FileDevice::Open(dir + "/bare.cu8", opts, &err);
+
+			THEN("it is refused") {
+				REQUIRE(dev == NULL);
+				REQUIRE(err.find("sample rate") != std::string::npos);
+			}
+		}
+
+		WHEN("it is opened with one") {
+			std::string err;
+			write_recording(dir + "/bare.cu8", 1024);
+			opts.sample_rate = 1024000;
+			opts.center_freq = 162000000;
+			FileDevice * dev = FileDevice::Open(dir + "/bare.cu8", opts, &err);
+
+			THEN("the options describe it") {
+				REQUIRE(dev != NULL);
+				REQUIRE(dev->SampleRate() == 1024000);
+				REQUIRE(dev->settings.center_freq == 162000000);
+				delete dev;
+			}
+		}
+	}
+
+	GIVEN("a file that does not exist") {
+		std::string err;
+		opts.sample_rate = 1024000;
+		FileDevice * dev = FileDevice::Open(dir + "/missing.cu8", opts, &err);
+
+		THEN("it is refused with the reason") {
+			REQUIRE(dev == NULL);
+			REQUIRE(err.find("could not open " + dir + "/missing.cu8") == 0);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#include <cmath>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/iq_correct.h"
+
+// pairs complex samples of a tone with a DC offset and a Q branch that is gain x too strong and phase radians early
+static std::vector<float> impaired_tone(size_t pairs, float dc_i, float dc_q, float gain, float phase) {
+	std::vector<float> iq(2 * pairs);
+
+	for(size_t k = 0; k < pairs; k++) {
+		const double wt = 2 * M_PI * k / 64;
+		iq[2 * k]     = (float) (0.5 * cos(wt)) + dc_i;
+		iq[2 * k + 1] = (float) (0.5 * gain * sin(wt + phase)) + dc_q;
+	}
+
+	return iq;
+}
+
+SCENARIO("IqCorrector removes DC and balances I/Q") {
+	const size_t pairs = 4096;
+
+	GIVEN("a tone with DC offsets and a gain and phase imbalance") {
+		IqCorrector corrector(true, true);
+
+		WHEN("two transfers are corrected") {
+			std::vector<float> first = impaired_tone(pairs, 0.1f, -0.05f, 1.2f, 0.1f);
+			std::vector<float> second = first;
+			corrector.Process(first.data(), first.size());
+			corrector.Process(second.data(), second.size());
+
+			THEN("the estimates match the impairments") {
+				iq_correction_estimates_t est = corrector.Estimates();
+				REQUIRE(est.dc_i == Approx(0.1).margin(1e-4));
+				REQUIRE(est.dc_q == Approx(-0.05).margin(1e-4));
+				REQUIRE(est.gain == Approx(1.2).margin(1e-3));
+				REQUIRE(est.phase == Approx(0.1).margin(1e-3));
+				REQUIRE(est.samples == 2 * pairs);
+			}
+
+			THEN("the second transfer comes out balanced and DC-free") {
+				double sum_i = 0, sum_q = 0, ii = 0, qq = 0, iq = 0;
+				for(size_t k = 0; k < pairs; k++) {
+					const double i = second[2 * k], q = second[2 * k + 1];
+					sum_i += i; sum_q += q; ii += i * i; qq += q * q; iq += i * q;
+				}
+
+				REQUIRE(sum_i / pairs == Approx(0).margin(1e-4));
+				REQUIRE(sum_q / pairs == Approx(0).margin(1e-4));
+				REQUIRE(qq / ii == Approx(1).margin(1e-3));
+				REQUIRE(iq / ii == Approx(0).margin(1e-3));
+			}
+		}
+	}
+
+	GIVEN("a corrector that only blocks DC") {
+		IqCorrector corrector(true, false);
+		std::vector<float> iq = impaired_tone(pairs, 0.2f, 0.2f, 1.2f, 0.1f);
+		corrector.Process(iq.data(), iq.size());
+
+		THEN("the balance is left alone") {
+			iq_correction_estimates_t est = corrector.Estimates();
+			REQUIRE(est.dc_i == Approx(0.2).margin(1e-4));
+			REQUIRE(est.gain == 1);
+			REQUIRE(iq[1] == Approx(0.5 * 1.2 * sin(0.1)).margin(1e-4));
+		}
+	}
+}
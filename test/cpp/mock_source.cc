@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cmath>
+#include <set>
+#include <vector>
+#include "catch.hpp"
+#include "rtl-sdr.h"
+
+typedef struct mock_read {
+	rtlsdr_dev_t * dev;
+	std::vector<uint8_t> bytes;
+	std::set<uint8_t *> buffers;
+	uint32_t transfers;
+	uint32_t limit; // cancel after this many transfers
+} mock_read_t;
+
+static void collect(unsigned char * buf, uint32_t len, void * ctx) {
+	mock_read_t * read = (mock_read_t *) ctx;
+	read->bytes.insert(read->bytes.end(), buf, buf + len);
+	read->buffers.insert(buf);
+	if(++read->transfers == read->limit) rtlsdr_cancel_async(read->dev);
+}
+
+static double read_ms(mock_read_t * read, uint32_t buf_num, uint32_t buf_len) {
+	const auto started = std::chrono::steady_clock::now();
+	REQUIRE(rtlsdr_read_async(read->dev, &collect, read, buf_num, buf_len) == 0);
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+SCENARIO("The rtl-sdr mock synthesizes paced I/Q") {
+	rtlsdr_dev_t * dev = NULL;
+	REQUIRE(rtlsdr_open(&dev, 0) == 0);
+	rtlsdr_set_sample_rate(dev, 256000);
+	rtlsdr_reset_buffer(dev);
+	dev->mock_synthetic = true;
+
+	GIVEN("a paced source") {
+		WHEN("six 32 ms transfers are read from a pool of four") {
+			mock_read_t read = {dev, {}, {}, 0, 6};
+			const double ms = read_ms(&read, 4, 16384);
+
+			THEN("they take as long as hardware would and cycle through the pool") {
+				REQUIRE(ms >= 185);
+				REQUIRE(read.buffers.size() == 4);
+				REQUIRE(read.bytes.size() == 6 * 16384);
+			}
+		}
+	}
+
+	GIVEN("an unpaced, noiseless tone an eighth of the sample rate up") {
+		dev->mock_paced = false;
+		dev->mock_noise_amplitude = 0;
+		dev->mock_tone_offset = 32000;
+
+		WHEN("a transfer is read") {
+			mock_read_t read = {dev, {}, {}, 0, 1};
+			read_ms(&read, 1, 4096);
+
+			THEN("each sample is the tone, advanced a further 45 degrees") {
+				for(size_t n = 0; n < 2048; n++) {
+					const double phase = M_PI / 4 * n;
+					REQUIRE(std::fabs(read.bytes[2 * n] - (127.5 + 63.75 * std::cos(phase))) <= 1);
+					REQUIRE(std::fabs(read.bytes[2 * n + 1] - (127.5 + 63.75 * std::sin(phase))) <= 1);
+				}
+			}
+		}
+	}
+
+	GIVEN("an unpaced tone keyed on for a quarter of each 100 ms") {
+		dev->mock_paced = false;
+		dev->mock_noise_amplitude = 0;
+		dev->mock_burst_period_ms = 100;
+		dev->mock_burst_ms = 25;
+
+		WHEN("a second of samples is read") {
+			mock_read_t read = {dev, {}, {}, 0, 125};
+			read_ms(&read, 4, 4096);
+
+			THEN("a quarter of them carry the tone") {
+				size_t keyed = 0;
+				for(size_t i = 0; i < read.bytes.size(); i += 2) {
+					if(std::fabs(read.bytes[i] - 127.5) + std::fabs(read.bytes[i + 1] - 127.5) > 10) keyed++;
+				}
+
+				REQUIRE(keyed == read.bytes.size() / 2 / 4);
+			}
+		}
+	}
+
+	GIVEN("an unpaced source that drops every third transfer") {
+		dev->mock_paced = false;
+		dev->mock_drop_every = 3;
+
+		WHEN("ten transfers are delivered") {
+			mock_read_t read = {dev, {}, {}, 0, 10};
+			read_ms(&read, 4, 4096);
+
+			THEN("four more were lost, and their samples with them") {
+				REQUIRE(dev->mock_transfers == 14);
+				REQUIRE(dev->mock_dropped == 4);
+				REQUIRE(dev->mock_samples == 14 * 2048);
+			}
+		}
+	}
+
+	GIVEN("a source with jitter") {
+		dev->mock_jitter_us = 20000;
+
+		WHEN("eight 8 ms transfers are read") {
+			mock_read_t read = {dev, {}, {}, 0, 8};
+			const double ms = read_ms(&read, 4, 4096);
+
+			THEN("lateness does not accumulate") {
+				REQUIRE(ms >= 60);
+				REQUIRE(ms < 64 + 20 + 40);
+			}
+		}
+	}
+
+	delete dev;
+}
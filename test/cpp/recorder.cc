@@ -0,0 +1,151 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/recorder.h"
+
+static std::string temp_dir() {
+	char path[] = "/tmp/js-rtlsdr-recorder-XXXXXX";
+	REQUIRE(mkdtemp(path) != NULL);
+	return path;
+}
+
+static std::string slurp(const std::string & path) {
+	std::ifstream in(path.c_str(), std::ios::binary);
+	std::ostringstream out;
+	out << in.rdbuf();
+	return out.str();
+}
+
+// a transfer of len bytes whose byte i holds (from + i) % 251, so any byte says where in the stream it came from
+static std::vector<uint8_t> counter_transfer(uint64_t from, size_t len) {
+	std::vector<uint8_t> buf(len);
+	for(size_t i = 0; i < len; i++) buf[i] = (uint8_t) ((from + i) % 251);
+	return buf;
+}
+
+static bool holds_stream(const std::string & data, uint64_t from) {
+	for(size_t i = 0; i < data.size(); i++) {
+		if((uint8_t) data[i] != (uint8_t) ((from + i) % 251)) return false;
+	}
+
+	return true;
+}
+
+SCENARIO("Recorder writes transfers to rotating files with SigMF sidecars") {
+	recorder_options_t opts;
+	opts.path = temp_dir() + "/rec";
+	opts.block_size = 4096;
+	opts.blocks = 4;
+	opts.sample_rate = 2048000;
+	opts.center_freq = 100000000;
+	opts.hw = "RTL-SDR, tuner gain 29.7 dB";
+
+	GIVEN("a recording that rotates every 10000 bytes") {
+		opts.rotate_bytes = 10000;
+		Recorder recorder(opts);
+
+		WHEN("25000 bytes arrive in odd-sized transfers and it is closed") {
+			for(uint64_t offset = 0; offset < 25000; offset += 5000) {
+				const std::vector<uint8_t> buf = counter_transfer(offset, 5000);
+				REQUIRE(recorder.Write(buf.data(), 5000));
+			}
+
+			std::string err;
+			REQUIRE(recorder.Close(&err));
+
+			THEN("three files hold the stream in order, each with its own sidecar") {
+				const std::string first = slurp(opts.path + "-0000.cu8");
+				const std::string second = slurp(opts.path + "-0001.cu8");
+				const std::string third = slurp(opts.path + "-0002.cu8");
+
+				REQUIRE(first.size() == 10000);
+				REQUIRE(second.size() == 10000);
+				REQUIRE(third.size() == 5000);
+				REQUIRE(holds_stream(first, 0));
+				REQUIRE(holds_stream(second, 10000));
+				REQUIRE(holds_stream(third, 20000));
+
+				const std::string meta = slurp(opts.path + "-0001.sigmf-meta");
+				REQUIRE(meta.find("\"core:datatype\": \"cu8\"") != std::string::npos);
+				REQUIRE(meta.find("\"core:sample_rate\": 2048000") != std::string::npos);
+				REQUIRE(meta.find("\"core:dataset\": \"rec-0001.cu8\"") != std::string::npos);
+				REQUIRE(meta.find("\"core:global_index\": 5000") != std::string::npos);
+				REQUIRE(meta.find("\"core:frequency\": 100000000") != std::string::npos);
+				REQUIRE(meta.find("tuner gain 29.7 dB") != std::string::npos);
+			}
+
+			THEN("the statistics count every byte and write") {
+				recorder_stats_t stats;
+				recorder.Stats(&stats);
+
+				REQUIRE(stats.bytes_written == 25000);
+				REQUIRE(stats.bytes_dropped == 0);
+				REQUIRE(stats.files == 3);
+				REQUIRE(stats.file.empty());
+				REQUIRE(stats.backlog == 0);
+				REQUIRE(stats.backlog_max >= 1);
+				REQUIRE(stats.backlog_max <= 4);
+				// per file: two full blocks and a short one, or one full and one short
+				REQUIRE(stats.writes == 8);
+			}
+		}
+	}
+
+	GIVEN("a recording that does not rotate") {
+		Recorder recorder(opts);
+
+		WHEN("a short transfer is written and it is closed") {
+			const std::vector<uint8_t> buf = counter_transfer(0, 1000);
+			REQUIRE(recorder.Write(buf.data(), 1000));
+
+			std::string err;
+			REQUIRE(recorder.Close(&err));
+
+			THEN("one unnumbered file holds it") {
+				REQUIRE(slurp(opts.path + ".cu8").size() == 1000);
+				REQUIRE(slurp(opts.path + ".sigmf-meta").find("\"core:dataset\": \"rec.cu8\"") != std::string::npos);
+			}
+		}
+	}
+
+	GIVEN("a recording into a directory that does not exist") {
+		opts.path = "/nonexistent-js-rtlsdr-dir/rec";
+		Recorder recorder(opts);
+
+		WHEN("blocks are written") {
+			const std::vector<uint8_t> buf = counter_transfer(0, 4096);
+			bool ok = true;
+			for(int i = 0; i < 64 && ok; i++) ok = recorder.Write(buf.data(), 4096);
+
+			std::string err;
+			const bool closed = recorder.Close(&err);
+
+			THEN("writes start failing and Close reports why") {
+				REQUIRE_FALSE(ok);
+				REQUIRE_FALSE(closed);
+				REQUIRE(err.find("could not open /nonexistent-js-rtlsdr-dir/rec.cu8") == 0);
+			}
+		}
+	}
+
+	GIVEN("a released recording under a drop policy") {
+		opts.overflow = OVERFLOW_DROP_NEWEST;
+		Recorder recorder(opts);
+
+		WHEN("a transfer arrives after the release") {
+			recorder.Release();
+			const std::vector<uint8_t> buf = counter_transfer(0, 5000);
+			REQUIRE(recorder.Write(buf.data(), 5000));
+
+			THEN("it is counted as dropped") {
+				recorder_stats_t stats;
+				recorder.Stats(&stats);
+				REQUIRE(stats.bytes_dropped == 5000);
+			}
+		}
+	}
+}
@@ -0,0 +1,107 @@
+#include <cmath>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/resampler.h"
+
+// feed a complex tone through resampler in transfer-sized chunks; returns the mean output magnitude over the
+// second half of the output, and the total number of output pairs in *pairs_out
+static double tone_magnitude(Resampler & resampler, double input_rate, double freq, size_t * pairs_out) {
+	const size_t chunk = 8192, chunks = 24;
+	std::vector<float> iq(2 * chunk), out;
+	size_t n = 0;
+
+	for(size_t c = 0; c < chunks; c++) {
+		for(size_t k = 0; k < chunk; k++, n++) {
+			const double wt = 2 * M_PI * freq * n / input_rate;
+			iq[2 * k] = (float) (0.5 * cos(wt));
+			iq[2 * k + 1] = (float) (0.5 * sin(wt));
+		}
+
+		const size_t len = resampler.Process(iq.data(), iq.size());
+		REQUIRE(len <= resampler.MaxOutput(iq.size()));
+		out.insert(out.end(), iq.begin(), iq.begin() + len);
+	}
+
+	*pairs_out = out.size() / 2;
+
+	double sum = 0;
+	const size_t from = *pairs_out / 2;
+	for(size_t k = from; k < *pairs_out; k++) sum += hypot(out[2 * k], out[2 * k + 1]);
+	return sum / (*pairs_out - from);
+}
+
+SCENARIO("Resampler plans a CIC, half-band, and polyphase cascade") {
+	GIVEN("2.4 MS/s to 48 kS/s") {
+		Resampler resampler(2400000, 48000);
+
+		THEN("it decimates by 6 * 2 * 2 * 25 / 12") {
+			REQUIRE(resampler.CicFactor() == 6);
+			REQUIRE(resampler.HalfBands() == 2);
+			REQUIRE(resampler.Interpolation() == 12);
+			REQUIRE(resampler.Decimation() == 25);
+			REQUIRE(resampler.OutputRate() == Approx(48000));
+		}
+	}
+
+	GIVEN("2.048 MS/s to 256 kS/s") {
+		Resampler resampler(2048000, 256000);
+
+		THEN("it needs no CIC, and the polyphase stage decimates by 2") {
+			REQUIRE(resampler.CicFactor() == 1);
+			REQUIRE(resampler.HalfBands() == 2);
+			REQUIRE(resampler.Interpolation() == 1);
+			REQUIRE(resampler.Decimation() == 2);
+		}
+	}
+
+	GIVEN("a ratio that is not a small fraction") {
+		Resampler resampler(2400000, 44101);
+
+		THEN("the output rate is approximated closely") {
+			REQUIRE(resampler.Decimation() <= RESAMPLER_MAX_PHASES);
+			REQUIRE(resampler.OutputRate() == Approx(44101).epsilon(1e-5));
+		}
+	}
+}
+
+SCENARIO("Resampler passes in-band signals and rejects the rest") {
+	const double input_rate = 2400000;
+	size_t pairs;
+
+	GIVEN("a 5 kHz tone resampled to 48 kS/s") {
+		Resampler resampler(2400000, 48000);
+		const double magnitude = tone_magnitude(resampler, input_rate, 5000, &pairs);
+
+		THEN("it keeps its amplitude, at the output rate") {
+			REQUIRE(magnitude == Approx(0.5).epsilon(0.02));
+			REQUIRE(pairs == Approx(24 * 8192 / 50.0).margin(8));
+		}
+	}
+
+	GIVEN("a 100 kHz tone resampled to 48 kS/s") {
+		Resampler resampler(2400000, 48000);
+		const double magnitude = tone_magnitude(resampler, input_rate, 100000, &pairs);
+
+		THEN("it is attenuated by at least 60 dB") {
+			REQUIRE(magnitude < 0.0005);
+		}
+	}
+
+	GIVEN("a 30 kHz tone resampled to 48 kS/s, just outside the output band") {
+		Resampler resampler(2400000, 48000);
+		const double magnitude = tone_magnitude(resampler, input_rate, 30000, &pairs);
+
+		THEN("it does not alias back in") {
+			REQUIRE(magnitude < 0.0005);
+		}
+	}
+
+	GIVEN("a 40 kHz tone decimated by 8") {
+		Resampler resampler(2400000, 300000);
+		const double magnitude = tone_magnitude(resampler, input_rate, 40000, &pairs);
+
+		THEN("it keeps its amplitude") {
+			REQUIRE(magnitude == Approx(0.5).epsilon(0.02));
+		}
+	}
+}
@@ -0,0 +1,254 @@
+#include <chrono>
+#include <thread>
+#include "catch.hpp"
+#include "../../lib/addon/sample_queue.h"
+
+SCENARIO("SampleQueue delivers and drops transfers per its overflow policy") {
+	uint8_t bufs[4][4] = {{0, 0, 0, 0}, {1, 1, 1, 1}, {2, 2, 2, 2}, {3, 3, 3, 3}};
+	BufferPool * pool = BufferPool::Create(4, 8);
+	sample_block_t out;
+
+	GIVEN("a queue of depth 2 that drops the oldest transfer") {
+		SampleQueue queue(2, OVERFLOW_DROP_OLDEST, pool);
+
+		WHEN("three transfers are pushed") {
+			REQUIRE(queue.Push(bufs[0], 4));
+			REQUIRE(queue.Push(bufs[1], 4));
+			REQUIRE(queue.Push(bufs[2], 4));
+
+			THEN("the first is dropped and the rest come out in order") {
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.data[0] == 1);
+				queue.Discard(out);
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.data[0] == 2);
+				queue.Discard(out);
+				REQUIRE(!queue.Pop(out));
+
+				sample_queue_counts_t counts = queue.Counts();
+				REQUIRE(counts.transfers == 3);
+				REQUIRE(counts.dropped == 1);
+				REQUIRE(counts.depth_max == 2);
+			}
+		}
+	}
+
+	GIVEN("a queue of depth 2 that drops the newest transfer") {
+		SampleQueue queue(2, OVERFLOW_DROP_NEWEST, pool);
+
+		WHEN("three transfers are pushed") {
+			REQUIRE(queue.Push(bufs[0], 4));
+			REQUIRE(queue.Push(bufs[1], 4));
+			REQUIRE(!queue.Push(bufs[2], 4));
+
+			THEN("the last is dropped") {
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.data[0] == 0);
+				queue.Discard(out);
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.data[0] == 1);
+				queue.Discard(out);
+				REQUIRE(queue.Counts().dropped == 1);
+			}
+		}
+	}
+
+	GIVEN("a queue of depth 1 that blocks") {
+		SampleQueue queue(1, OVERFLOW_BLOCK, pool);
+
+		WHEN("a producer pushes more transfers than fit") {
+			std::thread producer([&]() {
+				for(int i = 0; i < 4; i++) queue.Push(bufs[i], 4);
+			});
+
+			THEN("nothing is dropped and every transfer arrives in order") {
+				for(int i = 0; i < 4; i++) {
+					while(!queue.Pop(out)) std::this_thread::yield();
+					REQUIRE(out.data[0] == i);
+					queue.Discard(out);
+				}
+
+				producer.join();
+				REQUIRE(queue.Counts().dropped == 0);
+			}
+		}
+
+		WHEN("the queue is closed while a producer is blocked") {
+			queue.Push(bufs[0], 4);
+			std::thread producer([&]() { queue.Push(bufs[1], 4); });
+			queue.Close();
+
+			THEN("the producer is released and its transfer is discarded") {
+				producer.join();
+				REQUIRE(queue.Counts().dropped == 0);
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.data[0] == 0);
+				queue.Discard(out);
+				REQUIRE(!queue.Pop(out));
+			}
+		}
+	}
+
+	GIVEN("a transfer larger than a pool slab") {
+		uint8_t big[16] = {7};
+
+		THEN("it is copied to the heap instead") {
+			SampleQueue queue(2, OVERFLOW_DROP_NEWEST, pool);
+			REQUIRE(queue.Push(big, 16));
+			REQUIRE(queue.Pop(out));
+			REQUIRE(!out.pooled);
+			REQUIRE(out.len == 16);
+			REQUIRE(out.data[0] == 7);
+			REQUIRE(queue.Counts().unpooled == 1);
+			queue.Discard(out);
+		}
+	}
+
+	pool->Orphan();
+}
+
+SCENARIO("SampleQueue converts transfers to its sample format") {
+	uint8_t buf[4] = {0, 255, 0, 255};
+	BufferPool * pool = BufferPool::Create(16, 2);
+	sample_block_t out;
+
+	GIVEN("a float32 queue") {
+		SampleQueue queue(2, OVERFLOW_BLOCK, pool, SAMPLE_FORMAT_FLOAT32);
+
+		WHEN("a transfer is pushed") {
+			REQUIRE(queue.Push(buf, 4));
+
+			THEN("the block holds four floats in a pool slab") {
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.pooled);
+				REQUIRE(out.len == 16);
+				REQUIRE(((float *) out.data)[0] == Approx(-1.0));
+				REQUIRE(((float *) out.data)[3] == Approx(1.0));
+				queue.Discard(out);
+			}
+		}
+	}
+
+	pool->Orphan();
+}
+
+SCENARIO("SampleQueue carries squelch edges") {
+	uint8_t buf[4] = {1, 2, 3, 4};
+	BufferPool * pool = BufferPool::Create(4, 4);
+	sample_block_t out;
+
+	GIVEN("a queue of depth 2 that drops the newest transfer") {
+		SampleQueue queue(2, OVERFLOW_DROP_NEWEST, pool);
+
+		WHEN("a tagged segment and a bare edge are pushed, then one more") {
+			REQUIRE(queue.Push(buf, 4, 1000, SAMPLE_BLOCK_OPENED));
+			REQUIRE(queue.PushEdges(1002, SAMPLE_BLOCK_CLOSED));
+			REQUIRE_FALSE(queue.PushEdges(1004, SAMPLE_BLOCK_OPENED));
+
+			THEN("the segment keeps its offset and edges, and the edge has no storage") {
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.offset == 1000);
+				REQUIRE(out.edges == SAMPLE_BLOCK_OPENED);
+				REQUIRE(out.data[3] == 4);
+				queue.Discard(out);
+
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.offset == 1002);
+				REQUIRE(out.edges == SAMPLE_BLOCK_CLOSED);
+				REQUIRE(out.data == NULL);
+				REQUIRE(out.len == 0);
+				queue.Discard(out);
+
+				REQUIRE(queue.Counts().dropped == 1);
+				REQUIRE(queue.Counts().unpooled == 0);
+			}
+		}
+	}
+
+	pool->Orphan();
+}
+
+SCENARIO("SampleQueue hands shared slabs between threads") {
+	BufferPool * shared = BufferPool::Create(4, 4);
+	BufferPool * pool = BufferPool::Create(4, 4);
+	sample_block_t tags, out;
+	tags.offset = 500;
+	tags.arrival_ns = 1234;
+	tags.wall_ns = 5678;
+
+	GIVEN("a queue of depth 1 that drops the oldest transfer") {
+		SampleQueue queue(1, OVERFLOW_DROP_OLDEST, pool);
+
+		WHEN("two shared slabs are pushed") {
+			uint8_t * a = shared->Acquire();
+			uint8_t * b = shared->Acquire();
+			a[0] = 1;
+			b[0] = 2;
+			shared->Share(a, 1);
+			shared->Share(b, 1);
+
+			REQUIRE(queue.PushShared(a, 4, shared, tags));
+			REQUIRE(queue.PushShared(b, 4, shared, tags));
+
+			THEN("the dropped one goes back to its pool, and the other keeps its tags without a copy") {
+				REQUIRE(shared->FreeCount() == 3);
+
+				REQUIRE(queue.Pop(out));
+				REQUIRE(out.data == b);
+				REQUIRE(out.shared == shared);
+				REQUIRE(out.offset == 500);
+				REQUIRE(out.arrival_ns == 1234);
+				REQUIRE(out.wall_ns == 5678);
+				queue.Discard(out);
+
+				REQUIRE(shared->FreeCount() == 4);
+				REQUIRE(pool->FreeCount() == 4);
+				REQUIRE(queue.Counts().dropped == 1);
+			}
+		}
+
+		WHEN("a transfer is lost before it reaches the queue") {
+			queue.Skip();
+
+			THEN("it counts as offered and dropped") {
+				sample_queue_counts_t counts = queue.Counts();
+				REQUIRE(counts.transfers == 1);
+				REQUIRE(counts.dropped == 1);
+			}
+		}
+
+		WHEN("a consumer waits while a producer pushes and then closes the queue") {
+			uint8_t * a = shared->Acquire();
+			a[0] = 7;
+			shared->Share(a, 1);
+
+			uint8_t first = 0;
+			bool got = false, more = true;
+			std::thread consumer([&]() {
+				sample_block_t block;
+				got = queue.Wait(block);
+				if(got) {
+					first = block.data[0];
+					queue.Discard(block);
+				}
+
+				more = queue.Wait(block);
+			});
+
+			REQUIRE(queue.PushShared(a, 4, shared, tags));
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			queue.Close();
+			consumer.join();
+
+			THEN("it takes the block, then stops") {
+				REQUIRE(got);
+				REQUIRE(first == 7);
+				REQUIRE(!more);
+				REQUIRE(shared->FreeCount() == 4);
+			}
+		}
+	}
+
+	shared->Orphan();
+	pool->Orphan();
+}
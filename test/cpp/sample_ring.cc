@@ -0,0 +1,136 @@
+#include <cstring>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/sample_ring.h"
+
+// what lib/api/ring.js does: take the record at the read counter, skipping padding, and release it
+typedef struct ring_record {
+	int32_t  len;
+	double   index;
+	uint8_t  first;
+} ring_record_t;
+
+static bool take(uint8_t * memory, ring_record_t * out) {
+	int32_t * header = (int32_t *) memory;
+	const uint32_t capacity = (uint32_t) header[SAMPLE_RING_CAPACITY];
+	uint32_t read = (uint32_t) header[SAMPLE_RING_READ];
+
+	if(read == (uint32_t) header[SAMPLE_RING_WRITE]) return false;
+
+	uint8_t * record = memory + SAMPLE_RING_HEADER_BYTES + (read & (capacity - 1));
+	if(*(int32_t *) record == SAMPLE_RING_PADDING) {
+		read += capacity - (read & (capacity - 1));
+		record = memory + SAMPLE_RING_HEADER_BYTES;
+	}
+
+	out->len = *(int32_t *) record;
+	memcpy(&out->index, record + 8, sizeof(double));
+	out->first = record[SAMPLE_RING_RECORD_BYTES];
+
+	const uint32_t payload = (uint32_t) out->len;
+	read += SAMPLE_RING_RECORD_BYTES + (payload + SAMPLE_RING_RECORD_BYTES - 1) / SAMPLE_RING_RECORD_BYTES
+	                                   * SAMPLE_RING_RECORD_BYTES;
+	header[SAMPLE_RING_READ] = (int32_t) read;
+	return true;
+}
+
+SCENARIO("SampleRing hands records to a consumer without either waiting") {
+	std::vector<uint64_t> storage((SAMPLE_RING_HEADER_BYTES + 4096) / sizeof(uint64_t), ~0ULL);
+	uint8_t * memory = (uint8_t *) storage.data();
+	int32_t * header = (int32_t *) memory;
+
+	std::vector<uint8_t> transfer(1000);
+	ring_record_t record;
+
+	GIVEN("a ring with 4 KiB of records") {
+		const size_t size = storage.size() * sizeof(uint64_t);
+		REQUIRE(SampleRing::Fits(size, SampleRing::RecordBytes(1000, SAMPLE_FORMAT_UINT8)));
+		SampleRing ring(memory, size, SAMPLE_FORMAT_UINT8);
+
+		THEN("the header describes an empty, running ring") {
+			REQUIRE(header[SAMPLE_RING_WRITE] == 0);
+			REQUIRE(header[SAMPLE_RING_READ] == 0);
+			REQUIRE(header[SAMPLE_RING_STATE] == SAMPLE_RING_STATE_RUNNING);
+			REQUIRE(header[SAMPLE_RING_FORMAT] == SAMPLE_FORMAT_UINT8);
+			REQUIRE(header[SAMPLE_RING_CAPACITY] == 4096);
+			REQUIRE(!take(memory, &record));
+		}
+
+		WHEN("three transfers are written") {
+			for(int i = 0; i < 3; i++) {
+				memset(transfer.data(), i + 1, transfer.size());
+				REQUIRE(ring.Write(transfer.data(), (uint32_t) transfer.size(), 500 * i, 0, 0));
+			}
+
+			THEN("they come out in order, each with its first sample's index") {
+				for(int i = 0; i < 3; i++) {
+					REQUIRE(take(memory, &record));
+					REQUIRE(record.len == 1000);
+					REQUIRE(record.index == 500 * i);
+					REQUIRE(record.first == i + 1);
+				}
+
+				REQUIRE(!take(memory, &record));
+			}
+
+			AND_WHEN("a fourth does not fit before the end or after the unread records") {
+				REQUIRE(!ring.Write(transfer.data(), (uint32_t) transfer.size(), 1500, 0, 0));
+
+				THEN("it is dropped and counted") {
+					REQUIRE(ring.Dropped() == 1);
+					REQUIRE(header[SAMPLE_RING_DROPPED] == 1);
+				}
+
+				AND_WHEN("the consumer releases a record and a fifth is written") {
+					REQUIRE(take(memory, &record));
+					memset(transfer.data(), 5, transfer.size());
+					REQUIRE(ring.Write(transfer.data(), (uint32_t) transfer.size(), 2000, 0, 0));
+
+					THEN("it wraps to the start behind a padding record") {
+						REQUIRE(take(memory, &record));
+						REQUIRE(take(memory, &record));
+						REQUIRE(take(memory, &record));
+						REQUIRE(record.index == 2000);
+						REQUIRE(record.first == 5);
+						REQUIRE(!take(memory, &record));
+					}
+				}
+			}
+		}
+
+		WHEN("the producer finishes") {
+			ring.Finish(false);
+
+			THEN("the state says so") {
+				REQUIRE(header[SAMPLE_RING_STATE] == SAMPLE_RING_STATE_DONE);
+			}
+		}
+	}
+
+	GIVEN("a ring of int16 samples") {
+		SampleRing ring(memory, storage.size() * sizeof(uint64_t), SAMPLE_FORMAT_INT16);
+
+		WHEN("a transfer is written") {
+			memset(transfer.data(), 255, transfer.size());
+			REQUIRE(ring.Write(transfer.data(), 100, 0, 0, 0));
+
+			THEN("its payload is converted") {
+				REQUIRE(take(memory, &record));
+				REQUIRE(record.len == 200);
+
+				int16_t first;
+				memcpy(&first, memory + SAMPLE_RING_HEADER_BYTES + SAMPLE_RING_RECORD_BYTES, sizeof(first));
+				REQUIRE(first == 255 * 256 - 32640);
+			}
+		}
+	}
+
+	GIVEN("sizes that do not make a ring") {
+		THEN("Fits refuses them") {
+			REQUIRE(!SampleRing::Fits(SAMPLE_RING_HEADER_BYTES + 3000, 32));
+			REQUIRE(!SampleRing::Fits(SAMPLE_RING_HEADER_BYTES + 2048, 32));
+			REQUIRE(!SampleRing::Fits(SAMPLE_RING_HEADER_BYTES + 4096, 4096));
+			REQUIRE(SampleRing::Fits(SAMPLE_RING_HEADER_BYTES + 8192, 4096));
+		}
+	}
+}
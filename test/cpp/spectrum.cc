@@ -0,0 +1,76 @@
+#include <cmath>
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/spectrum.h"
+
+// a full-scale complex tone of freq cycles per sample
+static std::vector<float> tone(double freq, size_t pairs) {
+	std::vector<float> iq(2 * pairs);
+
+	for(size_t n = 0; n < pairs; n++) {
+		iq[2 * n] = (float) cos(2 * M_PI * freq * n);
+		iq[2 * n + 1] = (float) sin(2 * M_PI * freq * n);
+	}
+
+	return iq;
+}
+
+SCENARIO("SpectrumAnalyzer averages windowed power spectra into dB rows") {
+	GIVEN("a 256-bin analyzer averaging 4 frames with a Blackman-Harris window") {
+		SpectrumAnalyzer spectrum(256, SPECTRUM_WINDOW_BLACKMAN_HARRIS, 0, 4);
+
+		WHEN("it is fed a full-scale tone 32 bins below DC") {
+			const std::vector<float> iq = tone(-32.0 / 256, 1024);
+			const size_t rows = spectrum.Process(iq.data(), iq.size());
+
+			THEN("one row is made, peaking at 0 dB in the tone's bin") {
+				REQUIRE(rows == 1);
+
+				const float * row = spectrum.Row(0);
+				REQUIRE(row[128 - 32] == Approx(0).margin(0.01));
+				REQUIRE(row[128] < -90);
+				REQUIRE(row[128 + 32] < -90);
+			}
+		}
+
+		WHEN("it is fed less than a row at a time") {
+			const std::vector<float> iq = tone(0, 300);
+			size_t rows = 0;
+			for(int i = 0; i < 7; i++) rows += spectrum.Process(iq.data(), iq.size());
+
+			THEN("frames span calls") {
+				// 2100 samples make 8 frames
+				REQUIRE(rows == 2);
+				REQUIRE(spectrum.Row(0)[128] == Approx(0).margin(0.01));
+			}
+		}
+	}
+
+	GIVEN("a 64-bin analyzer with 75% overlap") {
+		SpectrumAnalyzer spectrum(64, SPECTRUM_WINDOW_HANN, 0.75, 1);
+
+		THEN("frames start every 16 samples") {
+			REQUIRE(spectrum.Hop() == 16);
+
+			const std::vector<float> iq = tone(0.25, 64 + 16 * 9);
+			const size_t rows = spectrum.Process(iq.data(), iq.size());
+			REQUIRE(rows == 10);
+			REQUIRE(rows <= spectrum.MaxRows(iq.size()));
+			REQUIRE(spectrum.Row(9)[32 + 16] == Approx(0).margin(0.01));
+		}
+	}
+}
+
+SCENARIO("Spectrum windows are named") {
+	spectrum_window_t window;
+
+	REQUIRE(parse_spectrum_window("blackman-harris", &window));
+	REQUIRE(window == SPECTRUM_WINDOW_BLACKMAN_HARRIS);
+	REQUIRE(std::string(spectrum_window_name(window)) == "blackman-harris");
+	REQUIRE_FALSE(parse_spectrum_window("kaiser", &window));
+
+	const std::vector<float> hann = spectrum_window_coefficients(SPECTRUM_WINDOW_HANN, 8);
+	REQUIRE(hann[0] == Approx(0).margin(1e-6));
+	REQUIRE(hann[4] == Approx(1));
+	REQUIRE(hann[2] == Approx(hann[6]));
+}
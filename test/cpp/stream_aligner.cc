@@ -0,0 +1,119 @@
+#include <vector>
+#include "catch.hpp"
+#include "../../lib/addon/stream_aligner.h"
+
+// count complex samples from first, each sample's I and Q both holding its number
+static std::vector<uint8_t> ramp(uint8_t first, uint32_t samples) {
+	std::vector<uint8_t> buf(2 * samples);
+	for(uint32_t n = 0; n < samples; n++) buf[2 * n] = buf[2 * n + 1] = (uint8_t) (first + n);
+	return buf;
+}
+
+SCENARIO("StreamAligner cuts several streams into matched blocks") {
+	stream_aligner_options_t opts;
+	opts.block = 4;
+	opts.rate = 1e6; // a complex sample per microsecond
+
+	std::vector<uint8_t> out(2 * 2 * 4);
+	uint64_t index = 99;
+
+	GIVEN("two streams aligned by index, the second offset by 2 samples") {
+		opts.by_time = false;
+		opts.offsets = {0, 2};
+		StreamAligner aligner(2, opts);
+
+		WHEN("the first has 8 samples and the second 10") {
+			std::vector<uint8_t> first = ramp(0, 8), second = ramp(0, 10);
+			REQUIRE(aligner.Push(0, first.data(), (uint32_t) first.size(), 0));
+			REQUIRE(aligner.Push(1, second.data(), (uint32_t) second.size(), 0));
+
+			THEN("two blocks come out, each stream's from its own lead on") {
+				REQUIRE(aligner.Aligned());
+				REQUIRE(aligner.Lead(0) == 0);
+				REQUIRE(aligner.Lead(1) == 2);
+
+				REQUIRE(aligner.Pop(out.data(), &index));
+				REQUIRE(index == 0);
+				REQUIRE(out[0] == 0);
+				REQUIRE(out[6] == 3);
+				REQUIRE(out[8] == 2);
+				REQUIRE(out[14] == 5);
+
+				REQUIRE(aligner.Pop(out.data(), &index));
+				REQUIRE(index == 4);
+				REQUIRE(out[0] == 4);
+				REQUIRE(out[8] == 6);
+
+				REQUIRE(!aligner.Pop(out.data(), &index));
+			}
+		}
+
+		WHEN("only one stream has delivered") {
+			std::vector<uint8_t> first = ramp(0, 8);
+			REQUIRE(aligner.Push(0, first.data(), (uint32_t) first.size(), 0));
+
+			THEN("nothing comes out") {
+				REQUIRE(!aligner.Pop(out.data(), &index));
+			}
+		}
+	}
+
+	GIVEN("two streams aligned by time") {
+		StreamAligner aligner(2, opts);
+
+		WHEN("the second's first 8-sample transfer arrives 3 us after the first's") {
+			std::vector<uint8_t> first = ramp(0, 8), second = ramp(100, 8);
+			REQUIRE(aligner.Push(0, first.data(), (uint32_t) first.size(), 100000));
+			REQUIRE(!aligner.Aligned());
+			REQUIRE(aligner.Push(1, second.data(), (uint32_t) second.size(), 103000));
+
+			THEN("the first skips the 3 samples it took before the second started") {
+				REQUIRE(aligner.Aligned());
+				REQUIRE(aligner.Lead(0) == 3);
+				REQUIRE(aligner.Lead(1) == 0);
+
+				REQUIRE(aligner.Pop(out.data(), &index));
+				REQUIRE(index == 0);
+				REQUIRE(out[0] == 3);
+				REQUIRE(out[8] == 100);
+				REQUIRE(!aligner.Pop(out.data(), &index));
+
+				AND_WHEN("both continue") {
+					std::vector<uint8_t> more_first = ramp(8, 8), more_second = ramp(108, 8);
+					REQUIRE(aligner.Push(0, more_first.data(), (uint32_t) more_first.size(), 108000));
+					REQUIRE(aligner.Push(1, more_second.data(), (uint32_t) more_second.size(), 111000));
+
+					THEN("the streams stay in step across transfers") {
+						REQUIRE(aligner.Pop(out.data(), &index));
+						REQUIRE(index == 4);
+						REQUIRE(out[0] == 7);
+						REQUIRE(out[8] == 104);
+
+						REQUIRE(aligner.Pop(out.data(), &index));
+						REQUIRE(index == 8);
+						REQUIRE(out[0] == 11);
+						REQUIRE(out[8] == 108);
+					}
+				}
+			}
+		}
+	}
+
+	GIVEN("three streams that may each stage up to 8 samples") {
+		opts.by_time = false;
+		opts.max_backlog = 8;
+		StreamAligner aligner(3, opts);
+
+		WHEN("the first two run ahead of the third") {
+			std::vector<uint8_t> buf = ramp(0, 8);
+			REQUIRE(aligner.Push(0, buf.data(), (uint32_t) buf.size(), 0));
+			REQUIRE(aligner.Push(1, buf.data(), (uint32_t) buf.size(), 0));
+			REQUIRE(aligner.Push(2, buf.data(), 4, 0));
+			REQUIRE(!aligner.Push(0, buf.data(), (uint32_t) buf.size(), 0));
+
+			THEN("the third is blamed") {
+				REQUIRE(aligner.Lagging() == 2);
+			}
+		}
+	}
+}
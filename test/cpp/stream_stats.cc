@@ -0,0 +1,125 @@
+#include <chrono>
+#include <thread>
+#include "catch.hpp"
+#include "../../lib/addon/sample_queue.h"
+#include "../../lib/addon/stream_stats.h"
+
+SCENARIO("StreamStats buckets latencies to within a few percent") {
+	GIVEN("latencies across the histogram's range") {
+		const uint64_t values[] = {0, 1, 31, 32, 33, 63, 64, 100, 1000, 12345, 999999, (uint64_t) 1 << 39};
+
+		THEN("each lands in a bucket that holds it, no more than 1/32 wider than the value") {
+			for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+				const size_t bucket = StreamStats::Bucket(values[i]);
+				REQUIRE(bucket < STREAM_STATS_BUCKETS);
+				REQUIRE(StreamStats::BucketMax(bucket) >= values[i]);
+				REQUIRE(StreamStats::BucketMax(bucket) - values[i] <= values[i] / 32);
+				if(bucket > 0) REQUIRE(StreamStats::BucketMax(bucket - 1) < values[i]);
+			}
+		}
+
+		THEN("latencies beyond the range share the last bucket") {
+			REQUIRE(StreamStats::Bucket((uint64_t) 1 << 40) == STREAM_STATS_BUCKETS - 1);
+			REQUIRE(StreamStats::Bucket(UINT64_MAX) == STREAM_STATS_BUCKETS - 1);
+		}
+	}
+}
+
+SCENARIO("StreamStats counts a read's transfers, overflow, and deliveries") {
+	StreamStats stats;
+	stream_stats_snapshot_t snapshot;
+
+	GIVEN("a read of four 1000-byte transfers 10 ms apart") {
+		stats.Begin();
+		for(int i = 0; i < 4; i++) {
+			if(i > 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			stats.Transfer(1000);
+		}
+
+		stats.Snapshot(&snapshot);
+
+		THEN("the bytes and the rate they arrived at are counted") {
+			REQUIRE(snapshot.transfers == 4);
+			REQUIRE(snapshot.bytes == 4000);
+			REQUIRE(snapshot.rate_ms >= 30);
+			REQUIRE(snapshot.rate == Approx(1500 / (snapshot.rate_ms / 1000)));
+			REQUIRE(snapshot.rate <= 50000);
+		}
+
+		WHEN("the counters are reset") {
+			stats.Reset();
+			stats.Snapshot(&snapshot);
+
+			THEN("they start over") {
+				REQUIRE(snapshot.transfers == 0);
+				REQUIRE(snapshot.bytes == 0);
+				REQUIRE(snapshot.rate == 0);
+				REQUIRE(snapshot.latency.count == 0);
+			}
+		}
+	}
+
+	GIVEN("a queue of depth 2 that drops the oldest transfer, counting into it") {
+		BufferPool * pool = BufferPool::Create(4, 8);
+		uint8_t buf[4] = {0, 1, 2, 3};
+
+		{
+			SampleQueue queue(2, OVERFLOW_DROP_OLDEST, pool, SAMPLE_FORMAT_UINT8, &stats);
+			stats.Begin();
+
+			WHEN("three transfers are queued and drained together, 2 ms after they arrived") {
+				const int64_t wall_before = StreamStats::WallNow();
+				stats.Transfer(4);
+				for(int i = 0; i < 3; i++) queue.Push(buf, 4, 2 * i);
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+				sample_block_t block;
+				uint64_t delivered = 0;
+				while(queue.Pop(block)) {
+					REQUIRE(block.arrival_ns == stats.Arrival());
+					REQUIRE(block.wall_ns == stats.WallArrival());
+					REQUIRE(block.wall_ns >= wall_before);
+					REQUIRE(block.wall_ns <= StreamStats::WallNow());
+
+					// the oldest was dropped, leaving a gap of one transfer before the survivors
+					REQUIRE(block.offset == 2 * (delivered + 1));
+					stats.Delivered(block.arrival_ns);
+					delivered++;
+					queue.Discard(block);
+				}
+
+				stats.Drained(delivered);
+				stats.Snapshot(&snapshot);
+
+				THEN("the overflow, depth, coalescing, and latency are counted") {
+					REQUIRE(snapshot.dropped == 1);
+					REQUIRE(snapshot.depth_max == 2);
+					REQUIRE(snapshot.wakeups == 1);
+					REQUIRE(snapshot.delivered == 2);
+					REQUIRE(snapshot.coalesced == 1);
+					REQUIRE(snapshot.latency.count == 2);
+					REQUIRE(snapshot.latency.min_ms >= 2);
+					REQUIRE(snapshot.latency.p50_ms >= snapshot.latency.min_ms);
+					REQUIRE(snapshot.latency.p999_ms <= snapshot.latency.max_ms);
+				}
+			}
+		}
+
+		pool->Orphan();
+	}
+
+	GIVEN("a thousand deliveries of known latency") {
+		for(int i = 1; i <= 1000; i++) stats.Delivered(StreamStats::Now() - (int64_t) i * 1000000);
+		stats.Snapshot(&snapshot);
+
+		THEN("the percentiles are within the histogram's precision") {
+			REQUIRE(snapshot.latency.count == 1000);
+			REQUIRE(snapshot.latency.min_ms == Approx(1).epsilon(0.01));
+			REQUIRE(snapshot.latency.p50_ms == Approx(500).epsilon(0.04));
+			REQUIRE(snapshot.latency.p90_ms == Approx(900).epsilon(0.04));
+			REQUIRE(snapshot.latency.p99_ms == Approx(990).epsilon(0.04));
+			REQUIRE(snapshot.latency.max_ms == Approx(1000).epsilon(0.01));
+			REQUIRE(snapshot.latency.mean_ms == Approx(500.5).epsilon(0.01));
+		}
+	}
+}
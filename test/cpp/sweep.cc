@@ -0,0 +1,102 @@
+#include <cmath>
+#include <mutex>
+#include <string>
+#include "catch.hpp"
+#include "rtl-sdr.h"
+#include "../../lib/addon/sweep.h"
+
+static sweep_options_t vhf_options(void) {
+	sweep_options_t opts;
+	opts.start = 100000000;
+	opts.stop = 110000000;
+	opts.bin_width = 10000;
+	opts.dwell_ms = 10;
+	return opts;
+}
+
+SCENARIO("Sweeper plans hops across the range") {
+	GIVEN("100-110 MHz in bins of at most 10 kHz at 2.048 MS/s, cropping 25%") {
+		Sweeper sweeper(vhf_options(), 2048000);
+
+		THEN("it uses 256-point FFTs and keeps 192 bins of each") {
+			REQUIRE(sweeper.FftSize() == 256);
+			REQUIRE(sweeper.BinWidth() == Approx(8000));
+			REQUIRE(sweeper.BinsPerHop() == 192);
+			REQUIRE(sweeper.Bins() == 1250);
+			REQUIRE(sweeper.Hops() == 7);
+		}
+
+		THEN("each hop's first kept bin follows the last hop's") {
+			REQUIRE(sweeper.HopFrequency(0) == 100000000 + 96 * 8000);
+			REQUIRE(sweeper.HopFrequency(1) - sweeper.HopFrequency(0) == 192 * 8000);
+		}
+	}
+
+	GIVEN("options that cannot be planned") {
+		std::string err;
+		sweep_options_t opts = vhf_options();
+
+		THEN("Valid says why") {
+			REQUIRE(Sweeper::Valid(opts, 2048000, &err));
+
+			opts.stop = opts.start;
+			REQUIRE_FALSE(Sweeper::Valid(opts, 2048000, &err));
+
+			opts = vhf_options();
+			opts.bin_width = 10;
+			REQUIRE_FALSE(Sweeper::Valid(opts, 2048000, &err));
+			REQUIRE(err.find("binWidth") != std::string::npos);
+		}
+	}
+}
+
+SCENARIO("Sweeper stitches one row per sweep") {
+	GIVEN("a mock device, whose samples are all DC") {
+		rtlsdr_dev_t * dev;
+		rtlsdr_open(&dev, 0);
+		rtlsdr_set_sample_rate(dev, 2048000);
+		rtlsdr_reset_buffer(dev);
+
+		Sweeper sweeper(vhf_options(), 2048000);
+		std::vector<float> row(sweeper.Bins(), 1.0f);
+		std::atomic<bool> cancelled(false);
+		std::mutex control;
+		std::string err;
+
+		WHEN("it sweeps") {
+			REQUIRE(sweeper.Sweep(dev, control, cancelled, row.data(), &err) == 0);
+
+			THEN("every hop's DC bin holds the mock's level and the rest is empty") {
+				const float dc = (float) (10 * log10(2 * pow((100 - 127.5) / 127.5, 2)));
+
+				// the Hann window's main lobe spreads DC into the bins either side
+				for(size_t n = 0; n < row.size(); n++) {
+					if(n % 192 == 96) REQUIRE(row[n] == Approx(dc).margin(0.01));
+					else if(n % 192 < 95 || n % 192 > 97) REQUIRE(row[n] < -100);
+				}
+
+				REQUIRE(rtlsdr_get_center_freq(dev) == sweeper.HopFrequency(6));
+			}
+		}
+
+		WHEN("the device fails") {
+			dev->mock_return_error = -5;
+
+			THEN("the sweep stops with the error") {
+				REQUIRE(sweeper.Sweep(dev, control, cancelled, row.data(), &err) == -5);
+				REQUIRE(err.find("rtlsdr_set_center_freq") != std::string::npos);
+			}
+		}
+
+		WHEN("it is cancelled") {
+			cancelled = true;
+
+			THEN("it stops without retuning") {
+				REQUIRE(sweeper.Sweep(dev, control, cancelled, row.data(), &err) == 0);
+				REQUIRE(rtlsdr_get_center_freq(dev) == 0);
+			}
+		}
+
+		delete dev;
+	}
+}
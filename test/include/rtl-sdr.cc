@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <stdlib.h>
+#include <thread>
 #include "rtl-sdr.h"
 
 #define TEST_CHECK_DEV(dev) if(dev == NULL || !dev->open) return -1;
@@ -7,6 +10,7 @@
 #define TEST_CHECK_DEV_ZERO(dev) if(dev == NULL || !dev->open) return 0;
 #define MAYBE_RETURN_MOCK_ERR_ZERO(dev) if(dev != NULL && dev->mock_return_error != 0) return 0;
 #define DEFAULT_BUFFER_SIZE (512)
+#define DEFAULT_SAMPLE_RATE (2048000) // what the synthetic source assumes before a rate is set
 
 static uint32_t device_count = 1;
 
@@ -18,8 +22,9 @@ uint32_t rtlsdr_get_device_count(void) {
 	return device_count;
 }
 
+// librtlsdr returns static strings, which callers do not free
 const char* rtlsdr_get_device_name(uint32_t index) {
-	char * name = new char[100];
+	static char name[100];
 
 	if(index < device_count)
 		sprintf(name, "Mock RTLSDR Device #%u", index);
@@ -48,6 +53,67 @@ int rtlsdr_get_index_by_serial(const char *serial) {
 	return serial_num - 1;
 }
 
+// xorshift64*, uniform on [0, 1)
+static double mock_uniform(uint64_t * state) {
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+	return (*state * 0x2545f4914f6cdd1dULL >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint8_t mock_to_byte(double v) {
+	return (uint8_t) std::min(255.0, std::max(0.0, std::floor(127.5 + 127.5 * v + 0.5)));
+}
+
+// the synthetic source's next len / 2 samples
+static void mock_synthesize(rtlsdr_dev_t * dev, uint8_t * buf, uint32_t len) {
+	const double rate = dev->sample_rate > 0 ? dev->sample_rate : DEFAULT_SAMPLE_RATE;
+	const double step = 2 * M_PI * dev->mock_tone_offset / rate;
+	const double step_re = std::cos(step), step_im = std::sin(step);
+	const uint64_t period = (uint64_t) (dev->mock_burst_period_ms * rate / 1000);
+	const uint64_t keyed = (uint64_t) (dev->mock_burst_ms * rate / 1000);
+
+	for(uint32_t i = 0; i + 1 < len; i += 2) {
+		const uint64_t n = dev->mock_samples++;
+		const double amplitude = period == 0 || n % period < keyed ? dev->mock_tone_amplitude : 0;
+
+		// the sum of two uniforms is triangular: cheap, bounded, and close enough to Gaussian here
+		const double noise_i = mock_uniform(&dev->mock_rng) + mock_uniform(&dev->mock_rng) - 1;
+		const double noise_q = mock_uniform(&dev->mock_rng) + mock_uniform(&dev->mock_rng) - 1;
+
+		buf[i] = mock_to_byte(amplitude * dev->mock_re + dev->mock_noise_amplitude * noise_i);
+		buf[i + 1] = mock_to_byte(amplitude * dev->mock_im + dev->mock_noise_amplitude * noise_q);
+
+		const double re = dev->mock_re * step_re - dev->mock_im * step_im;
+		dev->mock_im = dev->mock_re * step_im + dev->mock_im * step_re;
+		dev->mock_re = re;
+	}
+
+	// keep the phasor on the unit circle
+	const double norm = std::sqrt(dev->mock_re * dev->mock_re + dev->mock_im * dev->mock_im);
+	dev->mock_re /= norm;
+	dev->mock_im /= norm;
+}
+
+// wait until hardware would have finished sampling the next samples, plus up to mock_jitter_us
+static void mock_pace(rtlsdr_dev_t * dev, uint32_t samples) {
+	if(!dev->mock_paced) return;
+
+	const double rate = dev->sample_rate > 0 ? dev->sample_rate : DEFAULT_SAMPLE_RATE;
+	dev->mock_paced_samples += samples;
+
+	double due = dev->mock_paced_samples / rate;
+	if(dev->mock_jitter_us > 0) due += mock_uniform(&dev->mock_rng) * dev->mock_jitter_us / 1e6;
+
+	std::this_thread::sleep_until(dev->mock_pace_start +
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(due)));
+}
+
+static void mock_restart_pacing(rtlsdr_dev_t * dev) {
+	dev->mock_pace_start = std::chrono::steady_clock::now();
+	dev->mock_paced_samples = 0;
+}
+
 int rtlsdr_open(rtlsdr_dev_t **dev, uint32_t index) {
 	if(index >= device_count) return -1;
 	if(dev == NULL) return -2;
@@ -93,6 +159,9 @@ int rtlsdr_write_eeprom(rtlsdr_dev_t *dev, uint8_t *data, uint8_t offset, uint16
 	if((len + offset) > 256) return -2;
 	if(!dev->has_eeprom) return -3;
 
+	if(dev->mock_eeprom_delay_ms > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(dev->mock_eeprom_delay_ms));
+
 	for(size_t i = 0; i < len; i++) {
 		dev->mock_eeprom[i + offset] = data[i];
 	}
@@ -106,6 +175,9 @@ int rtlsdr_read_eeprom(rtlsdr_dev_t *dev, uint8_t *data, uint8_t offset, uint16_
 	if((len + offset) > 256) return -2;
 	if(!dev->has_eeprom) return -3;
 
+	if(dev->mock_eeprom_delay_ms > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(dev->mock_eeprom_delay_ms));
+
 	sprintf((char *) data, "Mock RTLSDR read_eeprom Contents %u+%u", offset, len);
 	return 0;
 }
@@ -257,6 +329,15 @@ int rtlsdr_read_sync(rtlsdr_dev_t *dev, void *buf, int len, int *n_read) {
 	if(!dev->buffer_ready) return -8;
 
 	int to_read = len - dev->mock_sync_read_discount;
+
+	if(dev->mock_synthetic && to_read > 0) {
+		mock_restart_pacing(dev);
+		mock_synthesize(dev, (uint8_t *) buf, (uint32_t) to_read);
+		mock_pace(dev, (uint32_t) to_read / 2);
+		*n_read = to_read;
+		return 0;
+	}
+
 	for(int i = 0; i < to_read; *n_read = ++i)
 		((uint8_t *) buf)[i] = (uint8_t) 'd'; // d for data, yuk yuk
 
@@ -276,11 +357,32 @@ int rtlsdr_read_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb, void *ctx, u
 	if(buf_len == 0) buf_len = DEFAULT_BUFFER_SIZE;
 	if(buf_len % 512 != 0) return -1;
 
-	for(int i = 0; dev->buffer_ready && dev->mock_return_error == 0; i++) {
-		char * buf = new char[buf_num * buf_len];
-		for(size_t j = 0; j < buf_num * buf_len; j++) buf[j] = 'd';
-
-		(*cb)((uint8_t *) buf, buf_num * buf_len, ctx);
+	if(dev->mock_synthetic) {
+		dev->mock_pool.assign(buf_num, std::vector<uint8_t>(buf_len));
+		mock_restart_pacing(dev);
+
+		for(uint32_t i = 0; dev->buffer_ready && dev->mock_return_error == 0; i = (i + 1) % buf_num) {
+			uint8_t * buf = dev->mock_pool[i].data();
+			mock_synthesize(dev, buf, buf_len);
+			mock_pace(dev, buf_len / 2);
+
+			// a dropped transfer's samples are gone, as after a USB overrun
+			dev->mock_transfers++;
+			if(dev->mock_drop_every > 0 && dev->mock_transfers % dev->mock_drop_every == 0) {
+				dev->mock_dropped++;
+				continue;
+			}
+
+			(*cb)(buf, buf_len, ctx);
+		}
+	} else {
+		// one buffer for the whole read, refilled in case a reader scribbled on it
+		std::vector<uint8_t> buf(buf_num * buf_len);
+
+		while(dev->buffer_ready && dev->mock_return_error == 0) {
+			std::fill(buf.begin(), buf.end(), (uint8_t) 'd');
+			(*cb)(buf.data(), buf_num * buf_len, ctx);
+		}
 	}
 	MAYBE_RETURN_MOCK_ERR(dev);
 
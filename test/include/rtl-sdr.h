@@ -5,7 +5,10 @@
 
 #define JS_RTLSDR_MODULE_IS_UNDER_TEST
 
+#include <stdint.h>
+#include <chrono>
 #include <map>
+#include <vector>
 
 typedef void(*rtlsdr_read_async_cb_t)(unsigned char *buf, uint32_t len, void *ctx);
 
@@ -31,6 +34,31 @@ typedef struct rtlsdr_dev {
 	bool buffer_ready = false;
 	bool open = false;
 	bool has_eeprom = false;
+	uint32_t mock_eeprom_delay_ms = 0; // each EEPROM read or write takes this long, as a dongle's I2C access does
+
+	// The synthetic source. Off, reads fill transfers with 'd' bytes as fast as they are taken. On, they carry
+	// offset-binary I/Q like a dongle's -- a tone at mock_tone_offset Hz from the center, keyed on for mock_burst_ms
+	// of every mock_burst_period_ms (0 for a steady tone), over uniform-ish noise -- paced at sample_rate unless
+	// mock_paced is cleared. Each transfer is up to mock_jitter_us late, as USB is, without the lateness adding up;
+	// every mock_drop_every-th transfer is lost as in an overrun, its samples skipped. read_async hands out buf_len
+	// transfers from a pool of buf_num buffers allocated when the read starts, as librtlsdr does.
+	bool mock_synthetic = false;
+	bool mock_paced = true;
+	double mock_tone_offset = 0;
+	double mock_tone_amplitude = 0.5;   // of full scale
+	double mock_noise_amplitude = 0.05; // of full scale
+	uint32_t mock_burst_period_ms = 0;
+	uint32_t mock_burst_ms = 0;
+	uint32_t mock_jitter_us = 0;
+	uint32_t mock_drop_every = 0;
+	uint32_t mock_transfers = 0;        // transfers synthesized, dropped ones included
+	uint32_t mock_dropped = 0;
+	uint64_t mock_samples = 0;          // samples synthesized, which is also the index of the next
+	uint64_t mock_paced_samples = 0;    // samples released since mock_pace_start
+	std::chrono::steady_clock::time_point mock_pace_start;
+	double mock_re = 1, mock_im = 0;    // the tone's phasor
+	uint64_t mock_rng = 0x9e3779b97f4a7c15ULL;
+	std::vector<std::vector<uint8_t> > mock_pool;
 } rtlsdr_dev_t;
 
 enum rtlsdr_tuner {